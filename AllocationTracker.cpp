@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "AllocationTracker.h"
+
+#ifdef HR_TRACK_ALLOCATIONS
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+    constexpr uint32_t kWarmupSamples = 8;
+
+    std::atomic<uint64_t> g_totalAllocations{ 0 };
+    std::atomic<uint64_t> g_hotPathAllocations{ 0 };
+    std::atomic<uint32_t> g_warmupRemaining{ kWarmupSamples };
+    thread_local int t_hotPathDepth = 0;
+    thread_local bool t_enforcing = false; // Inside a scope entered after warm-up
+
+    void CountAllocation() {
+        g_totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        if (t_hotPathDepth > 0 && t_enforcing) {
+#ifdef _WIN32
+            if (g_hotPathAllocations.fetch_add(1, std::memory_order_relaxed) == 0) {
+                OutputDebugStringA("BLEHeartRateMonitor: heap allocation on the streaming path after warm-up\n");
+            }
+            if (IsDebuggerPresent()) {
+                __debugbreak(); // The stack shows who allocated
+            }
+#else
+            if (g_hotPathAllocations.fetch_add(1, std::memory_order_relaxed) == 0) {
+                std::fputs("BLEHeartRateMonitor: heap allocation on the streaming path after warm-up\n", stderr);
+            }
+#endif
+        }
+    }
+
+    void* Allocate(size_t size) {
+        CountAllocation();
+        void* block = malloc(size ? size : 1);
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+
+    void* AllocateAligned(size_t size, std::align_val_t alignment) {
+        CountAllocation();
+#ifdef _WIN32
+        void* block = _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment));
+#else
+        size_t align = static_cast<size_t>(alignment);
+        void* block = std::aligned_alloc(align, size ? (size + align - 1) / align * align : align); // Size must be a multiple
+#endif
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+}
+
+HotPathScope::HotPathScope() {
+    if (t_hotPathDepth++ == 0) {
+        uint32_t remaining = g_warmupRemaining.load(std::memory_order_relaxed);
+        while (remaining > 0 && !g_warmupRemaining.compare_exchange_weak(remaining, remaining - 1, std::memory_order_relaxed)) {
+        }
+        t_enforcing = remaining == 0;
+    }
+}
+
+HotPathScope::~HotPathScope() {
+    --t_hotPathDepth;
+}
+
+void ResetAllocationWarmup() {
+    g_warmupRemaining = kWarmupSamples;
+}
+
+bool AllocationStats(HrAllocationStats& out) {
+    out.totalAllocations = g_totalAllocations.load(std::memory_order_relaxed);
+    out.hotPathAllocations = g_hotPathAllocations.load(std::memory_order_relaxed);
+    out.enabled = 1;
+    out.reserved = 0;
+    return true;
+}
+
+// Replaceable allocation functions; the nothrow forms forward to these
+void* operator new(size_t size) {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return AllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    free(block);
+}
+
+#ifdef _WIN32
+void operator delete(void* block, std::align_val_t) noexcept {
+    _aligned_free(block);
+}
+
+void operator delete[](void* block, std::align_val_t) noexcept {
+    _aligned_free(block);
+}
+#else
+void operator delete(void* block, std::align_val_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, std::align_val_t) noexcept {
+    free(block);
+}
+#endif
+
+#endif
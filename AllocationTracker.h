@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include "BLEHeartRateMonitor.h"
+
+// --- Allocation tracking (debug aid) ---
+// Build with HR_TRACK_ALLOCATIONS defined to replace operator new for this DLL with a counting
+// version. Code between a HotPathScope's construction and destruction is the streaming path
+// (notification to delivery); once it has run kWarmupSamples times since ResetAllocationWarmup,
+// any allocation inside it is counted as a hot-path allocation and breaks into an attached
+// debugger. Without the define everything here compiles away.
+// Only C++ operator new is seen; WinRT objects handed to us by the OS (e.g. the notification's
+// IBuffer) are allocated outside this DLL. Portable: tools/allocation_test builds it on Linux to
+// hold the parse, queue and dispatch path to zero allocations.
+
+#ifdef HR_TRACK_ALLOCATIONS
+
+class HotPathScope {
+public:
+    HotPathScope();
+    ~HotPathScope();
+    HotPathScope(const HotPathScope&) = delete;
+    HotPathScope& operator=(const HotPathScope&) = delete;
+};
+
+void ResetAllocationWarmup(); // Call when a stream (re)starts; warm-up allocations are expected
+bool AllocationStats(HrAllocationStats& out);
+
+#else
+
+class HotPathScope {
+public:
+    HotPathScope() {}
+};
+
+inline void ResetAllocationWarmup() {}
+inline bool AllocationStats(HrAllocationStats& out) {
+    out = HrAllocationStats{};
+    return false;
+}
+
+#endif
@@ -2,15 +2,44 @@
 #include <windows.h>
 #include <winrt/Windows.Foundation.h>
 #include <winrt/Windows.Devices.Bluetooth.h>
+#include <winrt/Windows.Devices.Bluetooth.Advertisement.h>
 #include <winrt/Windows.Devices.Bluetooth.GenericAttributeProfile.h>
 #include <winrt/Windows.Devices.Enumeration.h>
 #include <winrt/Windows.Storage.Streams.h>
+#include <algorithm>
 #include <atomic>
+#include <cwchar>
 #include <mutex>
+#include <vector>
 #include <winrt/Windows.Foundation.Collections.h>
+#include <chrono>
+#include <memory>
+#include <combaseapi.h>
+#include "BLEHeartRateMonitor.h"
+#include "HrMeasurement.h"
+#include "LinkStats.h"
+#include "StatusEvents.h"
+#include "Executor.h"
+#include "TimerWheel.h"
+#include "HrTransport.h"
+#include "SessionEngine.h"
+#include "SharedChannel.h"
+#include "NetPublisher.h"
+#include "OscEmitter.h"
+#include "WebSocketServer.h"
+#include "SampleDispatcher.h"
+#include "LatestSamples.h"
+#include "AllocationTracker.h"
+#include "SampleQueue.h"
+#include "BatchDecoder.h"
+#include "CaptureWriter.h"
+#include "FaultInjector.h"
+#include "LoadGenerator.h"
+#include "StartupProfile.h"
 
 using namespace winrt;
 using namespace Windows::Devices::Bluetooth;
+using namespace Windows::Devices::Bluetooth::Advertisement;
 using namespace Windows::Devices::Bluetooth::GenericAttributeProfile;
 using namespace Windows::Devices::Enumeration;
 using namespace Windows::Storage::Streams;
@@ -18,178 +47,669 @@ using namespace Windows::Storage::Streams;
 
 // --- Callbacks ---
 typedef void(__stdcall* StatusCallback)(int status, const char* message);
-typedef void(__stdcall* HeartRateCallback)(int bpm);
+typedef void(__stdcall* StatusEventCallback)(const HrStatusEvent* evt);
+typedef void(__stdcall* LinkStatsCallback)(const HrLinkStats* stats);
 
 StatusCallback g_statusCallback = nullptr;
-HeartRateCallback g_hrCallback = nullptr;
+StatusEventCallback g_statusEventCallback = nullptr;
+LinkStatsCallback g_linkStatsCallback = nullptr;
 
-// --- Threading & State ---
-std::atomic<bool> g_shouldStop(false);
-std::thread g_workerThread; // Use std::thread for easier management
-std::mutex g_callbackMutex; // Protect callback pointers
-std::atomic<int> g_currentState(0); // Define states: 0=Idle, 1=Connecting, 2=Connected, 3=Error etc.
-
-// --- BLE Components (managed only by worker thread) ---
+// --- BLE Components (owned by the WinRT transport) ---
 // Keep UUIDs global or pass them around
 winrt::guid g_hrServiceUuid{ 0x0000180D, 0x0000, 0x1000, {0x80,0x00,0x00,0x80,0x5F,0x9B,0x34,0xFB} };
 winrt::guid g_hrMeasurementUuid{ 0x00002A37, 0x0000, 0x1000, {0x80,0x00,0x00,0x80,0x5F,0x9B,0x34,0xFB} };
 
+// --- Threading & State ---
+std::atomic<uint32_t> g_stopTimeoutMs(5000); // Default deadline for StopHrMonitoring
+std::mutex g_callbackMutex; // Protect callback pointers
+std::atomic<int> g_currentState(0); // Define states: 0=Idle, 1=Connecting, 2=Connected, 3=Error etc.
+LinkStats g_linkStats; // Packet loss / jitter counters for the current device
+std::atomic<uint32_t> g_statusSequence(0);
+StatusEventQueue g_statusQueue; // Recent events for PollStatusEvent
+TimerWheel::Timer g_statsFlushTimer; // Periodic LinkStatsCallback
+std::atomic<uint32_t> g_statsFlushIntervalMs(0);
+std::atomic<uint32_t> g_sampleQueueCapacity(0); // PollSamples queue size, applied at session open
+SharedChannelWriter g_sharedChannel; // Out-of-process consumers (see EnableSharedChannel)
+std::mutex g_sharedChannelMutex; // Protect g_sharedChannel against Enable/Disable
+
 // Forward declaration
-void ReportStatus(int status, const char* message);
-void ReportHeartRate(int bpm);
+void ReportStatus(HrState state, HrErrorCategory category, int32_t hresult, uint64_t deviceAddress);
+void PublishSample(const HrSample& sample);
+void EnsureRuntime();
+uint64_t WarmDeviceAddress(int64_t nowUs);
+void RememberLastStrap(uint64_t address);
+void PausePrewarm();
+void ResumePrewarm();
 
-// --- Worker Thread Function ---
-void BleWorkerLogic() {
-    // Use RAII for apartment initialization/uninitialization
-    winrt::apartment_context ui_thread; // Capture calling context if needed for marshaling back (optional)
-    init_apartment(apartment_type::multi_threaded); // Or single_threaded if needed
+// Monotonic timestamp used for arrival times
+int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    BluetoothLEDevice bleDevice = nullptr;
-    GattCharacteristic hrCharacteristic = nullptr;
-    winrt::event_token valueChangedToken{};
-    winrt::event_token connectionStatusToken{};
+// --- WinRT transport ---
+// HrTransport over Windows.Devices.Bluetooth; the session logic itself is SessionEngine.
+// Each operation runs as a WinRT coroutine holding a reference to the transport and reports
+// through done. The async call it is waiting on is tracked so Cancel can reach it. Event
+// handlers reach the listener through a relay they share, so a handler still running after
+// SetListener(nullptr), or after the transport is gone, is harmless.
 
+// Classifies the exception being handled. Call only from inside a catch block.
+HrTransportResult CurrentTransportError() {
     try {
-        ReportStatus(1, "Starting Scan..."); // Status: Scanning
-        // --- Device Discovery (using DeviceWatcher recommended for flexibility) ---
-        // Simplified FindAllAsync for now:
-        auto selector = GattDeviceService::GetDeviceSelectorFromUuid(g_hrServiceUuid);
-        auto devices = DeviceInformation::FindAllAsync(selector).get();
-        if (devices.Size() == 0) {
-            throw std::runtime_error("No HR device found.");
+        throw;
+    }
+    catch (winrt::hresult_error const& e) {
+        return { HrErrorWinRt, static_cast<int32_t>(e.code()) };
+    }
+    catch (std::exception const&) {
+        return { HrErrorStd, 0 };
+    }
+    catch (...) {
+        return { HrErrorUnknown, 0 };
+    }
+}
+
+struct ListenerRelay {
+    std::mutex mutex; // Held while calling the listener
+    HrTransportListener* listener = nullptr;
+};
+
+class WinRtTransport final : public HrTransport, public std::enable_shared_from_this<WinRtTransport> {
+public:
+    ~WinRtTransport() override {
+        try {
+            Release();
+        }
+        catch (...) {
+            // Nothing left to report to
         }
-        auto deviceInfo = devices.GetAt(0); // Still using first device here
+    }
 
-        ReportStatus(2, "Connecting..."); // Status: Connecting
-        bleDevice = BluetoothLEDevice::FromIdAsync(deviceInfo.Id()).get();
-        if (!bleDevice) {
-            throw std::runtime_error("Failed to get BluetoothLEDevice object.");
+    void SetListener(HrTransportListener* listener) override {
+        std::lock_guard<std::mutex> lock(m_relay->mutex);
+        m_relay->listener = listener;
+    }
+
+    void Scan(Completion done, void* context) override {
+        Begin();
+        ScanAsync(shared_from_this(), done, context);
+    }
+
+    void Connect(uint64_t address, Completion done, void* context) override {
+        Begin();
+        ConnectAsync(shared_from_this(), address, done, context);
+    }
+
+    uint64_t Address() const override {
+        return m_address;
+    }
+
+    void Discover(Completion done, void* context) override {
+        Begin();
+        DiscoverAsync(shared_from_this(), done, context);
+    }
+
+    void Subscribe(bool enable, Completion done, void* context) override {
+        Begin();
+        SubscribeAsync(shared_from_this(), enable, done, context);
+    }
+
+    void Disconnect(Completion done, void* context) override {
+        HrTransportResult result{ HrErrorNone, 0 };
+        try {
+            Release();
+        }
+        catch (...) {
+            result = CurrentTransportError();
         }
+        done(context, result);
+    }
 
-        // Monitor connection status
-        connectionStatusToken = bleDevice.ConnectionStatusChanged([&](BluetoothLEDevice const& device, auto const& args) {
-            if (device.ConnectionStatus() == BluetoothConnectionStatus::Disconnected) {
-                ReportStatus(5, "Device Disconnected"); // Status: Disconnected
-                // Signal stop or attempt reconnect based on desired logic
-                g_shouldStop = true; // Example: Stop on disconnect
+    void Cancel() override {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_cancelled = true; // Also stops a multi-step operation from starting its next call
+        if (m_pending) {
+            try {
+                m_pending.Cancel();
             }
-            });
+            catch (winrt::hresult_error const&) {
+                // Already completed
+            }
+        }
+    }
 
-        // Check initial connection status (FromIdAsync doesn't guarantee connection)
-        if (bleDevice.ConnectionStatus() != BluetoothConnectionStatus::Connected) {
-            // Optional: May need explicit connect call depending on device/scenario
-            // GattSession::FromDeviceIdAsync might be more robust for session management
-            ReportStatus(2, "Waiting for Connection...");
-            // Add logic to wait or fail if not connected after timeout
+private:
+    // A new operation: forget the previous one and any Cancel aimed at it
+    void Begin() {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pending = nullptr;
+        m_cancelled = false;
+    }
+
+    // Remembers the in-flight async call so Cancel can cancel it
+    template <typename Async>
+    Async Track(Async operation) {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pending = operation;
+        if (m_cancelled) {
+            operation.Cancel();
         }
+        return operation;
+    }
 
-        ReportStatus(3, "Discovering Services..."); // Status: Discovering
-        auto serviceResult = bleDevice.GetGattServicesForUuidAsync(g_hrServiceUuid).get();
-        if (serviceResult.Status() != GattCommunicationStatus::Success || serviceResult.Services().Size() == 0) {
-            throw std::runtime_error("HR Service not found.");
+    static winrt::fire_and_forget ScanAsync(std::shared_ptr<WinRtTransport> self, Completion done, void* context) {
+        HrTransportResult result{ HrErrorNone, 0 };
+        try {
+            // --- Device Discovery (using DeviceWatcher recommended for flexibility) ---
+            // Simplified FindAllAsync for now:
+            auto selector = GattDeviceService::GetDeviceSelectorFromUuid(g_hrServiceUuid);
+            auto devices = co_await self->Track(DeviceInformation::FindAllAsync(selector));
+            if (devices.Size() == 0) {
+                result = { HrErrorNoDevice, 0 };
+            }
+            else {
+                self->m_deviceId = devices.GetAt(0).Id(); // Still using first device here
+            }
         }
-        auto hrService = serviceResult.Services().GetAt(0);
+        catch (...) {
+            result = CurrentTransportError();
+        }
+        done(context, result);
+    }
 
-        auto charResult = hrService.GetCharacteristicsForUuidAsync(g_hrMeasurementUuid).get();
-        if (charResult.Status() != GattCommunicationStatus::Success || charResult.Characteristics().Size() == 0) {
-            throw std::runtime_error("HR Measurement Characteristic not found.");
+    static winrt::fire_and_forget ConnectAsync(std::shared_ptr<WinRtTransport> self, uint64_t address, Completion done, void* context) {
+        HrTransportResult result{ HrErrorNone, 0 };
+        try {
+            self->Release(); // A failed attempt may have left one behind
+            BluetoothLEDevice device{ nullptr };
+            if (address != 0) {
+                device = co_await self->Track(BluetoothLEDevice::FromBluetoothAddressAsync(address));
+            }
+            else if (!self->m_deviceId.empty()) {
+                device = co_await self->Track(BluetoothLEDevice::FromIdAsync(self->m_deviceId));
+            }
+            if (!device) {
+                result = { HrErrorDeviceUnavailable, 0 };
+            }
+            else {
+                self->AttachDevice(device);
+            }
+        }
+        catch (...) {
+            result = CurrentTransportError();
         }
-        hrCharacteristic = charResult.Characteristics().GetAt(0);
+        done(context, result);
+    }
 
-        ReportStatus(4, "Subscribing..."); // Status: Subscribing
-        auto status = hrCharacteristic.WriteClientCharacteristicConfigurationDescriptorAsync(
-            GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
-        if (status != GattCommunicationStatus::Success) {
-            throw std::runtime_error("Failed to subscribe to HR notifications.");
+    static winrt::fire_and_forget DiscoverAsync(std::shared_ptr<WinRtTransport> self, Completion done, void* context) {
+        HrTransportResult result{ HrErrorNone, 0 };
+        try {
+            // FromIdAsync doesn't guarantee a connection; discovery connects, and the engine's
+            // connect timeout fails the attempt if it never does
+            auto serviceResult = co_await self->Track(self->m_device.GetGattServicesForUuidAsync(g_hrServiceUuid));
+            if (serviceResult.Status() != GattCommunicationStatus::Success || serviceResult.Services().Size() == 0) {
+                result = { HrErrorServiceNotFound, 0 };
+            }
+            else {
+                auto hrService = serviceResult.Services().GetAt(0);
+                auto charResult = co_await self->Track(hrService.GetCharacteristicsForUuidAsync(g_hrMeasurementUuid));
+                if (charResult.Status() != GattCommunicationStatus::Success || charResult.Characteristics().Size() == 0) {
+                    result = { HrErrorCharacteristicNotFound, 0 };
+                }
+                else {
+                    self->AttachCharacteristic(charResult.Characteristics().GetAt(0));
+                }
+            }
+        }
+        catch (...) {
+            result = CurrentTransportError();
+        }
+        done(context, result);
+    }
+
+    static winrt::fire_and_forget SubscribeAsync(std::shared_ptr<WinRtTransport> self, bool enable, Completion done, void* context) {
+        HrTransportResult result{ HrErrorNone, 0 };
+        try {
+            if (!self->m_characteristic) {
+                result = { HrErrorSubscribeFailed, 0 };
+            }
+            else {
+                auto status = co_await self->Track(self->m_characteristic.WriteClientCharacteristicConfigurationDescriptorAsync(enable
+                    ? GattClientCharacteristicConfigurationDescriptorValue::Notify
+                    : GattClientCharacteristicConfigurationDescriptorValue::None));
+                if (status != GattCommunicationStatus::Success) {
+                    result = { HrErrorSubscribeFailed, 0 };
+                }
+            }
+        }
+        catch (...) {
+            result = CurrentTransportError();
         }
+        done(context, result);
+    }
+
+    void AttachDevice(BluetoothLEDevice const& device) {
+        m_device = device;
+        m_address = device.BluetoothAddress();
+        // Monitor connection status
+        m_connectionStatusToken = device.ConnectionStatusChanged([relay = m_relay](BluetoothLEDevice const& sender, auto const&) {
+            if (sender.ConnectionStatus() == BluetoothConnectionStatus::Disconnected) {
+                std::lock_guard<std::mutex> lock(relay->mutex);
+                if (relay->listener) {
+                    relay->listener->OnLinkLost();
+                }
+            }
+            });
+    }
 
-        valueChangedToken = hrCharacteristic.ValueChanged(
-            [&](GattCharacteristic const& sender, GattValueChangedEventArgs const& args) {
+    void AttachCharacteristic(GattCharacteristic const& characteristic) {
+        m_characteristic = characteristic;
+        m_valueChangedToken = characteristic.ValueChanged(
+            [relay = m_relay](GattCharacteristic const&, GattValueChangedEventArgs const& args) {
+                HotPathScope hotPath; // Notification to delivery must not allocate once warmed up
                 try {
-                    DataReader reader = DataReader::FromBuffer(args.CharacteristicValue());
-                    uint8_t flags = reader.ReadByte();
-                    uint16_t rate = (flags & 0x01) ? reader.ReadUInt16() : reader.ReadByte();
-                    ReportHeartRate(rate);
+                    int64_t arrivalUs = NowUs();
+                    auto buffer = args.CharacteristicValue();
+                    std::lock_guard<std::mutex> lock(relay->mutex);
+                    if (relay->listener) {
+                        relay->listener->OnNotification(buffer.data(), buffer.Length(), arrivalUs);
+                    }
                 }
                 catch (winrt::hresult_error const& e) {
                     // Handle read error if buffer is malformed etc.
-                    std::string errorMsg = "HR Read Error: " + winrt::to_string(e.message());
-                    ReportStatus(99, errorMsg.c_str()); // Status: Runtime Error
+                    std::lock_guard<std::mutex> lock(relay->mutex);
+                    if (relay->listener) {
+                        relay->listener->OnTransportError(static_cast<int32_t>(e.code()));
+                    }
                 }
             });
+    }
+
+    // Drops the handlers and closes the device
+    void Release() {
+        if (m_characteristic) {
+            m_characteristic.ValueChanged(m_valueChangedToken); // Unsubscribe event
+            m_characteristic = nullptr;
+        }
+        if (m_device) {
+            m_device.ConnectionStatusChanged(m_connectionStatusToken); // Unsubscribe event
+            m_device.Close(); // Close connection and release resources
+            m_device = nullptr;
+        }
+    }
+
+    std::shared_ptr<ListenerRelay> m_relay = std::make_shared<ListenerRelay>();
+    std::mutex m_pendingMutex; // Protects the two below
+    Windows::Foundation::IAsyncInfo m_pending{ nullptr };
+    bool m_cancelled = false;
+    // Used by one operation at a time (ordered by the engine's completions)
+    winrt::hstring m_deviceId; // Found by the last Scan
+    uint64_t m_address = 0;
+    BluetoothLEDevice m_device{ nullptr };
+    GattCharacteristic m_characteristic{ nullptr };
+    winrt::event_token m_valueChangedToken{};
+    winrt::event_token m_connectionStatusToken{};
+};
+
+// --- Session engine wiring ---
+// Sessions run on the shared executor against the steady clock and the shared timer wheel, and
+// report through the same status, sample and capture paths as any other producer.
+class ExecutorRuntime final : public SessionRuntime {
+public:
+    bool Resume(std::coroutine_handle<> coroutine) override {
+        return g_executor.Resume(coroutine);
+    }
+    int64_t NowUs() override {
+        return ::NowUs();
+    }
+    TimerWheel& Timers() override {
+        return g_timers;
+    }
+};
+
+ExecutorRuntime g_sessionRuntime;
+
+class DllSessionHost final : public SessionHost {
+public:
+    std::shared_ptr<HrTransport> CreateTransport() override {
+        std::shared_ptr<HrTransport> transport = std::make_shared<WinRtTransport>();
+        if (g_faults.Enabled()) {
+            transport = std::make_shared<FaultyTransport>(std::move(transport), g_faults, g_sessionRuntime);
+        }
+        return transport;
+    }
+    void OnStatus(HrState state, HrErrorCategory category, int32_t hresult, uint64_t deviceAddress) override {
+        if (state == HrStateStreaming && deviceAddress != 0) {
+            RememberLastStrap(deviceAddress);
+        }
+        ReportStatus(state, category, hresult, deviceAddress);
+    }
+    void OnSample(const HrSample& sample) override {
+        PublishSample(sample);
+    }
+    void OnNotification(uint64_t deviceAddress, int64_t arrivalUs, const uint8_t* data, size_t length) override {
+        g_capture.RecordNotification(deviceAddress, arrivalUs, data, length);
+    }
+    bool PrepareSession() override {
+        if (!g_sampleQueue.Reserve(g_sampleQueueCapacity)) {
+            return false;
+        }
+        try {
+            EnsureRuntime();
+        }
+        catch (...) {
+            return false;
+        }
+        return true;
+    }
+    void OnRadioBusy(bool busy) override {
+        if (busy) {
+            PausePrewarm(); // The session has the radio until it ends
+        }
+        else {
+            ResumePrewarm();
+        }
+    }
+    uint64_t WarmAddress(int64_t nowUs) override {
+        return WarmDeviceAddress(nowUs);
+    }
+};
+
+DllSessionHost g_sessionHost;
+SessionEngine g_engine(g_sessionRuntime, g_sessionHost, g_linkStats, g_startup);
 
-        ReportStatus(10, "Connected and Monitoring"); // Status: Connected/Streaming
+// Helper to publish a status event: queue it for pollers and invoke both callbacks
+void ReportStatus(HrState state, HrErrorCategory category, int32_t hresult, uint64_t deviceAddress) {
+    g_currentState = state;
 
+    HrStatusEvent evt{};
+    evt.timestampUs = NowUs();
+    evt.deviceAddress = deviceAddress;
+    evt.sequence = g_statusSequence.fetch_add(1) + 1;
+    evt.state = state;
+    evt.category = category;
+    evt.hresult = hresult;
+    g_statusQueue.Push(evt);
+    g_capture.RecordStatus(evt.deviceAddress, evt.timestampUs, state, category, hresult);
 
-        while (!g_shouldStop) {
-            // Use condition variable or just sleep
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::lock_guard<std::mutex> lock(g_callbackMutex);
+    if (g_statusEventCallback) {
+        g_statusEventCallback(&evt);
+    }
+    if (g_statusCallback) {
+        // Legacy string callback: only errors need formatting, done on the stack
+        if (category == HrErrorNone) {
+            g_statusCallback(state, StatusStateText(state));
         }
+        else {
+            char message[256];
+            FormatStatusEvent(evt, message, sizeof(message));
+            g_statusCallback(state, message);
+        }
+    }
+}
 
-        ReportStatus(11, "Stopping..."); // Status: Stopping
+// Fans a decoded sample out to every consumer
+void PublishSample(const HrSample& sample) {
+    g_latestSamples.Store(sample);
+    g_sampleQueue.Push(sample); // No-op unless a capacity was set
+    {
+        std::lock_guard<std::mutex> lock(g_sharedChannelMutex);
+        g_sharedChannel.Publish(sample); // No-op unless enabled
+    }
+    g_netPublisher.Publish(sample);
+    g_oscEmitter.Publish(sample);
+    g_webSocketServer.Publish(sample);
+    g_dispatcher.Deliver(sample); // Heart rate callbacks and subscribers
+}
 
+// Keeps the process MTA alive so thread-pool threads that resume our coroutines can use WinRT
+// without each one calling init_apartment, and makes sure the shared executor is running.
+void EnsureRuntime() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        CO_MTA_USAGE_COOKIE cookie{};
+        winrt::check_hresult(CoIncrementMTAUsage(&cookie)); // Held for the life of the process
+    });
+    if (!g_executor.Start() || !g_timers.StartDriver(g_executor.Environment())) {
+        winrt::throw_last_error();
     }
-    catch (winrt::hresult_error const& e) {
-        std::string errorMsg = "BLE Error: " + winrt::to_string(e.message());
-        ReportStatus(99, errorMsg.c_str()); // Status: Error
+}
+
+// --- Pre-warm (see InitializePluginEx) ---
+// Between sessions a passive advertisement watcher listens for straps advertising the HR
+// service, so a session's first connect can go straight to one in range instead of waiting
+// for device enumeration. Passive scanning sends no scan requests: a strap that only lists
+// 0x180D in its scan response is not heard, and Start falls back to the normal scan.
+// Only straps Windows already knows with the HR service (enumerated when pre-warm starts) and
+// the last strap a session streamed from are candidates: a stranger's strap advertising 0x180D
+// nearby is never connected to.
+struct WarmDevice {
+    uint64_t address;
+    int64_t lastSeenUs;
+    int16_t rssi;
+};
+
+constexpr int kMaxWarmDevices = 8;
+constexpr int kMaxKnownStraps = 16;
+constexpr int64_t kWarmDeviceFreshUs = 10000000; // Heard within 10 s: still in range
+
+std::mutex g_prewarmMutex; // Protect the watcher and the flags below
+BluetoothLEAdvertisementWatcher g_advertWatcher{ nullptr };
+winrt::event_token g_advertToken{};
+bool g_prewarmEnabled = false;
+uint32_t g_prewarmPauses = 0; // Sessions using the radio; the watcher only runs at 0
+std::atomic<int32_t> g_prewarmState(HrPrewarmOff);
+std::atomic<int32_t> g_prewarmHresult(0);
+std::atomic<uint64_t> g_adapterAddress(0);
+std::atomic<uint64_t> g_advertisements(0);
+std::mutex g_warmDeviceMutex; // Protect g_warmDevices and the known straps (advertisement callbacks)
+WarmDevice g_warmDevices[kMaxWarmDevices] = {};
+int g_warmDeviceCount = 0;
+uint64_t g_knownStraps[kMaxKnownStraps] = {}; // Paired, with the HR service
+int g_knownStrapCount = 0;
+uint64_t g_lastStrapAddress = 0; // Last strap a session streamed from
+
+bool IsKnownStrapLocked(uint64_t address) {
+    if (address == g_lastStrapAddress) {
+        return true;
     }
-    catch (std::exception const& e) {
-        std::string errorMsg = "Std Error: " + std::string(e.what());
-        ReportStatus(99, errorMsg.c_str()); // Status: Error
+    for (int i = 0; i < g_knownStrapCount; ++i) {
+        if (g_knownStraps[i] == address) {
+            return true;
+        }
     }
-    catch (...) {
-        ReportStatus(99, "Unknown error occurred."); // Status: Error
+    return false;
+}
+
+void RememberLastStrap(uint64_t address) {
+    std::lock_guard<std::mutex> lock(g_warmDeviceMutex);
+    g_lastStrapAddress = address;
+}
+
+// Bluetooth address of an enumerated device interface, 0 if it doesn't carry one
+uint64_t EnumeratedAddress(DeviceInformation const& device) {
+    auto value = device.Properties().TryLookup(L"System.DeviceInterface.Bluetooth.DeviceAddress");
+    winrt::hstring text = winrt::unbox_value_or<winrt::hstring>(value, L"");
+    return text.empty() ? 0 : std::wcstoull(text.c_str(), nullptr, 16);
+}
+
+void OnAdvertisement(BluetoothLEAdvertisementWatcher const&, BluetoothLEAdvertisementReceivedEventArgs const& args) {
+    uint64_t address = args.BluetoothAddress();
+    int16_t rssi = args.RawSignalStrengthInDBm();
+    int64_t nowUs = NowUs();
+    g_advertisements.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(g_warmDeviceMutex);
+    int slot = 0;
+    for (; slot < g_warmDeviceCount; ++slot) {
+        if (g_warmDevices[slot].address == address) {
+            break;
+        }
     }
+    if (slot == g_warmDeviceCount) {
+        if (g_warmDeviceCount < kMaxWarmDevices) {
+            ++g_warmDeviceCount;
+        }
+        else {
+            for (int i = 1; i < kMaxWarmDevices; ++i) { // Full: replace the stalest
+                if (g_warmDevices[i].lastSeenUs < g_warmDevices[slot].lastSeenUs) {
+                    slot = i;
+                }
+            }
+        }
+    }
+    g_warmDevices[slot] = { address, nowUs, rssi };
+}
+
+// Known strap heard recently, 0 if none (or pre-warm is off): the last one used if it is in
+// range, otherwise the strongest
+uint64_t WarmDeviceAddress(int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(g_warmDeviceMutex);
+    const WarmDevice* best = nullptr;
+    for (int i = 0; i < g_warmDeviceCount; ++i) {
+        const WarmDevice& device = g_warmDevices[i];
+        if (nowUs - device.lastSeenUs > kWarmDeviceFreshUs || !IsKnownStrapLocked(device.address)) {
+            continue;
+        }
+        if (device.address == g_lastStrapAddress) {
+            return device.address;
+        }
+        if (!best || device.rssi > best->rssi) {
+            best = &device;
+        }
+    }
+    return best ? best->address : 0;
+}
 
-    // --- Cleanup (happens within worker thread) ---
+void StartWatcherLocked() {
+    if (g_advertWatcher && g_prewarmPauses == 0) {
+        try {
+            g_advertWatcher.Start();
+            g_prewarmState = HrPrewarmScanning;
+        }
+        catch (winrt::hresult_error const& e) {
+            g_prewarmHresult = static_cast<int32_t>(e.code());
+            g_prewarmState = HrPrewarmFailed;
+        }
+    }
+}
+
+void StopWatcherLocked() {
+    if (g_advertWatcher) {
+        try {
+            g_advertWatcher.Stop();
+        }
+        catch (winrt::hresult_error const&) {
+            // Already stopped or aborted
+        }
+    }
+}
+
+// Queries the adapter once, then starts the watcher (on the executor, off the host's thread)
+winrt::fire_and_forget PrewarmAsync() {
+    co_await g_executor.Schedule();
     try {
-        if (hrCharacteristic) {
-            hrCharacteristic.ValueChanged(valueChangedToken); // Unsubscribe event
-            // Attempt to disable notifications (best effort)
-            hrCharacteristic.WriteClientCharacteristicConfigurationDescriptorAsync(
-                GattClientCharacteristicConfigurationDescriptorValue::None).get(); // Still blocking, but on worker thread
+        auto adapter = co_await BluetoothAdapter::GetDefaultAsync();
+        if (!adapter || !adapter.IsLowEnergySupported() || !adapter.IsCentralRoleSupported()) {
+            g_prewarmState = HrPrewarmNoAdapter;
+            co_return;
         }
-        if (bleDevice) {
-            bleDevice.ConnectionStatusChanged(connectionStatusToken); // Unsubscribe event
-            bleDevice.Close(); // Close connection and release resources
+        g_adapterAddress = adapter.BluetoothAddress();
+
+        std::vector<winrt::hstring> properties{ L"System.DeviceInterface.Bluetooth.DeviceAddress" };
+        auto straps = co_await DeviceInformation::FindAllAsync(GattDeviceService::GetDeviceSelectorFromUuid(g_hrServiceUuid), properties);
+        {
+            std::lock_guard<std::mutex> lock(g_warmDeviceMutex);
+            g_knownStrapCount = 0;
+            for (auto const& strap : straps) {
+                uint64_t address = EnumeratedAddress(strap);
+                if (address != 0 && g_knownStrapCount < kMaxKnownStraps && !IsKnownStrapLocked(address)) {
+                    g_knownStraps[g_knownStrapCount++] = address;
+                }
+            }
         }
+
+        BluetoothLEAdvertisementWatcher watcher;
+        watcher.ScanningMode(BluetoothLEScanningMode::Passive);
+        watcher.AdvertisementFilter().Advertisement().ServiceUuids().Append(g_hrServiceUuid);
+        std::lock_guard<std::mutex> lock(g_prewarmMutex);
+        if (!g_prewarmEnabled || g_advertWatcher) {
+            co_return; // Shut down (or started again) meanwhile
+        }
+        g_advertToken = watcher.Received(&OnAdvertisement);
+        g_advertWatcher = watcher;
+        g_prewarmState = HrPrewarmPaused;
+        StartWatcherLocked();
     }
     catch (winrt::hresult_error const& e) {
-        // Log cleanup error, but proceed
-        std::string errorMsg = "Cleanup Error: " + winrt::to_string(e.message());
-        ReportStatus(98, errorMsg.c_str()); // Status: Cleanup Error
+        g_prewarmHresult = static_cast<int32_t>(e.code());
+        g_prewarmState = HrPrewarmFailed;
     }
-    catch (...) {
-        ReportStatus(98, "Unknown cleanup error.");
+}
+
+void StartPrewarm() {
+    std::lock_guard<std::mutex> lock(g_prewarmMutex);
+    if (g_prewarmEnabled) {
+        return;
     }
+    g_prewarmEnabled = true;
+    g_prewarmHresult = 0;
+    g_prewarmState = HrPrewarmStarting;
+    PrewarmAsync();
+}
 
-    bleDevice = nullptr; // Release WinRT objects
-    hrCharacteristic = nullptr;
+void StopPrewarm() {
+    {
+        std::lock_guard<std::mutex> lock(g_prewarmMutex);
+        g_prewarmEnabled = false;
+        if (g_advertWatcher) {
+            g_advertWatcher.Received(g_advertToken);
+            StopWatcherLocked();
+            g_advertWatcher = nullptr;
+        }
+        g_prewarmState = HrPrewarmOff;
+    }
+    std::lock_guard<std::mutex> lock(g_warmDeviceMutex);
+    g_warmDeviceCount = 0;
+}
 
-    ReportStatus(0, "Stopped"); // Status: Idle/Stopped
-    uninit_apartment(); // Uninitialize COM/WinRT for this thread
+void PausePrewarm() {
+    std::lock_guard<std::mutex> lock(g_prewarmMutex);
+    if (g_prewarmPauses++ == 0 && g_advertWatcher) {
+        StopWatcherLocked();
+        g_prewarmState = HrPrewarmPaused;
+    }
 }
 
-// Helper to safely invoke status callback
-void ReportStatus(int status, const char* message) {
-    g_currentState = status;
-    std::lock_guard<std::mutex> lock(g_callbackMutex);
-    if (g_statusCallback) {
-        g_statusCallback(status, message);
+void ResumePrewarm() {
+    std::lock_guard<std::mutex> lock(g_prewarmMutex);
+    if (g_prewarmPauses > 0 && --g_prewarmPauses == 0) {
+        StartWatcherLocked();
     }
-    // Optional: Log to debug output/file here too
-    // OutputDebugStringA(...)
 }
 
-// Helper to safely invoke HR callback
-void ReportHeartRate(int bpm) {
-    // No need to store bpm globally if using callback
-    std::lock_guard<std::mutex> lock(g_callbackMutex);
-    if (g_hrCallback) {
-        g_hrCallback(bpm);
+// Periodic link stats push; re-arms itself while an interval is set
+void OnStatsFlush(void*) {
+    HrLinkStats stats;
+    g_linkStats.Snapshot(stats);
+    {
+        std::lock_guard<std::mutex> lock(g_callbackMutex);
+        if (g_linkStatsCallback) {
+            g_linkStatsCallback(&stats);
+        }
+    }
+    uint32_t interval = g_statsFlushIntervalMs;
+    if (interval > 0) {
+        g_timers.Schedule(g_statsFlushTimer, interval);
     }
 }
 
+void StopStatsFlush() {
+    g_statsFlushIntervalMs = 0;
+    g_timers.Cancel(g_statsFlushTimer);
+}
+
 // --- Exported C API ---
 extern "C" {
     __declspec(dllexport) int InitializePlugin() {
@@ -198,54 +718,212 @@ extern "C" {
         return 0; // Success
     }
 
+    // InitializePlugin with options (HrInitFlags). With HrInitPrewarm the runtime is started
+    // here instead of on the first Start, the adapter is checked in the background and a
+    // passive scan runs whenever no session is active (see GetPrewarmStats).
+    __declspec(dllexport) int InitializePluginEx(int flags) {
+        if (flags & ~HrInitPrewarm) {
+            return -1;
+        }
+        g_currentState = 0;
+        if (flags & HrInitPrewarm) {
+            try {
+                EnsureRuntime();
+                StartPrewarm();
+            }
+            catch (...) {
+                return -2;
+            }
+        }
+        return 0;
+    }
+
+    __declspec(dllexport) int GetPrewarmStats(HrPrewarmStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        *stats = HrPrewarmStats{};
+        stats->adapterAddress = g_adapterAddress;
+        stats->advertisements = g_advertisements;
+        stats->candidateAddress = WarmDeviceAddress(NowUs());
+        stats->state = g_prewarmState;
+        stats->hresult = g_prewarmHresult;
+        {
+            std::lock_guard<std::mutex> lock(g_warmDeviceMutex);
+            stats->devices = static_cast<uint32_t>(g_warmDeviceCount);
+            const uint64_t* knownEnd = g_knownStraps + g_knownStrapCount;
+            stats->knownStraps = static_cast<uint32_t>(g_knownStrapCount);
+            if (g_lastStrapAddress != 0 && std::find(g_knownStraps, knownEnd, g_lastStrapAddress) == knownEnd) {
+                ++stats->knownStraps; // Used, but not paired (or paired since pre-warm started)
+            }
+        }
+        return 0;
+    }
+
+    // Stops any session (bounded by the stop timeout) and releases the shared executor threads.
+    // Call before unloading the DLL; Start brings everything back up if called again.
+    __declspec(dllexport) int ShutdownPlugin() {
+        g_engine.Stop(g_stopTimeoutMs, false);
+        StopPrewarm();
+        StopStatsFlush();
+        g_netPublisher.Stop();
+        g_oscEmitter.Close();
+        g_webSocketServer.Stop();
+        g_capture.Stop();
+        g_timers.StopDriver();
+        g_executor.Shutdown();
+        return 0;
+    }
+
     __declspec(dllexport) int RegisterStatusCallback(StatusCallback callback) {
         std::lock_guard<std::mutex> lock(g_callbackMutex);
         g_statusCallback = callback;
         return 0;
     }
 
-    __declspec(dllexport) int RegisterHeartRateCallback(HeartRateCallback callback) {
+    // Typed alternative to RegisterStatusCallback; both may be registered
+    __declspec(dllexport) int RegisterStatusEventCallback(StatusEventCallback callback) {
         std::lock_guard<std::mutex> lock(g_callbackMutex);
-        g_hrCallback = callback;
+        g_statusEventCallback = callback;
         return 0;
     }
 
-    __declspec(dllexport) int StartHrMonitoring() {
-        if (g_workerThread.joinable()) {
-            return -1; // Already running
+    // Pops the oldest queued status event. Returns 1 if one was written, 0 if the queue is empty.
+    __declspec(dllexport) int PollStatusEvent(HrStatusEvent* evt) {
+        if (!evt) {
+            return -1;
         }
-        g_shouldStop = false;
-        try {
-            // Start thread using std::thread
-            g_workerThread = std::thread(BleWorkerLogic);
-        }
-        catch (std::exception const& e) {
-            // Failed to create thread?
-            ReportStatus(99, e.what());
-            return -2; // Thread creation failed
+        return g_statusQueue.Pop(*evt) ? 1 : 0;
+    }
+
+    // Human-readable text for an event, formatted on demand into the caller's buffer
+    __declspec(dllexport) int GetStatusEventText(const HrStatusEvent* evt, char* buffer, int length) {
+        if (!evt || !buffer || length <= 0) {
+            return -1;
         }
-        return 0; // Success (thread started)
+        return FormatStatusEvent(*evt, buffer, static_cast<size_t>(length));
     }
 
-    __declspec(dllexport) int StopHrMonitoring() {
-        if (!g_workerThread.joinable()) {
-            return -1; // Not running
+    __declspec(dllexport) int RegisterHeartRateCallback(HeartRateCallback callback) {
+        g_dispatcher.SetLegacy(callback);
+        return 0;
+    }
+
+    // Delivery policy for the RegisterHeartRateCallback callback: HrDeliveryEverySample (default)
+    // or HrDeliveryCoalesce with intervalMs as the minimum spacing between calls
+    __declspec(dllexport) int SetHeartRateCallbackPolicy(int policy, int intervalMs) {
+        if ((policy != HrDeliveryEverySample && policy != HrDeliveryCoalesce)
+            || (policy == HrDeliveryCoalesce && intervalMs <= 0)) {
+            return -1;
+        }
+        if (policy == HrDeliveryCoalesce) {
+            try {
+                EnsureRuntime();
+            }
+            catch (...) {
+                return -2;
+            }
         }
-        g_shouldStop = true; // Signal worker thread
+        g_dispatcher.SetLegacyPolicy(static_cast<HrDeliveryPolicy>(policy), static_cast<uint32_t>(intervalMs > 0 ? intervalMs : 0));
+        return 0;
+    }
 
-        // Wait for worker thread to finish
-        try {
-            if (g_workerThread.joinable()) {
-                g_workerThread.join(); // Waits indefinitely
+    // Adds a sample subscriber with its own HrDeliveryPolicy (intervalMs is ignored for every-sample).
+    // Returns an id for RemoveHeartRateSubscriber, or -1 on bad arguments / all slots in use.
+    __declspec(dllexport) int AddHeartRateSubscriber(HeartRateSampleCallback callback, void* userData, int policy, int intervalMs) {
+        if (!callback || policy < HrDeliveryEverySample || policy > HrDeliveryBatch
+            || (policy != HrDeliveryEverySample && intervalMs <= 0)) {
+            return -1;
+        }
+        if (policy != HrDeliveryEverySample) {
+            try {
+                EnsureRuntime(); // Coalesced and batched delivery run off the timer wheel
+            }
+            catch (...) {
+                return -2;
             }
         }
-        catch (std::system_error const& e) {
-            // Error joining thread?
-            ReportStatus(98, e.what());
+        return g_dispatcher.Add(callback, userData, static_cast<HrDeliveryPolicy>(policy),
+            static_cast<uint32_t>(intervalMs > 0 ? intervalMs : 0));
+    }
+
+    // After this returns the callback is not called again
+    __declspec(dllexport) int RemoveHeartRateSubscriber(int id) {
+        return g_dispatcher.Remove(id) ? 0 : -1;
+    }
+
+    // Resumes a lingering session at once (see SetStopLinger). Returns -1 if one is already
+    // running (or still stopping), -2 if the session could not be created.
+    __declspec(dllexport) int StartHrMonitoring() {
+        return g_engine.Start(NowUs(), g_stopTimeoutMs);
+    }
+
+    // Stops and waits up to the configured stop timeout (see SetStopTimeout).
+    // Returns 0 when fully stopped, -3 if the deadline passed and cleanup was abandoned.
+    __declspec(dllexport) int StopHrMonitoring() {
+        return g_engine.Stop(g_stopTimeoutMs, true);
+    }
+
+    // Same as StopHrMonitoring with an explicit deadline in milliseconds
+    __declspec(dllexport) int StopHrMonitoringTimeout(int timeoutMs) {
+        if (timeoutMs < 0) {
             return -2;
         }
-        // g_workerThread destructor handles cleanup if needed, join ensures it's done.
-        return 0; // Success
+        return g_engine.Stop(static_cast<uint32_t>(timeoutMs), true);
+    }
+
+    // Returns immediately; completion is reported as an HrStateIdle status event
+    __declspec(dllexport) int StopHrMonitoringAsync() {
+        return g_engine.StopAsync();
+    }
+
+    // Scan, connect, discovery and subscribe must complete within this or the session fails
+    __declspec(dllexport) int SetConnectTimeout(int timeoutMs) {
+        if (timeoutMs <= 0) {
+            return -1;
+        }
+        g_engine.connectTimeoutMs = static_cast<uint32_t>(timeoutMs);
+        return 0;
+    }
+
+    // Silence after which the watchdog reports HrStateStalled; it resubscribes at twice and
+    // reconnects at four times this. 0 = derive from the strap's cadence (at least 3 s).
+    __declspec(dllexport) int SetWatchdogTimeout(int warnAfterMs) {
+        if (warnAfterMs < 0) {
+            return -1;
+        }
+        g_engine.watchdogWarnMs = static_cast<uint32_t>(warnAfterMs);
+        return 0;
+    }
+
+    // Reconnect attempts after a lost or stalled link before the session gives up (0 = none)
+    __declspec(dllexport) int SetReconnectPolicy(int maxAttempts) {
+        if (maxAttempts < 0) {
+            return -1;
+        }
+        g_engine.maxReconnectAttempts = static_cast<uint32_t>(maxAttempts);
+        return 0;
+    }
+
+    // Deadline used by StopHrMonitoring and for the CCCD write during cleanup
+    __declspec(dllexport) int SetStopTimeout(int timeoutMs) {
+        if (timeoutMs < 0) {
+            return -1;
+        }
+        g_stopTimeoutMs = static_cast<uint32_t>(timeoutMs);
+        return 0;
+    }
+
+    // Keeps a streaming session's link for lingerMs after Stop (delivering nothing, status Idle),
+    // so a Start within that time resumes at once instead of scanning, connecting and
+    // discovering again. Meant for hosts that stop and start around every exercise interval.
+    // Stopping again while it lingers disconnects at once. 0 (the default) disconnects on Stop.
+    __declspec(dllexport) int SetStopLinger(int lingerMs) {
+        if (lingerMs < 0) {
+            return -1;
+        }
+        g_engine.stopLingerMs = static_cast<uint32_t>(lingerMs);
+        return 0;
     }
 
     //// Optional: Keep GetLatestStatus if needed, but callback is better
@@ -253,8 +931,336 @@ extern "C" {
         return g_currentState.load();
     }
 
-    // Remove GetLatestHeartRate if relying solely on callback
-    // __declspec(dllexport) int GetLatestHeartRate() { ... }
+    // Link quality counters for the current (or last) device
+    __declspec(dllexport) int GetLinkStats(HrLinkStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        g_linkStats.Snapshot(*stats);
+        return 0;
+    }
+
+    // Pushes GetLinkStats to the callback every intervalMs (null callback or 0 stops it)
+    __declspec(dllexport) int RegisterLinkStatsCallback(LinkStatsCallback callback, int intervalMs) {
+        StopStatsFlush();
+        {
+            std::lock_guard<std::mutex> lock(g_callbackMutex);
+            g_linkStatsCallback = callback;
+        }
+        if (!callback || intervalMs <= 0) {
+            return 0;
+        }
+        try {
+            EnsureRuntime();
+        }
+        catch (...) {
+            return -2;
+        }
+        g_statsFlushTimer.callback = &OnStatsFlush;
+        g_statsFlushIntervalMs = static_cast<uint32_t>(intervalMs);
+        g_timers.Schedule(g_statsFlushTimer, static_cast<uint32_t>(intervalMs));
+        return 0;
+    }
+
+    // Publishes every sample into a named shared-memory ring (e.g. "Local\\BleHeartRate") that
+    // other processes open read-only with SharedChannelReader. capacity is the ring size in
+    // samples (0 = 256). Replaces any channel already enabled.
+    __declspec(dllexport) int EnableSharedChannel(const char* name, int capacity) {
+        if (!name || !*name || capacity < 0) {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(g_sharedChannelMutex);
+        if (!g_sharedChannel.Open(name, capacity > 0 ? static_cast<uint32_t>(capacity) : 256)) {
+            return -2; // Mapping failed or the name is in use with a different layout
+        }
+        return 0;
+    }
+
+    __declspec(dllexport) int DisableSharedChannel() {
+        std::lock_guard<std::mutex> lock(g_sharedChannelMutex);
+        g_sharedChannel.Close();
+        return 0;
+    }
+
+    // Serves samples over TCP and UDP on port (see NetPublisher.h for framing and the UDP
+    // subscribe handshake). format is an HrNetFormat. flags: 1 = listen on all interfaces
+    // instead of loopback only. Restarts the publisher if it is already running.
+    __declspec(dllexport) int StartNetPublisher(int port, int format, int flags) {
+        if (port <= 0 || port > 65535 || (format != HrNetFormatBinary && format != HrNetFormatJson)) {
+            return -1;
+        }
+        g_netPublisher.Stop();
+        try {
+            EnsureRuntime();
+        }
+        catch (...) {
+            return -2;
+        }
+        if (!g_netPublisher.Start(static_cast<uint16_t>(port), static_cast<HrNetFormat>(format),
+            (flags & 1) != 0, g_executor.Environment())) {
+            return -2; // Port in use or Winsock failure
+        }
+        return 0;
+    }
+
+    __declspec(dllexport) int StopNetPublisher() {
+        g_netPublisher.Stop();
+        return 0;
+    }
+
+    __declspec(dllexport) int GetNetPublisherStats(HrNetStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        g_netPublisher.Snapshot(*stats);
+        return 0;
+    }
+
+    // Sends every sample as OSC over UDP to host:port (/hr/<device>/bpm and /hr/<device>/rr
+    // in ms, bundled per sample). Replaces any previous target.
+    __declspec(dllexport) int StartOscOutput(const char* host, int port) {
+        if (!host || !*host || port <= 0 || port > 65535) {
+            return -1;
+        }
+        return g_oscEmitter.Open(host, static_cast<uint16_t>(port)) ? 0 : -2;
+    }
+
+    __declspec(dllexport) int StopOscOutput() {
+        g_oscEmitter.Close();
+        return 0;
+    }
+
+    // Serves browser dashboards over WebSocket on port: every cadenceMs, each client gets one
+    // binary message with the samples of all devices since the last one (see WebSocketServer.h).
+    // flags: 1 = listen on all interfaces instead of loopback only.
+    __declspec(dllexport) int StartWebSocketServer(int port, int cadenceMs, int flags) {
+        if (port <= 0 || port > 65535 || cadenceMs <= 0) {
+            return -1;
+        }
+        g_webSocketServer.Stop();
+        try {
+            EnsureRuntime();
+        }
+        catch (...) {
+            return -2;
+        }
+        if (!g_webSocketServer.Start(static_cast<uint16_t>(port), static_cast<uint32_t>(cadenceMs),
+            (flags & 1) != 0, g_executor.Environment())) {
+            return -2; // Port in use or Winsock failure
+        }
+        return 0;
+    }
+
+    __declspec(dllexport) int StopWebSocketServer() {
+        g_webSocketServer.Stop();
+        return 0;
+    }
+
+    // tcpClients = open WebSocket clients, framesDropped = batches skipped by slow clients
+    __declspec(dllexport) int GetWebSocketStats(HrNetStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        g_webSocketServer.Snapshot(*stats);
+        return 0;
+    }
+
+    // Heap allocation counters. Returns 0, or -2 (zeroed stats) if the DLL was built without
+    // HR_TRACK_ALLOCATIONS.
+    __declspec(dllexport) int GetAllocationStats(HrAllocationStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        return AllocationStats(*stats) ? 0 : -2;
+    }
+
+    // Queue every sample for PollSamples, holding up to capacity (0 = off, the default).
+    // Storage is allocated when the next session starts.
+    __declspec(dllexport) int SetSampleQueueCapacity(int capacity) {
+        if (capacity < 0 || capacity > 65536) {
+            return -1;
+        }
+        g_sampleQueueCapacity = static_cast<uint32_t>(capacity);
+        return 0;
+    }
+
+    // Copies out up to maxSamples queued samples, oldest first. Returns the count written.
+    __declspec(dllexport) int PollSamples(HrSample* samples, int maxSamples) {
+        if (!samples || maxSamples <= 0) {
+            return -1;
+        }
+        int count = 0;
+        while (count < maxSamples && g_sampleQueue.Pop(samples[count])) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Samples dropped from the PollSamples queue because the host fell behind
+    __declspec(dllexport) int GetSampleQueueOverflows(uint64_t* overflows) {
+        if (!overflows) {
+            return -1;
+        }
+        *overflows = g_sampleQueue.Overflows();
+        return 0;
+    }
+
+    // Lock-free copy of the newest sample from any device, for hosts that poll.
+    // Returns 1 if written, 0 if nothing has arrived yet. A changed sequence means new data.
+    __declspec(dllexport) int GetLatestSample(HrSample* sample) {
+        if (!sample) {
+            return -1;
+        }
+        return g_latestSamples.Load(*sample) ? 1 : 0;
+    }
+
+    // Same as GetLatestSample for one device. Devices keep their slot until it is needed for a
+    // new device and they have been silent for a few seconds.
+    __declspec(dllexport) int GetLatestSampleForDevice(uint64_t deviceAddress, HrSample* sample) {
+        if (!sample) {
+            return -1;
+        }
+        return g_latestSamples.Load(deviceAddress, *sample) ? 1 : 0;
+    }
+
+    // Samples GetLatestSampleForDevice could not keep because every slot belonged to a device
+    // that was still sending
+    __declspec(dllexport) int GetLatestSampleUntracked(uint64_t* samples) {
+        if (!samples) {
+            return -1;
+        }
+        *samples = g_latestSamples.Untracked();
+        return 0;
+    }
+
+    // Phase timings of a recent connection attempt: index 0 is the most recent, up to 15 back.
+    // Returns 1 if written, 0 if there is no such attempt yet.
+    __declspec(dllexport) int GetStartupProfile(int index, HrStartupProfile* profile) {
+        if (!profile || index < 0) {
+            return -1;
+        }
+        return g_startup.Profile(static_cast<uint32_t>(index), *profile) ? 1 : 0;
+    }
+
+    // Per-phase timing across every attempt so far, indexed by HrStartupPhase. Fills up to
+    // count entries and returns how many were written.
+    __declspec(dllexport) int GetStartupStats(HrStartupPhaseStats* stats, int count) {
+        if (!stats || count < 0) {
+            return -1;
+        }
+        int filled = count < HrStartupPhaseCount ? count : HrStartupPhaseCount;
+        g_startup.Stats(stats, filled);
+        return filled;
+    }
+
+    __declspec(dllexport) int ResetStartupStats() {
+        g_startup.Reset();
+        return 0;
+    }
+
+    // Injects transport faults into the live session (see HrFaultConfig) to measure how the
+    // host copes with a bad radio. Null or all-zero rates turn injection off. Whether faults are
+    // injected at all is decided when a session starts; rates changed later apply at once.
+    __declspec(dllexport) int SetFaultInjection(const HrFaultConfig* config) {
+        if (!config) {
+            g_faults.Disable();
+            return 0;
+        }
+        auto rate = [](double r) { return r >= 0.0 && r <= 1.0; };
+        if (!rate(config->dropRate) || !rate(config->delayRate) || !rate(config->malformedRate)
+            || !rate(config->cccdFailureRate) || !rate(config->slowDiscoveryRate) || config->disconnectsPerHour < 0.0
+            || config->delayMinMs > config->delayMaxMs || config->discoveryDelayMinMs > config->discoveryDelayMaxMs) {
+            return -1;
+        }
+        g_faults.Configure(*config);
+        return 0;
+    }
+
+    __declspec(dllexport) int GetFaultStats(HrFaultStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        g_faults.Snapshot(*stats);
+        return 0;
+    }
+
+    // Records every raw notification and status event, from every device, into a capture file
+    // at path (format in CaptureFile.h; replay it with CaptureReader / ReplayCapture).
+    // Replaces any capture in progress.
+    __declspec(dllexport) int StartCapture(const char* path) {
+        if (!path || !*path) {
+            return -1;
+        }
+        try {
+            EnsureRuntime();
+        }
+        catch (...) {
+            return -2;
+        }
+        return g_capture.Start(path, NowUs()) ? 0 : -2;
+    }
+
+    // Writes out what is buffered and closes the capture file
+    __declspec(dllexport) int StopCapture() {
+        g_capture.Stop();
+        return 0;
+    }
+
+    __declspec(dllexport) int GetCaptureStats(HrCaptureStats* stats) {
+        if (!stats) {
+            return -1;
+        }
+        g_capture.Snapshot(*stats);
+        return 0;
+    }
+
+    // Decodes packetCount recorded 0x2A37 payloads; packet i is data[offsets[i] .. offsets[i + 1]).
+    // Returns the number decoded (less than packetCount if out->rr filled up), -1 on bad arguments.
+    __declspec(dllexport) int DecodeHrBatch(const uint8_t* data, uint32_t dataSize, const uint32_t* offsets,
+        int packetCount, HrBatchOutput* out) {
+        if (!data || !offsets || !out || packetCount < 0 || !out->bpm || !out->valid || !out->rrStart
+            || (!out->rr && out->rrCapacity > 0) || offsets[packetCount] > dataSize) {
+            return -1;
+        }
+        for (int i = 0; i < packetCount; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                return -1;
+            }
+        }
+        return DecodeHrBatch(data, dataSize, offsets, packetCount, *out, SelectedBatchDecoder());
+    }
+
+    // Which DecodeHrBatch kernel this CPU uses: 0 scalar, 1 SSE2, 2 AVX2
+    __declspec(dllexport) int GetBatchDecoderKind() {
+        return static_cast<int>(SelectedBatchDecoder());
+    }
+
+    // Pushes devices simulated straps at rateHz each through a private copy of the pipeline for
+    // durationMs and writes the results as JSON (see LoadGenerator.h). Blocks for the whole run;
+    // capturePath may be null. Returns the JSON length, -1 on bad arguments, -2 if it failed.
+    __declspec(dllexport) int RunLoadTest(int devices, double rateHz, int durationMs, const char* capturePath,
+        char* json, int jsonCapacity) {
+        if (devices <= 0 || rateHz < 0.0 || durationMs <= 0 || !json || jsonCapacity <= 0) {
+            return -1;
+        }
+        LoadConfig config;
+        config.devices = static_cast<uint32_t>(devices);
+        config.rateHz = rateHz;
+        config.durationMs = static_cast<uint32_t>(durationMs);
+        config.capturePath = capturePath && *capturePath ? capturePath : nullptr;
+        LoadReport report;
+        try {
+            EnsureRuntime();
+            if (!RunLoadTest(config, report)) {
+                return -2;
+            }
+        }
+        catch (...) {
+            return -2;
+        }
+        size_t length = FormatLoadReportJson(report, json, static_cast<size_t>(jsonCapacity));
+        return length > 0 ? static_cast<int>(length) : -2;
+    }
 }
 
 
@@ -0,0 +1,210 @@
+#pragma once
+#include <cstdint>
+
+// --- Types shared with the host through the exported C API ---
+// Keep these plain and naturally aligned so they can be mirrored by P/Invoke structs.
+
+// Session states. Values match the legacy StatusCallback codes.
+enum HrState : int32_t {
+    HrStateIdle = 0,
+    HrStateScanning = 1,
+    HrStateConnecting = 2,
+    HrStateDiscovering = 3,
+    HrStateSubscribing = 4,
+    HrStateDisconnected = 5,
+    HrStateStreaming = 10,
+    HrStateStopping = 11,
+    HrStateStalled = 12,      // Connected but notifications stopped (watchdog)
+    HrStateReconnecting = 13, // Lost or stalled link, retrying with backoff
+    HrStateCleanupError = 98,
+    HrStateError = 99,
+};
+
+// What went wrong, for events in an error state (HrErrorNone otherwise)
+enum HrErrorCategory : int32_t {
+    HrErrorNone = 0,
+    HrErrorNoDevice,              // Scan found no HR device
+    HrErrorDeviceUnavailable,     // BluetoothLEDevice could not be opened
+    HrErrorServiceNotFound,       // 0x180D missing or GATT failure
+    HrErrorCharacteristicNotFound,// 0x2A37 missing or GATT failure
+    HrErrorSubscribeFailed,       // CCCD write failed
+    HrErrorMalformedData,         // Notification could not be parsed
+    HrErrorWinRt,                 // hresult_error, see hresult
+    HrErrorStd,                   // std::exception
+    HrErrorThread,                // Worker thread could not be started or joined
+    HrErrorTimeout,               // Operation missed its deadline (e.g. stop/cleanup)
+    HrErrorUnknown,
+};
+
+// Typed status event (see RegisterStatusEventCallback / PollStatusEvent)
+struct HrStatusEvent {
+    int64_t timestampUs;    // Monotonic time of the event
+    uint64_t deviceAddress; // Bluetooth address of the device, 0 if not yet known
+    uint32_t sequence;      // Increments per event; gaps mean the poll queue overflowed
+    int32_t state;          // HrState
+    int32_t category;       // HrErrorCategory
+    int32_t hresult;        // HRESULT for HrErrorWinRt, S_OK otherwise
+};
+
+// Maximum RR intervals carried per sample
+constexpr int kHrSampleMaxRr = 16;
+
+// One decoded Heart Rate Measurement as delivered to consumers
+struct HrSample {
+    int64_t timestampUs;     // Monotonic arrival time
+    uint64_t deviceAddress;  // Bluetooth address of the device
+    uint64_t sequence;       // Per-session sample counter, starts at 1
+    uint16_t bpm;
+    uint16_t energyExpended; // kJ, valid if flags & 0x08
+    uint8_t flags;           // Raw 0x2A37 flags (contact bits 0x02/0x04, RR present 0x10)
+    uint8_t rrCount;
+    uint16_t rr[kHrSampleMaxRr]; // RR intervals, 1/1024 s
+};
+
+// How a heart rate subscriber is called (see AddHeartRateSubscriber)
+enum HrDeliveryPolicy : int32_t {
+    HrDeliveryEverySample = 0, // Called on the notification thread for every sample
+    HrDeliveryCoalesce = 1,    // Latest sample only, at most once per interval
+    HrDeliveryBatch = 2,       // Every interval with all samples since the last call (up to 32)
+};
+
+// Per-device link quality counters (see GetLinkStats)
+struct HrLinkStats {
+    uint64_t deviceAddress;      // Bluetooth address of the device, 0 if none
+    uint64_t received;           // Well-formed notifications received
+    uint64_t droppedEstimated;   // Notifications estimated lost from arrival gaps
+    uint64_t malformed;          // Notifications that failed to parse
+    uint64_t late;               // Notifications that arrived late but within the loss threshold
+    uint32_t jitterUs;           // Smoothed inter-arrival jitter (RFC 3550 style)
+    uint32_t nominalIntervalUs;  // Learned notification cadence
+};
+
+// Struct-of-arrays output for DecodeHrBatch. Arrays are caller-owned; count = packets.
+struct HrBatchOutput {
+    uint16_t* bpm;            // [count], 0 for malformed packets
+    uint16_t* energyExpended; // [count] or null
+    uint8_t* flags;           // [count] or null
+    uint8_t* valid;           // [count]: 1 decoded, 0 malformed
+    uint32_t* rrStart;        // [count + 1]: packet i's RR are rr[rrStart[i] .. rrStart[i + 1])
+    uint16_t* rr;             // [rrCapacity], 1/1024 s
+    uint32_t rrCapacity;
+    uint32_t reserved;
+};
+
+// Heap allocation counters; only collected in builds with HR_TRACK_ALLOCATIONS defined
+struct HrAllocationStats {
+    uint64_t totalAllocations;   // operator new calls in this DLL
+    uint64_t hotPathAllocations; // Of those, made on the streaming path after warm-up (should be 0)
+    uint32_t enabled;            // 1 if this build tracks allocations
+    uint32_t reserved;
+};
+
+// Raw capture counters (see GetCaptureStats)
+struct HrCaptureStats {
+    uint64_t records;      // Notifications and status events recorded
+    uint64_t dropped;      // Records lost because the writer fell behind the disk
+    uint64_t bytesWritten; // File size so far
+    uint32_t active;       // 1 while capturing
+    uint32_t writeFailed;  // 1 if a disk write failed (capture is incomplete)
+};
+
+// Transport faults to inject for resilience testing (see SetFaultInjection). Rates are
+// probabilities per event (0..1) unless noted; all zero disables injection.
+struct HrFaultConfig {
+    uint64_t seed;                // Random seed, 0 = pick one
+    double dropRate;              // Notifications discarded before the engine sees them
+    double delayRate;             // Notifications held back by delayMinMs..delayMaxMs
+    double malformedRate;         // Notifications truncated so they fail to parse
+    double cccdFailureRate;       // CCCD writes (subscribe / resubscribe) reported as failed
+    double disconnectsPerHour;    // Spurious link drops while streaming
+    double slowDiscoveryRate;     // Connects whose service discovery is held back
+    uint32_t delayMinMs;
+    uint32_t delayMaxMs;
+    uint32_t discoveryDelayMinMs;
+    uint32_t discoveryDelayMaxMs;
+};
+
+// Faults injected so far (see GetFaultStats)
+struct HrFaultStats {
+    uint64_t dropped;
+    uint64_t delayed;
+    uint64_t malformed;
+    uint64_t cccdFailures;
+    uint64_t disconnects;
+    uint64_t slowDiscoveries;
+};
+
+// Connection startup phases, in order (see GetStartupProfile / GetStartupStats)
+enum HrStartupPhase : int32_t {
+    HrStartupLaunch = 0,      // StartHrMonitoring until the session worker runs (first attempt only)
+    HrStartupScan = 1,        // Device enumeration (first attempt only; reconnects skip it)
+    HrStartupConnect = 2,     // Opening the BluetoothLEDevice
+    HrStartupDiscover = 3,    // Service and characteristic lookup; the radio link comes up here
+    HrStartupSubscribe = 4,   // CCCD write
+    HrStartupFirstSample = 5, // Subscribed until the first well-formed notification
+    HrStartupTotal = 6,       // Whole attempt, start to first sample
+    HrStartupPhaseCount = 7,
+};
+
+constexpr int32_t kHrStartupStopped = -1; // HrStartupProfile::outcome when Stop came first
+
+// Timing of one connection attempt, on the monotonic clock
+struct HrStartupProfile {
+    int64_t startUs;                       // StartHrMonitoring for a session's first attempt
+    uint32_t phaseUs[HrStartupPhaseCount]; // 0 for phases not reached or skipped
+    uint32_t completedPhases;              // Bit (1 << HrStartupPhase) per phase that finished
+    int32_t reconnect;                     // 1 for a reconnect to the session's known device
+    int32_t outcome;                       // HrErrorNone once the first sample arrived, else HrErrorCategory or kHrStartupStopped
+    int32_t failedPhase;                   // Phase running when the attempt ended early, -1 on success
+    int32_t prewarmed;                     // 1 if it went straight to a strap the pre-warm scan had heard
+};
+
+// One phase across all attempts since load or ResetStartupStats; percentiles within ~6%
+struct HrStartupPhaseStats {
+    uint64_t count;    // Attempts that completed the phase
+    uint64_t failures; // Attempts that failed during it (stops not counted)
+    uint32_t p50Us;
+    uint32_t p90Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+// InitializePluginEx flags
+enum HrInitFlags : int32_t {
+    HrInitPrewarm = 1, // Start the runtime, check the adapter and keep a passive scan running between sessions
+};
+
+enum HrPrewarmState : int32_t {
+    HrPrewarmOff = 0,
+    HrPrewarmStarting = 1,  // Runtime up, adapter query in flight
+    HrPrewarmScanning = 2,  // Passive scan listening for HR straps
+    HrPrewarmPaused = 3,    // Scan stopped while a session uses the radio
+    HrPrewarmNoAdapter = 4, // No Bluetooth LE central-capable adapter
+    HrPrewarmFailed = 5,    // See hresult
+};
+
+// Pre-warm status (see GetPrewarmStats)
+struct HrPrewarmStats {
+    uint64_t adapterAddress;     // 0 until the adapter query finished
+    uint64_t advertisements;     // HR service advertisements heard
+    uint64_t candidateAddress;   // Strap the next Start would connect to directly, 0 if none in range
+                                 // (only a paired HR strap or the last one streamed from qualifies)
+    int32_t state;               // HrPrewarmState
+    int32_t hresult;             // For HrPrewarmFailed
+    uint32_t devices;            // Distinct straps heard
+    uint32_t knownStraps;        // Paired HR straps found when pre-warm started, plus the last one used
+};
+
+// Wire format for StartNetPublisher
+enum HrNetFormat : int32_t {
+    HrNetFormatBinary = 0, // Length-prefixed little-endian frames
+    HrNetFormatJson = 1,   // One JSON object per line
+};
+
+// Network publisher counters (see GetNetPublisherStats)
+struct HrNetStats {
+    uint32_t tcpClients;      // Connected TCP clients
+    uint32_t udpSubscribers;  // Live UDP subscribers
+    uint64_t framesPublished; // Samples handed to the publisher
+    uint64_t framesDropped;   // Frames skipped for clients that fell behind
+};
@@ -0,0 +1,300 @@
+#include "pch.h"
+#include "BatchDecoder.h"
+#include "HrMeasurement.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HR_BATCH_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+    struct BatchState {
+        const uint8_t* data;
+        const uint32_t* offsets;
+        HrBatchOutput& out;
+        uint32_t rrUsed;
+    };
+
+    // Writes one packet's header fields and copies its RR intervals. False if out.rr is full.
+    bool Emit(BatchState& state, int i, uint32_t flags, uint32_t bpm, uint32_t energy, bool valid, uint32_t fixed) {
+        HrBatchOutput& out = state.out;
+        uint32_t rrCount = 0;
+        if (valid && (flags & kHrFlagRrPresent)) {
+            uint32_t length = state.offsets[i + 1] - state.offsets[i];
+            rrCount = (length - fixed) / 2;
+            if (rrCount > kMaxRrIntervals) {
+                rrCount = kMaxRrIntervals;
+            }
+            if (state.rrUsed + rrCount > out.rrCapacity) {
+                return false;
+            }
+            const uint8_t* rr = state.data + state.offsets[i] + fixed;
+            for (uint32_t k = 0; k < rrCount; ++k) {
+                out.rr[state.rrUsed + k] = ReadLe16(rr + 2 * k);
+            }
+        }
+        out.bpm[i] = static_cast<uint16_t>(valid ? bpm : 0);
+        if (out.energyExpended) {
+            out.energyExpended[i] = static_cast<uint16_t>(valid ? energy : 0);
+        }
+        if (out.flags) {
+            out.flags[i] = static_cast<uint8_t>(flags);
+        }
+        out.valid[i] = valid ? 1 : 0;
+        out.rrStart[i] = state.rrUsed;
+        state.rrUsed += rrCount;
+        out.rrStart[i + 1] = state.rrUsed;
+        return true;
+    }
+
+    // Per-packet path, also used for block tails
+    int DecodeScalar(BatchState& state, int first, int count) {
+        for (int i = first; i < count; ++i) {
+            uint32_t offset = state.offsets[i];
+            uint32_t length = state.offsets[i + 1] - offset;
+            HrMeasurement m;
+            bool valid = ParseHrMeasurement(state.data + offset, length, m);
+            uint32_t flags = length > 0 ? state.data[offset] : 0;
+            uint32_t fixed = 1 + ((flags & kHrFlagValueUInt16) ? 2 : 1) + ((flags & kHrFlagEnergyExpended) ? 2 : 0);
+            if (!Emit(state, i, flags, m.bpm, m.energyExpended, valid, fixed)) {
+                return i;
+            }
+        }
+        return count;
+    }
+
+#ifdef HR_BATCH_X86
+    // GCC and Clang only compile the vector kernels for the ISA named here, since the build as a
+    // whole targets plain x86 (MSVC takes the intrinsics anywhere)
+#if defined(_MSC_VER)
+#define HR_TARGET_SSE2
+#define HR_TARGET_AVX2
+#else
+#define HR_TARGET_SSE2 __attribute__((target("sse2")))
+#define HR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+    // Blocks read up to 8 header bytes past each packet start and copy RR intervals as one
+    // 32-byte move, so only whole blocks with that much buffer left are vectorised
+    constexpr size_t kReadSlack = 40;
+    constexpr uint32_t kWriteSlack = kMaxRrIntervals; // RR copies may write this far past rrUsed
+
+    int VectorLimit(const uint32_t* offsets, int count, size_t dataSize, int width) {
+        int limit = 0;
+        while (limit + width <= count && static_cast<size_t>(offsets[limit + width]) + kReadSlack <= dataSize) {
+            limit += width;
+        }
+        return limit;
+    }
+
+    // Copies each packet's RR block with fixed-size moves. False (nothing written) if the
+    // block might not fit, so the caller can finish with the exact scalar path.
+    template <int Width>
+    HR_TARGET_SSE2 bool CopyRr(BatchState& state, int i, const uint32_t* fixed, const uint32_t* rrCount) {
+        uint32_t total = 0;
+        for (int k = 0; k < Width; ++k) {
+            total += rrCount[k];
+        }
+        if (state.rrUsed + total + kWriteSlack > state.out.rrCapacity) {
+            return false;
+        }
+        for (int k = 0; k < Width; ++k) {
+            const uint8_t* source = state.data + state.offsets[i + k] + fixed[k];
+            uint16_t* target = state.out.rr + state.rrUsed;
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + 8), high);
+            state.out.rrStart[i + k] = state.rrUsed;
+            state.rrUsed += rrCount[k];
+        }
+        state.out.rrStart[i + Width] = state.rrUsed;
+        return true;
+    }
+
+    HR_TARGET_SSE2 int DecodeSse2(BatchState& state, int count, size_t dataSize) {
+        HrBatchOutput& out = state.out;
+        int limit = VectorLimit(state.offsets, count, dataSize, 4);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i byteMask = _mm_set1_epi32(0xFF);
+        const __m128i maxRr = _mm_set1_epi32(kMaxRrIntervals);
+        alignas(16) uint32_t words[4], energyWords[4];
+        alignas(16) uint32_t flags[4], bpm[4], energyOut[4], fixed[4], valid[4], rrCount[4];
+        for (int i = 0; i < limit; i += 4) {
+            for (int k = 0; k < 4; ++k) {
+                const uint8_t* p = state.data + state.offsets[i + k];
+                memcpy(&words[k], p, 4);
+                memcpy(&energyWords[k], p + 2 + (p[0] & kHrFlagValueUInt16), 4);
+            }
+            __m128i word = _mm_load_si128(reinterpret_cast<const __m128i*>(words));
+            __m128i begin = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state.offsets + i));
+            __m128i end = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state.offsets + i + 1));
+            __m128i length = _mm_sub_epi32(end, begin);
+            __m128i f = _mm_andnot_si128(_mm_cmpeq_epi32(length, zero), _mm_and_si128(word, byteMask));
+            __m128i wide = _mm_and_si128(f, one);
+            __m128i energy = _mm_and_si128(_mm_srli_epi32(f, 3), one);
+            __m128i rrPresent = _mm_and_si128(_mm_srli_epi32(f, 4), one);
+            __m128i wideMask = _mm_cmpeq_epi32(wide, one);
+            __m128i hr8 = _mm_and_si128(_mm_srli_epi32(word, 8), byteMask);
+            __m128i hr16 = _mm_and_si128(_mm_srli_epi32(word, 8), _mm_set1_epi32(0xFFFF));
+            __m128i hr = _mm_or_si128(_mm_and_si128(wideMask, hr16), _mm_andnot_si128(wideMask, hr8));
+            __m128i fix = _mm_add_epi32(_mm_add_epi32(_mm_set1_epi32(2), wide), _mm_slli_epi32(energy, 1));
+            // Valid: length >= fixed, and an even RR tail when RR is present (lengths are < 2^31)
+            __m128i tail = _mm_sub_epi32(length, fix);
+            __m128i oddTail = _mm_cmpeq_epi32(_mm_and_si128(_mm_and_si128(tail, one), rrPresent), one);
+            __m128i ok = _mm_cmpeq_epi32(_mm_or_si128(_mm_cmpgt_epi32(fix, length), oddTail), zero);
+            __m128i rr = _mm_and_si128(_mm_srli_epi32(tail, 1), _mm_and_si128(ok, _mm_cmpeq_epi32(rrPresent, one)));
+            __m128i over = _mm_cmpgt_epi32(rr, maxRr);
+            rr = _mm_or_si128(_mm_and_si128(over, maxRr), _mm_andnot_si128(over, rr));
+            __m128i e = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(energyWords)), _mm_set1_epi32(0xFFFF));
+            e = _mm_and_si128(e, _mm_and_si128(ok, _mm_cmpeq_epi32(energy, one)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(flags), f);
+            _mm_store_si128(reinterpret_cast<__m128i*>(bpm), _mm_and_si128(hr, ok));
+            _mm_store_si128(reinterpret_cast<__m128i*>(energyOut), e);
+            _mm_store_si128(reinterpret_cast<__m128i*>(fixed), fix);
+            _mm_store_si128(reinterpret_cast<__m128i*>(valid), _mm_and_si128(ok, one));
+            _mm_store_si128(reinterpret_cast<__m128i*>(rrCount), rr);
+            if (!CopyRr<4>(state, i, fixed, rrCount)) {
+                return DecodeScalar(state, i, count);
+            }
+            for (int k = 0; k < 4; ++k) {
+                out.bpm[i + k] = static_cast<uint16_t>(bpm[k]);
+                out.valid[i + k] = static_cast<uint8_t>(valid[k]);
+            }
+            if (out.energyExpended) {
+                for (int k = 0; k < 4; ++k) {
+                    out.energyExpended[i + k] = static_cast<uint16_t>(energyOut[k]);
+                }
+            }
+            if (out.flags) {
+                for (int k = 0; k < 4; ++k) {
+                    out.flags[i + k] = static_cast<uint8_t>(flags[k]);
+                }
+            }
+        }
+        return DecodeScalar(state, limit, count);
+    }
+
+    // 8 x uint32 (each <= 0xFFFF) to 8 x uint16
+    HR_TARGET_AVX2 inline __m128i Narrow16(__m256i v) {
+        return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08));
+    }
+
+    HR_TARGET_AVX2 int DecodeAvx2(BatchState& state, int count, size_t dataSize) {
+        HrBatchOutput& out = state.out;
+        int limit = VectorLimit(state.offsets, count, dataSize, 8);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i byteMask = _mm256_set1_epi32(0xFF);
+        const __m256i wordMask = _mm256_set1_epi32(0xFFFF);
+        const int* base = reinterpret_cast<const int*>(state.data);
+        alignas(32) uint32_t fixed[8], rrCount[8];
+        for (int i = 0; i < limit; i += 8) {
+            __m256i begin = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.offsets + i));
+            __m256i end = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.offsets + i + 1));
+            __m256i length = _mm256_sub_epi32(end, begin);
+            __m256i word = _mm256_i32gather_epi32(base, begin, 1);
+            __m256i f = _mm256_andnot_si256(_mm256_cmpeq_epi32(length, zero), _mm256_and_si256(word, byteMask));
+            __m256i wide = _mm256_and_si256(f, one);
+            __m256i energy = _mm256_and_si256(_mm256_srli_epi32(f, 3), one);
+            __m256i rrPresent = _mm256_and_si256(_mm256_srli_epi32(f, 4), one);
+            __m256i hr8 = _mm256_and_si256(_mm256_srli_epi32(word, 8), byteMask);
+            __m256i hr16 = _mm256_and_si256(_mm256_srli_epi32(word, 8), wordMask);
+            __m256i hr = _mm256_blendv_epi8(hr8, hr16, _mm256_cmpeq_epi32(wide, one));
+            __m256i fix = _mm256_add_epi32(_mm256_add_epi32(_mm256_set1_epi32(2), wide), _mm256_slli_epi32(energy, 1));
+            __m256i tail = _mm256_sub_epi32(length, fix);
+            __m256i oddTail = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_and_si256(tail, one), rrPresent), one);
+            __m256i ok = _mm256_cmpeq_epi32(_mm256_or_si256(_mm256_cmpgt_epi32(fix, length), oddTail), zero);
+            __m256i rr = _mm256_and_si256(_mm256_srli_epi32(tail, 1), _mm256_and_si256(ok, _mm256_cmpeq_epi32(rrPresent, one)));
+            rr = _mm256_min_epu32(rr, _mm256_set1_epi32(kMaxRrIntervals));
+            // Energy sits right after HR; only gathered where present in a valid packet
+            __m256i energyMask = _mm256_and_si256(ok, _mm256_cmpeq_epi32(energy, one));
+            __m256i energyIndex = _mm256_add_epi32(begin, _mm256_add_epi32(_mm256_set1_epi32(2), wide));
+            __m256i e = _mm256_mask_i32gather_epi32(zero, base, energyIndex, energyMask, 1);
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(fixed), fix);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(rrCount), rr);
+            if (!CopyRr<8>(state, i, fixed, rrCount)) {
+                return DecodeScalar(state, i, count);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out.bpm + i), Narrow16(_mm256_and_si256(hr, ok)));
+            __m128i valid16 = Narrow16(_mm256_and_si256(ok, one));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out.valid + i), _mm_packus_epi16(valid16, valid16));
+            if (out.energyExpended) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out.energyExpended + i), Narrow16(_mm256_and_si256(e, wordMask)));
+            }
+            if (out.flags) {
+                __m128i flags16 = Narrow16(f);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out.flags + i), _mm_packus_epi16(flags16, flags16));
+            }
+        }
+        return DecodeScalar(state, limit, count);
+    }
+
+    bool CpuHasSse2() {
+#if defined(_MSC_VER) || defined(__x86_64__)
+        return true; // Part of the x64 baseline; MSVC's x86 target requires it too
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+
+    bool CpuHasAvx2() {
+#if !defined(_MSC_VER)
+        return __builtin_cpu_supports("avx2"); // Also checks that the OS saves YMM state
+#else
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false; // The OS doesn't save YMM state
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#endif
+    }
+#endif
+}
+
+BatchDecoderKind SelectedBatchDecoder() {
+#ifdef HR_BATCH_X86
+    static const BatchDecoderKind kind = CpuHasAvx2() ? BatchDecoderKind::Avx2
+        : CpuHasSse2() ? BatchDecoderKind::Sse2 : BatchDecoderKind::Scalar;
+    return kind;
+#else
+    return BatchDecoderKind::Scalar;
+#endif
+}
+
+int DecodeHrBatch(const uint8_t* data, size_t dataSize, const uint32_t* offsets, int count,
+    HrBatchOutput& out, BatchDecoderKind kind) {
+    BatchState state{ data, offsets, out, 0 };
+    out.rrStart[0] = 0;
+    // Gathers take signed 32-bit indices
+    if (dataSize > 0x7FFFFFFF) {
+        kind = BatchDecoderKind::Scalar;
+    }
+#ifdef HR_BATCH_X86
+    BatchDecoderKind supported = SelectedBatchDecoder();
+    if (kind == BatchDecoderKind::Avx2 && supported == BatchDecoderKind::Avx2) {
+        return DecodeAvx2(state, count, dataSize);
+    }
+    if (kind != BatchDecoderKind::Scalar && supported != BatchDecoderKind::Scalar) {
+        return DecodeSse2(state, count, dataSize);
+    }
+#else
+    (void)kind; // Only the scalar decoder exists here
+    (void)dataSize;
+#endif
+    return DecodeScalar(state, 0, count);
+}
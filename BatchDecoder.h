@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "BLEHeartRateMonitor.h"
+
+// --- Batch 0x2A37 decoding for recorded streams ---
+// Decodes many stored payloads at once into struct-of-arrays output, with the same results
+// (including the per-packet RR cap and malformed rules) as the live ParseHrMeasurement.
+// Packet i is data[offsets[i] .. offsets[i + 1]). The header of each packet (flags, HR,
+// energy, layout checks) is decoded 8 at a time with AVX2 gathers or 4 at a time with SSE2,
+// chosen at runtime; the tail and non-x86 builds use the scalar table decoder.
+
+enum class BatchDecoderKind { Scalar = 0, Sse2 = 1, Avx2 = 2 };
+
+BatchDecoderKind SelectedBatchDecoder();
+
+// Returns the number of packets decoded; fewer than count if out.rr filled up (call again
+// from there with a fresh rr buffer).
+int DecodeHrBatch(const uint8_t* data, size_t dataSize, const uint32_t* offsets, int count,
+    HrBatchOutput& out, BatchDecoderKind kind);
@@ -0,0 +1,194 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "HrMeasurement.h"
+
+// --- Raw notification capture format ---
+// Written by CaptureWriter (see StartCapture); read back with CaptureReader, which only needs
+// the C++ standard library so captures can be replayed through ParseHrMeasurement off Windows.
+//
+// File: CaptureFileHeader, then records. Everything is little endian.
+// Record: u8 type, u8 device, u16 length, i32 timestamp delta (us since the previous record),
+// then length payload bytes:
+//   Device       u64 Bluetooth address; later records with this device index refer to it
+//   Notification the raw 0x2A37 value exactly as received
+//   Status       i32 state, i32 category, i32 hresult (an HrStatusEvent)
+//   Clock        i64 absolute timestamp (us), written when a delta would not fit in 32 bits
+// Device index kCaptureNoDevice means no device (e.g. status before a device is known).
+
+constexpr uint32_t kCaptureMagic = 0x50435248; // 'HRCP'
+constexpr uint16_t kCaptureVersion = 1;
+constexpr uint8_t kCaptureNoDevice = 0xFF;
+constexpr size_t kCaptureRecordHeaderBytes = 8;
+
+enum CaptureRecordType : uint8_t {
+    CaptureRecordDevice = 1,
+    CaptureRecordNotification = 2,
+    CaptureRecordStatus = 3,
+    CaptureRecordClock = 4,
+};
+
+struct CaptureFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;   // sizeof(CaptureFileHeader); records start here
+    int64_t startTimestampUs; // Base for the first record's delta
+};
+static_assert(sizeof(CaptureFileHeader) == 16, "CaptureFileHeader is a file format");
+
+inline void WriteCaptureRecordHeader(uint8_t* p, uint8_t type, uint8_t device, uint16_t length, int32_t delta) {
+    p[0] = type;
+    p[1] = device;
+    p[2] = static_cast<uint8_t>(length);
+    p[3] = static_cast<uint8_t>(length >> 8);
+    for (int i = 0; i < 4; ++i) {
+        p[4 + i] = static_cast<uint8_t>(static_cast<uint32_t>(delta) >> (8 * i));
+    }
+}
+
+// One notification or status record, with the device and clock records already applied
+struct CaptureEvent {
+    uint8_t type;           // CaptureRecordNotification or CaptureRecordStatus
+    int64_t timestampUs;    // Arrival time on the capturing machine's monotonic clock
+    uint64_t deviceAddress; // 0 if none
+    const uint8_t* payload; // Valid until the next call to Next
+    uint16_t length;
+};
+
+// Sequential reader (header-only)
+class CaptureReader {
+public:
+    ~CaptureReader() { Close(); }
+
+    bool Open(const char* path) {
+        Close();
+        m_file = std::fopen(path, "rb");
+        if (!m_file) {
+            return false;
+        }
+        uint8_t raw[sizeof(CaptureFileHeader)];
+        if (std::fread(raw, 1, sizeof(raw), m_file) != sizeof(raw)) {
+            Close();
+            return false;
+        }
+        uint32_t magic = ReadLe32(raw);
+        uint16_t version = ReadLe16(raw + 4);
+        uint16_t headerSize = ReadLe16(raw + 6);
+        if (magic != kCaptureMagic || version != kCaptureVersion || headerSize < sizeof(raw)
+            || std::fseek(m_file, headerSize, SEEK_SET) != 0) {
+            Close();
+            return false;
+        }
+        m_timestampUs = static_cast<int64_t>(ReadLe32(raw + 8) | (static_cast<uint64_t>(ReadLe32(raw + 12)) << 32));
+        for (uint64_t& address : m_devices) {
+            address = 0;
+        }
+        m_truncated = false;
+        return true;
+    }
+
+    void Close() {
+        if (m_file) {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    // Next notification or status record. False at end of file (see Truncated).
+    bool Next(CaptureEvent& out) {
+        uint8_t header[kCaptureRecordHeaderBytes];
+        while (m_file) {
+            size_t got = std::fread(header, 1, sizeof(header), m_file);
+            if (got != sizeof(header)) {
+                m_truncated = got != 0;
+                return false;
+            }
+            uint8_t type = header[0];
+            uint8_t device = header[1];
+            uint16_t length = ReadLe16(header + 2);
+            m_timestampUs += static_cast<int32_t>(ReadLe32(header + 4));
+            m_payload.resize(length);
+            if (length > 0 && std::fread(m_payload.data(), 1, length, m_file) != length) {
+                m_truncated = true; // Writer stopped mid-record (e.g. the process died)
+                return false;
+            }
+            if (type == CaptureRecordDevice && length >= 8) {
+                m_devices[device] = ReadLe32(m_payload.data()) | (static_cast<uint64_t>(ReadLe32(m_payload.data() + 4)) << 32);
+            }
+            else if (type == CaptureRecordClock && length >= 8) {
+                m_timestampUs = static_cast<int64_t>(ReadLe32(m_payload.data())
+                    | (static_cast<uint64_t>(ReadLe32(m_payload.data() + 4)) << 32));
+            }
+            else if (type == CaptureRecordNotification || type == CaptureRecordStatus) {
+                out.type = type;
+                out.timestampUs = m_timestampUs;
+                out.deviceAddress = device == kCaptureNoDevice ? 0 : m_devices[device];
+                out.payload = m_payload.data();
+                out.length = length;
+                return true;
+            }
+            // Unknown record types are skipped so newer writers stay readable
+        }
+        return false;
+    }
+
+    // True if the file ended in the middle of a record
+    bool Truncated() const { return m_truncated; }
+
+private:
+    static uint32_t ReadLe32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    std::FILE* m_file = nullptr;
+    std::vector<uint8_t> m_payload;
+    uint64_t m_devices[256] = {};
+    int64_t m_timestampUs = 0;
+    bool m_truncated = false;
+};
+
+// Decodes a CaptureRecordStatus payload
+inline bool ReadCaptureStatus(const CaptureEvent& event, int32_t& state, int32_t& category, int32_t& hresult) {
+    if (event.type != CaptureRecordStatus || event.length < 12) {
+        return false;
+    }
+    int32_t fields[3];
+    for (int i = 0; i < 3; ++i) {
+        const uint8_t* p = event.payload + 4 * i;
+        fields[i] = static_cast<int32_t>(static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24));
+    }
+    state = fields[0];
+    category = fields[1];
+    hresult = fields[2];
+    return true;
+}
+
+// Feeds every captured notification through the live parser, in capture order:
+// onPacket(const CaptureEvent&, const HrMeasurement&, bool parsed). Status records go to
+// onStatus(const CaptureEvent&). Returns the number of notifications, or -1 if path can't be read.
+template <typename OnPacket, typename OnStatus>
+int64_t ReplayCapture(const char* path, OnPacket&& onPacket, OnStatus&& onStatus) {
+    CaptureReader reader;
+    if (!reader.Open(path)) {
+        return -1;
+    }
+    int64_t notifications = 0;
+    CaptureEvent event;
+    while (reader.Next(event)) {
+        if (event.type == CaptureRecordNotification) {
+            HrMeasurement measurement;
+            bool parsed = ParseHrMeasurement(event.payload, event.length, measurement);
+            onPacket(event, measurement, parsed);
+            ++notifications;
+        }
+        else {
+            onStatus(event);
+        }
+    }
+    return notifications;
+}
@@ -0,0 +1,238 @@
+#include "pch.h"
+#include "CaptureWriter.h"
+#ifdef _WIN32
+#include "Executor.h"
+#endif
+#include <cstring>
+#include <new>
+#include <utility>
+
+CaptureWriter g_capture;
+
+bool CaptureWriter::Start(const char* path, int64_t nowUs) {
+    Stop();
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    if (!m_active) {
+        m_active.reset(new (std::nothrow) uint8_t[kBufferBytes]);
+        m_spare.reset(new (std::nothrow) uint8_t[kBufferBytes]);
+        if (!m_active || !m_spare) {
+            m_active.reset();
+            m_spare.reset();
+            return false;
+        }
+    }
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    CaptureFileHeader header{};
+    header.magic = kCaptureMagic;
+    header.version = kCaptureVersion;
+    header.headerSize = sizeof(header);
+    header.startTimestampUs = nowUs;
+    if (std::fwrite(&header, 1, sizeof(header), file) != sizeof(header)) {
+        std::fclose(file);
+        return false;
+    }
+    m_file = file;
+    m_records = 0;
+    m_dropped = 0;
+    m_bytesWritten = sizeof(header);
+    m_writeFailed = false;
+    m_flushQueued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_used = 0;
+        m_lastTimestampUs = nowUs;
+        m_deviceCount = 0;
+        m_running.store(true, std::memory_order_release);
+    }
+    m_timer.callback = &OnTimer;
+    m_timer.context = this;
+    g_timers.Schedule(m_timer, kFlushIntervalMs);
+    return true;
+}
+
+void CaptureWriter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!Running()) {
+            return;
+        }
+        m_running.store(false, std::memory_order_release);
+    }
+    g_timers.Cancel(m_timer);
+#ifndef _WIN32
+    // Not running any more, so QueueFlush starts no new thread; join outside the lock the
+    // pending flush itself needs
+    std::thread pending;
+    {
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        pending = std::move(m_flushThread);
+    }
+    if (pending.joinable()) {
+        pending.join();
+    }
+#endif
+    Flush();
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    std::fclose(m_file);
+    m_file = nullptr; // A flush still queued on the pool now does nothing
+}
+
+void CaptureWriter::RecordNotification(uint64_t deviceAddress, int64_t timestampUs, const uint8_t* data, size_t length) {
+    if (!Running()) {
+        return;
+    }
+    Append(CaptureRecordNotification, deviceAddress, timestampUs, data, length);
+}
+
+void CaptureWriter::RecordStatus(uint64_t deviceAddress, int64_t timestampUs, int32_t state, int32_t category, int32_t hresult) {
+    if (!Running()) {
+        return;
+    }
+    uint8_t payload[12];
+    const int32_t fields[3] = { state, category, hresult };
+    for (int i = 0; i < 3; ++i) {
+        for (int b = 0; b < 4; ++b) {
+            payload[4 * i + b] = static_cast<uint8_t>(static_cast<uint32_t>(fields[i]) >> (8 * b));
+        }
+    }
+    Append(CaptureRecordStatus, deviceAddress, timestampUs, payload, sizeof(payload));
+}
+
+void CaptureWriter::Snapshot(HrCaptureStats& out) const {
+    out.records = m_records.load(std::memory_order_relaxed);
+    out.dropped = m_dropped.load(std::memory_order_relaxed);
+    out.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    out.active = Running() ? 1 : 0;
+    out.writeFailed = m_writeFailed.load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+void CaptureWriter::Append(uint8_t type, uint64_t deviceAddress, int64_t timestampUs, const uint8_t* payload, size_t length) {
+    if (length > kMaxPayload) {
+        length = kMaxPayload;
+    }
+    bool flush = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!Running()) {
+            return;
+        }
+        // Room for a clock record, a device record and this one
+        size_t worst = 3 * kCaptureRecordHeaderBytes + 16 + length;
+        if (m_used + worst > kBufferBytes) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            flush = true;
+        }
+        else {
+            uint8_t device = DeviceIndex(deviceAddress, timestampUs);
+            Put(type, device, timestampUs, payload, length);
+            m_records.fetch_add(1, std::memory_order_relaxed);
+            flush = m_used >= kBufferBytes / 2;
+        }
+    }
+    if (flush) {
+        QueueFlush();
+    }
+}
+
+void CaptureWriter::Put(uint8_t type, uint8_t device, int64_t timestampUs, const uint8_t* payload, size_t length) {
+    int64_t delta = timestampUs - m_lastTimestampUs;
+    if (delta < INT32_MIN || delta > INT32_MAX) {
+        uint8_t* p = m_active.get() + m_used;
+        WriteCaptureRecordHeader(p, CaptureRecordClock, kCaptureNoDevice, 8, 0);
+        for (int i = 0; i < 8; ++i) {
+            p[kCaptureRecordHeaderBytes + i] = static_cast<uint8_t>(static_cast<uint64_t>(timestampUs) >> (8 * i));
+        }
+        m_used += kCaptureRecordHeaderBytes + 8;
+        delta = 0;
+    }
+    m_lastTimestampUs = timestampUs;
+    uint8_t* p = m_active.get() + m_used;
+    WriteCaptureRecordHeader(p, type, device, static_cast<uint16_t>(length), static_cast<int32_t>(delta));
+    if (length > 0) {
+        memcpy(p + kCaptureRecordHeaderBytes, payload, length);
+    }
+    m_used += kCaptureRecordHeaderBytes + length;
+}
+
+// Small table of devices seen in this capture; a new one gets a Device record first
+uint8_t CaptureWriter::DeviceIndex(uint64_t deviceAddress, int64_t timestampUs) {
+    if (deviceAddress == 0) {
+        return kCaptureNoDevice;
+    }
+    for (uint32_t i = 0; i < m_deviceCount; ++i) {
+        if (m_devices[i] == deviceAddress) {
+            return static_cast<uint8_t>(i);
+        }
+    }
+    if (m_deviceCount == kCaptureNoDevice) {
+        m_deviceCount = 0; // Table full: start reassigning indexes (the reader follows along)
+    }
+    uint8_t index = static_cast<uint8_t>(m_deviceCount++);
+    m_devices[index] = deviceAddress;
+    uint8_t payload[8];
+    for (int i = 0; i < 8; ++i) {
+        payload[i] = static_cast<uint8_t>(deviceAddress >> (8 * i));
+    }
+    Put(CaptureRecordDevice, index, timestampUs, payload, sizeof(payload));
+    return index;
+}
+
+void CaptureWriter::QueueFlush() {
+    if (m_flushQueued.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+#ifdef _WIN32
+    if (!g_executor.Submit(&FlushCallback, this)) {
+        m_flushQueued.store(false, std::memory_order_release); // Timer retries
+    }
+#else
+    // The previous flush has finished (it cleared m_flushQueued), so this join doesn't wait
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    if (!Running()) {
+        m_flushQueued.store(false, std::memory_order_release); // Stop writes the rest itself
+        return;
+    }
+    if (m_flushThread.joinable()) {
+        m_flushThread.join();
+    }
+    m_flushThread = std::thread([this] { Flush(); });
+#endif
+}
+
+#ifdef _WIN32
+void CALLBACK CaptureWriter::FlushCallback(PTP_CALLBACK_INSTANCE, void* context) {
+    static_cast<CaptureWriter*>(context)->Flush();
+}
+#endif
+
+void CaptureWriter::OnTimer(void* context) {
+    auto writer = static_cast<CaptureWriter*>(context);
+    writer->QueueFlush();
+    if (writer->Running()) {
+        g_timers.Schedule(writer->m_timer, kFlushIntervalMs);
+    }
+}
+
+// Swaps the recording buffer for the spare one and writes it out, off the recording lock
+void CaptureWriter::Flush() {
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    if (m_file) {
+        size_t length;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::swap(m_active, m_spare);
+            length = m_used;
+            m_used = 0;
+        }
+        size_t written = length > 0 ? std::fwrite(m_spare.get(), 1, length, m_file) : 0;
+        if (written != length) {
+            m_writeFailed.store(true, std::memory_order_relaxed);
+        }
+        m_bytesWritten.fetch_add(written, std::memory_order_relaxed);
+    }
+    m_flushQueued.store(false, std::memory_order_release);
+}
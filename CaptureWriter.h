@@ -0,0 +1,84 @@
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "BLEHeartRateMonitor.h"
+#include "CaptureFile.h"
+#include "TimerWheel.h"
+
+// --- Raw notification capture ---
+// Appends every raw 0x2A37 value and status event to a capture file (format in CaptureFile.h).
+// Recording only encodes into a preallocated in-memory buffer under a short lock; a work item
+// on the shared executor swaps buffers and writes the full one to disk, queued when a buffer is
+// half full or by a periodic timer. If the disk can't keep up, records are dropped and counted
+// rather than stalling the notification thread. At most one flush is queued or running.
+// Off Windows there is no shared executor, so each flush gets a short-lived thread instead.
+class CaptureWriter {
+public:
+#ifndef _WIN32
+    ~CaptureWriter() {
+        if (m_flushThread.joinable()) {
+            m_flushThread.join();
+        }
+    }
+#endif
+
+    bool Start(const char* path, int64_t nowUs);
+    void Stop(); // Writes whatever is buffered and closes the file
+    bool Running() const { return m_running.load(std::memory_order_acquire); }
+
+    // Any thread
+    void RecordNotification(uint64_t deviceAddress, int64_t timestampUs, const uint8_t* data, size_t length);
+    void RecordStatus(uint64_t deviceAddress, int64_t timestampUs, int32_t state, int32_t category, int32_t hresult);
+
+    void Snapshot(HrCaptureStats& out) const;
+
+private:
+    static constexpr size_t kBufferBytes = 256 * 1024;
+    static constexpr uint32_t kFlushIntervalMs = 250;
+    static constexpr size_t kMaxPayload = 512; // Largest ATT value
+
+    void Append(uint8_t type, uint64_t deviceAddress, int64_t timestampUs, const uint8_t* payload, size_t length);
+    void Put(uint8_t type, uint8_t device, int64_t timestampUs, const uint8_t* payload, size_t length); // Lock held
+    uint8_t DeviceIndex(uint64_t deviceAddress, int64_t timestampUs); // Lock held
+    void QueueFlush();
+    void Flush();
+#ifdef _WIN32
+    static void CALLBACK FlushCallback(PTP_CALLBACK_INSTANCE, void* context);
+#endif
+    static void OnTimer(void* context);
+
+    std::atomic<bool> m_running{ false };
+    TimerWheel::Timer m_timer;
+    std::atomic<bool> m_flushQueued{ false };
+
+    // Recording side
+    std::mutex m_mutex;
+    std::unique_ptr<uint8_t[]> m_active;
+    size_t m_used = 0;
+    int64_t m_lastTimestampUs = 0;
+    uint64_t m_devices[kCaptureNoDevice] = {};
+    uint32_t m_deviceCount = 0;
+
+    // Flush side
+    std::mutex m_flushMutex; // One writer to the file at a time; Stop waits on it
+    std::FILE* m_file = nullptr; // Unbuffered; writes are whole buffers already
+    std::unique_ptr<uint8_t[]> m_spare;
+#ifndef _WIN32
+    std::thread m_flushThread;
+#endif
+
+    std::atomic<uint64_t> m_records{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_bytesWritten{ 0 };
+    std::atomic<bool> m_writeFailed{ false };
+};
+
+extern CaptureWriter g_capture;
@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "Executor.h"
+#include <thread>
+
+Executor g_executor;
+
+bool Executor::Start(unsigned maxThreads) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pool) {
+        return true;
+    }
+    if (maxThreads == 0) {
+        maxThreads = std::thread::hardware_concurrency();
+        if (maxThreads == 0) {
+            maxThreads = 2;
+        }
+    }
+
+    m_pool = CreateThreadpool(nullptr);
+    if (!m_pool) {
+        return false;
+    }
+    SetThreadpoolThreadMaximum(m_pool, maxThreads);
+    if (!SetThreadpoolThreadMinimum(m_pool, 1)) {
+        CloseThreadpool(m_pool);
+        m_pool = nullptr;
+        return false;
+    }
+    m_cleanupGroup = CreateThreadpoolCleanupGroup();
+    if (!m_cleanupGroup) {
+        CloseThreadpool(m_pool);
+        m_pool = nullptr;
+        return false;
+    }
+    InitializeThreadpoolEnvironment(&m_environment);
+    SetThreadpoolCallbackPool(&m_environment, m_pool);
+    SetThreadpoolCallbackCleanupGroup(&m_environment, m_cleanupGroup, nullptr);
+    return true;
+}
+
+void Executor::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pool || m_closing) {
+            return;
+        }
+        m_closing = true;
+    }
+    // Without the lock: callbacks still running may need it. Queued resumptions run rather than
+    // being dropped with their coroutines.
+    CloseThreadpoolCleanupGroupMembers(m_cleanupGroup, FALSE, nullptr);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CloseThreadpoolCleanupGroup(m_cleanupGroup);
+    DestroyThreadpoolEnvironment(&m_environment);
+    CloseThreadpool(m_pool);
+    m_cleanupGroup = nullptr;
+    m_pool = nullptr;
+    m_closing = false;
+}
+
+bool Executor::Running() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pool != nullptr;
+}
+
+PTP_CALLBACK_ENVIRON Executor::Environment() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pool && !m_closing ? &m_environment : nullptr;
+}
+
+bool Executor::Submit(PTP_SIMPLE_CALLBACK callback, void* context) {
+    return TrySubmitThreadpoolCallback(callback, context, Environment()) != FALSE;
+}
+
+bool Executor::Resume(std::coroutine_handle<> coroutine) {
+    return Submit(&ResumeCoroutine, coroutine.address());
+}
+
+void CALLBACK Executor::ResumeCoroutine(PTP_CALLBACK_INSTANCE, void* context) {
+    std::coroutine_handle<>::from_address(context).resume();
+}
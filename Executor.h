@@ -0,0 +1,53 @@
+#pragma once
+#include <windows.h>
+#include <coroutine>
+#include <mutex>
+
+// Shared executor for every session: one private Windows thread pool capped at one thread per
+// core. Session coroutines, timers and dispatch work all run here, so adding devices adds work
+// items rather than threads. (The OS pool balances work between its threads itself.)
+class Executor {
+public:
+    bool Start(unsigned maxThreads = 0); // 0 = one thread per core; no-op if already running
+    // Waits for running and queued callbacks. Stop the sessions first: queued work still runs.
+    void Shutdown();
+    bool Running() const;
+
+    // Callback environment for pool objects (timers, waits) that should run on this executor.
+    // Null when not running or shutting down, which makes the OS fall back to the process
+    // default pool.
+    PTP_CALLBACK_ENVIRON Environment();
+
+    // Queues a raw callback without allocating
+    bool Submit(PTP_SIMPLE_CALLBACK callback, void* context);
+
+    // Queues a suspended coroutine to be resumed on the pool (never inline)
+    bool Resume(std::coroutine_handle<> coroutine);
+
+    // co_await g_executor.Schedule(): continue the coroutine on the pool
+    auto Schedule();
+
+private:
+    static void CALLBACK ResumeCoroutine(PTP_CALLBACK_INSTANCE, void* context);
+
+    mutable std::mutex m_mutex;
+    PTP_POOL m_pool = nullptr;
+    PTP_CLEANUP_GROUP m_cleanupGroup = nullptr;
+    TP_CALLBACK_ENVIRON m_environment{};
+    bool m_closing = false;
+};
+
+extern Executor g_executor;
+
+inline auto Executor::Schedule() {
+    struct Awaiter {
+        Executor& executor;
+        bool await_ready() const noexcept { return false; }
+        // Resumes inline if the pool is unavailable
+        bool await_suspend(std::coroutine_handle<> resume) {
+            return executor.Submit(&Executor::ResumeCoroutine, resume.address());
+        }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{ *this };
+}
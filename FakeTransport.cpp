@@ -0,0 +1,288 @@
+#include "pch.h"
+#include "FakeTransport.h"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+FakeTransport::FakeTransport(SessionRuntime& runtime, uint64_t address)
+    : m_runtime(runtime), m_address(address) {
+    m_opTimer = { &OnOpTimer, this };
+}
+
+FakeTransport::~FakeTransport() {
+    m_runtime.Timers().Cancel(m_opTimer);
+}
+
+void FakeTransport::SetLatencyMs(FakeOp op, uint32_t latencyMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latencyMs[static_cast<int>(op)] = latencyMs;
+}
+
+void FakeTransport::SetScript(Script script, void* context) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_script = script;
+    m_scriptContext = context;
+}
+
+void FakeTransport::SetPresent(bool present) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_present = present;
+}
+
+void FakeTransport::SetUnresponsive(bool wedged) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wedged = wedged;
+}
+
+bool FakeTransport::Notify(const uint8_t* data, size_t length) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_subscribed) {
+            return false;
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    if (!m_listener) {
+        return false;
+    }
+    m_listener->OnNotification(data, length, m_runtime.NowUs());
+    return true;
+}
+
+void FakeTransport::DropLink() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_connected) {
+            return;
+        }
+        m_connected = false;
+        m_subscribed = false;
+    }
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    if (m_listener) {
+        m_listener->OnLinkLost();
+    }
+}
+
+bool FakeTransport::Connected() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_connected;
+}
+
+bool FakeTransport::Subscribed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_subscribed;
+}
+
+uint64_t FakeTransport::Operations(FakeOp op) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_operations[static_cast<int>(op)];
+}
+
+void FakeTransport::SetListener(HrTransportListener* listener) {
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    m_listener = listener;
+}
+
+void FakeTransport::Scan(Completion done, void* context) {
+    Begin(FakeOp::Scan, done, context);
+}
+
+void FakeTransport::Connect(uint64_t address, Completion done, void* context) {
+    Begin(FakeOp::Connect, done, context, address);
+}
+
+uint64_t FakeTransport::Address() const {
+    return m_address;
+}
+
+void FakeTransport::Discover(Completion done, void* context) {
+    Begin(FakeOp::Discover, done, context);
+}
+
+void FakeTransport::Subscribe(bool enable, Completion done, void* context) {
+    Begin(enable ? FakeOp::Subscribe : FakeOp::Unsubscribe, done, context);
+}
+
+void FakeTransport::Disconnect(Completion done, void* context) {
+    Begin(FakeOp::Disconnect, done, context);
+}
+
+void FakeTransport::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending || m_wedged) {
+            return;
+        }
+        m_result = { HrErrorWinRt, kHrTransportCancelled };
+    }
+    m_runtime.Timers().Cancel(m_opTimer); // Waits out a completion already firing
+    Complete();
+}
+
+void FakeTransport::Begin(FakeOp op, Completion done, void* context, uint64_t address) {
+    FakeOutcome outcome;
+    bool wedged;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_operations[static_cast<int>(op)];
+        outcome.latencyMs = m_latencyMs[static_cast<int>(op)];
+        if (op == FakeOp::Scan && !m_present) {
+            outcome.result = { HrErrorNoDevice, 0 };
+        }
+        else if (op == FakeOp::Connect && address != 0 && address != m_address) {
+            outcome.result = { HrErrorDeviceUnavailable, 0 }; // Some other strap: not ours to open
+        }
+        else if ((op == FakeOp::Discover || op == FakeOp::Subscribe) && !m_connected) {
+            outcome.result = { op == FakeOp::Discover ? HrErrorServiceNotFound : HrErrorSubscribeFailed, 0 };
+        }
+        Script script = m_script;
+        void* scriptContext = m_scriptContext;
+        if (script) {
+            outcome = script(scriptContext, op);
+        }
+        m_pending = true;
+        m_op = op;
+        m_result = outcome.result;
+        m_done = done;
+        m_context = context;
+        wedged = m_wedged;
+    }
+    if (!wedged && !outcome.hang) {
+        m_runtime.Timers().Schedule(m_opTimer, outcome.latencyMs);
+    }
+}
+
+void FakeTransport::Complete() {
+    Completion done;
+    void* context;
+    HrTransportResult result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending) {
+            return;
+        }
+        m_pending = false;
+        result = m_result;
+        if (result.category == HrErrorNone) {
+            switch (m_op) {
+            case FakeOp::Connect:
+                m_connected = true;
+                break;
+            case FakeOp::Subscribe:
+                m_subscribed = true;
+                break;
+            case FakeOp::Unsubscribe:
+                m_subscribed = false;
+                break;
+            case FakeOp::Disconnect:
+                m_connected = false;
+                m_subscribed = false;
+                break;
+            default:
+                break;
+            }
+        }
+        done = std::exchange(m_done, nullptr);
+        context = m_context;
+    }
+    done(context, result);
+}
+
+void FakeTransport::OnOpTimer(void* context) {
+    auto transport = static_cast<FakeTransport*>(context);
+    bool wedged;
+    {
+        std::lock_guard<std::mutex> lock(transport->m_mutex);
+        wedged = transport->m_wedged;
+    }
+    if (!wedged) {
+        transport->Complete();
+    }
+}
+
+// --- VirtualRuntime ---
+VirtualRuntime::VirtualRuntime() {
+    m_timers.Reset(0);
+}
+
+bool VirtualRuntime::Resume(std::coroutine_handle<> coroutine) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready.push_back(coroutine);
+    return true;
+}
+
+void VirtualRuntime::RunReady() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_ready.empty()) {
+                return;
+            }
+            std::swap(m_ready, m_running);
+        }
+        for (std::coroutine_handle<> coroutine : m_running) {
+            coroutine.resume();
+        }
+        m_running.clear();
+    }
+}
+
+void VirtualRuntime::AdvanceTo(int64_t nowUs) {
+    const int64_t tickUs = static_cast<int64_t>(TimerWheel::kTickMs) * 1000;
+    RunReady();
+    while (m_nowUs < nowUs) {
+        int64_t nextUs = std::min(nowUs, (m_nowUs / tickUs + 1) * tickUs);
+        m_nowUs = nextUs;
+        m_timers.Advance(static_cast<uint64_t>(nextUs / 1000));
+        RunReady();
+    }
+}
+
+// --- ThreadRuntime ---
+ThreadRuntime::ThreadRuntime() {
+    m_worker = std::thread([this] { Work(); });
+}
+
+ThreadRuntime::~ThreadRuntime() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    m_worker.join();
+}
+
+bool ThreadRuntime::Resume(std::coroutine_handle<> coroutine) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            return false;
+        }
+        m_ready.push_back(coroutine);
+    }
+    m_changed.notify_one();
+    return true;
+}
+
+int64_t ThreadRuntime::NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs what is queued, and advances the wheel at least once a millisecond
+void ThreadRuntime::Work() {
+    std::vector<std::coroutine_handle<>> running;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_changed.wait_for(lock, std::chrono::milliseconds(1), [&] { return m_stopping || !m_ready.empty(); });
+        std::swap(m_ready, running);
+        lock.unlock();
+        for (std::coroutine_handle<> coroutine : running) {
+            coroutine.resume();
+        }
+        running.clear();
+        m_timers.Advance(TimerWheel::NowMs());
+        lock.lock();
+    }
+}
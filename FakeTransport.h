@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "HrTransport.h"
+#include "SessionEngine.h"
+#include "TimerWheel.h"
+
+// --- Fake radio and runtimes for the session engine ---
+// FakeTransport plays a strap and its Bluetooth stack: each operation completes on the runtime's
+// timer wheel after a latency, and the owner makes the strap notify, drop the link or wedge.
+// VirtualRuntime runs the engine on a manual clock, so hours of sessions take milliseconds and
+// replay exactly; ThreadRuntime runs it on one worker thread against the real clock, for
+// blocking calls such as SessionEngine::Stop and for timing. Portable: the simulator, the soak
+// and the tests and benchmarks in tools/ use them to drive the real engine without a radio.
+
+enum class FakeOp : uint8_t { Scan, Connect, Discover, Subscribe, Unsubscribe, Disconnect, Count };
+
+// How one operation turns out
+struct FakeOutcome {
+    HrTransportResult result{ HrErrorNone, 0 };
+    uint32_t latencyMs = 0;
+    bool hang = false; // Never completes on its own; only Cancel ends it
+};
+
+class FakeTransport final : public HrTransport {
+public:
+    // Decides each operation instead of the fixed latencies (e.g. random failures, an
+    // unreachable strap). Called on the thread that started the operation.
+    using Script = FakeOutcome (*)(void* context, FakeOp op);
+
+    FakeTransport(SessionRuntime& runtime, uint64_t address);
+    ~FakeTransport() override;
+
+    void SetLatencyMs(FakeOp op, uint32_t latencyMs); // Defaults: scan 50, connect 100, discover 100, CCCD 30, disconnect 10
+    void SetScript(Script script, void* context);
+    void SetPresent(bool present);      // Scan finds the strap (default true)
+    void SetUnresponsive(bool wedged);  // From now on operations and Cancel are ignored: nothing completes
+
+    // Strap side. Notify delivers data if the CCCD is on, stamped with the runtime's clock.
+    bool Notify(const uint8_t* data, size_t length);
+    void DropLink(); // The connection goes away (listener hears OnLinkLost)
+    bool Connected() const;
+    bool Subscribed() const;
+    uint64_t Operations(FakeOp op) const; // Started so far
+
+    // HrTransport
+    void SetListener(HrTransportListener* listener) override;
+    void Scan(Completion done, void* context) override;
+    void Connect(uint64_t address, Completion done, void* context) override;
+    uint64_t Address() const override;
+    void Discover(Completion done, void* context) override;
+    void Subscribe(bool enable, Completion done, void* context) override;
+    void Disconnect(Completion done, void* context) override;
+    void Cancel() override;
+
+private:
+    void Begin(FakeOp op, Completion done, void* context, uint64_t address = 0);
+    void Complete(); // Finishes the pending operation, if any
+    static void OnOpTimer(void* context);
+
+    SessionRuntime& m_runtime;
+    const uint64_t m_address;
+    TimerWheel::Timer m_opTimer;
+
+    mutable std::mutex m_mutex; // Protects everything below
+    uint32_t m_latencyMs[static_cast<int>(FakeOp::Count)] = { 50, 100, 100, 30, 30, 10 };
+    uint64_t m_operations[static_cast<int>(FakeOp::Count)] = {};
+    Script m_script = nullptr;
+    void* m_scriptContext = nullptr;
+    bool m_present = true;
+    bool m_wedged = false;
+    bool m_connected = false;
+    bool m_subscribed = false;
+    bool m_pending = false;
+    FakeOp m_op = FakeOp::Scan;
+    HrTransportResult m_result{ HrErrorNone, 0 };
+    Completion m_done = nullptr;
+    void* m_context = nullptr;
+
+    std::mutex m_listenerMutex; // Held while calling the listener
+    HrTransportListener* m_listener = nullptr;
+};
+
+// Runs the engine on a clock that only moves when told to. Single-threaded: coroutines and
+// timers run inside RunReady/AdvanceTo on the caller's thread.
+class VirtualRuntime final : public SessionRuntime {
+public:
+    VirtualRuntime();
+
+    bool Resume(std::coroutine_handle<> coroutine) override;
+    int64_t NowUs() override { return m_nowUs.load(std::memory_order_relaxed); }
+    TimerWheel& Timers() override { return m_timers; }
+
+    void RunReady(); // Runs queued coroutines until none is left
+    void AdvanceTo(int64_t nowUs); // Moves the clock a wheel tick at a time, running what each tick wakes
+
+private:
+    std::mutex m_mutex; // Protects m_ready (transport callbacks may queue from other threads)
+    std::vector<std::coroutine_handle<>> m_ready;
+    std::vector<std::coroutine_handle<>> m_running;
+    TimerWheel m_timers;
+    std::atomic<int64_t> m_nowUs{ 0 };
+};
+
+// Runs the engine on one worker thread with the steady clock, the way one pool thread would
+class ThreadRuntime final : public SessionRuntime {
+public:
+    ThreadRuntime();
+    ~ThreadRuntime(); // Coroutines still suspended are left as they are
+
+    bool Resume(std::coroutine_handle<> coroutine) override;
+    int64_t NowUs() override;
+    TimerWheel& Timers() override { return m_timers; }
+
+private:
+    void Work();
+
+    TimerWheel m_timers;
+    std::mutex m_mutex; // Protects the two below
+    std::condition_variable m_changed;
+    std::vector<std::coroutine_handle<>> m_ready;
+    bool m_stopping = false;
+    std::thread m_worker;
+};
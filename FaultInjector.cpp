@@ -0,0 +1,324 @@
+#include "pch.h"
+#include "FaultInjector.h"
+#include "HrMeasurement.h"
+#include "SessionPolicy.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+FaultInjector g_faults;
+
+void FaultInjector::Configure(const HrFaultConfig& config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+    m_random.seed(config.seed != 0 ? config.seed : std::random_device{}());
+    for (auto& count : m_counts) {
+        count = 0;
+    }
+    for (auto& delay : m_delayUs) {
+        delay = 0;
+    }
+    bool any = config.dropRate > 0.0 || config.delayRate > 0.0 || config.malformedRate > 0.0
+        || config.cccdFailureRate > 0.0 || config.disconnectsPerHour > 0.0 || config.slowDiscoveryRate > 0.0;
+    m_enabled.store(any, std::memory_order_relaxed);
+}
+
+void FaultInjector::Disable() {
+    m_enabled.store(false, std::memory_order_relaxed);
+}
+
+FaultKind FaultInjector::OnNotification(uint32_t& delayMs) {
+    if (!Enabled()) {
+        return FaultKind::Count;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Chance(m_config.dropRate)) {
+        Count(FaultKind::Drop);
+        return FaultKind::Drop;
+    }
+    if (Chance(m_config.malformedRate)) {
+        Count(FaultKind::Malformed);
+        return FaultKind::Malformed;
+    }
+    if (Chance(m_config.delayRate)) {
+        delayMs = Between(m_config.delayMinMs, m_config.delayMaxMs);
+        Count(FaultKind::Delay);
+        m_delayUs[static_cast<int>(FaultKind::Delay)].fetch_add(static_cast<uint64_t>(delayMs) * 1000, std::memory_order_relaxed);
+        return FaultKind::Delay;
+    }
+    return FaultKind::Count;
+}
+
+bool FaultInjector::FailCccdWrite() {
+    if (!Enabled()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!Chance(m_config.cccdFailureRate)) {
+        return false;
+    }
+    Count(FaultKind::CccdFailure);
+    return true;
+}
+
+bool FaultInjector::SpuriousDisconnect(uint32_t elapsedMs) {
+    if (!Enabled()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_config.disconnectsPerHour <= 0.0) {
+        return false;
+    }
+    // Poisson process sampled per call: P(at least one drop in elapsedMs)
+    double probability = 1.0 - std::exp(-m_config.disconnectsPerHour * elapsedMs / 3600000.0);
+    if (!Chance(probability)) {
+        return false;
+    }
+    Count(FaultKind::Disconnect);
+    return true;
+}
+
+uint32_t FaultInjector::DiscoveryDelayMs() {
+    if (!Enabled()) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!Chance(m_config.slowDiscoveryRate)) {
+        return 0;
+    }
+    Count(FaultKind::SlowDiscovery);
+    uint32_t delayMs = Between(m_config.discoveryDelayMinMs, m_config.discoveryDelayMaxMs);
+    m_delayUs[static_cast<int>(FaultKind::SlowDiscovery)].fetch_add(static_cast<uint64_t>(delayMs) * 1000, std::memory_order_relaxed);
+    return delayMs;
+}
+
+void FaultInjector::Snapshot(HrFaultStats& out) const {
+    auto count = [this](FaultKind kind) { return m_counts[static_cast<int>(kind)].load(std::memory_order_relaxed); };
+    out.dropped = count(FaultKind::Drop);
+    out.delayed = count(FaultKind::Delay);
+    out.malformed = count(FaultKind::Malformed);
+    out.cccdFailures = count(FaultKind::CccdFailure);
+    out.disconnects = count(FaultKind::Disconnect);
+    out.slowDiscoveries = count(FaultKind::SlowDiscovery);
+}
+
+bool FaultInjector::Chance(double probability) {
+    return probability > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < probability;
+}
+
+uint32_t FaultInjector::Between(uint32_t low, uint32_t high) {
+    return std::uniform_int_distribution<uint32_t>(low, high > low ? high : low)(m_random);
+}
+
+size_t CorruptHrPayload(const uint8_t* data, size_t length, uint8_t* out, size_t capacity) {
+    if (capacity < 2) {
+        return 0;
+    }
+    out[0] = static_cast<uint8_t>((length > 0 ? data[0] : 0) | kHrFlagValueUInt16 | kHrFlagEnergyExpended);
+    out[1] = length > 1 ? data[1] : 0;
+    return 2; // Flags + 1 byte, where the flags need at least 5
+}
+
+// --- FaultyTransport ---
+FaultyTransport::FaultyTransport(std::shared_ptr<HrTransport> inner, FaultInjector& faults, SessionRuntime& runtime)
+    : m_inner(std::move(inner)), m_faults(faults), m_runtime(runtime) {
+    m_lateTimer = { &OnLateTimer, this };
+    m_discoveryTimer = { &OnDiscoveryTimer, this };
+    m_disconnectTimer = { &OnDisconnectTick, this };
+    m_inner->SetListener(this);
+}
+
+FaultyTransport::~FaultyTransport() {
+    m_inner->SetListener(nullptr);
+    TimerWheel& timers = m_runtime.Timers();
+    timers.Cancel(m_lateTimer);
+    timers.Cancel(m_discoveryTimer);
+    timers.Cancel(m_disconnectTimer);
+}
+
+void FaultyTransport::SetListener(HrTransportListener* listener) {
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    m_listener = listener;
+    if (!listener) {
+        m_lateCount = 0; // Nobody left to deliver them to
+    }
+}
+
+void FaultyTransport::Scan(Completion done, void* context) {
+    m_inner->Scan(done, context);
+}
+
+void FaultyTransport::Connect(uint64_t address, Completion done, void* context) {
+    m_inner->Connect(address, done, context);
+}
+
+uint64_t FaultyTransport::Address() const {
+    return m_inner->Address();
+}
+
+void FaultyTransport::Discover(Completion done, void* context) {
+    uint32_t delayMs = m_faults.DiscoveryDelayMs();
+    if (delayMs == 0) {
+        m_inner->Discover(done, context);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_discoveryMutex);
+        m_holdingDiscovery = true;
+        m_discoveryDone = done;
+        m_discoveryContext = context;
+    }
+    m_runtime.Timers().Schedule(m_discoveryTimer, delayMs); // Injected slow discovery
+}
+
+void FaultyTransport::Subscribe(bool enable, Completion done, void* context) {
+    if (!enable) {
+        m_runtime.Timers().Cancel(m_disconnectTimer);
+        m_inner->Subscribe(false, done, context);
+        return;
+    }
+    m_subscribeDone = done;
+    m_subscribeContext = context;
+    m_inner->Subscribe(true, &OnSubscribed, this);
+}
+
+void FaultyTransport::Disconnect(Completion done, void* context) {
+    {
+        std::lock_guard<std::mutex> lock(m_listenerMutex);
+        m_lateCount = 0; // Still in the stack when the link went: never delivered
+    }
+    m_runtime.Timers().Cancel(m_lateTimer);
+    m_runtime.Timers().Cancel(m_disconnectTimer);
+    m_inner->Disconnect(done, context);
+}
+
+void FaultyTransport::Cancel() {
+    Completion done = nullptr;
+    void* context = nullptr;
+    {
+        // Held while cancelling the inner operation too, so a held-back discovery that is just
+        // being started can't slip past the Cancel
+        std::lock_guard<std::mutex> lock(m_discoveryMutex);
+        if (!m_holdingDiscovery) {
+            m_inner->Cancel();
+            return;
+        }
+        m_holdingDiscovery = false;
+        done = m_discoveryDone;
+        context = m_discoveryContext;
+    }
+    m_runtime.Timers().Cancel(m_discoveryTimer);
+    done(context, { HrErrorWinRt, kHrTransportCancelled });
+}
+
+void FaultyTransport::OnNotification(const uint8_t* data, size_t length, int64_t arrivalUs) {
+    uint32_t delayMs = 0;
+    uint8_t corrupted[2];
+    switch (m_faults.OnNotification(delayMs)) {
+    case FaultKind::Drop:
+        return; // Lost on air: the engine never sees it
+    case FaultKind::Malformed:
+        length = CorruptHrPayload(data, length, corrupted, sizeof(corrupted));
+        data = corrupted;
+        break;
+    default:
+        break;
+    }
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    if ((delayMs == 0 && m_lateCount == 0) || length > kMaxLatePayload) {
+        Deliver(data, length, arrivalUs);
+        return;
+    }
+    if (m_lateCount == kMaxLate) {
+        return; // The stack ran out of buffers
+    }
+    // Late, or queued behind one that is: a slow stack delivers in order
+    int64_t dueUs = arrivalUs + static_cast<int64_t>(delayMs) * 1000;
+    if (m_lateCount > 0) {
+        dueUs = std::max(dueUs, m_late[(m_lateHead + m_lateCount - 1) % kMaxLate].dueUs);
+    }
+    LateNotification& late = m_late[(m_lateHead + m_lateCount) % kMaxLate];
+    late.dueUs = dueUs;
+    late.length = static_cast<uint8_t>(length);
+    std::memcpy(late.data, data, length);
+    if (++m_lateCount == 1) {
+        m_runtime.Timers().Schedule(m_lateTimer, delayMs);
+    }
+}
+
+void FaultyTransport::OnLinkLost() {
+    m_runtime.Timers().Cancel(m_disconnectTimer);
+    LinkLost();
+}
+
+void FaultyTransport::OnTransportError(int32_t hresult) {
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    if (m_listener) {
+        m_listener->OnTransportError(hresult);
+    }
+}
+
+void FaultyTransport::Deliver(const uint8_t* data, size_t length, int64_t arrivalUs) {
+    if (m_listener) {
+        m_listener->OnNotification(data, length, arrivalUs);
+    }
+}
+
+void FaultyTransport::LinkLost() {
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    if (m_listener) {
+        m_listener->OnLinkLost();
+    }
+}
+
+// Delivers the held-back notifications that are due, stamped with the time they finally arrive
+void FaultyTransport::OnLateTimer(void* context) {
+    auto transport = static_cast<FaultyTransport*>(context);
+    std::lock_guard<std::mutex> lock(transport->m_listenerMutex);
+    int64_t nowUs = transport->m_runtime.NowUs();
+    while (transport->m_lateCount > 0) {
+        LateNotification& late = transport->m_late[transport->m_lateHead];
+        if (late.dueUs > nowUs) {
+            transport->m_runtime.Timers().Schedule(transport->m_lateTimer, static_cast<uint64_t>((late.dueUs - nowUs + 999) / 1000));
+            return;
+        }
+        transport->Deliver(late.data, late.length, nowUs);
+        transport->m_lateHead = (transport->m_lateHead + 1) % kMaxLate;
+        --transport->m_lateCount;
+    }
+}
+
+void FaultyTransport::OnDiscoveryTimer(void* context) {
+    auto transport = static_cast<FaultyTransport*>(context);
+    std::lock_guard<std::mutex> lock(transport->m_discoveryMutex);
+    if (transport->m_holdingDiscovery) {
+        transport->m_holdingDiscovery = false;
+        transport->m_inner->Discover(transport->m_discoveryDone, transport->m_discoveryContext);
+    }
+}
+
+// Spurious link drops while subscribed: the same path as a real link loss
+void FaultyTransport::OnDisconnectTick(void* context) {
+    auto transport = static_cast<FaultyTransport*>(context);
+    if (transport->m_faults.SpuriousDisconnect(kWatchdogTickMs)) {
+        transport->LinkLost();
+        return;
+    }
+    transport->m_runtime.Timers().Schedule(transport->m_disconnectTimer, kWatchdogTickMs);
+}
+
+void FaultyTransport::OnSubscribed(void* context, HrTransportResult result) {
+    auto transport = static_cast<FaultyTransport*>(context);
+    Completion done = transport->m_subscribeDone;
+    void* doneContext = transport->m_subscribeContext;
+    if (result.category == HrErrorNone) {
+        if (transport->m_faults.FailCccdWrite()) {
+            result = { HrErrorSubscribeFailed, 0 };
+        }
+        else {
+            transport->m_runtime.Timers().Schedule(transport->m_disconnectTimer, kWatchdogTickMs);
+        }
+    }
+    done(doneContext, result); // May end the session and free the transport: nothing after this
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include "BLEHeartRateMonitor.h"
+#include "HrTransport.h"
+#include "SessionEngine.h"
+#include "TimerWheel.h"
+
+// Fault types, in HrFaultStats order
+enum class FaultKind : uint8_t { Drop, Delay, Malformed, CccdFailure, Disconnect, SlowDiscovery, Count };
+
+// --- Transport fault injection ---
+// Makes the radio misbehave on purpose: drops, delays or corrupts notifications, fails CCCD
+// writes, drops the link and slows down discovery. FaultyTransport (below) applies it at the
+// transport seam, over the WinRT transport for the live session (see SetFaultInjection) and
+// over the fake one in the simulator (SimConfig::faults), so one fault profile can be measured
+// on a real strap and across simulated scenarios.
+// Decisions come from one seeded generator. Disabled (the default) every query is one relaxed
+// load, so the hooks cost nothing in normal use.
+class FaultInjector {
+public:
+    void Configure(const HrFaultConfig& config); // Enabled if any rate is non-zero; resets counters
+    void Disable();
+    bool Enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // What to do with an incoming notification; delayMs is set for FaultKind::Delay.
+    // Returns FaultKind::Count for "deliver normally".
+    FaultKind OnNotification(uint32_t& delayMs);
+    bool FailCccdWrite();
+    bool SpuriousDisconnect(uint32_t elapsedMs); // Asked periodically while streaming
+    uint32_t DiscoveryDelayMs();                 // 0 = no delay
+
+    void Snapshot(HrFaultStats& out) const;
+    // Total delay injected so far by FaultKind::Delay or FaultKind::SlowDiscovery
+    uint64_t InjectedDelayUs(FaultKind kind) const { return m_delayUs[static_cast<int>(kind)].load(std::memory_order_relaxed); }
+
+private:
+    bool Chance(double probability); // Lock held
+    uint32_t Between(uint32_t low, uint32_t high); // Lock held
+    void Count(FaultKind kind) { m_counts[static_cast<int>(kind)].fetch_add(1, std::memory_order_relaxed); }
+
+    std::atomic<bool> m_enabled{ false };
+    std::mutex m_mutex; // Notification thread and session both draw from the generator
+    HrFaultConfig m_config{};
+    std::mt19937_64 m_random;
+    std::atomic<uint64_t> m_counts[static_cast<int>(FaultKind::Count)] = {};
+    std::atomic<uint64_t> m_delayUs[static_cast<int>(FaultKind::Count)] = {};
+};
+
+// Rewrites a 0x2A37 value into one ParseHrMeasurement rejects, the way a truncated ATT value
+// looks: flags claim a uint16 HR and energy field that the data doesn't hold. Returns its length.
+size_t CorruptHrPayload(const uint8_t* data, size_t length, uint8_t* out, size_t capacity);
+
+extern FaultInjector g_faults; // Live session
+
+// Decorates a transport with the injector's faults, so the session engine meets them exactly
+// where it would meet a misbehaving radio. Late notifications are copied into a fixed ring and
+// redelivered in order from the timer wheel, and slow discovery is a timer too: nothing ever
+// holds up the transport's thread or allocates per notification.
+class FaultyTransport final : public HrTransport, private HrTransportListener {
+public:
+    FaultyTransport(std::shared_ptr<HrTransport> inner, FaultInjector& faults, SessionRuntime& runtime);
+    ~FaultyTransport() override;
+
+    // HrTransport
+    void SetListener(HrTransportListener* listener) override;
+    void Scan(Completion done, void* context) override;
+    void Connect(uint64_t address, Completion done, void* context) override;
+    uint64_t Address() const override;
+    void Discover(Completion done, void* context) override;
+    void Subscribe(bool enable, Completion done, void* context) override;
+    void Disconnect(Completion done, void* context) override;
+    void Cancel() override;
+
+private:
+    static constexpr size_t kMaxLate = 32;         // Notifications held back at once; more are lost
+    static constexpr size_t kMaxLatePayload = 64;  // Longer ones are delivered on time
+
+    struct LateNotification {
+        int64_t dueUs;
+        uint8_t length;
+        uint8_t data[kMaxLatePayload];
+    };
+
+    // HrTransportListener, from the inner transport
+    void OnNotification(const uint8_t* data, size_t length, int64_t arrivalUs) override;
+    void OnLinkLost() override;
+    void OnTransportError(int32_t hresult) override;
+
+    void Deliver(const uint8_t* data, size_t length, int64_t arrivalUs); // m_listenerMutex held
+    void LinkLost();
+
+    static void OnLateTimer(void* context);
+    static void OnDiscoveryTimer(void* context);
+    static void OnDisconnectTick(void* context);
+    static void OnSubscribed(void* context, HrTransportResult result);
+
+    const std::shared_ptr<HrTransport> m_inner;
+    FaultInjector& m_faults;
+    SessionRuntime& m_runtime;
+    TimerWheel::Timer m_lateTimer;
+    TimerWheel::Timer m_discoveryTimer;
+    TimerWheel::Timer m_disconnectTimer; // Spurious link drops, while subscribed
+
+    std::mutex m_listenerMutex; // Held while calling the listener; also protects the ring
+    HrTransportListener* m_listener = nullptr;
+    LateNotification m_late[kMaxLate];
+    size_t m_lateHead = 0;
+    size_t m_lateCount = 0;
+
+    std::mutex m_discoveryMutex; // Protects the discovery held back, and orders it against Cancel
+    bool m_holdingDiscovery = false;
+    Completion m_discoveryDone = nullptr;
+    void* m_discoveryContext = nullptr;
+
+    // Subscribe(true) in flight: completed through OnSubscribed (one operation at a time)
+    Completion m_subscribeDone = nullptr;
+    void* m_subscribeContext = nullptr;
+};
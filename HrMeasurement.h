@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// --- Heart Rate Measurement (0x2A37) ---
+// Layout: flags, HR (uint8 or uint16), [energy expended uint16], [RR intervals uint16...]
+constexpr uint8_t kHrFlagValueUInt16 = 0x01;      // HR value is uint16 instead of uint8
+constexpr uint8_t kHrFlagContactDetected = 0x02;  // Sensor contact detected
+constexpr uint8_t kHrFlagContactSupported = 0x04; // Sensor contact feature supported
+constexpr uint8_t kHrFlagEnergyExpended = 0x08;   // Energy expended field present
+constexpr uint8_t kHrFlagRrPresent = 0x10;        // One or more RR intervals present
+
+// Default MTU leaves room for 9 RR intervals; larger MTUs can carry more, extra ones are dropped.
+constexpr int kMaxRrIntervals = 16;
+
+struct HrMeasurement {
+    uint16_t bpm = 0;
+    uint16_t energyExpended = 0; // kJ, only valid with kHrFlagEnergyExpended
+    uint8_t flags = 0;
+    uint8_t rrCount = 0;
+    uint16_t rr[kMaxRrIntervals] = {}; // Units of 1/1024 s
+};
+
+inline uint16_t ReadLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// One decoder per layout-relevant flag combination (uint16 HR, energy expended, RR present),
+// generated at compile time so each is straight-line code with its field offsets as constants.
+template <bool Wide, bool Energy, bool Rr>
+bool DecodeHrMeasurement(const uint8_t* data, size_t length, HrMeasurement& out) {
+    constexpr size_t kFixed = 1 + (Wide ? 2 : 1) + (Energy ? 2 : 0); // Flags, HR, energy
+    if (length < kFixed) {
+        return false;
+    }
+    out.flags = data[0];
+    if constexpr (Wide) {
+        out.bpm = ReadLe16(data + 1);
+    }
+    else {
+        out.bpm = data[1];
+    }
+    if constexpr (Energy) {
+        out.energyExpended = ReadLe16(data + kFixed - 2);
+    }
+    else {
+        out.energyExpended = 0;
+    }
+    if constexpr (Rr) {
+        // An odd trailing byte means the packet was cut mid-interval
+        size_t rrBytes = length - kFixed;
+        if (rrBytes % 2 != 0) {
+            return false;
+        }
+        size_t count = rrBytes / 2 < kMaxRrIntervals ? rrBytes / 2 : kMaxRrIntervals;
+        for (size_t i = 0; i < count; ++i) {
+            out.rr[i] = ReadLe16(data + kFixed + 2 * i);
+        }
+        out.rrCount = static_cast<uint8_t>(count);
+    }
+    else {
+        out.rrCount = 0;
+    }
+    return true;
+}
+
+using HrDecoder = bool (*)(const uint8_t* data, size_t length, HrMeasurement& out);
+
+// Bit 0 = kHrFlagValueUInt16, bit 1 = kHrFlagEnergyExpended, bit 2 = kHrFlagRrPresent.
+// Contact bits and reserved bits don't change the layout and are ignored here.
+constexpr uint8_t HrDecoderIndex(uint8_t flags) {
+    return static_cast<uint8_t>((flags & kHrFlagValueUInt16) | ((flags & kHrFlagEnergyExpended) >> 2)
+        | ((flags & kHrFlagRrPresent) >> 2));
+}
+
+inline constexpr HrDecoder kHrDecoders[8] = {
+    &DecodeHrMeasurement<false, false, false>,
+    &DecodeHrMeasurement<true, false, false>,
+    &DecodeHrMeasurement<false, true, false>,
+    &DecodeHrMeasurement<true, true, false>,
+    &DecodeHrMeasurement<false, false, true>,
+    &DecodeHrMeasurement<true, false, true>,
+    &DecodeHrMeasurement<false, true, true>,
+    &DecodeHrMeasurement<true, true, true>,
+};
+
+static_assert(HrDecoderIndex(kHrFlagValueUInt16) == 1 && HrDecoderIndex(kHrFlagEnergyExpended) == 2
+    && HrDecoderIndex(kHrFlagRrPresent) == 4 && HrDecoderIndex(0xFF) == 7, "Decoder table index");
+
+// Parses a raw characteristic value. Returns false if the payload is truncated.
+inline bool ParseHrMeasurement(const uint8_t* data, size_t length, HrMeasurement& out) {
+    if (!data || length == 0) {
+        return false;
+    }
+    return kHrDecoders[HrDecoderIndex(data[0])](data, length, out);
+}
+
+// Sum of the RR intervals in a packet, in microseconds
+inline int64_t RrSumUs(const HrMeasurement& m) {
+    int64_t sum = 0;
+    for (int i = 0; i < m.rrCount; ++i) {
+        sum += m.rr[i];
+    }
+    return sum * 1000000 / 1024;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "BLEHeartRateMonitor.h"
+
+// --- Transport seam ---
+// Everything the session engine (SessionEngine.h) needs from a radio: find a strap, connect,
+// discover the HR measurement characteristic, write its CCCD, hear notifications and link loss,
+// disconnect. The DLL implements it over WinRT (BLEHeartRateMonitor.cpp); FakeTransport.h
+// scripts one on a virtual clock for tests, benchmarks and the simulator.
+//
+// One operation is in flight at a time. Each completes exactly once through done(context,
+// result), on any thread, possibly before the call returns. Cancel asks the operation in flight
+// to complete soon with a failure (and does nothing if there is none); a wedged radio may still
+// never complete it, which the engine only bounds with its stop deadline.
+
+// HRESULT an operation completes with when it was cancelled (HRESULT_FROM_WIN32(ERROR_CANCELLED))
+constexpr int32_t kHrTransportCancelled = static_cast<int32_t>(0x800704C7);
+
+// Outcome of one operation; category is HrErrorNone on success
+struct HrTransportResult {
+    HrErrorCategory category;
+    int32_t hresult; // For HrErrorWinRt
+};
+
+// Receives what the strap sends. Called on the transport's threads; notifications of one
+// connection never overlap, and nothing is called once SetListener(nullptr) has returned.
+class HrTransportListener {
+public:
+    virtual void OnNotification(const uint8_t* data, size_t length, int64_t arrivalUs) = 0;
+    virtual void OnLinkLost() = 0;                      // The connection dropped
+    virtual void OnTransportError(int32_t hresult) = 0; // A notification could not be read
+
+protected:
+    ~HrTransportListener() = default;
+};
+
+class HrTransport {
+public:
+    using Completion = void (*)(void* context, HrTransportResult result);
+
+    virtual ~HrTransport() = default;
+
+    virtual void SetListener(HrTransportListener* listener) = 0;
+
+    // Looks for a strap advertising the HR service (HrErrorNoDevice if there is none)
+    virtual void Scan(Completion done, void* context) = 0;
+    // Opens the strap at address, or the one the last Scan found if address is 0
+    virtual void Connect(uint64_t address, Completion done, void* context) = 0;
+    virtual uint64_t Address() const = 0; // Of the connected strap, once Connect succeeded
+    // Finds the HR service and measurement characteristic on the connected strap
+    virtual void Discover(Completion done, void* context) = 0;
+    // Writes the CCCD: notifications on (enable) or off
+    virtual void Subscribe(bool enable, Completion done, void* context) = 0;
+    // Releases the connection; the next Connect starts over
+    virtual void Disconnect(Completion done, void* context) = 0;
+    virtual void Cancel() = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear latency histogram: 16 linear sub-buckets per power of two, so any value is kept
+// to within ~6%. Fixed size, no allocation, so it can be recorded into on hot paths; one
+// writer per instance (merge per-thread histograms for a combined view).
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    void Record(uint64_t value) {
+        ++m_counts[Index(value)];
+        ++m_total;
+        if (value > m_max) {
+            m_max = value;
+        }
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (int i = 0; i < kBuckets; ++i) {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_total += other.m_total;
+        if (other.m_max > m_max) {
+            m_max = other.m_max;
+        }
+    }
+
+    void Reset() {
+        *this = LatencyHistogram{};
+    }
+
+    uint64_t Count() const { return m_total; }
+    uint64_t Max() const { return m_max; }
+
+    // Upper bound of the bucket holding percentile p (0..100); 0 when empty
+    uint64_t Percentile(double p) const {
+        if (m_total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(m_total));
+        if (rank >= m_total) {
+            rank = m_total - 1;
+        }
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += m_counts[i];
+            if (seen > rank) {
+                uint64_t upper = UpperBound(i);
+                return upper < m_max ? upper : m_max;
+            }
+        }
+        return m_max;
+    }
+
+private:
+    static int Index(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<int>(value);
+        }
+        int log2 = 63;
+        while (!(value >> log2)) {
+            --log2;
+        }
+        int shift = log2 - kSubBits;
+        int sub = static_cast<int>((value >> shift) & (kSubBuckets - 1));
+        return (shift + 1) * kSubBuckets + sub;
+    }
+
+    static uint64_t UpperBound(int index) {
+        if (index < kSubBuckets) {
+            return static_cast<uint64_t>(index);
+        }
+        int shift = index / kSubBuckets - 1;
+        uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+        return ((static_cast<uint64_t>(kSubBuckets) + sub + 1) << shift) - 1;
+    }
+
+    uint64_t m_counts[kBuckets] = {};
+    uint64_t m_total = 0;
+    uint64_t m_max = 0;
+};
@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "LatestSamples.h"
+
+LatestSamples g_latestSamples;
+
+LatestSamples::LatestSamples(uint32_t capacity)
+    : m_capacity(capacity > 0 ? capacity : 1), m_slots(new Slot[m_capacity]) {
+}
+
+int LatestSamples::Find(uint64_t deviceAddress) const {
+    for (uint32_t i = 0; i < m_capacity; ++i) {
+        const Slot& slot = m_slots[i];
+        if (slot.claimed.load(std::memory_order_acquire) && slot.address.load(std::memory_order_acquire) == deviceAddress) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool LatestSamples::TryWrite(int index, const HrSample& sample) {
+    Slot& slot = m_slots[index];
+    if (slot.writing.exchange(true, std::memory_order_acquire)) {
+        return false; // Being handed over right now
+    }
+    bool owned = slot.claimed.load(std::memory_order_relaxed)
+        && slot.address.load(std::memory_order_relaxed) == sample.deviceAddress;
+    if (owned) {
+        slot.cell.Store(sample);
+        slot.updatedUs.store(sample.timestampUs, std::memory_order_relaxed);
+    }
+    slot.writing.store(false, std::memory_order_release);
+    if (owned) {
+        m_latest.store(index, std::memory_order_release);
+    }
+    return owned;
+}
+
+int LatestSamples::Claim(const HrSample& sample) {
+    std::lock_guard<std::mutex> lock(m_claimMutex);
+    int index = Find(sample.deviceAddress);
+    if (index >= 0) {
+        return index;
+    }
+    int oldest = -1;
+    for (uint32_t i = 0; i < m_capacity; ++i) {
+        if (!m_slots[i].claimed.load(std::memory_order_relaxed)) {
+            oldest = static_cast<int>(i);
+            break;
+        }
+        if (oldest < 0 || m_slots[i].updatedUs.load(std::memory_order_relaxed)
+            < m_slots[oldest].updatedUs.load(std::memory_order_relaxed)) {
+            oldest = static_cast<int>(i);
+        }
+    }
+    Slot& slot = m_slots[oldest];
+    if (slot.claimed.load(std::memory_order_relaxed)
+        && sample.timestampUs - slot.updatedUs.load(std::memory_order_relaxed) < kEvictAfterUs) {
+        return -1; // Every slot belongs to a device that is still sending
+    }
+    // Wait out a write by the evicted device, then retag the slot. Its next Store sees the new
+    // address and goes through Claim itself.
+    while (slot.writing.exchange(true, std::memory_order_acquire)) {
+    }
+    slot.address.store(sample.deviceAddress, std::memory_order_release);
+    slot.updatedUs.store(sample.timestampUs, std::memory_order_relaxed);
+    slot.claimed.store(true, std::memory_order_release);
+    slot.writing.store(false, std::memory_order_release);
+    return oldest;
+}
+
+int LatestSamples::Store(const HrSample& sample, int hint) {
+    if (hint >= 0 && static_cast<uint32_t>(hint) < m_capacity && TryWrite(hint, sample)) {
+        return hint;
+    }
+    int index = Find(sample.deviceAddress);
+    if (index < 0 || !TryWrite(index, sample)) {
+        index = Claim(sample);
+        if (index < 0 || !TryWrite(index, sample)) {
+            m_untracked.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+    }
+    return index;
+}
+
+bool LatestSamples::Load(HrSample& out) const {
+    int index = m_latest.load(std::memory_order_acquire);
+    if (index < 0) {
+        return false;
+    }
+    m_slots[index].cell.Load(out);
+    return true;
+}
+
+bool LatestSamples::Load(uint64_t deviceAddress, HrSample& out) const {
+    int index = Find(deviceAddress);
+    if (index < 0) {
+        return false;
+    }
+    m_slots[index].cell.Load(out);
+    // Claimed but the first Store hasn't landed yet, or the slot changed hands since Find
+    return out.deviceAddress == deviceAddress && out.sequence != 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+#include "Seqlock.h"
+
+// Latest sample per device for polling hosts. Each device's sample sits in its own seqlock
+// cell; reads take no lock and never make the writer wait. Pollers compare HrSample::sequence
+// to see whether anything is new.
+// A device gets a free slot on its first sample. When none is free, the slot updated least
+// recently is handed over, provided its device has been silent for kEvictAfterUs; otherwise
+// the sample is not tracked and counted in Untracked(). A per-slot write flag keeps the cell
+// single-writer while a slot changes hands.
+class LatestSamples {
+public:
+    static constexpr uint32_t kDefaultDevices = 8;
+    static constexpr int64_t kEvictAfterUs = 5000000; // Several missed notifications at any cadence
+
+    explicit LatestSamples(uint32_t capacity = kDefaultDevices);
+
+    // hint: the slot this device's previous Store returned, or -1. Returns the slot used, or -1
+    // if the sample was not tracked.
+    int Store(const HrSample& sample, int hint = -1);
+    bool Load(HrSample& out) const;                          // Most recently stored, any device
+    bool Load(uint64_t deviceAddress, HrSample& out) const;  // False if the device has no slot
+    uint64_t Untracked() const { return m_untracked.load(std::memory_order_relaxed); }
+    uint32_t Capacity() const { return m_capacity; }
+
+private:
+    struct Slot {
+        std::atomic<bool> claimed{ false };
+        std::atomic<bool> writing{ false };
+        std::atomic<uint64_t> address{ 0 };
+        std::atomic<int64_t> updatedUs{ 0 };
+        SeqlockCell<HrSample> cell;
+    };
+
+    int Find(uint64_t deviceAddress) const;
+    bool TryWrite(int slot, const HrSample& sample); // False if the slot is not this device's
+    int Claim(const HrSample& sample);
+
+    const uint32_t m_capacity;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<int> m_latest{ -1 };
+    std::atomic<uint64_t> m_untracked{ 0 };
+    std::mutex m_claimMutex; // First sample from a device without a slot only
+};
+
+extern LatestSamples g_latestSamples;
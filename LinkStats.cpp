@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "LinkStats.h"
+#include <cmath>
+
+namespace {
+    constexpr double kDefaultIntervalUs = 1000000.0; // Most straps notify once per second
+    constexpr double kLateFactor = 1.25;             // Gap above this * cadence counts as late
+    constexpr double kDropFactor = 1.5;              // Gap above this * cadence counts as loss
+    constexpr double kBunchedFactor = 0.25;          // Gap below this * cadence: held back and delivered in a bunch
+}
+
+void LinkStats::Reset(uint64_t deviceAddress) {
+    m_deviceAddress = deviceAddress;
+    m_received = 0;
+    m_dropped = 0;
+    m_malformed = 0;
+    m_late = 0;
+    m_jitterUs = 0;
+    m_nominalUs = static_cast<uint32_t>(kDefaultIntervalUs);
+    m_lastArrivalUs = -1;
+    m_jitter = 0.0;
+    m_nominal = kDefaultIntervalUs;
+}
+
+void LinkStats::OnPacket(int64_t arrivalUs, const HrMeasurement& measurement) {
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    if (m_lastArrivalUs < 0) {
+        m_lastArrivalUs = arrivalUs;
+        return;
+    }
+    double gap = static_cast<double>(arrivalUs - m_lastArrivalUs);
+    m_lastArrivalUs = arrivalUs;
+
+    // A long gap is only loss if the beats reported in this packet don't account for it
+    // (a strap that notifies per beat legitimately goes quiet for one long RR interval).
+    double unexplained = gap;
+    if (measurement.rrCount > 0) {
+        unexplained = gap - static_cast<double>(RrSumUs(measurement));
+    }
+
+    if (gap > kDropFactor * m_nominal && unexplained > 0.5 * m_nominal) {
+        // Without RR the gap includes the arrived packet's own interval: a 2x gap is one loss, 3x two
+        long long lost = std::llround(unexplained / m_nominal);
+        if (measurement.rrCount == 0) {
+            --lost;
+        }
+        m_dropped.fetch_add(lost > 0 ? static_cast<uint64_t>(lost) : 1, std::memory_order_relaxed);
+    }
+    else if (gap > kLateFactor * m_nominal) {
+        m_late.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (gap >= kBunchedFactor * m_nominal) {
+        // Only learn the cadence from on-time packets so outages (and the bunch a stalled
+        // stack delivers all at once afterwards) don't skew it
+        m_nominal += (gap - m_nominal) / 8.0;
+        m_nominalUs.store(static_cast<uint32_t>(m_nominal), std::memory_order_relaxed);
+    }
+
+    double deviation = std::fabs(gap - m_nominal);
+    if (deviation > m_nominal) {
+        deviation = m_nominal; // Keep one outage from dominating the jitter estimate
+    }
+    m_jitter += (deviation - m_jitter) / 16.0;
+    m_jitterUs.store(static_cast<uint32_t>(m_jitter), std::memory_order_relaxed);
+}
+
+void LinkStats::OnMalformed() {
+    m_malformed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkStats::Snapshot(HrLinkStats& out) const {
+    out.deviceAddress = m_deviceAddress.load(std::memory_order_relaxed);
+    out.received = m_received.load(std::memory_order_relaxed);
+    out.droppedEstimated = m_dropped.load(std::memory_order_relaxed);
+    out.malformed = m_malformed.load(std::memory_order_relaxed);
+    out.late = m_late.load(std::memory_order_relaxed);
+    out.jitterUs = m_jitterUs.load(std::memory_order_relaxed);
+    out.nominalIntervalUs = m_nominalUs.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "BLEHeartRateMonitor.h"
+#include "HrMeasurement.h"
+
+// Tracks notification arrival against the strap's cadence and the RR time it reports,
+// so a dropped notification can be told apart from a slow heart.
+// OnPacket/OnMalformed are called from the notification thread only; Snapshot from any thread.
+class LinkStats {
+public:
+    void Reset(uint64_t deviceAddress);
+    void OnPacket(int64_t arrivalUs, const HrMeasurement& measurement);
+    void OnMalformed();
+    void Snapshot(HrLinkStats& out) const;
+    uint32_t NominalIntervalUs() const { return m_nominalUs.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_deviceAddress{ 0 };
+    std::atomic<uint64_t> m_received{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_malformed{ 0 };
+    std::atomic<uint64_t> m_late{ 0 };
+    std::atomic<uint32_t> m_jitterUs{ 0 };
+    std::atomic<uint32_t> m_nominalUs{ 0 };
+
+    // Notification thread only
+    int64_t m_lastArrivalUs = -1;
+    double m_jitter = 0.0;
+    double m_nominal = 0.0;
+};
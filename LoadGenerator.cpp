@@ -0,0 +1,439 @@
+#include "pch.h"
+#include "LoadGenerator.h"
+#include "CaptureWriter.h"
+#include "HrMeasurement.h"
+#include "LatencyHistogram.h"
+#include "LatestSamples.h"
+#include "LinkStats.h"
+#include "SampleDispatcher.h"
+#include "SampleQueue.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    int64_t ElapsedNs(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    int64_t NowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // User + kernel time of the whole process
+    int64_t ProcessCpuNs() {
+#ifdef _WIN32
+        FILETIME created, exited, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+            return 0;
+        }
+        auto ticks = [](FILETIME const& t) {
+            return static_cast<int64_t>((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime);
+        };
+        return (ticks(kernel) + ticks(user)) * 100;
+#else
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        auto ns = [](timeval const& t) { return static_cast<int64_t>(t.tv_sec) * 1000000000 + static_cast<int64_t>(t.tv_usec) * 1000; };
+        return ns(usage.ru_utime) + ns(usage.ru_stime);
+#endif
+    }
+
+    int64_t ResidentBytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return 0;
+        }
+        return static_cast<int64_t>(counters.WorkingSetSize);
+#else
+        long pages = 0, resident = 0;
+        std::FILE* statm = std::fopen("/proc/self/statm", "r");
+        if (!statm) {
+            return 0;
+        }
+        int fields = std::fscanf(statm, "%ld %ld", &pages, &resident);
+        std::fclose(statm);
+        return fields == 2 ? static_cast<int64_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+#endif
+    }
+
+    int64_t OpenHandles() {
+#ifdef _WIN32
+        DWORD count = 0;
+        return GetProcessHandleCount(GetCurrentProcess(), &count) ? static_cast<int64_t>(count) : 0;
+#else
+        DIR* fds = opendir("/proc/self/fd");
+        if (!fds) {
+            return 0;
+        }
+        int64_t count = -1; // Not counting the descriptor opendir itself holds
+        while (dirent* entry = readdir(fds)) {
+            if (entry->d_name[0] != '.') {
+                ++count;
+            }
+        }
+        closedir(fds);
+        return count;
+#endif
+    }
+
+    // One simulated strap: heart rate random walk, 1-2 RR intervals, energy every 10th packet
+    struct Strap {
+        uint64_t address = 0;
+        uint32_t random = 1;
+        uint16_t bpm = 70;
+        uint16_t energy = 0;
+        uint64_t sequence = 0;
+        int latestSlot = -1; // LatestSamples hint, as a session keeps it
+
+        uint32_t Next() {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            return random;
+        }
+
+        size_t Encode(uint8_t* out) {
+            uint32_t r = Next();
+            int step = static_cast<int>(r % 5) - 2;
+            bpm = static_cast<uint16_t>(std::clamp(bpm + step, 50, 190));
+            uint8_t flags = kHrFlagContactSupported | kHrFlagContactDetected | kHrFlagRrPresent;
+            bool withEnergy = (sequence % 10) == 0;
+            if (withEnergy) {
+                flags |= kHrFlagEnergyExpended;
+            }
+            size_t length = 0;
+            out[length++] = flags;
+            out[length++] = static_cast<uint8_t>(bpm);
+            if (withEnergy) {
+                energy = static_cast<uint16_t>(energy + 1);
+                out[length++] = static_cast<uint8_t>(energy);
+                out[length++] = static_cast<uint8_t>(energy >> 8);
+            }
+            int rrCount = 1 + static_cast<int>((r >> 8) & 1);
+            uint16_t rr = static_cast<uint16_t>(60 * 1024 / bpm);
+            for (int i = 0; i < rrCount; ++i) {
+                out[length++] = static_cast<uint8_t>(rr);
+                out[length++] = static_cast<uint8_t>(rr >> 8);
+            }
+            return length;
+        }
+    };
+
+    struct Pipeline {
+        std::unique_ptr<LinkStats[]> stats;
+        std::unique_ptr<LatestSamples> latest; // A slot per device, so every Store does the full write
+        SampleQueue queue;
+        CaptureWriter capture;
+        SampleDispatcher dispatcher;
+        bool capturing = false;
+    };
+
+    struct ProducerResult {
+        LatencyHistogram latency;
+        uint64_t samples = 0;
+        int64_t maxLagNs = 0;
+
+        // Current reporting interval, handed over to the RunLoadTest thread at its end
+        std::mutex intervalMutex;
+        LatencyHistogram interval;
+        uint64_t intervalSamples = 0;
+    };
+
+    void __stdcall CountSamples(const HrSample*, int, void* userData) {
+        static_cast<std::atomic<uint64_t>*>(userData)->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Notification thread stand-in: the same steps as the live ValueChanged handler
+    void Produce(Pipeline& pipeline, std::vector<Strap>& straps, uint32_t first, uint32_t count,
+        double rateHz, Clock::time_point start, Clock::time_point end, bool intervals, ProducerResult& result) {
+        const int64_t periodNs = rateHz > 0.0 ? static_cast<int64_t>(1e9 / rateHz) : 0;
+        uint8_t payload[16];
+        for (uint64_t round = 0;; ++round) {
+            for (uint32_t k = 0; k < count; ++k) {
+                Clock::time_point now = Clock::now();
+                if (periodNs > 0) {
+                    // Spread this thread's devices evenly over the period
+                    Clock::time_point due = start + std::chrono::nanoseconds(
+                        static_cast<int64_t>(round) * periodNs + periodNs * k / count);
+                    if (due >= end) {
+                        return;
+                    }
+                    if (now < due) {
+                        std::this_thread::sleep_until(due);
+                        now = Clock::now();
+                    }
+                    result.maxLagNs = std::max(result.maxLagNs, ElapsedNs(due, now));
+                }
+                else if (now >= end) {
+                    return;
+                }
+                uint32_t index = first + k;
+                Strap& strap = straps[index];
+                size_t length = strap.Encode(payload);
+
+                Clock::time_point begin = Clock::now();
+                int64_t arrivalUs = NowUs();
+                HrMeasurement measurement;
+                if (!ParseHrMeasurement(payload, length, measurement)) {
+                    pipeline.stats[index].OnMalformed();
+                    continue;
+                }
+                pipeline.stats[index].OnPacket(arrivalUs, measurement);
+                HrSample sample{};
+                sample.timestampUs = arrivalUs;
+                sample.deviceAddress = strap.address;
+                sample.sequence = ++strap.sequence;
+                sample.bpm = measurement.bpm;
+                sample.energyExpended = measurement.energyExpended;
+                sample.flags = measurement.flags;
+                sample.rrCount = measurement.rrCount;
+                for (uint8_t i = 0; i < measurement.rrCount; ++i) {
+                    sample.rr[i] = measurement.rr[i];
+                }
+                strap.latestSlot = pipeline.latest->Store(sample, strap.latestSlot);
+                pipeline.queue.Push(sample);
+                if (pipeline.capturing) {
+                    pipeline.capture.RecordNotification(strap.address, arrivalUs, payload, length);
+                }
+                pipeline.dispatcher.Deliver(sample);
+                uint64_t latencyNs = static_cast<uint64_t>(ElapsedNs(begin, Clock::now()));
+                result.latency.Record(latencyNs);
+                ++result.samples;
+                if (intervals) {
+                    std::lock_guard<std::mutex> lock(result.intervalMutex);
+                    result.interval.Record(latencyNs);
+                    ++result.intervalSamples;
+                }
+            }
+        }
+    }
+
+    LoadLatency Summarize(const LatencyHistogram& histogram) {
+        return { histogram.Percentile(50.0), histogram.Percentile(99.0), histogram.Percentile(99.9), histogram.Max() };
+    }
+}
+
+bool RunLoadTest(const LoadConfig& config, LoadReport& report) {
+    if (config.devices == 0 || config.durationMs == 0 || config.rateHz < 0.0 || config.queueCapacity == 0
+        || config.queueCapacity > 65536) {
+        return false;
+    }
+    uint32_t threads = config.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    }
+    threads = std::min(threads, config.devices);
+
+    report = LoadReport{};
+    report.devices = config.devices;
+    report.threads = threads;
+    report.targetRateHz = config.rateHz;
+
+    int64_t residentBefore = ResidentBytes();
+    auto pipeline = std::make_unique<Pipeline>();
+    pipeline->stats.reset(new LinkStats[config.devices]);
+    pipeline->latest = std::make_unique<LatestSamples>(config.devices);
+    std::vector<Strap> straps(config.devices);
+    for (uint32_t i = 0; i < config.devices; ++i) {
+        straps[i].address = 0xC0FFEE000000ull + i;
+        straps[i].random = 0x9E3779B9u ^ (i * 2654435761u) ^ 1u;
+        pipeline->stats[i].Reset(straps[i].address);
+    }
+    if (!pipeline->queue.Reserve(config.queueCapacity)) {
+        return false;
+    }
+    if (config.capturePath) {
+        if (!pipeline->capture.Start(config.capturePath, NowUs())) {
+            return false;
+        }
+        pipeline->capturing = true;
+    }
+    std::atomic<uint64_t> calls[3] = {};
+    int subscribers[3] = {
+        pipeline->dispatcher.Add(&CountSamples, &calls[0], HrDeliveryEverySample, 0),
+        pipeline->dispatcher.Add(&CountSamples, &calls[1], HrDeliveryCoalesce, 250), // UI label
+        pipeline->dispatcher.Add(&CountSamples, &calls[2], HrDeliveryBatch, 1000),   // Logger
+    };
+
+    const bool intervals = config.intervalMs > 0 && config.onInterval;
+    std::vector<ProducerResult> results(threads);
+    LatencyHistogram queueLatency;
+    std::mutex queueIntervalMutex;
+    LatencyHistogram queueInterval;
+    std::atomic<bool> producing{ true };
+    int64_t cpuBefore = ProcessCpuNs();
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(20); // Let every thread get going
+    Clock::time_point end = start + std::chrono::milliseconds(config.durationMs);
+
+    // Host polling the every-sample queue
+    std::thread consumer([&] {
+        HrSample sample;
+        for (;;) {
+            bool last = !producing.load(std::memory_order_acquire);
+            std::unique_lock<std::mutex> lock(queueIntervalMutex, std::defer_lock);
+            if (intervals) {
+                lock.lock();
+            }
+            while (pipeline->queue.Pop(sample)) {
+                uint64_t latencyNs = static_cast<uint64_t>(std::max<int64_t>(NowUs() - sample.timestampUs, 0)) * 1000;
+                queueLatency.Record(latencyNs);
+                if (intervals) {
+                    queueInterval.Record(latencyNs);
+                }
+            }
+            if (lock) {
+                lock.unlock();
+            }
+            if (last) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.pollIntervalMs));
+        }
+    });
+
+    std::vector<std::thread> producers;
+    uint32_t first = 0;
+    for (uint32_t t = 0; t < threads; ++t) {
+        uint32_t count = config.devices / threads + (t < config.devices % threads ? 1 : 0);
+        producers.emplace_back(Produce, std::ref(*pipeline), std::ref(straps), first, count, config.rateHz,
+            start, end, intervals, std::ref(results[t]));
+        first += count;
+    }
+    // Drive the coalesce/batch and capture timers ourselves (no thread-pool driver off Windows)
+    std::unique_ptr<LoadInterval> interval;
+    Clock::time_point nextInterval = end;
+    int64_t intervalCpuNs = cpuBefore;
+    if (intervals) {
+        interval = std::make_unique<LoadInterval>();
+        nextInterval = start + std::chrono::milliseconds(config.intervalMs);
+    }
+    for (Clock::time_point now = Clock::now(); now < end; now = Clock::now()) {
+        g_timers.Advance(TimerWheel::NowMs());
+        if (now >= nextInterval) {
+            // Only whole intervals are reported; the one cut short by the end of the run is not
+            *interval = LoadInterval{};
+            for (auto& result : results) {
+                std::lock_guard<std::mutex> lock(result.intervalMutex);
+                interval->pipeline.Merge(result.interval);
+                interval->samples += result.intervalSamples;
+                result.interval.Reset();
+                result.intervalSamples = 0;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queueIntervalMutex);
+                interval->queue.Merge(queueInterval);
+                queueInterval.Reset();
+            }
+            int64_t cpuNs = ProcessCpuNs();
+            interval->elapsedS = static_cast<double>(ElapsedNs(start, now)) / 1e9;
+            interval->queueDepth = pipeline->queue.Depth();
+            interval->queueOverflows = pipeline->queue.Overflows();
+            if (pipeline->capturing) {
+                HrCaptureStats capture;
+                pipeline->capture.Snapshot(capture);
+                interval->captureDropped = capture.dropped;
+            }
+            interval->residentBytes = ResidentBytes();
+            interval->handles = OpenHandles();
+            interval->cpuPercent = static_cast<double>(cpuNs - intervalCpuNs) / 1e4 / config.intervalMs;
+            intervalCpuNs = cpuNs;
+            config.onInterval(*interval, config.intervalContext);
+            nextInterval += std::chrono::milliseconds(config.intervalMs);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(TimerWheel::kTickMs));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    Clock::time_point stopped = Clock::now();
+    producing.store(false, std::memory_order_release);
+    consumer.join();
+    int64_t cpuNs = ProcessCpuNs() - cpuBefore;
+    int64_t residentAfter = ResidentBytes();
+
+    for (int id : subscribers) {
+        pipeline->dispatcher.Remove(id);
+    }
+    if (pipeline->capturing) {
+        pipeline->capture.Stop();
+        HrCaptureStats capture;
+        pipeline->capture.Snapshot(capture);
+        report.captureRecords = capture.records;
+        report.captureDropped = capture.dropped;
+        report.captureBytes = capture.bytesWritten;
+    }
+
+    LatencyHistogram latency;
+    for (auto const& result : results) {
+        latency.Merge(result.latency);
+        report.samples += result.samples;
+        report.maxLagNs = std::max<uint64_t>(report.maxLagNs, static_cast<uint64_t>(result.maxLagNs));
+    }
+    report.elapsedS = static_cast<double>(ElapsedNs(start, stopped)) / 1e9;
+    report.throughputPerS = report.elapsedS > 0.0 ? static_cast<double>(report.samples) / report.elapsedS : 0.0;
+    report.pipeline = Summarize(latency);
+    report.queue = Summarize(queueLatency);
+    report.polled = queueLatency.Count();
+    report.queueOverflows = pipeline->queue.Overflows();
+    report.latestUntracked = pipeline->latest->Untracked();
+    report.cpuPercent = report.elapsedS > 0.0 ? static_cast<double>(cpuNs) / 1e9 / report.elapsedS * 100.0 : 0.0;
+    report.cpuPercentPerDevice = report.cpuPercent / config.devices;
+    report.memoryBytes = residentAfter - residentBefore;
+    report.memoryBytesPerDevice = report.memoryBytes / static_cast<int64_t>(config.devices);
+    for (int i = 0; i < 3; ++i) {
+        report.subscriberCalls[i] = calls[i].load(std::memory_order_relaxed);
+    }
+    return true;
+}
+
+size_t FormatLoadReportJson(const LoadReport& report, char* out, size_t capacity) {
+    auto latency = [](LoadLatency const& l) {
+        return std::make_tuple(static_cast<unsigned long long>(l.p50Ns), static_cast<unsigned long long>(l.p99Ns),
+            static_cast<unsigned long long>(l.p999Ns), static_cast<unsigned long long>(l.maxNs));
+    };
+    auto [p50, p99, p999, pmax] = latency(report.pipeline);
+    auto [q50, q99, q999, qmax] = latency(report.queue);
+    int length = std::snprintf(out, capacity,
+        "{\"devices\":%u,\"threads\":%u,\"targetRateHz\":%.3f,\"elapsedS\":%.3f,\"samples\":%llu,"
+        "\"throughputPerS\":%.1f,"
+        "\"pipelineLatencyNs\":{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},"
+        "\"queueLatencyNs\":{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},"
+        "\"maxLagNs\":%llu,\"cpuPercent\":%.2f,\"cpuPercentPerDevice\":%.5f,"
+        "\"memoryBytes\":%lld,\"memoryBytesPerDevice\":%lld,"
+        "\"queueOverflows\":%llu,\"polled\":%llu,\"latestUntracked\":%llu,"
+        "\"capture\":{\"records\":%llu,\"dropped\":%llu,\"bytes\":%llu},"
+        "\"subscriberCalls\":{\"everySample\":%llu,\"coalesce\":%llu,\"batch\":%llu}}",
+        report.devices, report.threads, report.targetRateHz, report.elapsedS,
+        static_cast<unsigned long long>(report.samples), report.throughputPerS,
+        p50, p99, p999, pmax, q50, q99, q999, qmax,
+        static_cast<unsigned long long>(report.maxLagNs), report.cpuPercent, report.cpuPercentPerDevice,
+        static_cast<long long>(report.memoryBytes), static_cast<long long>(report.memoryBytesPerDevice),
+        static_cast<unsigned long long>(report.queueOverflows), static_cast<unsigned long long>(report.polled),
+        static_cast<unsigned long long>(report.latestUntracked),
+        static_cast<unsigned long long>(report.captureRecords), static_cast<unsigned long long>(report.captureDropped),
+        static_cast<unsigned long long>(report.captureBytes),
+        static_cast<unsigned long long>(report.subscriberCalls[0]), static_cast<unsigned long long>(report.subscriberCalls[1]),
+        static_cast<unsigned long long>(report.subscriberCalls[2]));
+    if (length < 0 || static_cast<size_t>(length) >= capacity) {
+        return 0;
+    }
+    return static_cast<size_t>(length);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "LatencyHistogram.h"
+
+// --- Load generator ---
+// Drives N simulated straps through the real sample pipeline for a fixed time: parse, link
+// stats (analytics), latest-sample cells (a slot per device), the every-sample queue drained by
+// a polling consumer, raw capture to disk, and dispatch to an every-sample, a coalesced and a
+// batched subscriber. Devices are spread over a few producer threads, each sending its devices'
+// notifications round-robin at rateHz (0 = as fast as possible).
+// Uses private instances of each pipeline stage, so it never touches a live session's state.
+// Portable: the DLL exports it as RunLoadTest, and tools/loadgen.cpp runs it headless on Linux.
+
+// What happened over one reporting interval of a run (see LoadConfig::intervalMs)
+struct LoadInterval {
+    double elapsedS;              // Since the run started, at the end of this interval
+    uint64_t samples;             // This interval
+    LatencyHistogram pipeline;    // This interval, ns
+    LatencyHistogram queue;       // This interval, ns
+    uint32_t queueDepth;          // When the interval ended
+    uint64_t queueOverflows;      // Since the run started
+    uint64_t captureDropped;      // Since the run started
+    int64_t residentBytes;
+    int64_t handles;              // Open handles (file descriptors off Windows)
+    double cpuPercent;            // This interval, 100 = one core
+};
+
+typedef void (*LoadIntervalCallback)(const LoadInterval& interval, void* context);
+
+struct LoadConfig {
+    uint32_t devices = 100;
+    double rateHz = 4.0;              // Notifications per device per second, 0 = unthrottled
+    uint32_t durationMs = 10000;
+    uint32_t threads = 0;             // Producer threads, 0 = half the cores
+    uint32_t queueCapacity = 65536;   // Every-sample queue, drained every pollIntervalMs
+    uint32_t pollIntervalMs = 5;
+    const char* capturePath = nullptr; // Raw capture file, null = skip the recording stage
+    uint32_t intervalMs = 0;           // Call onInterval this often on the RunLoadTest thread, 0 = never
+    LoadIntervalCallback onInterval = nullptr;
+    void* intervalContext = nullptr;
+};
+
+struct LoadLatency {
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+};
+
+struct LoadReport {
+    uint32_t devices;
+    uint32_t threads;
+    double targetRateHz;
+    double elapsedS;
+    uint64_t samples;                // Notifications pushed through the pipeline
+    double throughputPerS;
+    LoadLatency pipeline;            // Arrival to dispatch returning, on the producer thread
+    LoadLatency queue;               // Arrival to the polling consumer popping it
+    uint64_t maxLagNs;               // Furthest a producer fell behind its schedule
+    double cpuPercent;               // Process CPU over the run, 100 = one core
+    double cpuPercentPerDevice;
+    int64_t memoryBytes;             // Resident set growth over the run
+    int64_t memoryBytesPerDevice;
+    uint64_t queueOverflows;
+    uint64_t polled;
+    uint64_t latestUntracked;        // Samples the latest-sample table had no slot for (0 when sized right)
+    uint64_t captureRecords;
+    uint64_t captureDropped;
+    uint64_t captureBytes;
+    uint64_t subscriberCalls[3];     // Every-sample, coalesced, batched
+};
+
+// Runs the load test on the calling thread plus config.threads producers and one consumer.
+// False if the configuration is invalid or a stage could not be set up.
+bool RunLoadTest(const LoadConfig& config, LoadReport& report);
+
+// Writes report as one JSON object. Returns the length, or 0 if capacity is too small.
+size_t FormatLoadReportJson(const LoadReport& report, char* out, size_t capacity);
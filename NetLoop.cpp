@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "NetLoop.h"
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#ifdef _WIN32
+bool NetLoop::Open(Pass pass, void* context, NetLoopEnvironment environment) {
+    m_pass = pass;
+    m_context = context;
+    m_closing = false;
+    m_event = WSACreateEvent();
+    if (m_event == WSA_INVALID_EVENT) {
+        return false;
+    }
+    m_wait = CreateThreadpoolWait(&WaitCallback, this, environment);
+    if (!m_wait) {
+        WSACloseEvent(m_event);
+        m_event = WSA_INVALID_EVENT;
+        return false;
+    }
+    SetThreadpoolWait(m_wait, m_event, nullptr);
+    return true;
+}
+
+void NetLoop::Close() {
+    if (!m_wait) {
+        return;
+    }
+    m_closing.store(true, std::memory_order_release);
+    // A pass that already started may re-arm once more; cancel that too
+    WaitForThreadpoolWaitCallbacks(m_wait, FALSE);
+    SetThreadpoolWait(m_wait, nullptr, nullptr);
+    WaitForThreadpoolWaitCallbacks(m_wait, TRUE);
+    CloseThreadpoolWait(m_wait);
+    m_wait = nullptr;
+    WSACloseEvent(m_event);
+    m_event = WSA_INVALID_EVENT;
+}
+
+bool NetLoop::Watch(SOCKET socket, Interest interest) {
+    long events = interest == NetAccept ? FD_ACCEPT : interest == NetRead ? FD_READ : FD_READ | FD_WRITE | FD_CLOSE;
+    // Also makes the socket non-blocking; accepted sockets inherit the listener's selection, this replaces it
+    return WSAEventSelect(socket, m_event, events) != SOCKET_ERROR;
+}
+
+void NetLoop::Wake() {
+    WSASetEvent(m_event);
+}
+
+// One pass: reset the event first so anything signalled while it runs triggers another pass
+void CALLBACK NetLoop::WaitCallback(PTP_CALLBACK_INSTANCE, void* context, PTP_WAIT wait, TP_WAIT_RESULT) {
+    auto loop = static_cast<NetLoop*>(context);
+    WSAResetEvent(loop->m_event);
+    loop->m_pass(loop->m_context);
+    if (!loop->m_closing.load(std::memory_order_acquire)) {
+        SetThreadpoolWait(wait, loop->m_event, nullptr); // Waits are one-shot
+    }
+}
+#else
+bool NetLoop::Open(Pass pass, void* context, NetLoopEnvironment) {
+    m_pass = pass;
+    m_context = context;
+    m_closing = false;
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = m_wake;
+    if (m_epoll == -1 || m_wake == -1 || epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &event) == -1) {
+        if (m_epoll != -1) {
+            close(m_epoll);
+        }
+        if (m_wake != -1) {
+            close(m_wake);
+        }
+        m_epoll = -1;
+        m_wake = -1;
+        return false;
+    }
+    m_thread = std::thread([this] { Run(); });
+    return true;
+}
+
+void NetLoop::Close() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_closing.store(true, std::memory_order_release);
+    Wake();
+    m_thread.join();
+    close(m_epoll);
+    close(m_wake);
+    m_epoll = -1;
+    m_wake = -1;
+}
+
+bool NetLoop::Watch(SOCKET socket, Interest interest) {
+    if (!NetSetNonBlocking(socket)) {
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLET | (interest == NetReadWrite ? EPOLLIN | EPOLLOUT | EPOLLRDHUP : EPOLLIN);
+    event.data.fd = socket;
+    return epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event) != -1;
+}
+
+void NetLoop::Wake() {
+    uint64_t one = 1;
+    ssize_t written = write(m_wake, &one, sizeof(one));
+    (void)written; // Only fails when the counter is already huge, i.e. a wake is pending anyway
+}
+
+void NetLoop::Run() {
+    epoll_event events[64];
+    while (!m_closing.load(std::memory_order_acquire)) {
+        int ready = epoll_wait(m_epoll, events, 64, -1);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        // Clear the wake counter first so a Wake during the pass triggers another pass
+        uint64_t count;
+        ssize_t drained = read(m_wake, &count, sizeof(count));
+        (void)drained;
+        if (m_closing.load(std::memory_order_acquire)) {
+            return;
+        }
+        m_pass(m_context);
+    }
+}
+#endif
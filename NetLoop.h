@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#ifndef _WIN32
+#include <thread>
+#endif
+#include "NetSocket.h"
+
+#ifdef _WIN32
+using NetLoopEnvironment = PTP_CALLBACK_ENVIRON;
+#else
+using NetLoopEnvironment = void*; // Unused: the loop has its own thread
+#endif
+
+// --- Socket event loop ---
+// Runs the owner's pass whenever a watched socket has news or Wake is called. A pass must
+// drain every socket it cares about (accept, recv and send until they would block): events
+// are edge-like, so one that arrives during a pass only guarantees another pass.
+// Windows: every socket is WSAEventSelect'ed onto one event and the pass runs from a
+// thread-pool wait on it, in the given environment (the shared executor). Elsewhere: an
+// edge-triggered epoll set and an eventfd, waited on by a dedicated thread.
+class NetLoop {
+public:
+    using Pass = void(*)(void* context);
+
+    enum Interest {
+        NetAccept,    // Listening socket
+        NetRead,      // Datagram socket
+        NetReadWrite, // Connected stream: readable, writable again, or closed
+    };
+
+    // Starts waiting; the first pass runs on the first event
+    bool Open(Pass pass, void* context, NetLoopEnvironment environment);
+    // Stops waiting and waits for a pass in progress to return; sockets are the owner's to close
+    void Close();
+
+    // Watches a socket (also makes it non-blocking); closing it stops the watch
+    bool Watch(SOCKET socket, Interest interest);
+    void Wake(); // Any thread; runs another pass soon
+
+private:
+    Pass m_pass = nullptr;
+    void* m_context = nullptr;
+    std::atomic<bool> m_closing{ false };
+#ifdef _WIN32
+    static void CALLBACK WaitCallback(PTP_CALLBACK_INSTANCE, void* context, PTP_WAIT wait, TP_WAIT_RESULT);
+
+    WSAEVENT m_event = WSA_INVALID_EVENT;
+    PTP_WAIT m_wait = nullptr;
+#else
+    void Run();
+
+    int m_epoll = -1;
+    int m_wake = -1; // eventfd
+    std::thread m_thread;
+#endif
+};
@@ -0,0 +1,332 @@
+#include "pch.h"
+#include "NetPublisher.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+NetPublisher g_netPublisher;
+
+namespace {
+    constexpr uint8_t kFrameTypeSample = 1;
+
+    uint8_t* PutLe(uint8_t* p, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            *p++ = static_cast<uint8_t>(value >> (8 * i));
+        }
+        return p;
+    }
+
+    void CloseSocket(SOCKET& socket) {
+        if (socket != INVALID_SOCKET) {
+            closesocket(socket);
+            socket = INVALID_SOCKET;
+        }
+    }
+}
+
+size_t EncodeSampleBinary(const HrSample& sample, uint8_t* out, size_t capacity) {
+    size_t length = 34 + 2 * static_cast<size_t>(sample.rrCount);
+    if (length > capacity) {
+        return 0;
+    }
+    uint8_t* p = PutLe(out, length - 2, 2);
+    *p++ = kFrameTypeSample;
+    *p++ = sample.rrCount;
+    p = PutLe(p, sample.deviceAddress, 8);
+    p = PutLe(p, sample.sequence, 8);
+    p = PutLe(p, static_cast<uint64_t>(sample.timestampUs), 8);
+    p = PutLe(p, sample.bpm, 2);
+    p = PutLe(p, sample.energyExpended, 2);
+    *p++ = sample.flags;
+    *p++ = 0;
+    for (uint8_t i = 0; i < sample.rrCount; ++i) {
+        p = PutLe(p, sample.rr[i], 2);
+    }
+    return length;
+}
+
+size_t EncodeSampleJson(const HrSample& sample, uint8_t* out, size_t capacity) {
+    char* text = reinterpret_cast<char*>(out);
+    int written = snprintf(text, capacity,
+        "{\"device\":%llu,\"seq\":%llu,\"t\":%lld,\"bpm\":%u,\"energy\":%u,\"flags\":%u,\"rr\":[",
+        static_cast<unsigned long long>(sample.deviceAddress), static_cast<unsigned long long>(sample.sequence),
+        static_cast<long long>(sample.timestampUs), sample.bpm, sample.energyExpended, sample.flags);
+    size_t length = written > 0 ? static_cast<size_t>(written) : capacity;
+    for (uint8_t i = 0; i < sample.rrCount && length < capacity; ++i) {
+        written = snprintf(text + length, capacity - length, i == 0 ? "%u" : ",%u", sample.rr[i]);
+        length += written > 0 ? static_cast<size_t>(written) : capacity;
+    }
+    if (length < capacity) {
+        written = snprintf(text + length, capacity - length, "]}\n");
+        length += written > 0 ? static_cast<size_t>(written) : capacity;
+    }
+    return length < capacity ? length : 0; // Truncated frames are not sent
+}
+
+bool NetPublisher::Start(uint16_t port, HrNetFormat format, bool allInterfaces, NetLoopEnvironment environment) {
+    if (Running()) {
+        return false;
+    }
+    if (!NetStartup()) {
+        return false;
+    }
+    auto fail = [this] {
+        m_loop.Close();
+        CloseAll();
+        NetCleanup();
+        return false;
+    };
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(allInterfaces ? INADDR_ANY : INADDR_LOOPBACK);
+
+    m_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    m_udp = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (m_listener == INVALID_SOCKET || m_udp == INVALID_SOCKET) {
+        return fail();
+    }
+    NetExclusiveAddress(m_listener);
+    NetExclusiveAddress(m_udp);
+    if (bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR
+        || listen(m_listener, SOMAXCONN) == SOCKET_ERROR
+        || bind(m_udp, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR) {
+        return fail();
+    }
+
+    // Loop state is set before the loop can run a pass
+    m_format = format;
+    m_mirrored = 0;
+    m_framesPublished = 0;
+    m_framesDropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        m_published = 0;
+    }
+    if (!m_loop.Open(&OnPass, this, environment)
+        || !m_loop.Watch(m_listener, NetLoop::NetAccept)
+        || !m_loop.Watch(m_udp, NetLoop::NetRead)) {
+        return fail();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        m_running.store(true, std::memory_order_release);
+    }
+    return true;
+}
+
+void NetPublisher::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        if (!Running()) {
+            return;
+        }
+        m_running.store(false, std::memory_order_release); // Publish no longer wakes the loop
+    }
+    m_loop.Close();
+    CloseAll();
+    NetCleanup();
+}
+
+void NetPublisher::Publish(const HrSample& sample) {
+    if (!Running()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_outboxMutex);
+    if (!Running()) {
+        return;
+    }
+    Frame& frame = m_outbox[m_published % kOutboxCapacity];
+    size_t length = m_format == HrNetFormatJson
+        ? EncodeSampleJson(sample, frame.data, sizeof(frame.data))
+        : EncodeSampleBinary(sample, frame.data, sizeof(frame.data));
+    if (length == 0) {
+        return;
+    }
+    frame.length = static_cast<uint16_t>(length);
+    ++m_published;
+    m_framesPublished.fetch_add(1, std::memory_order_relaxed);
+    m_loop.Wake();
+}
+
+void NetPublisher::Snapshot(HrNetStats& out) const {
+    out.tcpClients = m_tcpCount.load(std::memory_order_relaxed);
+    out.udpSubscribers = m_udpCount.load(std::memory_order_relaxed);
+    out.framesPublished = m_framesPublished.load(std::memory_order_relaxed);
+    out.framesDropped = m_framesDropped.load(std::memory_order_relaxed);
+}
+
+void NetPublisher::OnPass(void* context) {
+    static_cast<NetPublisher*>(context)->RunLoop();
+}
+
+// One pass: every socket is drained, so an event that arrives meanwhile just means another pass
+void NetPublisher::RunLoop() {
+    uint64_t nowMs = TimerWheel::NowMs();
+    AcceptClients();
+    ReceiveDatagrams(nowMs);
+
+    uint64_t published;
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        published = m_published;
+        MirrorOutbox(published);
+    }
+
+    char discard[256];
+    for (auto& client : m_clients) {
+        // Clients have nothing to say; read only to notice them closing
+        bool alive = true;
+        for (;;) {
+            int received = recv(client.socket, discard, sizeof(discard), 0);
+            if (received > 0) {
+                continue;
+            }
+            alive = received == SOCKET_ERROR && NetWouldBlock();
+            break;
+        }
+        if (!alive || !FlushClient(client, published)) {
+            CloseSocket(client.socket);
+        }
+    }
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+        [](TcpClient const& client) { return client.socket == INVALID_SOCKET; }), m_clients.end());
+
+    m_subscribers.erase(std::remove_if(m_subscribers.begin(), m_subscribers.end(),
+        [nowMs](UdpSubscriber const& subscriber) { return nowMs - subscriber.lastSeenMs > kUdpExpiryMs; }),
+        m_subscribers.end());
+    for (auto& subscriber : m_subscribers) {
+        FlushSubscriber(subscriber, published);
+    }
+
+    m_tcpCount.store(static_cast<uint32_t>(m_clients.size()), std::memory_order_relaxed);
+    m_udpCount.store(static_cast<uint32_t>(m_subscribers.size()), std::memory_order_relaxed);
+}
+
+void NetPublisher::AcceptClients() {
+    for (;;) {
+        SOCKET socket = accept(m_listener, nullptr, nullptr);
+        if (socket == INVALID_SOCKET) {
+            return; // Would block, or a connection that reset before we got to it
+        }
+        NetNoDelay(socket);
+        if (m_clients.size() >= kMaxTcpClients || !m_loop.Watch(socket, NetLoop::NetReadWrite)) {
+            closesocket(socket);
+            continue;
+        }
+        TcpClient client;
+        client.socket = socket;
+        client.cursor = m_mirrored; // New clients start with the next sample
+        m_clients.push_back(client);
+    }
+}
+
+void NetPublisher::ReceiveDatagrams(uint64_t nowMs) {
+    char payload[64];
+    for (;;) {
+        sockaddr_in from{};
+        socklen_t fromLength = sizeof(from);
+        int received = recvfrom(m_udp, payload, sizeof(payload), 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if (received == SOCKET_ERROR) {
+            if (NetRetryReceive()) {
+                continue;
+            }
+            return;
+        }
+        if (from.sin_family != AF_INET) {
+            continue;
+        }
+        auto match = std::find_if(m_subscribers.begin(), m_subscribers.end(), [&from](UdpSubscriber const& s) {
+            return s.address.sin_addr.s_addr == from.sin_addr.s_addr && s.address.sin_port == from.sin_port;
+        });
+        if (received == 3 && memcmp(payload, "bye", 3) == 0) {
+            if (match != m_subscribers.end()) {
+                m_subscribers.erase(match);
+            }
+        }
+        else if (match != m_subscribers.end()) {
+            match->lastSeenMs = nowMs;
+        }
+        else if (m_subscribers.size() < kMaxUdpSubscribers) {
+            UdpSubscriber subscriber;
+            subscriber.address = from;
+            subscriber.cursor = m_mirrored;
+            subscriber.lastSeenMs = nowMs;
+            m_subscribers.push_back(subscriber);
+        }
+    }
+}
+
+// Copies frames the loop hasn't seen yet (lock held); usually one or two
+void NetPublisher::MirrorOutbox(uint64_t published) {
+    uint64_t first = published - m_mirrored > kOutboxCapacity ? published - kOutboxCapacity : m_mirrored;
+    for (uint64_t i = first; i < published; ++i) {
+        const Frame& frame = m_outbox[i % kOutboxCapacity];
+        Frame& copy = m_mirror[i % kOutboxCapacity];
+        copy.length = frame.length;
+        memcpy(copy.data, frame.data, frame.length);
+    }
+    m_mirrored = published;
+}
+
+uint64_t NetPublisher::SkipAhead(uint64_t& cursor, uint64_t published) {
+    if (published - cursor <= kClientBacklog) {
+        return 0;
+    }
+    uint64_t skipped = published - kClientBacklog - cursor;
+    cursor = published - kClientBacklog;
+    m_framesDropped.fetch_add(skipped, std::memory_order_relaxed);
+    return skipped;
+}
+
+bool NetPublisher::FlushClient(TcpClient& client, uint64_t published) {
+    if (client.offset > 0 && published - client.cursor > kOutboxCapacity) {
+        return false; // The frame it was halfway through is gone; the stream can't be resumed
+    }
+    while (client.cursor != published) {
+        if (client.offset == 0) {
+            SkipAhead(client.cursor, published);
+        }
+        const Frame& frame = m_mirror[client.cursor % kOutboxCapacity];
+        int sent = send(client.socket, reinterpret_cast<const char*>(frame.data) + client.offset,
+            static_cast<int>(frame.length - client.offset), kNetSendFlags);
+        if (sent == SOCKET_ERROR) {
+            return NetWouldBlock(); // Full socket buffer: the loop runs again once it drains
+        }
+        client.offset += static_cast<size_t>(sent);
+        if (client.offset == frame.length) {
+            client.offset = 0;
+            ++client.cursor;
+        }
+    }
+    return true;
+}
+
+void NetPublisher::FlushSubscriber(UdpSubscriber& subscriber, uint64_t published) {
+    SkipAhead(subscriber.cursor, published);
+    for (; subscriber.cursor != published; ++subscriber.cursor) {
+        const Frame& frame = m_mirror[subscriber.cursor % kOutboxCapacity];
+        if (sendto(m_udp, reinterpret_cast<const char*>(frame.data), frame.length, 0,
+            reinterpret_cast<const sockaddr*>(&subscriber.address), sizeof(subscriber.address)) == SOCKET_ERROR) {
+            m_framesDropped.fetch_add(1, std::memory_order_relaxed); // Datagrams are not retried
+        }
+    }
+}
+
+void NetPublisher::CloseAll() {
+    for (auto& client : m_clients) {
+        CloseSocket(client.socket);
+    }
+    m_clients.clear();
+    m_subscribers.clear();
+    CloseSocket(m_listener);
+    CloseSocket(m_udp);
+    m_tcpCount = 0;
+    m_udpCount = 0;
+}
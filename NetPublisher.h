@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "BLEHeartRateMonitor.h"
+#include "NetLoop.h"
+
+// --- Network publisher ---
+// Fans samples out to TCP clients and UDP subscribers on one port. Publish only encodes the
+// frame once into a shared outbox and wakes the loop (NetLoop: on the shared executor on
+// Windows), so sockets are never touched from the notification thread.
+// Each client reads the outbox through its own cursor, which bounds its queue: a client more
+// than kClientBacklog frames behind skips ahead (counted as dropped), and a client lapped in the
+// middle of a frame is disconnected.
+//
+// Binary frame (little endian): u16 length of the rest, u8 type (1 = sample), u8 rrCount,
+// u64 deviceAddress, u64 sequence, i64 timestampUs, u16 bpm, u16 energyExpended, u8 flags,
+// u8 reserved, u16 rr[rrCount]. JSON frames are one object per line.
+// UDP: any datagram to the port subscribes (or refreshes) the sender for 30 s; "bye" unsubscribes.
+
+constexpr size_t kNetMaxFrameBytes = 320;
+
+size_t EncodeSampleBinary(const HrSample& sample, uint8_t* out, size_t capacity);
+size_t EncodeSampleJson(const HrSample& sample, uint8_t* out, size_t capacity);
+
+class NetPublisher {
+public:
+    // Binds TCP and UDP on port (loopback unless allInterfaces) and starts the loop
+    bool Start(uint16_t port, HrNetFormat format, bool allInterfaces, NetLoopEnvironment environment);
+    void Stop(); // Closes every client and waits for the loop to finish
+    bool Running() const { return m_running.load(std::memory_order_acquire); }
+
+    void Publish(const HrSample& sample); // Any thread
+    void Snapshot(HrNetStats& out) const;
+
+private:
+    static constexpr uint32_t kOutboxCapacity = 256;  // Frames
+    static constexpr uint32_t kClientBacklog = 64;    // Frames a client may fall behind
+    static constexpr size_t kMaxTcpClients = 1024;
+    static constexpr size_t kMaxUdpSubscribers = 256;
+    static constexpr uint64_t kUdpExpiryMs = 30000;
+
+    struct Frame {
+        uint16_t length = 0;
+        uint8_t data[kNetMaxFrameBytes] = {};
+    };
+    struct TcpClient {
+        SOCKET socket = INVALID_SOCKET;
+        uint64_t cursor = 0; // Next frame to send
+        size_t offset = 0;   // Bytes of that frame already sent
+    };
+    struct UdpSubscriber {
+        sockaddr_in address{};
+        uint64_t cursor = 0;
+        uint64_t lastSeenMs = 0;
+    };
+
+    static void OnPass(void* context);
+    void RunLoop();
+    void AcceptClients();
+    void ReceiveDatagrams(uint64_t nowMs);
+    void MirrorOutbox(uint64_t published);
+    bool FlushClient(TcpClient& client, uint64_t published); // False if the client must be closed
+    void FlushSubscriber(UdpSubscriber& subscriber, uint64_t published);
+    uint64_t SkipAhead(uint64_t& cursor, uint64_t published);
+    void CloseAll();
+
+    std::atomic<bool> m_running{ false };
+    HrNetFormat m_format = HrNetFormatBinary;
+    NetLoop m_loop;
+    SOCKET m_listener = INVALID_SOCKET;
+    SOCKET m_udp = INVALID_SOCKET;
+
+    // Written by Publish
+    std::mutex m_outboxMutex;
+    Frame m_outbox[kOutboxCapacity];
+    uint64_t m_published = 0;
+
+    // Loop only
+    Frame m_mirror[kOutboxCapacity]; // Outbox copy the loop sends from, outside the lock
+    uint64_t m_mirrored = 0;
+    std::vector<TcpClient> m_clients;
+    std::vector<UdpSubscriber> m_subscribers;
+
+    std::atomic<uint32_t> m_tcpCount{ 0 };
+    std::atomic<uint32_t> m_udpCount{ 0 };
+    std::atomic<uint64_t> m_framesPublished{ 0 };
+    std::atomic<uint64_t> m_framesDropped{ 0 };
+};
+
+extern NetPublisher g_netPublisher;
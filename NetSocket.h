@@ -0,0 +1,95 @@
+#pragma once
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// --- Socket portability ---
+// The network outputs are written against Winsock. Off Windows (the loopback tests under
+// tools/) the few Winsock names they use map onto BSD sockets, and the calls that differ go
+// through the helpers below.
+#ifndef _WIN32
+using SOCKET = int;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+
+inline int closesocket(SOCKET socket) {
+    return close(socket);
+}
+#endif
+
+// A peer that went away must fail send with an error, not raise SIGPIPE
+#ifdef _WIN32
+constexpr int kNetSendFlags = 0;
+#else
+constexpr int kNetSendFlags = MSG_NOSIGNAL;
+#endif
+
+inline bool NetStartup() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void NetCleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// The last socket call failed only because it would have blocked
+inline bool NetWouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// A failed recvfrom on a datagram socket is worth retrying: it reported an earlier send's
+// ICMP unreachable, or a datagram too big for the buffer, rather than an empty queue
+inline bool NetRetryReceive() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAECONNRESET || WSAGetLastError() == WSAEMSGSIZE;
+#else
+    return errno == ECONNREFUSED || errno == EINTR;
+#endif
+}
+
+inline bool NetSetNonBlocking(SOCKET socket) {
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    return ioctlsocket(socket, FIONBIO, &nonBlocking) != SOCKET_ERROR;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
+// Refuse to share the port with another process (Windows lets a later bind steal it otherwise)
+inline void NetExclusiveAddress(SOCKET socket) {
+#ifdef _WIN32
+    BOOL exclusive = TRUE;
+    setsockopt(socket, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&exclusive), sizeof(exclusive));
+#else
+    (void)socket; // Without SO_REUSEADDR/SO_REUSEPORT a bound port is already exclusive
+#endif
+}
+
+inline void NetNoDelay(SOCKET socket) {
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+// Fixed-capacity pool of T. All storage is allocated by Reserve (at open time); Acquire and
+// Release are then lock-free and never allocate. The free list is a Treiber stack of indices
+// with a version tag in the upper half of the head, so a recycled record can't cause ABA.
+template <typename T>
+class ObjectPool {
+public:
+    // Allocates capacity records, all free. Not safe against concurrent Acquire/Release.
+    bool Reserve(uint32_t capacity) {
+        m_items.reset(new (std::nothrow) T[capacity]);
+        m_next.reset(new (std::nothrow) std::atomic<uint32_t>[capacity]);
+        if (!m_items || !m_next || capacity == 0) {
+            m_items.reset();
+            m_next.reset();
+            m_capacity = 0;
+            m_head.store(kNil, std::memory_order_relaxed);
+            return capacity == 0;
+        }
+        for (uint32_t i = 0; i < capacity; ++i) {
+            m_next[i].store(i + 1 < capacity ? i + 1 : kNil, std::memory_order_relaxed);
+        }
+        m_capacity = capacity;
+        m_head.store(0, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t Capacity() const { return m_capacity; }
+
+    // Null when every record is in use
+    T* Acquire() noexcept {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        for (;;) {
+            uint32_t index = static_cast<uint32_t>(head);
+            if (index == kNil) {
+                return nullptr;
+            }
+            uint64_t next = m_next[index].load(std::memory_order_relaxed);
+            uint64_t desired = (((head >> 32) + 1) << 32) | next;
+            if (m_head.compare_exchange_weak(head, desired, std::memory_order_acquire, std::memory_order_acquire)) {
+                return &m_items[index];
+            }
+        }
+    }
+
+    void Release(T* item) noexcept {
+        uint32_t index = static_cast<uint32_t>(item - m_items.get());
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        uint64_t desired;
+        do {
+            m_next[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            desired = (((head >> 32) + 1) << 32) | index;
+        } while (!m_head.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFF;
+
+    std::unique_ptr<T[]> m_items;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+    std::atomic<uint64_t> m_head{ kNil }; // (tag << 32) | index of the first free record
+    uint32_t m_capacity = 0;
+};
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "OscEmitter.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+OscEmitter g_oscEmitter;
+
+namespace {
+    // OSC is big endian
+    void PutBe32(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    // OSC strings are null terminated and padded to a multiple of 4
+    size_t PutOscString(uint8_t* p, const char* text) {
+        size_t length = strlen(text);
+        size_t padded = (length + 4) & ~static_cast<size_t>(3);
+        memcpy(p, text, length);
+        memset(p + length, 0, padded - length);
+        return padded;
+    }
+
+    constexpr uint8_t kBundleHeader[16] = { '#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 0, 0, 0, 1 }; // Timetag 1 = now
+}
+
+bool OscEmitter::Open(const char* host, uint16_t port) {
+    Close();
+    if (!host || port == 0) {
+        return false;
+    }
+    if (!NetStartup()) {
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) {
+        NetCleanup();
+        return false;
+    }
+    SOCKET s = socket(result->ai_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET || !NetSetNonBlocking(s)) {
+        if (s != INVALID_SOCKET) {
+            closesocket(s);
+        }
+        freeaddrinfo(result);
+        NetCleanup();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_socket = s;
+    memcpy(&m_target, result->ai_addr, result->ai_addrlen);
+    m_targetLength = static_cast<int>(result->ai_addrlen);
+    m_templateDevice = ~0ull;
+    freeaddrinfo(result);
+    return true;
+}
+
+void OscEmitter::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_socket != INVALID_SOCKET) {
+        closesocket(m_socket);
+        m_socket = INVALID_SOCKET;
+        NetCleanup();
+    }
+}
+
+void OscEmitter::BuildMessage(Template& message, const char* address) {
+    size_t length = PutOscString(message.bytes, address);
+    length += PutOscString(message.bytes + length, ",i");
+    PutBe32(message.bytes + length, 0);
+    message.length = length + 4;
+}
+
+void OscEmitter::BuildTemplates(uint64_t deviceAddress) {
+    char address[kMaxAddress];
+    snprintf(address, sizeof(address), "/hr/%012llX/bpm", static_cast<unsigned long long>(deviceAddress));
+    BuildMessage(m_bpm, address);
+    snprintf(address, sizeof(address), "/hr/%012llX/rr", static_cast<unsigned long long>(deviceAddress));
+    BuildMessage(m_rr, address);
+    m_templateDevice = deviceAddress;
+}
+
+void OscEmitter::Publish(const HrSample& sample) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_socket == INVALID_SOCKET) {
+        return;
+    }
+    if (sample.deviceAddress != m_templateDevice) {
+        BuildTemplates(sample.deviceAddress);
+    }
+
+    uint8_t* p = m_datagram;
+    memcpy(p, kBundleHeader, sizeof(kBundleHeader));
+    p += sizeof(kBundleHeader);
+    auto append = [&p](const Template& message, uint32_t argument) {
+        PutBe32(p, static_cast<uint32_t>(message.length));
+        memcpy(p + 4, message.bytes, message.length);
+        PutBe32(p + 4 + message.length - 4, argument);
+        p += 4 + message.length;
+    };
+    append(m_bpm, sample.bpm);
+    for (uint8_t i = 0; i < sample.rrCount && i < kHrSampleMaxRr; ++i) {
+        append(m_rr, (static_cast<uint32_t>(sample.rr[i]) * 1000 + 512) / 1024); // 1/1024 s to ms
+    }
+    // Fire and forget: a full socket buffer or an absent receiver just loses this sample
+    sendto(m_socket, reinterpret_cast<const char*>(m_datagram), static_cast<int>(p - m_datagram), 0,
+        reinterpret_cast<const sockaddr*>(&m_target), m_targetLength);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+#include "NetSocket.h"
+
+// --- OSC output ---
+// Sends each sample as one OSC bundle over UDP: /hr/<device>/bpm i, followed by one
+// /hr/<device>/rr i (milliseconds) per RR interval. The messages are encoded once per device
+// into templates; per sample only the int32 arguments are patched in, so the dispatch path
+// does a few memcpys and one non-blocking sendto.
+class OscEmitter {
+public:
+    ~OscEmitter() { Close(); }
+
+    bool Open(const char* host, uint16_t port); // Resolves host (blocking) and creates the socket
+    void Close();
+    void Publish(const HrSample& sample);       // Any thread
+
+private:
+    static constexpr size_t kMaxAddress = 32;   // "/hr/AABBCCDDEEFF/bpm" plus padding
+    static constexpr size_t kMaxMessage = kMaxAddress + 4 + 4; // Address, ",i\0\0", int32
+    static constexpr size_t kMaxDatagram = 16 + (4 + kMaxMessage) * (1 + kHrSampleMaxRr);
+
+    struct Template {
+        uint8_t bytes[kMaxMessage] = {};
+        size_t length = 0; // Argument is the last 4 bytes
+    };
+
+    void BuildTemplates(uint64_t deviceAddress); // Lock held
+    static void BuildMessage(Template& message, const char* address);
+
+    std::mutex m_mutex;
+    SOCKET m_socket = INVALID_SOCKET;
+    sockaddr_storage m_target{};
+    int m_targetLength = 0;
+    uint64_t m_templateDevice = ~0ull;
+    Template m_bpm;
+    Template m_rr;
+    uint8_t m_datagram[kMaxDatagram] = {};
+};
+
+extern OscEmitter g_oscEmitter;
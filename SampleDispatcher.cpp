@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "SampleDispatcher.h"
+#include <cstring>
+
+SampleDispatcher g_dispatcher;
+
+void SampleDispatcher::Deliver(const HrSample& sample) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t nowMs = 0;
+    for (auto& subscriber : m_subscribers) {
+        if (subscriber.state != SlotState::Active) {
+            continue;
+        }
+        switch (subscriber.policy) {
+        case HrDeliveryEverySample:
+            Invoke(subscriber, &sample, 1);
+            break;
+        case HrDeliveryCoalesce:
+            if (nowMs == 0) {
+                nowMs = TimerWheel::NowMs();
+            }
+            if (nowMs - subscriber.lastDeliveryMs >= subscriber.intervalMs) {
+                subscriber.count = 0;
+                subscriber.lastDeliveryMs = nowMs;
+                Invoke(subscriber, &sample, 1);
+            }
+            else {
+                // Too soon: keep only the newest and deliver it when the interval is up
+                subscriber.pending[0] = sample;
+                subscriber.count = 1;
+                if (!g_timers.Armed(subscriber.timer)) {
+                    g_timers.Schedule(subscriber.timer, subscriber.lastDeliveryMs + subscriber.intervalMs - nowMs);
+                }
+            }
+            break;
+        case HrDeliveryBatch:
+            if (subscriber.count == kMaxBatch) {
+                memmove(subscriber.pending, subscriber.pending + 1, (kMaxBatch - 1) * sizeof(HrSample));
+                --subscriber.count;
+            }
+            subscriber.pending[subscriber.count++] = sample;
+            break;
+        }
+    }
+}
+
+int SampleDispatcher::Add(HeartRateSampleCallback callback, void* userData, HrDeliveryPolicy policy, uint32_t intervalMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (int i = 1; i < kMaxSubscribers; ++i) {
+        Subscriber& subscriber = m_subscribers[i];
+        if (subscriber.state == SlotState::Free) {
+            subscriber.legacy = nullptr;
+            subscriber.callback = callback;
+            subscriber.userData = userData;
+            subscriber.policy = policy;
+            subscriber.intervalMs = intervalMs;
+            Activate(subscriber);
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool SampleDispatcher::Remove(int id) {
+    if (id < 1 || id >= kMaxSubscribers) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_subscribers[id].state != SlotState::Active) {
+            return false;
+        }
+        m_subscribers[id].state = SlotState::Removing; // No new calls from here on
+    }
+    Release(id);
+    return true;
+}
+
+void SampleDispatcher::SetLegacy(HeartRateCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Subscriber& subscriber = m_subscribers[0];
+        if (callback) {
+            subscriber.legacy = callback;
+            if (subscriber.state == SlotState::Free) {
+                subscriber.callback = nullptr;
+                subscriber.userData = nullptr;
+                subscriber.policy = m_legacyPolicy;
+                subscriber.intervalMs = m_legacyIntervalMs;
+                Activate(subscriber);
+            }
+            return;
+        }
+        if (subscriber.state != SlotState::Active) {
+            return;
+        }
+        subscriber.state = SlotState::Removing;
+    }
+    Release(0);
+}
+
+bool SampleDispatcher::SetLegacyPolicy(HrDeliveryPolicy policy, uint32_t intervalMs) {
+    if (policy == HrDeliveryBatch) {
+        return false; // The legacy callback takes a single bpm
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_legacyPolicy = policy;
+    m_legacyIntervalMs = intervalMs;
+    Subscriber& subscriber = m_subscribers[0];
+    if (subscriber.state == SlotState::Active) {
+        subscriber.policy = policy;
+        subscriber.intervalMs = intervalMs;
+        subscriber.count = 0;
+    }
+    return true;
+}
+
+void SampleDispatcher::OnTimer(void* context) {
+    auto subscriber = static_cast<Subscriber*>(context);
+    SampleDispatcher* self = subscriber->owner;
+    std::lock_guard<std::mutex> lock(self->m_mutex);
+    if (subscriber->state != SlotState::Active) {
+        return;
+    }
+    if (subscriber->count > 0) {
+        subscriber->lastDeliveryMs = TimerWheel::NowMs();
+        self->Invoke(*subscriber, subscriber->pending, subscriber->count);
+        subscriber->count = 0;
+    }
+    if (subscriber->policy == HrDeliveryBatch) {
+        g_timers.Schedule(subscriber->timer, subscriber->intervalMs);
+    }
+}
+
+void SampleDispatcher::Invoke(Subscriber& subscriber, const HrSample* samples, size_t count) {
+    if (subscriber.legacy) {
+        subscriber.legacy(samples[count - 1].bpm);
+    }
+    else {
+        subscriber.callback(samples, static_cast<int>(count), subscriber.userData);
+    }
+}
+
+void SampleDispatcher::Activate(Subscriber& subscriber) {
+    subscriber.owner = this;
+    subscriber.count = 0;
+    subscriber.lastDeliveryMs = 0;
+    subscriber.timer.callback = &OnTimer;
+    subscriber.timer.context = &subscriber;
+    subscriber.state = SlotState::Active;
+    if (subscriber.policy == HrDeliveryBatch) {
+        g_timers.Schedule(subscriber.timer, subscriber.intervalMs);
+    }
+}
+
+void SampleDispatcher::Release(int index) {
+    Subscriber& subscriber = m_subscribers[index];
+    g_timers.Cancel(subscriber.timer); // Waits out a running OnTimer, which sees Removing and returns
+    std::lock_guard<std::mutex> lock(m_mutex);
+    subscriber.legacy = nullptr;
+    subscriber.callback = nullptr;
+    subscriber.userData = nullptr;
+    subscriber.count = 0;
+    subscriber.state = SlotState::Free;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+#include "TimerWheel.h"
+
+#ifndef _WIN32
+#define __stdcall // Calling conventions only matter at the Windows DLL boundary
+#endif
+
+typedef void(__stdcall* HeartRateCallback)(int bpm);
+typedef void(__stdcall* HeartRateSampleCallback)(const HrSample* samples, int count, void* userData);
+
+// Delivers samples to heart rate subscribers, each with its own policy. Every-sample subscribers
+// are called on the notification thread; coalesced and batched ones from the timer wheel, so a
+// UI label polling at 4 Hz no longer costs a cross-boundary call per notification.
+// Callbacks run under the dispatcher lock: once Remove returns, the callback is never called
+// again (so a callback must not Add or Remove subscribers itself).
+// Slot 0 is the legacy RegisterHeartRateCallback (bpm only, every-sample or coalesced).
+class SampleDispatcher {
+public:
+    static constexpr int kMaxSubscribers = 16;
+    static constexpr size_t kMaxBatch = 32; // Oldest samples are dropped beyond this
+
+    void Deliver(const HrSample& sample); // Notification thread
+
+    int Add(HeartRateSampleCallback callback, void* userData, HrDeliveryPolicy policy, uint32_t intervalMs); // Id > 0, or -1 if full
+    bool Remove(int id);
+    void SetLegacy(HeartRateCallback callback); // Null removes it; keeps the current policy
+    bool SetLegacyPolicy(HrDeliveryPolicy policy, uint32_t intervalMs);
+
+private:
+    enum class SlotState { Free, Active, Removing };
+
+    struct Subscriber {
+        SampleDispatcher* owner = nullptr;
+        SlotState state = SlotState::Free;
+        HeartRateCallback legacy = nullptr;
+        HeartRateSampleCallback callback = nullptr;
+        void* userData = nullptr;
+        HrDeliveryPolicy policy = HrDeliveryEverySample;
+        uint32_t intervalMs = 0;
+        uint64_t lastDeliveryMs = 0;
+        TimerWheel::Timer timer;
+        size_t count = 0; // Samples waiting in pending
+        HrSample pending[kMaxBatch] = {};
+    };
+
+    static void OnTimer(void* context);
+    void Invoke(Subscriber& subscriber, const HrSample* samples, size_t count); // Lock held
+    void Activate(Subscriber& subscriber); // Lock held
+    void Release(int index);               // Lock not held; cancels the timer
+
+    std::mutex m_mutex;
+    Subscriber m_subscribers[kMaxSubscribers];
+    HrDeliveryPolicy m_legacyPolicy = HrDeliveryEverySample;
+    uint32_t m_legacyIntervalMs = 0;
+};
+
+extern SampleDispatcher g_dispatcher;
@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "SampleQueue.h"
+#include <thread>
+
+SampleQueue g_sampleQueue;
+
+bool SampleQueue::Reserve(uint32_t capacity) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity.store(0);
+    }
+    // Pairs with the increment-then-load in Push: a producer either sees the queue closed or is
+    // counted here. Wait without the lock, which those producers may still need.
+    while (m_producers.load() != 0) {
+        std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_head = 0;
+    m_count = 0;
+    m_overflows = 0;
+    m_fifo.reset(capacity > 0 ? new (std::nothrow) HrSample*[capacity] : nullptr);
+    if (!m_pool.Reserve(capacity) || (capacity > 0 && !m_fifo)) {
+        m_fifo.reset();
+        m_pool.Reserve(0);
+        return false;
+    }
+    m_capacity.store(capacity);
+    return true;
+}
+
+void SampleQueue::Push(const HrSample& sample) {
+    if (m_capacity.load(std::memory_order_relaxed) == 0) {
+        return; // Closed: don't even get counted, or busy producers could keep Reserve waiting forever
+    }
+    m_producers.fetch_add(1);
+    uint32_t capacity = m_capacity.load();
+    if (capacity == 0) {
+        m_producers.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    HrSample* record = m_pool.Acquire();
+    if (!record) {
+        // Host is a whole pool behind: recycle the oldest queued record
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_overflows.fetch_add(1, std::memory_order_relaxed);
+        if (m_count == 0) {
+            // Every record is being filled by another producer: this sample is the one lost
+            m_producers.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        record = m_fifo[m_head];
+        m_head = (m_head + 1) % capacity;
+        --m_count;
+    }
+    *record = sample;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fifo[(m_head + m_count) % capacity] = record;
+        ++m_count;
+    }
+    m_producers.fetch_sub(1, std::memory_order_release);
+}
+
+bool SampleQueue::Pop(HrSample& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t capacity = m_capacity.load(std::memory_order_relaxed);
+    if (m_count == 0 || capacity == 0) {
+        return false; // Empty, or closed by a Reserve in progress
+    }
+    HrSample* record = m_fifo[m_head];
+    m_head = (m_head + 1) % capacity;
+    --m_count;
+    out = *record;
+    m_pool.Release(record);
+    return true;
+}
+
+uint32_t SampleQueue::Depth() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
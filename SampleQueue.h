@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+#include "ObjectPool.h"
+
+// Every-sample queue for polling hosts (see PollSamples), backed by a pool of sample records
+// sized when a session opens. The notification thread fills a pooled record without holding
+// the queue lock and only takes it to link the record in; records are recycled as the host
+// consumes them. When the host falls a whole pool behind, the oldest queued record is reused.
+// Reserve may run while producers are pushing: it closes the queue, waits for the producers
+// already inside Push to leave, then swaps the storage. Samples pushed meanwhile are dropped.
+class SampleQueue {
+public:
+    bool Reserve(uint32_t capacity); // 0 disables the queue
+    void Push(const HrSample& sample);
+    bool Pop(HrSample& out);
+    uint32_t Depth(); // Queued and not yet popped
+    uint64_t Overflows() const { return m_overflows.load(std::memory_order_relaxed); } // Samples lost to a full pool
+
+private:
+    std::atomic<uint32_t> m_capacity{ 0 };  // 0 while closed; the pool and FIFO below are fixed while nonzero
+    std::atomic<uint32_t> m_producers{ 0 }; // Threads inside Push
+    std::mutex m_mutex; // Protects the FIFO order below
+    ObjectPool<HrSample> m_pool;
+    std::unique_ptr<HrSample*[]> m_fifo;
+    uint32_t m_head = 0;
+    uint32_t m_count = 0;
+    std::atomic<uint64_t> m_overflows{ 0 };
+};
+
+extern SampleQueue g_sampleQueue;
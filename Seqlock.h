@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Single-writer seqlock cell. The value is copied as relaxed 32-bit atomic words, so readers
+// never race the writer in the memory-model sense, never block it, and never write to the
+// cell - which also makes it safe to place in a read-only shared-memory mapping.
+template <typename T>
+struct SeqlockCell {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockCell needs a trivially copyable type");
+    static constexpr size_t kWords = (sizeof(T) + 3) / 4;
+
+    std::atomic<uint32_t> sequence{ 0 }; // Odd while a write is in progress
+    std::atomic<uint32_t> words[kWords] = {};
+
+    void Store(const T& value) noexcept {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        uint32_t buffer[kWords] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // One attempt; false if a write overlapped the read
+    bool TryLoad(T& out, uint32_t* sequenceOut = nullptr) const noexcept {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        uint32_t buffer[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&out, buffer, sizeof(T));
+        if (sequenceOut) {
+            *sequenceOut = before;
+        }
+        return true;
+    }
+
+    // Retries until a consistent copy is read. Writes are a few stores long, so this settles fast.
+    void Load(T& out, uint32_t* sequenceOut = nullptr) const noexcept {
+        for (int attempt = 0; !TryLoad(out, sequenceOut); ++attempt) {
+            if (attempt > 64) {
+                std::this_thread::yield(); // Writer was preempted mid-write
+            }
+        }
+    }
+};
@@ -0,0 +1,713 @@
+#include "pch.h"
+#include "SessionEngine.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+#include "AllocationTracker.h"
+#include "HrMeasurement.h"
+#include "LinkStats.h"
+#include "SessionPolicy.h"
+#include "StartupProfile.h"
+#include "StreamWatchdog.h"
+
+namespace {
+    // The session's main coroutine: created suspended, then handed to the runtime, which owns it
+    // from there on (it frees itself when it returns)
+    struct Launch {
+        struct promise_type {
+            Launch get_return_object() noexcept { return { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+        std::coroutine_handle<> coroutine{};
+    };
+
+    // A step of the session that yields a T. Starts when awaited and resumes the caller on the
+    // same thread when done (symmetric transfer, so chains of steps don't grow the stack).
+    template <typename T>
+    class [[nodiscard]] Task {
+    public:
+        struct promise_type {
+            T value{};
+            std::coroutine_handle<> caller;
+
+            Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            auto final_suspend() noexcept {
+                struct ReturnToCaller {
+                    bool await_ready() noexcept { return false; }
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept {
+                        return self.promise().caller;
+                    }
+                    void await_resume() noexcept {}
+                };
+                return ReturnToCaller{};
+            }
+            void return_value(T result) noexcept { value = std::move(result); }
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+
+        Task(Task&& other) noexcept : m_coroutine(std::exchange(other.m_coroutine, nullptr)) {}
+        Task(const Task&) = delete;
+        ~Task() {
+            if (m_coroutine) {
+                m_coroutine.destroy();
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+            m_coroutine.promise().caller = caller;
+            return m_coroutine;
+        }
+        T await_resume() noexcept { return std::move(m_coroutine.promise().value); }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> coroutine) : m_coroutine(coroutine) {}
+        std::coroutine_handle<promise_type> m_coroutine;
+    };
+
+    // Auto-reset event a session coroutine suspends on without holding a thread
+    class WakeSignal {
+    public:
+        explicit WakeSignal(SessionRuntime& runtime) : m_runtime(runtime) {}
+
+        void Set() {
+            std::coroutine_handle<> waiter;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                waiter = std::exchange(m_waiter, nullptr);
+                m_set = !waiter;
+            }
+            if (waiter) {
+                m_runtime.Resume(waiter);
+            }
+        }
+
+        auto operator co_await() {
+            struct Awaiter {
+                WakeSignal& signal;
+                bool await_ready() const noexcept { return false; }
+                bool await_suspend(std::coroutine_handle<> coroutine) {
+                    std::lock_guard<std::mutex> lock(signal.m_mutex);
+                    if (signal.m_set) {
+                        signal.m_set = false;
+                        return false; // Already set: carry on
+                    }
+                    signal.m_waiter = coroutine;
+                    return true;
+                }
+                void await_resume() const noexcept {}
+            };
+            return Awaiter{ *this };
+        }
+
+    private:
+        SessionRuntime& m_runtime;
+        std::mutex m_mutex;
+        std::coroutine_handle<> m_waiter;
+        bool m_set = false;
+    };
+
+    // Which operations Stop and a deadline may cut short
+    enum class OpKind : uint8_t {
+        Connect, // Scan through subscribe: Stop and the connect timeout cancel it
+        Bounded, // Resubscribe and the cleanup CCCD write: only their deadline cancels them
+        Plain,   // Disconnect: never cancelled
+    };
+
+    // Error details of a failed attempt
+    struct SessionFailure {
+        HrErrorCategory category = HrErrorNone;
+        int32_t hresult = 0;
+    };
+
+    constexpr HrTransportResult kTransportOk{ HrErrorNone, 0 };
+}
+
+// --- Session ---
+// One monitoring session. The coroutine holds its own reference, so a session that misses its
+// stop deadline can be abandoned and finish cleanup on its own.
+struct SessionEngine::Session final : HrTransportListener, std::enable_shared_from_this<Session> {
+    explicit Session(SessionEngine& owner) : engine(owner), wake(owner.m_runtime) {}
+
+    SessionEngine& engine;
+    std::shared_ptr<HrTransport> transport;
+    std::atomic<bool> stopRequested{ false };
+    std::atomic<bool> abandoned{ false }; // Stop deadline passed; session must stay quiet
+    uint32_t cleanupTimeoutMs = 0;        // Bound for the CCCD write during cleanup
+    WakeSignal wake;                      // The flags below changed
+
+    // Set when the coroutine has finished, for synchronous stops
+    std::mutex doneMutex;
+    std::condition_variable doneChanged;
+    bool done = false;
+
+    // The operation in flight, so Stop or a deadline can cancel it. Held while an operation
+    // starts, so a Cancel can't slip in between the check and the start.
+    std::mutex opMutex;
+    OpKind opKind = OpKind::Plain;
+    TimerWheel::Timer deadlineTimer; // Connect attempt, resubscribe or cleanup write
+    std::atomic<bool> deadlinePassed{ false };
+
+    std::atomic<uint64_t> deviceAddress{ 0 }; // Known after the first connect; reconnects go straight to it
+    std::atomic<uint64_t> sampleSequence{ 0 };
+    int64_t launchUs = 0;                     // When Start was called (startup profile)
+    bool subscribed = false;                  // Coroutine only: the CCCD is set to notify
+
+    // Silence watchdog and reconnect backoff
+    StreamWatchdog watchdog;
+    TimerWheel::Timer watchdogTimer;
+    TimerWheel::Timer backoffTimer;
+    std::atomic<bool> resubscribeRequested{ false };
+    std::atomic<bool> reconnectRequested{ false };
+
+    // Stop linger: a stopped session can keep its link, delivering nothing, so a Start within
+    // the linger resumes streaming without scan, connect or discovery
+    std::atomic<bool> streaming{ false }; // Connected and subscribed
+    std::atomic<bool> parked{ false };    // Stopped as far as the host knows; link kept
+    TimerWheel::Timer lingerTimer;
+
+    // co_await Op(kind, start): start(transport, done, context) begins one transport operation
+    template <typename Start>
+    struct TransportOp {
+        Session& session;
+        OpKind kind;
+        Start start;
+        HrTransportResult result{ HrErrorUnknown, 0 };
+        std::coroutine_handle<> coroutine{};
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> resume) {
+            coroutine = resume;
+            OpKind opKind = kind;
+            // done may resume the coroutine and end the session before start returns: from here
+            // on only locals and this reference are safe to use
+            std::shared_ptr<Session> self = session.shared_from_this();
+            std::lock_guard<std::mutex> lock(self->opMutex);
+            self->opKind = opKind;
+            start(*self->transport, &Done, this);
+            if (self->CancelDue(opKind)) {
+                self->transport->Cancel();
+            }
+        }
+        HrTransportResult await_resume() const noexcept { return result; }
+
+        static void Done(void* context, HrTransportResult result) {
+            auto op = static_cast<TransportOp*>(context);
+            SessionRuntime& runtime = op->session.engine.m_runtime;
+            std::coroutine_handle<> resume = op->coroutine;
+            op->result = result;
+            runtime.Resume(resume); // op lives in the coroutine frame: not touched after this
+        }
+    };
+
+    template <typename Start>
+    TransportOp<Start> Op(OpKind kind, Start start) {
+        return { *this, kind, std::move(start) };
+    }
+
+    bool CancelDue(OpKind kind) const {
+        return kind == OpKind::Connect ? deadlinePassed || stopRequested
+            : kind == OpKind::Bounded && deadlinePassed;
+    }
+
+    // Stop (stopping) or a deadline: cancel the operation in flight if it is one they may cut short
+    void CancelOp(bool stopping) {
+        std::lock_guard<std::mutex> lock(opMutex);
+        if (opKind == OpKind::Connect || (!stopping && opKind == OpKind::Bounded)) {
+            transport->Cancel();
+        }
+    }
+
+    int64_t Now() const {
+        return engine.m_runtime.NowUs();
+    }
+
+    // Reports on behalf of the session; an abandoned or parked session no longer reaches the host
+    void Report(HrState state, HrErrorCategory category = HrErrorNone, int32_t hresult = 0) {
+        if (!abandoned && !parked) {
+            engine.m_host.OnStatus(state, category, hresult, deviceAddress.load(std::memory_order_relaxed));
+        }
+    }
+
+    // A failed connect-phase operation. Cancelled because the connect timeout fired: a timeout.
+    SessionFailure Failure(HrTransportResult result) const {
+        if (deadlinePassed && result.category == HrErrorWinRt) {
+            return { HrErrorTimeout, 0 };
+        }
+        return { result.category != HrErrorNone ? result.category : HrErrorUnknown, result.hresult };
+    }
+
+    static Launch Run(std::shared_ptr<Session> self);
+    Task<SessionFailure> Connect();
+    Task<bool> Resubscribe();
+    Task<bool> Release(bool stopping);
+
+    static void OnDeadline(void* context);
+    static void OnWake(void* context);
+    static void OnWatchdogTick(void* context);
+    static void OnLingerExpired(void* context);
+
+    // HrTransportListener
+    void OnNotification(const uint8_t* data, size_t length, int64_t arrivalUs) override;
+    void OnLinkLost() override;
+    void OnTransportError(int32_t hresult) override;
+};
+
+void SessionEngine::Session::OnDeadline(void* context) {
+    auto session = static_cast<Session*>(context);
+    session->deadlinePassed = true;
+    session->CancelOp(false);
+}
+
+void SessionEngine::Session::OnWake(void* context) {
+    static_cast<Session*>(context)->wake.Set();
+}
+
+// Escalates a silent stream: warn, then ask the coroutine to resubscribe, then to reconnect
+void SessionEngine::Session::OnWatchdogTick(void* context) {
+    auto session = static_cast<Session*>(context);
+    switch (session->watchdog.Check(session->Now(), session->engine.m_linkStats.NominalIntervalUs())) {
+    case WatchdogAction::Warn:
+        session->Report(HrStateStalled);
+        break;
+    case WatchdogAction::Resubscribe:
+        session->resubscribeRequested = true;
+        session->wake.Set();
+        break;
+    case WatchdogAction::Reconnect:
+        session->reconnectRequested = true;
+        session->wake.Set();
+        break;
+    case WatchdogAction::Recovered:
+        session->Report(HrStateStreaming);
+        break;
+    default:
+        break;
+    }
+    session->engine.m_runtime.Timers().Schedule(session->watchdogTimer, kWatchdogTickMs);
+}
+
+// Nobody restarted a parked session in time: really stop it now
+void SessionEngine::Session::OnLingerExpired(void* context) {
+    auto session = static_cast<Session*>(context);
+    std::lock_guard<std::mutex> lock(session->engine.m_mutex);
+    if (session->parked) {
+        session->stopRequested = true;
+        session->wake.Set();
+    }
+}
+
+void SessionEngine::Session::OnNotification(const uint8_t* data, size_t length, int64_t arrivalUs) {
+    if (abandoned.load(std::memory_order_relaxed)) {
+        return;
+    }
+    HotPathScope hotPath; // Notification to delivery must not allocate once warmed up
+    watchdog.OnNotification(arrivalUs);
+    if (parked.load(std::memory_order_relaxed) || stopRequested.load(std::memory_order_relaxed)) {
+        return; // Lingering after Stop, or on the way out: keep the link alive, deliver nothing
+    }
+    uint64_t address = deviceAddress.load(std::memory_order_relaxed);
+    engine.m_host.OnNotification(address, arrivalUs, data, length);
+    HrMeasurement measurement;
+    if (!ParseHrMeasurement(data, length, measurement)) {
+        engine.m_linkStats.OnMalformed();
+        Report(HrStateError, HrErrorMalformedData);
+        return;
+    }
+    engine.m_linkStats.OnPacket(arrivalUs, measurement);
+
+    static_assert(kMaxRrIntervals <= kHrSampleMaxRr, "HrSample must hold every parsed RR interval");
+    HrSample sample{};
+    sample.timestampUs = arrivalUs;
+    sample.deviceAddress = address;
+    sample.sequence = sampleSequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    sample.bpm = measurement.bpm;
+    sample.energyExpended = measurement.energyExpended;
+    sample.flags = measurement.flags;
+    sample.rrCount = measurement.rrCount;
+    for (uint8_t i = 0; i < measurement.rrCount; ++i) {
+        sample.rr[i] = measurement.rr[i];
+    }
+    engine.m_host.OnSample(sample);
+    engine.m_startup.OnSample(arrivalUs);
+}
+
+void SessionEngine::Session::OnLinkLost() {
+    Report(HrStateDisconnected);
+    reconnectRequested = true;
+    wake.Set();
+}
+
+void SessionEngine::Session::OnTransportError(int32_t hresult) {
+    Report(HrStateError, HrErrorWinRt, hresult);
+}
+
+// Scan (first time only), connect, discover and subscribe
+Task<SessionFailure> SessionEngine::Session::Connect() {
+    StartupProfiler& startup = engine.m_startup;
+    HrTransportResult result = kTransportOk;
+    uint64_t address = deviceAddress;
+    if (address != 0) {
+        // Reconnect straight to the device we were streaming from
+        Report(HrStateConnecting);
+        startup.EnterPhase(HrStartupConnect, Now());
+        result = co_await Op(OpKind::Connect, [address](HrTransport& transport, HrTransport::Completion done, void* context) {
+            transport.Connect(address, done, context);
+        });
+    }
+    else {
+        bool connected = false;
+        if (uint64_t warmAddress = engine.m_host.WarmAddress(Now())) {
+            // The pre-warm scan heard a strap moments ago: skip enumeration
+            Report(HrStateConnecting);
+            startup.EnterPhase(HrStartupConnect, Now());
+            result = co_await Op(OpKind::Connect, [warmAddress](HrTransport& transport, HrTransport::Completion done, void* context) {
+                transport.Connect(warmAddress, done, context);
+            });
+            connected = result.category == HrErrorNone;
+            if (connected) {
+                startup.MarkPrewarmed(); // Not when it fell back to the scan
+            }
+            // Gone, out of range, or the stack threw opening it: the scan may still find a strap.
+            // Only a stop or the connect timeout ends the attempt here.
+            if (!connected && (stopRequested || deadlinePassed)) {
+                co_return Failure(result);
+            }
+        }
+        if (!connected) {
+            Report(HrStateScanning);
+            startup.EnterPhase(HrStartupScan, Now());
+            result = co_await Op(OpKind::Connect, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+                transport.Scan(done, context);
+            });
+            if (result.category != HrErrorNone) {
+                co_return Failure(result);
+            }
+            Report(HrStateConnecting);
+            startup.EnterPhase(HrStartupConnect, Now());
+            result = co_await Op(OpKind::Connect, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+                transport.Connect(0, done, context);
+            });
+        }
+    }
+    if (result.category != HrErrorNone) {
+        co_return Failure(result);
+    }
+    if (deviceAddress == 0) {
+        deviceAddress = transport->Address();
+        engine.m_linkStats.Reset(deviceAddress);
+        sampleSequence = 0;
+    }
+
+    startup.EnterPhase(HrStartupDiscover, Now());
+    Report(HrStateDiscovering);
+    result = co_await Op(OpKind::Connect, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+        transport.Discover(done, context);
+    });
+    if (result.category != HrErrorNone) {
+        co_return Failure(result);
+    }
+
+    Report(HrStateSubscribing);
+    startup.EnterPhase(HrStartupSubscribe, Now());
+    result = co_await Op(OpKind::Connect, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+        transport.Subscribe(true, done, context);
+    });
+    if (result.category != HrErrorNone) {
+        co_return Failure(result);
+    }
+    subscribed = true;
+    startup.AwaitFirstSample(Now());
+    ResetAllocationWarmup();
+    co_return SessionFailure{};
+}
+
+// Rewrites the CCCD on a stalled but still-connected stream. Returns false if that failed.
+Task<bool> SessionEngine::Session::Resubscribe() {
+    TimerWheel& timers = engine.m_runtime.Timers();
+    Report(HrStateSubscribing);
+    deadlinePassed = false;
+    timers.Schedule(deadlineTimer, engine.connectTimeoutMs);
+    HrTransportResult result = co_await Op(OpKind::Bounded, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+        transport.Subscribe(true, done, context);
+    });
+    timers.Cancel(deadlineTimer);
+    deadlinePassed = false;
+    co_return result.category == HrErrorNone;
+}
+
+// Releases the current connection. Disabling notifications is only worth a round trip when
+// we are leaving on purpose; after a lost link it would just run into the timeout.
+Task<bool> SessionEngine::Session::Release(bool stopping) {
+    bool clean = true;
+    if (subscribed && stopping) {
+        // Best effort, bounded so an out-of-range device can't hang us
+        TimerWheel& timers = engine.m_runtime.Timers();
+        deadlinePassed = false;
+        timers.Schedule(deadlineTimer, cleanupTimeoutMs);
+        HrTransportResult result = co_await Op(OpKind::Bounded, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+            transport.Subscribe(false, done, context);
+        });
+        timers.Cancel(deadlineTimer);
+        if (deadlinePassed) {
+            Report(HrStateCleanupError, HrErrorTimeout);
+            clean = false;
+        }
+        else if (result.category == HrErrorWinRt) {
+            Report(HrStateCleanupError, HrErrorWinRt, result.hresult);
+            clean = false;
+        }
+        deadlinePassed = false;
+    }
+    subscribed = false;
+    HrTransportResult result = co_await Op(OpKind::Plain, [](HrTransport& transport, HrTransport::Completion done, void* context) {
+        transport.Disconnect(done, context);
+    });
+    if (result.category != HrErrorNone) {
+        Report(HrStateCleanupError, result.category, result.hresult); // Logged, but we proceed
+        clean = false;
+    }
+    co_return clean;
+}
+
+// Runs a session until Stop: connect, stream, and on a lost or stalled link reconnect with
+// backoff. The coroutine only occupies a runtime thread while it has work to do.
+Launch SessionEngine::Session::Run(std::shared_ptr<Session> self) {
+    Session& session = *self;
+    SessionEngine& engine = session.engine;
+    TimerWheel& timers = engine.m_runtime.Timers();
+    engine.m_host.OnRadioBusy(true); // The session has the radio until it ends
+    session.transport->SetListener(&session);
+
+    session.deadlineTimer = { &OnDeadline, &session };
+    session.watchdogTimer = { &OnWatchdogTick, &session };
+    session.backoffTimer = { &OnWake, &session };
+    session.lingerTimer = { &OnLingerExpired, &session };
+
+    uint32_t attempt = 0; // Consecutive failed reconnects
+    bool everStreamed = false;
+
+    while (!session.stopRequested) {
+        session.reconnectRequested = false;
+        session.resubscribeRequested = false;
+        session.deadlinePassed = false;
+        timers.Schedule(session.deadlineTimer, engine.connectTimeoutMs);
+
+        engine.m_startup.BeginAttempt(session.launchUs, session.Now(), session.deviceAddress != 0);
+        session.launchUs = 0; // Later attempts are timed from their own start
+        SessionFailure failure = co_await session.Connect();
+        bool connected = failure.category == HrErrorNone;
+        if (!connected) {
+            engine.m_startup.Fail(session.stopRequested ? kHrStartupStopped : failure.category, session.Now());
+        }
+        timers.Cancel(session.deadlineTimer); // Waits out a callback in flight, which uses session
+        session.deadlinePassed = false;
+
+        if (connected) {
+            attempt = 0;
+            everStreamed = true;
+            session.watchdog.Reset(session.Now());
+            timers.Schedule(session.watchdogTimer, kWatchdogTickMs);
+            session.Report(HrStateStreaming);
+            session.streaming = true;
+
+            // Suspend (no thread held) until Stop, a disconnect or the watchdog wakes us
+            while (!session.stopRequested && !session.reconnectRequested) {
+                co_await session.wake;
+                if (session.resubscribeRequested.exchange(false) && !session.stopRequested) {
+                    if (!co_await session.Resubscribe()) {
+                        session.reconnectRequested = true;
+                    }
+                }
+            }
+            session.streaming = false;
+            timers.Cancel(session.watchdogTimer);
+            if (session.parked) {
+                session.stopRequested = true; // Link lost while lingering: nothing to resume
+            }
+            // No-op once the first sample arrived; otherwise the link was lost or stalled first
+            engine.m_startup.Fail(session.stopRequested ? kHrStartupStopped : HrErrorDeviceUnavailable, session.Now());
+        }
+
+        bool stopping = session.stopRequested;
+        if (stopping) {
+            session.Report(HrStateStopping);
+        }
+        co_await session.Release(stopping);
+        if (stopping) {
+            break;
+        }
+
+        if (!ShouldReconnect(everStreamed, attempt, engine.maxReconnectAttempts)) {
+            // Never got going, or out of retries: the session ends here. A link that just
+            // dropped has already been reported (Disconnected/Stalled).
+            if (!connected) {
+                session.Report(HrStateError, failure.category, failure.hresult);
+            }
+            break;
+        }
+        session.Report(HrStateReconnecting, failure.category, failure.hresult);
+
+        // Back off before the next attempt; Stop cuts the wait short
+        timers.Schedule(session.backoffTimer, ReconnectDelayMs(attempt++));
+        while (!session.stopRequested && timers.Armed(session.backoffTimer)) {
+            co_await session.wake;
+        }
+        timers.Cancel(session.backoffTimer);
+    }
+
+    // --- Cleanup ---
+    timers.Cancel(session.watchdogTimer);
+    timers.Cancel(session.backoffTimer);
+    timers.Cancel(session.lingerTimer);
+    session.transport->SetListener(nullptr);
+    engine.m_host.OnRadioBusy(false);
+
+    {
+        std::lock_guard<std::mutex> lock(engine.m_mutex);
+        if (engine.m_session == self) {
+            engine.m_session.reset(); // Free the slot so Start can be called again
+        }
+    }
+    if (!session.abandoned && !session.parked) {
+        // A parked session reported it when it was stopped
+        engine.m_host.OnStatus(HrStateIdle, HrErrorNone, 0, session.deviceAddress);
+    }
+    {
+        std::lock_guard<std::mutex> lock(session.doneMutex);
+        session.done = true;
+    }
+    session.doneChanged.notify_all();
+}
+
+// --- Engine ---
+SessionEngine::SessionEngine(SessionRuntime& runtime, SessionHost& host, LinkStats& linkStats, StartupProfiler& startup)
+    : m_runtime(runtime), m_host(host), m_linkStats(linkStats), m_startup(startup) {}
+
+int SessionEngine::Start(int64_t launchUs, uint32_t cleanupTimeoutMs) {
+    if (ResumeParked(launchUs)) {
+        return 0; // Still connected from before the last Stop
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_session) {
+            return -1; // Already running (or still stopping)
+        }
+        try {
+            if (m_host.PrepareSession()) {
+                auto session = std::make_shared<Session>(*this);
+                session->transport = m_host.CreateTransport();
+                if (session->transport) {
+                    session->launchUs = launchUs;
+                    session->cleanupTimeoutMs = cleanupTimeoutMs;
+                    session->watchdog.SetWarnAfterUs(static_cast<int64_t>(watchdogWarnMs.load()) * 1000);
+                    // The coroutine owns a reference, so a stop can give up on it safely
+                    std::coroutine_handle<> run = Session::Run(session).coroutine;
+                    m_session = session;
+                    if (m_runtime.Resume(run)) { // Never run the connect flow on the host's thread
+                        return 0;
+                    }
+                    m_session.reset();
+                    run.destroy();
+                }
+            }
+        }
+        catch (...) {
+            // Could not allocate the session or its coroutine
+        }
+    }
+    m_host.OnStatus(HrStateError, HrErrorThread, 0, 0);
+    return -2;
+}
+
+// Signals the current session to stop without waiting. Returns it, or null if not running.
+std::shared_ptr<SessionEngine::Session> SessionEngine::SignalStop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_session) {
+        m_session->stopRequested = true;
+        m_session->wake.Set();
+        m_session->CancelOp(true); // Don't wait for a scan or discovery to finish first
+    }
+    return m_session;
+}
+
+// Stop with a linger set: a streaming session keeps its link and just stops delivering, so the
+// next Start is a flag flip. Returns false (and does nothing) if the session can't be parked.
+bool SessionEngine::Park() {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t lingerMs = stopLingerMs;
+        if (lingerMs == 0 || !m_session || m_session->parked || !m_session->streaming || m_session->stopRequested) {
+            return false;
+        }
+        session = m_session;
+        session->parked = true;
+        m_runtime.Timers().Schedule(session->lingerTimer, lingerMs);
+    }
+    m_startup.Fail(kHrStartupStopped, m_runtime.NowUs()); // In case the first sample hasn't arrived yet
+    m_host.OnStatus(HrStateIdle, HrErrorNone, 0, session->deviceAddress); // Outside the lock: the host may call Start
+    return true;
+}
+
+// Start on a parked session: deliver again. Returns false if there is none to resume.
+bool SessionEngine::ResumeParked(int64_t launchUs) {
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_session || !m_session->parked || m_session->stopRequested) {
+            return false;
+        }
+        session = m_session;
+        session->parked = false;
+    }
+    m_runtime.Timers().Cancel(session->lingerTimer); // Its callback sees parked == false and does nothing
+    m_startup.BeginAttempt(launchUs, m_runtime.NowUs(), true);
+    m_startup.AwaitFirstSample(m_runtime.NowUs());
+    session->Report(HrStateStreaming);
+    return true;
+}
+
+int SessionEngine::Stop(uint32_t timeoutMs, bool allowPark) {
+    if (allowPark && Park()) {
+        return 0;
+    }
+    auto session = SignalStop();
+    if (!session) {
+        return -1; // Not running
+    }
+    {
+        std::unique_lock<std::mutex> lock(session->doneMutex);
+        if (session->doneChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return session->done; })) {
+            return 0;
+        }
+    }
+    // Deadline passed: the coroutine keeps its own reference and finishes cleanup in the
+    // background, silenced so it can't report into a later session.
+    session->abandoned = true;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_session == session) {
+            m_session.reset();
+        }
+    }
+    m_host.OnStatus(HrStateIdle, HrErrorTimeout, 0, 0);
+    return -3; // Stopped, resources abandoned
+}
+
+int SessionEngine::StopAsync() {
+    if (Park()) {
+        return 0;
+    }
+    return SignalStop() ? 0 : -1;
+}
+
+bool SessionEngine::Active() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_session != nullptr;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+#include "HrTransport.h"
+#include "TimerWheel.h"
+
+class LinkStats;
+class StartupProfiler;
+
+// --- Session engine ---
+// One monitoring session at a time: scan, connect, discover, subscribe and stream, with the
+// connect timeout, silence watchdog, reconnect backoff (SessionPolicy.h), stop linger and stop
+// deadline. It only talks to a radio through HrTransport and only runs on a SessionRuntime,
+// so the same engine drives a strap from the DLL and a FakeTransport on a virtual clock.
+
+// Where session coroutines run and what time it is. The DLL resumes them on its thread pool
+// with the steady clock; tests and the simulator queue them and keep their own clock.
+class SessionRuntime {
+public:
+    virtual bool Resume(std::coroutine_handle<> coroutine) = 0; // Queue it, never run it inline; false if that failed
+    virtual int64_t NowUs() = 0;
+    virtual TimerWheel& Timers() = 0;
+
+protected:
+    ~SessionRuntime() = default;
+};
+
+// What the engine reports to and gets its radio from. Called on runtime and transport threads.
+class SessionHost {
+public:
+    virtual std::shared_ptr<HrTransport> CreateTransport() = 0; // One per session; null if that failed
+    virtual void OnStatus(HrState state, HrErrorCategory category, int32_t hresult, uint64_t deviceAddress) = 0;
+    virtual void OnSample(const HrSample& sample) = 0;
+    // Raw notification before it is parsed (capture)
+    virtual void OnNotification(uint64_t, int64_t, const uint8_t*, size_t) {}
+    // Under the session lock before a new session starts; false fails the Start
+    virtual bool PrepareSession() { return true; }
+    virtual void OnRadioBusy(bool) {}                  // A session holds the radio (true) or let it go
+    virtual uint64_t WarmAddress(int64_t) { return 0; } // A strap heard just now, to skip the scan
+
+protected:
+    ~SessionHost() = default;
+};
+
+class SessionEngine {
+public:
+    SessionEngine(SessionRuntime& runtime, SessionHost& host, LinkStats& linkStats, StartupProfiler& startup);
+    SessionEngine(const SessionEngine&) = delete;
+    SessionEngine& operator=(const SessionEngine&) = delete;
+
+    // Same meaning as the exported setters; read when a session or attempt starts
+    std::atomic<uint32_t> connectTimeoutMs{ 20000 };  // Scan through subscribe must finish within this
+    std::atomic<uint32_t> maxReconnectAttempts{ 5 };  // After a lost or stalled link; 0 = end the session
+    std::atomic<uint32_t> watchdogWarnMs{ 0 };        // Silence before the watchdog warns; 0 = from cadence
+    std::atomic<uint32_t> stopLingerMs{ 0 };          // How long a stopped session keeps its link
+
+    // Starts a session, or resumes a parked one. launchUs: when the host asked (startup profile);
+    // cleanupTimeoutMs bounds the CCCD write on the way out.
+    // 0 on success, -1 if one is already running (or still stopping), -2 if it could not start.
+    int Start(int64_t launchUs, uint32_t cleanupTimeoutMs);
+    // Stops the session, waiting at most timeoutMs for it to finish. allowPark: a streaming
+    // session may linger instead (see stopLingerMs). 0 when stopped, -1 if not running, -3 if
+    // the deadline passed and the session was abandoned to finish cleanup on its own.
+    int Stop(uint32_t timeoutMs, bool allowPark);
+    // Stop without waiting; completion is reported as HrStateIdle. -1 if not running.
+    int StopAsync();
+    bool Active() const; // A session exists (streaming, connecting, parked or stopping)
+
+private:
+    struct Session;
+
+    std::shared_ptr<Session> SignalStop();
+    bool Park();
+    bool ResumeParked(int64_t launchUs);
+
+    SessionRuntime& m_runtime;
+    SessionHost& m_host;
+    LinkStats& m_linkStats;
+    StartupProfiler& m_startup;
+    mutable std::mutex m_mutex; // Protects m_session
+    std::shared_ptr<Session> m_session; // Current session, null when idle
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+// --- Session timing policy ---
+// Reconnect and watchdog decisions of the session engine (SessionEngine.h), which runs both the
+// live session and the simulation harness (SessionSim.h).
+
+constexpr uint32_t kWatchdogTickMs = 1000;
+
+// 1 s, 2 s, 4 s ... capped at 30 s
+inline uint32_t ReconnectDelayMs(uint32_t attempt) {
+    return attempt >= 5 ? 30000u : (1000u << attempt);
+}
+
+// Whether a session whose connect failed or whose link was lost tries again. A session that
+// never streamed ends at once; otherwise up to maxAttempts consecutive failed reconnects.
+inline bool ShouldReconnect(bool everStreamed, uint32_t attempt, uint32_t maxAttempts) {
+    return everStreamed && attempt < maxAttempts;
+}
@@ -0,0 +1,469 @@
+#include "pch.h"
+#include "SessionSim.h"
+#include "FakeTransport.h"
+#include "HrMeasurement.h"
+#include "LinkStats.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <queue>
+#include <random>
+
+namespace {
+    // What the strap does; the engine's side is all SessionEngine's
+    enum class EventType { Notify, LinkDown, StallStart, StallEnd };
+
+    struct Event {
+        int64_t timeUs;
+        uint64_t order;      // Ties run in scheduling order
+        uint32_t device;
+        EventType type;
+        uint32_t generation; // Ignored if it no longer matches the device's stall
+    };
+
+    // Value at percentile p (0..100), nearest rank; -1 if there are none
+    int64_t PercentileUs(std::vector<int64_t> times, double p) {
+        if (times.empty()) {
+            return -1;
+        }
+        std::sort(times.begin(), times.end());
+        double rank = std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(times.size() - 1);
+        return times[static_cast<size_t>(std::lround(rank))];
+    }
+
+    struct Later {
+        bool operator()(Event const& a, Event const& b) const {
+            return a.timeUs != b.timeUs ? a.timeUs > b.timeUs : a.order > b.order;
+        }
+    };
+
+    class Simulator;
+
+    // One strap with its own engine. As the engine's host it follows the session through its
+    // status events, which is all a real host sees too.
+    struct Device final : SessionHost {
+        Simulator* sim = nullptr;
+        uint32_t index = 0;
+        FaultInjector faults;
+        std::shared_ptr<FakeTransport> strap;
+        std::shared_ptr<HrTransport> transport; // strap, behind a FaultyTransport if faults are on
+        LinkStats stats;
+        StartupProfiler startup;
+        std::unique_ptr<SessionEngine> engine;
+
+        bool streaming = false;    // Last status was Streaming (or a recovery to it)
+        bool resubscribing = false; // Watchdog CCCD rewrite in flight
+        bool ended = false;        // The session gave up
+        bool stalled = false;
+        uint32_t stallGeneration = 0;
+        int64_t unreachableUntilUs = 0;
+        bool droppingLink = false; // The script is taking the link down (not an injected fault)
+        int openIncident = -1;     // Index into the report, until a notification gets through
+        uint64_t sentAtOpen = 0;
+        uint64_t deliveredAtOpen = 0;
+        FaultKind downCause = FaultKind::Count; // Injected fault that took the link down, until it's back
+        int64_t attemptStartUs = 0;
+        int64_t recoveringSinceUs[static_cast<int>(FaultKind::Count)]; // Per fault, until a notification gets through; -1 if not
+        HrFaultStats seen{};       // Injections already accounted for
+        uint64_t sent = 0;
+        uint64_t handed = 0;       // Notifications the transport took while subscribed
+        uint64_t delivered = 0;
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return transport; }
+        void OnStatus(HrState state, HrErrorCategory category, int32_t, uint64_t) override;
+        void OnSample(const HrSample& sample) override;
+    };
+
+    class Simulator {
+    public:
+        Simulator(const SimConfig& config, SimReport& report)
+            : m_config(config), m_report(report), m_random(config.seed) {}
+
+        ~Simulator() {
+            for (auto& device : m_devices) {
+                device->transport.reset(); // Faulty transport first: it cancels timers on the wheel
+            }
+        }
+
+        void Run() {
+            HrFaultConfig faults = m_config.faults;
+            if (faults.seed == 0) {
+                faults.seed = m_config.seed * 0x9E3779B97F4A7C15ull + 1;
+            }
+            for (uint32_t i = 0; i < m_config.devices; ++i) {
+                auto device = std::make_unique<Device>();
+                device->sim = this;
+                device->index = i;
+                std::fill(std::begin(device->recoveringSinceUs), std::end(device->recoveringSinceUs), -1);
+                device->strap = std::make_shared<FakeTransport>(m_runtime, i + 1);
+                device->strap->SetScript(&Script, device.get());
+                device->transport = device->strap;
+                HrFaultConfig deviceFaults = faults;
+                deviceFaults.seed += i; // Own generator per device, so accounting stays per device
+                device->faults.Configure(deviceFaults);
+                if (device->faults.Enabled()) {
+                    device->transport = std::make_shared<FaultyTransport>(device->strap, device->faults, m_runtime);
+                }
+                device->engine = std::make_unique<SessionEngine>(m_runtime, *device, device->stats, device->startup);
+                device->engine->connectTimeoutMs = m_config.connectTimeoutMs;
+                device->engine->maxReconnectAttempts = m_config.maxReconnectAttempts;
+                m_devices.push_back(std::move(device));
+            }
+            for (auto& device : m_devices) {
+                Push(Uniform(0, m_config.notifyIntervalMs) * 1000, *device, EventType::Notify);
+                Push(NextIncidentUs(m_config.disconnectsPerHour), *device, EventType::LinkDown);
+                Push(NextIncidentUs(m_config.stallsPerHour), *device, EventType::StallStart);
+                device->engine->Start(0, 1000);
+            }
+
+            // The runtime advances a wheel tick at a time up to each strap event
+            while (!m_events.empty() && m_events.top().timeUs < m_config.durationUs) {
+                Event event = m_events.top();
+                m_events.pop();
+                m_runtime.AdvanceTo(event.timeUs);
+                Handle(event);
+                m_runtime.RunReady();
+            }
+            m_runtime.AdvanceTo(m_config.durationUs);
+
+            // Time's up: stop every session (not counted as giving up) and let them wind down
+            m_finishing = true;
+            for (auto& device : m_devices) {
+                device->engine->StopAsync();
+            }
+            for (int64_t untilUs = m_config.durationUs; AnyActive() && untilUs < m_config.durationUs + kWindDownUs; ) {
+                untilUs += 1000000;
+                m_runtime.AdvanceTo(untilUs);
+            }
+            for (auto& device : m_devices) {
+                Account(*device);
+                HrLinkStats stats;
+                device->stats.Snapshot(stats);
+                m_report.estimatedDropped += stats.droppedEstimated;
+                uint64_t lost = device->handed - std::min(device->handed, device->delivered);
+                lost -= std::min(lost, device->seen.dropped + device->seen.malformed);
+                Impact(FaultKind::Delay).samplesLost += lost; // Held back, then the link went first
+                for (FaultKind kind : { FaultKind::Delay, FaultKind::SlowDiscovery }) {
+                    Impact(kind).addedLatencyUs += device->faults.InjectedDelayUs(kind);
+                }
+                for (int kind = 0; kind < static_cast<int>(FaultKind::Count); ++kind) {
+                    if (device->recoveringSinceUs[kind] >= 0) {
+                        ++m_report.faults[kind].unrecovered;
+                    }
+                }
+            }
+            Impact(FaultKind::Drop).samplesLost = Impact(FaultKind::Drop).injected;
+            Impact(FaultKind::Malformed).samplesLost = Impact(FaultKind::Malformed).injected;
+            for (SimFaultImpact& impact : m_report.faults) {
+                impact.recoveryP50Us = PercentileUs(impact.recoveryUs, 50);
+                impact.recoveryP99Us = PercentileUs(impact.recoveryUs, 99);
+            }
+        }
+
+        // --- Device status, from the engine ---
+        void OnStatus(Device& device, HrState state, HrErrorCategory) {
+            switch (state) {
+            case HrStateConnecting:
+                ++m_report.connects;
+                device.attemptStartUs = m_runtime.NowUs();
+                device.streaming = false;
+                device.resubscribing = false;
+                break;
+            case HrStateStreaming:
+                Account(device); // A slow discovery on this attempt starts its recovery clock
+                device.streaming = true;
+                device.downCause = FaultKind::Count;
+                break;
+            case HrStateSubscribing:
+                if (device.streaming) {
+                    ++m_report.resubscribes; // Watchdog-requested CCCD rewrite
+                    device.resubscribing = true;
+                }
+                break;
+            case HrStateDisconnected:
+                if (!device.droppingLink && Account(device).disconnects > 0) {
+                    // Not the script's doing: FaultyTransport dropped it
+                    ++Impact(FaultKind::Disconnect).reconnects;
+                    OpenIncident(device, SimIncidentKind::SpuriousDisconnect);
+                    GoDown(device, FaultKind::Disconnect);
+                }
+                device.streaming = false;
+                break;
+            case HrStateReconnecting:
+            case HrStateError:
+                if (Account(device).cccdFailures > 0) {
+                    if (device.resubscribing) {
+                        ++Impact(FaultKind::CccdFailure).reconnects; // Failed resubscribe escalates to a reconnect
+                    }
+                    GoDown(device, FaultKind::CccdFailure);
+                }
+                device.streaming = false;
+                device.resubscribing = false;
+                break;
+            case HrStateIdle:
+                device.streaming = false;
+                if (!m_finishing && !device.ended) {
+                    device.ended = true;
+                    ++m_report.sessionsEnded;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void OnSample(Device& device, const HrSample& sample) {
+            ++m_report.delivered;
+            ++device.delivered;
+            if (device.openIncident >= 0) {
+                SimIncident& incident = m_report.incidents[device.openIncident];
+                incident.recoveredUs = sample.timestampUs;
+                uint64_t sent = device.sent - device.sentAtOpen;
+                uint64_t delivered = device.delivered - device.deliveredAtOpen;
+                incident.lost = static_cast<uint32_t>(sent - std::min(sent, delivered));
+                device.openIncident = -1;
+            }
+            for (int kind = 0; kind < static_cast<int>(FaultKind::Count); ++kind) {
+                if (device.recoveringSinceUs[kind] >= 0) {
+                    m_report.faults[kind].recoveryUs.push_back(sample.timestampUs - device.recoveringSinceUs[kind]);
+                    device.recoveringSinceUs[kind] = -1;
+                }
+            }
+        }
+
+    private:
+        static constexpr int64_t kWindDownUs = 60ll * 1000000;
+
+        // How each radio operation of a device's strap turns out
+        static FakeOutcome Script(void* context, FakeOp op) {
+            auto& device = *static_cast<Device*>(context);
+            Simulator& sim = *device.sim;
+            FakeOutcome outcome;
+            switch (op) {
+            case FakeOp::Scan:
+            case FakeOp::Connect:
+                if (sim.m_runtime.NowUs() < device.unreachableUntilUs) {
+                    outcome.hang = true; // Out of range: the attempt hangs until the connect timeout
+                    break;
+                }
+                if (op == FakeOp::Connect) {
+                    outcome.latencyMs = static_cast<uint32_t>(sim.Uniform(sim.m_config.connectMinMs, sim.m_config.connectMaxMs));
+                    if (sim.Chance(sim.m_config.connectFailureRate)) {
+                        outcome.result = { HrErrorDeviceUnavailable, 0 };
+                    }
+                }
+                break;
+            case FakeOp::Subscribe:
+                if (device.resubscribing) {
+                    if (device.stalled && sim.Chance(sim.m_config.resubscribeFixRate)) {
+                        device.stalled = false;
+                    }
+                }
+                else {
+                    device.stalled = false; // A fresh subscription clears a stuck one
+                }
+                break;
+            default:
+                break;
+            }
+            return outcome;
+        }
+
+        void Handle(Event const& event) {
+            Device& device = *m_devices[event.device];
+            switch (event.type) {
+            case EventType::Notify:
+                OnNotify(device);
+                break;
+            case EventType::LinkDown:
+                Push(m_runtime.NowUs() + NextIncidentUs(m_config.disconnectsPerHour), device, EventType::LinkDown);
+                if (device.streaming) {
+                    OpenIncident(device, SimIncidentKind::Disconnect);
+                    device.unreachableUntilUs = m_runtime.NowUs() + Uniform(m_config.outageMinMs, m_config.outageMaxMs) * 1000;
+                    device.droppingLink = true;
+                    device.strap->DropLink();
+                    device.droppingLink = false;
+                }
+                break;
+            case EventType::StallStart:
+                Push(m_runtime.NowUs() + NextIncidentUs(m_config.stallsPerHour), device, EventType::StallStart);
+                if (device.streaming && !device.stalled) {
+                    OpenIncident(device, SimIncidentKind::Stall);
+                    device.stalled = true;
+                    int64_t durationUs = Uniform(m_config.stallMinMs, m_config.stallMaxMs) * 1000;
+                    Push(m_runtime.NowUs() + durationUs, device, EventType::StallEnd, ++device.stallGeneration);
+                }
+                break;
+            case EventType::StallEnd:
+                if (event.generation == device.stallGeneration) {
+                    device.stalled = false;
+                }
+                break;
+            }
+        }
+
+        // The strap sends on its cadence whether or not anyone is listening. A real payload
+        // through the engine's parser: 8-bit HR (the cadence as a rate, capped at 255 for fast
+        // cadences) plus one RR interval.
+        void OnNotify(Device& device) {
+            int64_t jitterUs = Uniform(0, 2 * static_cast<int64_t>(m_config.notifyJitterMs)) * 1000
+                - static_cast<int64_t>(m_config.notifyJitterMs) * 1000;
+            int64_t intervalUs = static_cast<int64_t>(m_config.notifyIntervalMs) * 1000;
+            Push(m_runtime.NowUs() + std::max<int64_t>(intervalUs + jitterUs, 1000), device, EventType::Notify);
+            ++m_report.sent;
+            ++device.sent;
+
+            if (device.stalled || Chance(m_config.packetLossRate)) {
+                return; // Never left the strap, or lost on air
+            }
+            uint16_t rr = static_cast<uint16_t>(static_cast<uint64_t>(m_config.notifyIntervalMs) * 1024 / 1000);
+            uint8_t payload[4] = { kHrFlagRrPresent, static_cast<uint8_t>(std::min<uint32_t>(60000 / m_config.notifyIntervalMs, 255)),
+                static_cast<uint8_t>(rr), static_cast<uint8_t>(rr >> 8) };
+            if (device.strap->Notify(payload, sizeof(payload))) {
+                ++device.handed; // Faults, if any, are the FaultyTransport's business from here
+            }
+            else if (!device.ended && device.downCause != FaultKind::Count) {
+                ++Impact(device.downCause).samplesLost; // Down because of an injected fault
+            }
+        }
+
+        // Folds the device's injections since the last call into the report; returns just those
+        HrFaultStats Account(Device& device) {
+            HrFaultStats now{};
+            device.faults.Snapshot(now);
+            HrFaultStats added{};
+            added.dropped = now.dropped - device.seen.dropped;
+            added.delayed = now.delayed - device.seen.delayed;
+            added.malformed = now.malformed - device.seen.malformed;
+            added.cccdFailures = now.cccdFailures - device.seen.cccdFailures;
+            added.disconnects = now.disconnects - device.seen.disconnects;
+            added.slowDiscoveries = now.slowDiscoveries - device.seen.slowDiscoveries;
+            device.seen = now;
+            Impact(FaultKind::Drop).injected += added.dropped;
+            Impact(FaultKind::Delay).injected += added.delayed;
+            Impact(FaultKind::Malformed).injected += added.malformed;
+            Impact(FaultKind::CccdFailure).injected += added.cccdFailures;
+            Impact(FaultKind::Disconnect).injected += added.disconnects;
+            Impact(FaultKind::SlowDiscovery).injected += added.slowDiscoveries;
+            if (added.slowDiscoveries > 0) {
+                Recovering(device, FaultKind::SlowDiscovery, device.attemptStartUs);
+            }
+            return added;
+        }
+
+        // Link lost because of an injected fault; losses until it's back are charged to it
+        void GoDown(Device& device, FaultKind cause) {
+            if (device.downCause == FaultKind::Count) {
+                device.downCause = cause;
+            }
+            Recovering(device, cause, m_runtime.NowUs());
+        }
+
+        // Starts timing the recovery from a fault, unless one of its kind is already being timed
+        void Recovering(Device& device, FaultKind kind, int64_t sinceUs) {
+            int64_t& since = device.recoveringSinceUs[static_cast<int>(kind)];
+            if (since < 0) {
+                since = sinceUs;
+            }
+        }
+
+        SimFaultImpact& Impact(FaultKind kind) {
+            return m_report.faults[static_cast<int>(kind)];
+        }
+
+        void OpenIncident(Device& device, SimIncidentKind kind) {
+            if (device.openIncident >= 0) {
+                return; // Still recovering from the last one; count it as one incident
+            }
+            device.openIncident = static_cast<int>(m_report.incidents.size());
+            device.sentAtOpen = device.sent;
+            device.deliveredAtOpen = device.delivered;
+            m_report.incidents.push_back({ device.index, kind, m_runtime.NowUs(), -1, 0 });
+        }
+
+        bool AnyActive() const {
+            return std::any_of(m_devices.begin(), m_devices.end(),
+                [](std::unique_ptr<Device> const& device) { return device->engine->Active(); });
+        }
+
+        void Push(int64_t timeUs, Device const& device, EventType type, uint32_t generation = 0) {
+            m_events.push({ timeUs, m_order++, device.index, type, generation });
+        }
+
+        int64_t Uniform(int64_t low, int64_t high) {
+            return std::uniform_int_distribution<int64_t>(low, std::max(low, high))(m_random);
+        }
+
+        bool Chance(double probability) {
+            return probability > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < probability;
+        }
+
+        // Poisson arrivals; never if the rate is 0
+        int64_t NextIncidentUs(double perHour) {
+            if (perHour <= 0.0) {
+                return INT64_MAX / 2;
+            }
+            double hours = std::exponential_distribution<double>(perHour)(m_random);
+            return static_cast<int64_t>(hours * 3600.0 * 1000000.0) + 1;
+        }
+
+        const SimConfig& m_config;
+        SimReport& m_report;
+        std::mt19937_64 m_random;
+        VirtualRuntime m_runtime; // Outlives the devices: their timers live on its wheel
+        std::priority_queue<Event, std::vector<Event>, Later> m_events;
+        std::vector<std::unique_ptr<Device>> m_devices; // Stable addresses for the engines and scripts
+        uint64_t m_order = 0;
+        bool m_finishing = false;
+    };
+
+    void Device::OnStatus(HrState state, HrErrorCategory category, int32_t, uint64_t) {
+        sim->OnStatus(*this, state, category);
+    }
+
+    void Device::OnSample(const HrSample& sample) {
+        sim->OnSample(*this, sample);
+    }
+}
+
+namespace {
+    template <typename Filter>
+    int64_t RecoveryPercentile(std::vector<SimIncident> const& incidents, double p, Filter&& include) {
+        std::vector<int64_t> times;
+        for (auto const& incident : incidents) {
+            if (incident.recoveredUs >= 0 && include(incident)) {
+                times.push_back(incident.recoveredUs - incident.startUs);
+            }
+        }
+        return PercentileUs(std::move(times), p);
+    }
+}
+
+int64_t SimReport::RecoveryPercentileUs(double p) const {
+    return RecoveryPercentile(incidents, p, [](SimIncident const&) { return true; });
+}
+
+int64_t SimReport::RecoveryPercentileUs(double p, SimIncidentKind kind) const {
+    return RecoveryPercentile(incidents, p, [kind](SimIncident const& incident) { return incident.kind == kind; });
+}
+
+uint32_t SimReport::Unrecovered() const {
+    return static_cast<uint32_t>(std::count_if(incidents.begin(), incidents.end(),
+        [](SimIncident const& incident) { return incident.recoveredUs < 0; }));
+}
+
+bool RunSessionSimulation(const SimConfig& config, SimReport& report) {
+    // The interval also goes out as an RR value, in 1/1024 s in 16 bits
+    if (config.devices == 0 || config.durationUs <= 0 || config.notifyIntervalMs == 0
+        || static_cast<uint64_t>(config.notifyIntervalMs) * 1024 / 1000 > UINT16_MAX
+        || config.connectMinMs > config.connectMaxMs || config.outageMinMs > config.outageMaxMs
+        || config.stallMinMs > config.stallMaxMs) {
+        return false;
+    }
+    report = SimReport{};
+    Simulator simulator(config, report);
+    simulator.Run();
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BLEHeartRateMonitor.h"
+#include "FaultInjector.h"
+
+// --- Virtual-clock session simulation ---
+// Runs the real session engine (SessionEngine.h: connect timeout, watchdog escalation,
+// reconnect backoff and attempt limit, LinkStats) once per device against scripted straps on
+// FakeTransport: straps that notify on a cadence, drop the link or go silent at random, and
+// take a while to come back. Everything runs on one VirtualRuntime, and every random choice of
+// the script comes from one generator seeded by SimConfig::seed, so a scenario is reproducible
+// from its seed and hours of simulated time take milliseconds.
+// SimConfig::faults puts the live session's FaultyTransport (FaultInjector.h) between each
+// strap and its engine, and the report breaks the damage down per fault type.
+// Portable (no WinRT), so it also builds on Linux.
+
+struct SimConfig {
+    uint64_t seed = 1;
+    uint32_t devices = 1;
+    int64_t durationUs = 3600ll * 1000000;   // Simulated time
+
+    // Strap behaviour
+    uint32_t notifyIntervalMs = 1000;        // Up to 63999 (sent as an RR interval too)
+    uint32_t notifyJitterMs = 20;
+    double packetLossRate = 0.0;            // Notifications lost on air while connected
+    double disconnectsPerHour = 2.0;        // Link drops (device then unreachable for an outage)
+    uint32_t outageMinMs = 2000;
+    uint32_t outageMaxMs = 60000;
+    double stallsPerHour = 1.0;             // Link stays up but notifications stop
+    uint32_t stallMinMs = 5000;
+    uint32_t stallMaxMs = 120000;
+    double resubscribeFixRate = 0.5;        // Chance a CCCD rewrite ends a stall
+
+    // Radio / stack
+    uint32_t connectMinMs = 300;            // Connect time of an attempt (scan, discovery and CCCD add a tick each)
+    uint32_t connectMaxMs = 3000;
+    double connectFailureRate = 0.1;        // Attempts that fail even with the device in range
+
+    // Engine settings (same meaning as the exported setters)
+    uint32_t connectTimeoutMs = 20000;
+    uint32_t maxReconnectAttempts = 5;
+
+    // Injected transport faults; a zero seed is derived from seed so runs stay reproducible
+    HrFaultConfig faults{};
+};
+
+enum class SimIncidentKind : uint8_t { Disconnect, Stall, SpuriousDisconnect };
+
+struct SimIncident {
+    uint32_t device;
+    SimIncidentKind kind;
+    int64_t startUs;
+    int64_t recoveredUs; // First notification delivered afterwards, -1 if the session never recovered
+    uint32_t lost;       // Notifications the strap sent in between that never arrived
+};
+
+// What one injected fault type cost
+struct SimFaultImpact {
+    uint64_t injected = 0;
+    uint64_t samplesLost = 0;    // Notifications lost to it: dropped/corrupted, or while down because of it
+    uint64_t addedLatencyUs = 0; // Delivery delay (Delay) or extra connect time (SlowDiscovery)
+    uint32_t reconnects = 0;     // Reconnects it forced (Disconnect, CccdFailure on resubscribe)
+
+    // Time to recover (Disconnect, CccdFailure, SlowDiscovery): from the link going down, or from
+    // the start of the connect attempt that hit the slow discovery, to the next notification
+    // delivered. Raw samples so runs can be pooled; the percentiles are -1 if there are none.
+    std::vector<int64_t> recoveryUs;
+    int64_t recoveryP50Us = -1;
+    int64_t recoveryP99Us = -1;
+    uint32_t unrecovered = 0;    // Still not streaming when the run ended
+};
+
+struct SimReport {
+    std::vector<SimIncident> incidents;
+    SimFaultImpact faults[static_cast<int>(FaultKind::Count)];
+    uint64_t sent = 0;             // Notifications sent by all straps
+    uint64_t delivered = 0;        // Of those, parsed by the engine
+    uint64_t estimatedDropped = 0; // LinkStats' estimate of losses, to compare with the truth
+    uint32_t connects = 0;         // Connect attempts
+    uint32_t resubscribes = 0;     // Watchdog-requested CCCD rewrites
+    uint32_t sessionsEnded = 0;    // Devices whose session gave up before the end
+
+    // Time from incident to recovery at percentile p (0..100) over recovered incidents; -1 if none
+    int64_t RecoveryPercentileUs(double p) const;
+    int64_t RecoveryPercentileUs(double p, SimIncidentKind kind) const;
+    uint32_t Unrecovered() const;
+};
+
+// Runs one scenario to config.durationUs. False if the configuration is invalid.
+bool RunSessionSimulation(const SimConfig& config, SimReport& report);
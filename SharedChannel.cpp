@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "SharedChannel.h"
+#ifndef _WIN32
+#include <cerrno>
+#endif
+
+bool SharedChannelWriter::Open(const char* name, uint32_t capacity) {
+    Close();
+    if (!name || capacity == 0) {
+        return false;
+    }
+    uint64_t size = SharedChannelSize(capacity);
+#ifdef _WIN32
+    m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), name);
+    if (!m_mapping) {
+        return false;
+    }
+    bool existed = GetLastError() == ERROR_ALREADY_EXISTS;
+    void* view = MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (!view) {
+        Close();
+        return false;
+    }
+#else
+    std::string posixName = SharedChannelPosixName(name);
+    bool existed = false;
+    int fd = shm_open(posixName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1 && errno == EEXIST) {
+        existed = true;
+        fd = shm_open(posixName.c_str(), O_RDWR, 0);
+    }
+    if (fd == -1) {
+        return false;
+    }
+    struct stat info{};
+    // A fresh object is sized (and so zero-filled) here; an existing one must already fit the ring
+    bool sized = existed ? fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_size) == size
+        : ftruncate(fd, static_cast<off_t>(size)) == 0;
+    void* view = sized ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd); // The mapping keeps the object
+    if (view == MAP_FAILED) {
+        if (!existed) {
+            shm_unlink(posixName.c_str());
+        }
+        return false;
+    }
+    m_size = size;
+    if (!existed) {
+        m_name = posixName;
+    }
+#endif
+    m_header = static_cast<SharedChannelHeader*>(view);
+    if (existed && (m_header->magic != kSharedChannelMagic || m_header->version != kSharedChannelVersion
+        || m_header->slotSize != sizeof(SharedChannelSlot) || m_header->capacity != capacity)) {
+        Close(); // Someone else's mapping under this name, or a different layout
+        return false;
+    }
+    m_slots = reinterpret_cast<SharedChannelSlot*>(m_header + 1);
+    m_capacity = capacity;
+    if (!existed) {
+        // Fresh mappings are zero-filled, which is already a valid empty ring; just stamp it
+        m_header->capacity = capacity;
+        m_header->slotSize = sizeof(SharedChannelSlot);
+        m_header->version = kSharedChannelVersion;
+        std::atomic_thread_fence(std::memory_order_release);
+        m_header->magic = kSharedChannelMagic;
+    }
+    return true;
+}
+
+void SharedChannelWriter::Close() {
+#ifdef _WIN32
+    if (m_header) {
+        UnmapViewOfFile(m_header);
+        m_header = nullptr;
+        m_slots = nullptr;
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+#else
+    if (m_header) {
+        munmap(m_header, m_size);
+        m_header = nullptr;
+        m_slots = nullptr;
+        m_size = 0;
+    }
+    if (!m_name.empty()) {
+        shm_unlink(m_name.c_str()); // Readers that have it mapped keep reading; new ones cannot open it
+        m_name.clear();
+    }
+#endif
+    m_capacity = 0;
+}
+
+void SharedChannelWriter::Publish(const HrSample& sample) {
+    if (!m_header) {
+        return;
+    }
+    uint32_t index = m_header->published.load(std::memory_order_relaxed);
+    SharedChannelRecord record{};
+    record.index = index;
+    record.sample = sample;
+    m_slots[index % m_capacity].Store(record);
+    m_header->published.store(index + 1, std::memory_order_release);
+}
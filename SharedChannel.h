@@ -0,0 +1,226 @@
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#endif
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "BLEHeartRateMonitor.h"
+#include "Seqlock.h"
+
+// --- Shared-memory sample channel ---
+// The DLL (one writer) publishes every sample into a named file mapping laid out as a header
+// followed by a ring of seqlock slots. Other processes open the mapping read-only with
+// SharedChannelReader and never block the writer or each other; a reader that falls more than
+// one ring behind loses the oldest samples and is told how many. Readers never wait on the
+// writer either: a writer process that dies mid-write leaves that slot odd for good, so a slot
+// that stays unreadable for kSharedChannelLoadAttempts tries counts as lost.
+// Off Windows the mapping is a POSIX shared memory object (shm_open) of the same layout, so
+// reader processes can be tested locally; it lives until the writer that created it closes.
+// Both sides cache the capacity when they open: the header is writable by any process that
+// maps it read-write, and a changed capacity must not send an index out of the ring.
+// Only 32-bit atomics are used so readers can load them from a read-only view on x86 too.
+
+constexpr uint32_t kSharedChannelMagic = 0x48524348; // 'HRCH'
+constexpr uint32_t kSharedChannelVersion = 1;
+constexpr int kSharedChannelLoadAttempts = 256; // Seqlock reads of one slot before a reader gives up on it
+
+struct SharedChannelRecord {
+    uint32_t index; // Publish count when written; tells readers whether the slot was reused
+    uint32_t reserved;
+    HrSample sample;
+};
+using SharedChannelSlot = SeqlockCell<SharedChannelRecord>;
+
+struct SharedChannelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;  // Slots in the ring
+    uint32_t slotSize;  // sizeof(SharedChannelSlot), checked by readers
+    std::atomic<uint32_t> published; // Samples written so far (wraps)
+    uint32_t reserved[11];           // Pad to 64 bytes
+};
+static_assert(sizeof(SharedChannelHeader) == 64, "SharedChannelHeader layout is shared across processes");
+
+inline size_t SharedChannelSize(uint32_t capacity) {
+    return sizeof(SharedChannelHeader) + static_cast<size_t>(capacity) * sizeof(SharedChannelSlot);
+}
+
+inline const SharedChannelSlot* SharedChannelSlots(const SharedChannelHeader* header) {
+    return reinterpret_cast<const SharedChannelSlot*>(header + 1);
+}
+
+#ifndef _WIN32
+// shm_open wants "/name"; Windows-style names are accepted as they are otherwise
+inline std::string SharedChannelPosixName(const char* name) {
+    return name[0] == '/' ? std::string(name) : "/" + std::string(name);
+}
+#endif
+
+// Writer side, owned by the DLL. Publish must only be called from one thread at a time.
+class SharedChannelWriter {
+public:
+    ~SharedChannelWriter() { Close(); }
+
+    bool Open(const char* name, uint32_t capacity); // Creates (or reuses) the named mapping
+    void Close();
+    bool IsOpen() const { return m_header != nullptr; }
+    void Publish(const HrSample& sample);
+
+private:
+#ifdef _WIN32
+    HANDLE m_mapping = nullptr;
+#else
+    std::string m_name; // Set while this writer owns (created) the object, to unlink it on Close
+    size_t m_size = 0;
+#endif
+    SharedChannelHeader* m_header = nullptr;
+    SharedChannelSlot* m_slots = nullptr;
+    uint32_t m_capacity = 0;
+};
+
+// Reader side, for consumer processes (header-only). Each reader keeps its own position.
+class SharedChannelReader {
+public:
+    ~SharedChannelReader() { Close(); }
+
+    bool Open(const char* name) {
+        Close();
+        if (!name) {
+            return false;
+        }
+        size_t size = 0;
+#ifdef _WIN32
+        m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+        if (!m_mapping) {
+            return false;
+        }
+        m_header = static_cast<const SharedChannelHeader*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        MEMORY_BASIC_INFORMATION region{};
+        if (m_header && VirtualQuery(m_header, &region, sizeof(region))) {
+            size = region.RegionSize;
+        }
+#else
+        int fd = shm_open(SharedChannelPosixName(name).c_str(), O_RDONLY, 0);
+        if (fd == -1) {
+            return false;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedChannelHeader)) {
+            size = static_cast<size_t>(info.st_size);
+            void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            m_header = view != MAP_FAILED ? static_cast<const SharedChannelHeader*>(view) : nullptr;
+            m_size = size;
+        }
+        close(fd); // The mapping keeps the object
+#endif
+        if (!m_header || m_header->magic != kSharedChannelMagic || m_header->version != kSharedChannelVersion
+            || m_header->slotSize != sizeof(SharedChannelSlot) || m_header->capacity == 0
+            || SharedChannelSize(m_header->capacity) > size) {
+            Close();
+            return false;
+        }
+        m_capacity = m_header->capacity;
+        m_next = m_header->published.load(std::memory_order_acquire); // Start with new samples only
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (m_header) {
+            UnmapViewOfFile(m_header);
+            m_header = nullptr;
+        }
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+#else
+        if (m_header) {
+            munmap(const_cast<SharedChannelHeader*>(m_header), m_size);
+            m_header = nullptr;
+            m_size = 0;
+        }
+#endif
+        m_capacity = 0;
+    }
+
+    // Copies up to maxSamples samples published since the last call. lost (optional) is
+    // increased by the number overwritten before this reader got to them.
+    int Read(HrSample* out, int maxSamples, uint32_t* lost = nullptr) {
+        if (!m_header || !out || maxSamples <= 0) {
+            return 0;
+        }
+        const uint32_t capacity = m_capacity;
+        const SharedChannelSlot* slots = SharedChannelSlots(m_header);
+        uint32_t published = m_header->published.load(std::memory_order_acquire);
+        uint32_t skipped = 0;
+        if (published - m_next > capacity) {
+            skipped = published - m_next - capacity;
+            m_next = published - capacity;
+        }
+        int count = 0;
+        while (m_next != published && count < maxSamples) {
+            SharedChannelRecord record;
+            if (LoadSlot(slots[m_next % capacity], record) && record.index == m_next) {
+                out[count++] = record.sample;
+            }
+            else {
+                ++skipped; // Overwritten while we were reading, or the writer died overwriting it
+            }
+            ++m_next;
+        }
+        if (lost) {
+            *lost += skipped;
+        }
+        return count;
+    }
+
+    // Most recent sample, regardless of this reader's position
+    bool Latest(HrSample& out) const {
+        if (!m_header) {
+            return false;
+        }
+        uint32_t published = m_header->published.load(std::memory_order_acquire);
+        if (published == 0) {
+            return false;
+        }
+        SharedChannelRecord record;
+        if (!LoadSlot(SharedChannelSlots(m_header)[(published - 1) % m_capacity], record)) {
+            return false;
+        }
+        out = record.sample;
+        return true;
+    }
+
+private:
+    // SeqlockCell::Load with a bound. Below published a slot is only written while the writer
+    // laps it, so a slot that never settles holds nothing this reader can still get.
+    static bool LoadSlot(const SharedChannelSlot& slot, SharedChannelRecord& record) {
+        for (int attempt = 0; attempt < kSharedChannelLoadAttempts; ++attempt) {
+            if (slot.TryLoad(record)) {
+                return true;
+            }
+            if (attempt > 64) {
+                std::this_thread::yield(); // Writer was preempted mid-write
+            }
+        }
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE m_mapping = nullptr;
+#else
+    size_t m_size = 0;
+#endif
+    const SharedChannelHeader* m_header = nullptr;
+    uint32_t m_capacity = 0;
+    uint32_t m_next = 0;
+};
@@ -0,0 +1,367 @@
+#include "pch.h"
+#include "SoakTest.h"
+#include "FakeTransport.h"
+#include "LinkStats.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct MetricInfo {
+        const char* name;
+        double floor; // Smallest fitted growth worth failing a run for
+    };
+
+    constexpr MetricInfo kMetrics[SoakMetricCount] = {
+        { "residentBytes", 1024.0 * 1024.0 },
+        { "handles", 4.0 },
+        { "queueDepth", 64.0 },
+        { "pipelineP99Ns", 1000.0 },
+        { "queueP99Ns", 1000000.0 }, // Dominated by the poll interval
+    };
+
+    constexpr size_t kMinTestedIntervals = 8;
+
+    constexpr uint8_t kStrapPayload[4] = { 0x10, 72, 0x00, 0x04 }; // 72 bpm, one RR interval
+    constexpr uint32_t kChurnTickMs = 100;
+    constexpr uint32_t kSessionStopMs = 5000;
+
+    // One fake strap and the session engine that streams from it
+    struct SoakSession final : SessionHost {
+        SoakSession(SessionRuntime& runtime, uint64_t address)
+            : transport(std::make_shared<FakeTransport>(runtime, address)), engine(runtime, *this, stats, startup) {}
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return transport; }
+        void OnStatus(HrState state, HrErrorCategory, int32_t, uint64_t) override {
+            if (state == HrStateReconnecting) {
+                reconnects.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        void OnSample(const HrSample&) override { samples.fetch_add(1, std::memory_order_relaxed); }
+
+        std::shared_ptr<FakeTransport> transport;
+        LinkStats stats;
+        StartupProfiler startup;
+        std::atomic<uint64_t> samples{ 0 };
+        std::atomic<uint64_t> reconnects{ 0 };
+        SessionEngine engine;
+        uint64_t nextDropMs = 0;
+        uint64_t nextRestartMs = 0;
+    };
+
+    // Runs config.sessions engines beside the load: a driver thread makes each strap notify once
+    // a second, and drops links and restarts sessions at jittered intervals
+    class SessionChurn {
+    public:
+        bool Start(const SoakConfig& config) {
+            m_config = &config;
+            for (uint32_t i = 0; i < config.sessions; ++i) {
+                auto session = std::make_unique<SoakSession>(m_runtime, 0xF00D00000000ull + i);
+                session->nextDropMs = Jitter(config.linkDropMs);
+                session->nextRestartMs = Jitter(config.restartMs);
+                if (session->engine.Start(m_runtime.NowUs(), 1000) != 0) {
+                    return false;
+                }
+                m_sessions.push_back(std::move(session));
+            }
+            if (!m_sessions.empty()) {
+                m_driver = std::thread([this] { Run(); });
+            }
+            return true;
+        }
+
+        // Stops the driver and every session; fills report
+        void Stop(SoakSessions& report) {
+            m_stopping = true;
+            if (m_driver.joinable()) {
+                m_driver.join();
+            }
+            m_report.sessions = static_cast<uint32_t>(m_sessions.size());
+            for (auto& session : m_sessions) {
+                int stopped = session->engine.Stop(kSessionStopMs, false);
+                if (stopped == -1) {
+                    ++m_report.ended;
+                }
+                else if (stopped != 0) {
+                    ++m_report.stopFailures;
+                }
+                m_report.samples += session->samples.load();
+                m_report.reconnects += session->reconnects.load();
+            }
+            report = m_report;
+            if (m_report.stopFailures != 0) {
+                // An abandoned session still runs on its strap and runtime: never free them under it
+                for (auto& session : m_sessions) {
+                    session.release();
+                }
+            }
+        }
+
+    private:
+        uint64_t Jitter(uint32_t periodMs) {
+            if (periodMs == 0) {
+                return UINT64_MAX;
+            }
+            m_random ^= m_random << 13;
+            m_random ^= m_random >> 17;
+            m_random ^= m_random << 5;
+            return m_elapsedMs + periodMs / 2 + m_random % periodMs;
+        }
+
+        void Run() {
+            auto started = std::chrono::steady_clock::now();
+            uint64_t tick = 0;
+            while (!m_stopping.load()) {
+                for (size_t i = 0; i < m_sessions.size(); ++i) {
+                    SoakSession& session = *m_sessions[i];
+                    if ((tick + i) % (1000 / kChurnTickMs) == 0) {
+                        session.transport->Notify(kStrapPayload, sizeof(kStrapPayload));
+                    }
+                    if (m_elapsedMs >= session.nextDropMs) {
+                        // Only a streaming link: a first connect that fails ends the session
+                        if (session.transport->Subscribed()) {
+                            session.transport->DropLink();
+                            ++m_report.linkDrops;
+                        }
+                        session.nextDropMs = Jitter(m_config->linkDropMs);
+                    }
+                    if (m_elapsedMs >= session.nextRestartMs) {
+                        int stopped = session.engine.Stop(kSessionStopMs, false);
+                        if (stopped == -1) {
+                            ++m_report.ended;
+                        }
+                        else if (stopped != 0) {
+                            ++m_report.stopFailures;
+                        }
+                        if (session.engine.Start(m_runtime.NowUs(), 1000) != 0) {
+                            ++m_report.startFailures;
+                        }
+                        ++m_report.restarts;
+                        session.nextRestartMs = Jitter(m_config->restartMs);
+                    }
+                }
+                ++tick;
+                std::this_thread::sleep_until(started + std::chrono::milliseconds(tick * kChurnTickMs));
+                m_elapsedMs = tick * kChurnTickMs;
+            }
+        }
+
+        const SoakConfig* m_config = nullptr;
+        ThreadRuntime m_runtime;
+        std::vector<std::unique_ptr<SoakSession>> m_sessions;
+        std::thread m_driver;
+        std::atomic<bool> m_stopping{ false };
+        uint32_t m_random = 0x2545F491u;
+        uint64_t m_elapsedMs = 0;
+        SoakSessions m_report{};
+    };
+
+    struct Collector {
+        const SoakConfig* config = nullptr;
+        std::FILE* csv = nullptr;
+        bool csvFailed = false;
+        std::vector<double> times;
+        std::vector<double> series[SoakMetricCount];
+    };
+
+    void OnInterval(const LoadInterval& interval, void* context) {
+        auto collector = static_cast<Collector*>(context);
+        double values[SoakMetricCount];
+        values[SoakMetricResidentBytes] = static_cast<double>(interval.residentBytes);
+        values[SoakMetricHandles] = static_cast<double>(interval.handles);
+        values[SoakMetricQueueDepth] = static_cast<double>(interval.queueDepth);
+        values[SoakMetricPipelineP99] = static_cast<double>(interval.pipeline.Percentile(99.0));
+        values[SoakMetricQueueP99] = static_cast<double>(interval.queue.Percentile(99.0));
+        collector->times.push_back(interval.elapsedS);
+        for (int m = 0; m < SoakMetricCount; ++m) {
+            collector->series[m].push_back(values[m]);
+        }
+        if (!collector->csv) {
+            return;
+        }
+        double seconds = collector->config->intervalMs / 1000.0;
+        int written = std::fprintf(collector->csv, "%.3f,%llu,%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%u,%llu,%llu,%lld,%lld,%.2f\n",
+            interval.elapsedS, static_cast<unsigned long long>(interval.samples),
+            static_cast<double>(interval.samples) / seconds,
+            static_cast<unsigned long long>(interval.pipeline.Percentile(50.0)),
+            static_cast<unsigned long long>(interval.pipeline.Percentile(99.0)),
+            static_cast<unsigned long long>(interval.pipeline.Percentile(99.9)),
+            static_cast<unsigned long long>(interval.pipeline.Max()),
+            static_cast<unsigned long long>(interval.queue.Percentile(50.0)),
+            static_cast<unsigned long long>(interval.queue.Percentile(99.0)),
+            interval.queueDepth, static_cast<unsigned long long>(interval.queueOverflows),
+            static_cast<unsigned long long>(interval.captureDropped),
+            static_cast<long long>(interval.residentBytes), static_cast<long long>(interval.handles),
+            interval.cpuPercent);
+        if (written < 0 || std::fflush(collector->csv) != 0) {
+            collector->csvFailed = true;
+        }
+    }
+
+    // Mann-Kendall S statistic normalised to z, with the variance corrected for ties
+    double MannKendallZ(const double* x, size_t n) {
+        int64_t s = 0;
+        for (size_t i = 0; i + 1 < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j) {
+                s += (x[j] > x[i]) - (x[j] < x[i]);
+            }
+        }
+        std::vector<double> sorted(x, x + n);
+        std::sort(sorted.begin(), sorted.end());
+        double dn = static_cast<double>(n);
+        double variance = dn * (dn - 1) * (2 * dn + 5);
+        for (size_t i = 0; i < n;) {
+            size_t j = i;
+            while (j < n && sorted[j] == sorted[i]) {
+                ++j;
+            }
+            double t = static_cast<double>(j - i);
+            variance -= t * (t - 1) * (2 * t + 5);
+            i = j;
+        }
+        variance /= 18.0;
+        if (variance <= 0.0 || s == 0) {
+            return 0.0; // Constant series
+        }
+        return (static_cast<double>(s) - (s > 0 ? 1.0 : -1.0)) / std::sqrt(variance);
+    }
+
+    SoakDrift Analyze(const std::vector<double>& times, const std::vector<double>& values, size_t first,
+        const MetricInfo& metric, const SoakConfig& config) {
+        SoakDrift drift{};
+        if (values.size() < first + kMinTestedIntervals) {
+            return drift;
+        }
+        size_t n = values.size() - first;
+        const double* t = times.data() + first;
+        const double* x = values.data() + first;
+        double meanT = 0.0, meanX = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            meanT += t[i];
+            meanX += x[i];
+        }
+        meanT /= n;
+        meanX /= n;
+        double sxy = 0.0, sxx = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sxy += (t[i] - meanT) * (x[i] - meanX);
+            sxx += (t[i] - meanT) * (t[i] - meanT);
+        }
+        double slope = sxx > 0.0 ? sxy / sxx : 0.0;
+        drift.evaluated = true;
+        drift.start = meanX + slope * (t[0] - meanT);
+        drift.end = meanX + slope * (t[n - 1] - meanT);
+        drift.slopePerHour = slope * 3600.0;
+        drift.z = MannKendallZ(x, n);
+        double growth = drift.end - drift.start;
+        drift.failed = drift.z > config.zCritical
+            && growth >= std::max(config.minGrowth * std::fabs(drift.start), metric.floor);
+        return drift;
+    }
+}
+
+const char* SoakMetricName(SoakMetric metric) {
+    return metric >= 0 && metric < SoakMetricCount ? kMetrics[metric].name : "";
+}
+
+bool RunSoakTest(const SoakConfig& config, SoakReport& report) {
+    if (config.intervalMs == 0 || config.warmupFraction < 0.0 || config.warmupFraction >= 1.0) {
+        return false;
+    }
+    report = SoakReport{};
+    Collector collector;
+    collector.config = &config;
+    if (config.csvPath) {
+        collector.csv = std::fopen(config.csvPath, "w");
+        if (!collector.csv) {
+            return false;
+        }
+        if (std::fputs("elapsed_s,samples,throughput_per_s,p50_ns,p99_ns,p999_ns,max_ns,queue_p50_ns,queue_p99_ns,"
+            "queue_depth,queue_overflows,capture_dropped,rss_bytes,handles,cpu_percent\n", collector.csv) < 0) {
+            collector.csvFailed = true;
+        }
+    }
+    LoadConfig load = config.load;
+    load.intervalMs = config.intervalMs;
+    load.onInterval = &OnInterval;
+    load.intervalContext = &collector;
+    size_t expected = config.load.durationMs / config.intervalMs;
+    collector.times.reserve(expected);
+    for (auto& series : collector.series) {
+        series.reserve(expected);
+    }
+    SessionChurn churn;
+    bool ran = churn.Start(config) && RunLoadTest(load, report.load);
+    churn.Stop(report.sessions);
+    if (collector.csv) {
+        if (std::fclose(collector.csv) != 0) {
+            collector.csvFailed = true;
+        }
+    }
+    if (!ran) {
+        return false;
+    }
+
+    size_t intervals = collector.times.size();
+    size_t first = static_cast<size_t>(config.warmupFraction * static_cast<double>(intervals));
+    report.intervals = static_cast<uint32_t>(intervals);
+    report.testedIntervals = static_cast<uint32_t>(intervals - first);
+    report.csvFailed = collector.csvFailed;
+    const SoakSessions& sessions = report.sessions;
+    report.passed = sessions.startFailures == 0 && sessions.stopFailures == 0 && sessions.ended == 0;
+    for (int m = 0; m < SoakMetricCount; ++m) {
+        report.drift[m] = Analyze(collector.times, collector.series[m], first, kMetrics[m], config);
+        if (report.drift[m].failed) {
+            report.passed = false;
+        }
+    }
+    return true;
+}
+
+size_t FormatSoakReportJson(const SoakReport& report, char* out, size_t capacity) {
+    size_t length = 0;
+    auto append = [&](int written) {
+        if (written < 0 || length + static_cast<size_t>(written) >= capacity) {
+            length = capacity;
+            return false;
+        }
+        length += static_cast<size_t>(written);
+        return true;
+    };
+    if (!append(std::snprintf(out, capacity, "{\"passed\":%s,\"intervals\":%u,\"testedIntervals\":%u,\"csvFailed\":%s,\"drift\":{",
+        report.passed ? "true" : "false", report.intervals, report.testedIntervals, report.csvFailed ? "true" : "false"))) {
+        return 0;
+    }
+    for (int m = 0; m < SoakMetricCount; ++m) {
+        const SoakDrift& drift = report.drift[m];
+        if (!append(std::snprintf(out + length, capacity - length,
+            "%s\"%s\":{\"evaluated\":%s,\"start\":%.1f,\"end\":%.1f,\"slopePerHour\":%.3f,\"z\":%.2f,\"failed\":%s}",
+            m > 0 ? "," : "", kMetrics[m].name, drift.evaluated ? "true" : "false", drift.start, drift.end,
+            drift.slopePerHour, drift.z, drift.failed ? "true" : "false"))) {
+            return 0;
+        }
+    }
+    const SoakSessions& sessions = report.sessions;
+    if (!append(std::snprintf(out + length, capacity - length, "},\"sessions\":{\"sessions\":%u,\"samples\":%llu,"
+        "\"linkDrops\":%llu,\"reconnects\":%llu,\"restarts\":%llu,\"startFailures\":%u,\"stopFailures\":%u,\"ended\":%u}",
+        sessions.sessions, static_cast<unsigned long long>(sessions.samples),
+        static_cast<unsigned long long>(sessions.linkDrops), static_cast<unsigned long long>(sessions.reconnects),
+        static_cast<unsigned long long>(sessions.restarts), sessions.startFailures, sessions.stopFailures, sessions.ended))) {
+        return 0;
+    }
+    if (!append(std::snprintf(out + length, capacity - length, ",\"load\":"))) {
+        return 0;
+    }
+    size_t load = FormatLoadReportJson(report.load, out + length, capacity - length);
+    if (load == 0 || !append(static_cast<int>(load)) || !append(std::snprintf(out + length, capacity - length, "}"))) {
+        return 0;
+    }
+    return length;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "LoadGenerator.h"
+
+// --- Soak test ---
+// Runs the load generator for hours (load.durationMs) and samples resident memory, open
+// handles, queue depth and per-interval latency percentiles every intervalMs. Each interval is
+// appended to a CSV file as it completes, so a run that dies late still leaves its data.
+// At the end every tracked metric gets an upward-drift test over the intervals after warm-up.
+// The test is a one-sided Mann-Kendall trend test: it is rank-based, so single spikes don't
+// trip it. A metric fails only if the trend is significant (z above zCritical) AND its
+// least-squares fit grows by at least minGrowth over the window (and by at least a per-metric
+// absolute floor). Interval series are autocorrelated, which inflates z; the growth
+// requirement is what keeps a merely wobbly metric from failing the run.
+// Beside the load, config.sessions real session engines run on fake straps (FakeTransport.h)
+// on one runtime thread: streaming at 1 Hz, dropping their link and being stopped and
+// started again now and then, so leaks in the session lifecycle show up in the same metrics.
+// A session that fails to start, misses its stop deadline or gives up on its own fails the run.
+
+enum SoakMetric : int {
+    SoakMetricResidentBytes,
+    SoakMetricHandles,
+    SoakMetricQueueDepth,
+    SoakMetricPipelineP99,
+    SoakMetricQueueP99,
+    SoakMetricCount,
+};
+
+struct SoakConfig {
+    LoadConfig load;              // Production-like devices and rate; durationMs is the soak length
+    uint32_t intervalMs = 10000;
+    double warmupFraction = 0.1;  // Leading share of the intervals left out of the drift tests
+    double zCritical = 3.09;      // One-sided p < 0.001
+    double minGrowth = 0.10;      // Fitted growth over the window, relative to its start
+    const char* csvPath = nullptr; // One row per interval, null = no CSV
+    uint32_t sessions = 16;        // Session engines on fake straps, 0 = none
+    uint32_t linkDropMs = 60000;   // Each strap drops its link about this often, 0 = never
+    uint32_t restartMs = 300000;   // Each session is stopped and started again about this often, 0 = never
+};
+
+struct SoakSessions {
+    uint32_t sessions;
+    uint64_t samples;             // Delivered by the engines
+    uint64_t linkDrops;
+    uint64_t reconnects;
+    uint64_t restarts;
+    uint32_t startFailures;
+    uint32_t stopFailures;        // Stop missed its deadline
+    uint32_t ended;               // Sessions that gave up on their own
+};
+
+struct SoakDrift {
+    bool evaluated;               // False with too few intervals after warm-up
+    double start;                 // Least-squares fit at the first and last tested interval
+    double end;
+    double slopePerHour;
+    double z;                     // Mann-Kendall, positive = upward
+    bool failed;
+};
+
+struct SoakReport {
+    LoadReport load;
+    uint32_t intervals;
+    uint32_t testedIntervals;
+    SoakDrift drift[SoakMetricCount];
+    SoakSessions sessions;
+    bool csvFailed;
+    bool passed;
+};
+
+const char* SoakMetricName(SoakMetric metric);
+
+// False if the load test could not run; otherwise report.passed says whether anything drifted
+bool RunSoakTest(const SoakConfig& config, SoakReport& report);
+
+// Writes report as one JSON object. Returns the length, or 0 if capacity is too small.
+size_t FormatSoakReportJson(const SoakReport& report, char* out, size_t capacity);
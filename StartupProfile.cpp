@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "StartupProfile.h"
+
+StartupProfiler g_startup;
+
+namespace {
+    uint32_t ClampUs(int64_t us) {
+        return us <= 0 ? 0 : us >= UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(us);
+    }
+}
+
+void StartupProfiler::BeginAttempt(int64_t launchUs, int64_t nowUs, bool reconnect) {
+    m_awaiting.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active) {
+        Finish(kHrStartupStopped, nowUs); // Previous attempt never reported its end
+    }
+    m_current = HrStartupProfile{};
+    m_current.startUs = launchUs != 0 ? launchUs : nowUs;
+    m_current.reconnect = reconnect ? 1 : 0;
+    m_current.failedPhase = -1;
+    m_active = true;
+    m_phase = -1;
+    if (launchUs != 0) {
+        m_phase = HrStartupLaunch;
+        m_phaseStartUs = launchUs;
+        ClosePhase(nowUs);
+    }
+}
+
+void StartupProfiler::EnterPhase(HrStartupPhase phase, int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active) {
+        return;
+    }
+    ClosePhase(nowUs);
+    m_phase = phase;
+    m_phaseStartUs = nowUs;
+}
+
+void StartupProfiler::AwaitFirstSample(int64_t nowUs) {
+    EnterPhase(HrStartupFirstSample, nowUs);
+    m_awaiting.store(true, std::memory_order_release);
+}
+
+void StartupProfiler::MarkPrewarmed() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active) {
+        m_current.prewarmed = 1;
+    }
+}
+
+void StartupProfiler::Fail(int32_t outcome, int64_t nowUs) {
+    m_awaiting.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active) {
+        Finish(outcome, nowUs);
+    }
+}
+
+void StartupProfiler::Complete(int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active) {
+        return;
+    }
+    ClosePhase(nowUs);
+    Finish(HrErrorNone, nowUs);
+}
+
+void StartupProfiler::ClosePhase(int64_t nowUs) {
+    if (m_phase < 0) {
+        return;
+    }
+    uint32_t durationUs = ClampUs(nowUs - m_phaseStartUs);
+    m_current.phaseUs[m_phase] = durationUs;
+    m_current.completedPhases |= 1u << m_phase;
+    m_histograms[m_phase].Record(durationUs);
+    m_phase = -1;
+}
+
+// Ends the attempt: the phase still running is the one it failed in (not timed)
+void StartupProfiler::Finish(int32_t outcome, int64_t nowUs) {
+    m_current.outcome = outcome;
+    if (outcome == HrErrorNone) {
+        uint32_t totalUs = ClampUs(nowUs - m_current.startUs);
+        m_current.phaseUs[HrStartupTotal] = totalUs;
+        m_current.completedPhases |= 1u << HrStartupTotal;
+        m_histograms[HrStartupTotal].Record(totalUs);
+    }
+    else if (m_phase >= 0) {
+        m_current.failedPhase = m_phase;
+        if (outcome != kHrStartupStopped) {
+            ++m_failures[m_phase];
+        }
+    }
+    m_history[m_historyNext] = m_current;
+    m_historyNext = (m_historyNext + 1) % kHistory;
+    if (m_historyCount < kHistory) {
+        ++m_historyCount;
+    }
+    m_active = false;
+    m_phase = -1;
+}
+
+bool StartupProfiler::Profile(uint32_t index, HrStartupProfile& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index >= m_historyCount) {
+        return false;
+    }
+    out = m_history[(m_historyNext + kHistory - 1 - index) % kHistory];
+    return true;
+}
+
+void StartupProfiler::Stats(HrStartupPhaseStats* out, int count) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (int i = 0; i < count && i < HrStartupPhaseCount; ++i) {
+        const LatencyHistogram& histogram = m_histograms[i];
+        out[i].count = histogram.Count();
+        out[i].failures = m_failures[i];
+        out[i].p50Us = ClampUs(static_cast<int64_t>(histogram.Percentile(50.0)));
+        out[i].p90Us = ClampUs(static_cast<int64_t>(histogram.Percentile(90.0)));
+        out[i].p99Us = ClampUs(static_cast<int64_t>(histogram.Percentile(99.0)));
+        out[i].maxUs = ClampUs(static_cast<int64_t>(histogram.Max()));
+    }
+}
+
+void StartupProfiler::Reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_historyCount = 0;
+    m_historyNext = 0;
+    for (int i = 0; i < HrStartupPhaseCount; ++i) {
+        m_histograms[i].Reset();
+        m_failures[i] = 0;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+#include "LatencyHistogram.h"
+
+// Times each phase of a connection attempt (scan, connect, discover, subscribe, first sample)
+// and keeps the most recent attempts plus a histogram per phase across all of them.
+// The session coroutine drives an attempt through BeginAttempt/EnterPhase/AwaitFirstSample and
+// ends it with Fail; the notification thread ends it with OnSample, which costs one relaxed
+// load once the first sample has been seen.
+class StartupProfiler {
+public:
+    static constexpr uint32_t kHistory = 16;
+
+    // launchUs: when StartHrMonitoring was called, for a session's first attempt; 0 otherwise
+    void BeginAttempt(int64_t launchUs, int64_t nowUs, bool reconnect);
+    void EnterPhase(HrStartupPhase phase, int64_t nowUs); // Ends the phase running before it
+    void AwaitFirstSample(int64_t nowUs);                 // Subscribed; call before notifications can arrive
+    void MarkPrewarmed();                                 // Connecting to a strap the pre-warm scan heard
+    void OnSample(int64_t nowUs) {
+        if (m_awaiting.load(std::memory_order_relaxed) && m_awaiting.exchange(false, std::memory_order_acq_rel)) {
+            Complete(nowUs);
+        }
+    }
+    void Fail(int32_t outcome, int64_t nowUs); // HrErrorCategory or kHrStartupStopped; no-op once complete
+
+    bool Profile(uint32_t index, HrStartupProfile& out) const; // 0 = most recent attempt
+    void Stats(HrStartupPhaseStats* out, int count) const;
+    void Reset(); // Clears history and histograms
+
+private:
+    void Complete(int64_t nowUs);
+    void ClosePhase(int64_t nowUs);                    // Lock held
+    void Finish(int32_t outcome, int64_t nowUs);       // Lock held
+
+    std::atomic<bool> m_awaiting{ false };
+    mutable std::mutex m_mutex; // Protects everything below
+    bool m_active = false;
+    HrStartupProfile m_current{};
+    int32_t m_phase = -1;
+    int64_t m_phaseStartUs = 0;
+    HrStartupProfile m_history[kHistory] = {};
+    uint32_t m_historyCount = 0;
+    uint32_t m_historyNext = 0;
+    LatencyHistogram m_histograms[HrStartupPhaseCount]; // Microseconds
+    uint64_t m_failures[HrStartupPhaseCount] = {};
+};
+
+extern StartupProfiler g_startup;
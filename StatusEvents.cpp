@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "StatusEvents.h"
+#include <cstdio>
+
+void StatusEventQueue::Push(const HrStatusEvent& evt) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t tail = (m_head + m_count) % kCapacity;
+    m_events[tail] = evt;
+    if (m_count < kCapacity) {
+        ++m_count;
+    }
+    else {
+        m_head = (m_head + 1) % kCapacity; // Full: drop the oldest
+    }
+}
+
+bool StatusEventQueue::Pop(HrStatusEvent& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == 0) {
+        return false;
+    }
+    out = m_events[m_head];
+    m_head = (m_head + 1) % kCapacity;
+    --m_count;
+    return true;
+}
+
+void StatusEventQueue::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_head = 0;
+    m_count = 0;
+}
+
+const char* StatusStateText(int32_t state) {
+    switch (state) {
+    case HrStateIdle: return "Stopped";
+    case HrStateScanning: return "Starting Scan...";
+    case HrStateConnecting: return "Connecting...";
+    case HrStateDiscovering: return "Discovering Services...";
+    case HrStateSubscribing: return "Subscribing...";
+    case HrStateDisconnected: return "Device Disconnected";
+    case HrStateStreaming: return "Connected and Monitoring";
+    case HrStateStopping: return "Stopping...";
+    case HrStateStalled: return "Notifications stalled";
+    case HrStateReconnecting: return "Reconnecting...";
+    case HrStateCleanupError: return "Cleanup Error";
+    case HrStateError: return "Error";
+    default: return "Unknown state";
+    }
+}
+
+const char* StatusCategoryText(int32_t category) {
+    switch (category) {
+    case HrErrorNone: return "";
+    case HrErrorNoDevice: return "No HR device found.";
+    case HrErrorDeviceUnavailable: return "Failed to get BluetoothLEDevice object.";
+    case HrErrorServiceNotFound: return "HR Service not found.";
+    case HrErrorCharacteristicNotFound: return "HR Measurement Characteristic not found.";
+    case HrErrorSubscribeFailed: return "Failed to subscribe to HR notifications.";
+    case HrErrorMalformedData: return "HR Read Error: malformed measurement";
+    case HrErrorWinRt: return "BLE Error";
+    case HrErrorStd: return "Std Error";
+    case HrErrorThread: return "Worker thread error";
+    case HrErrorTimeout: return "Timed out";
+    default: return "Unknown error occurred.";
+    }
+}
+
+int FormatStatusEvent(const HrStatusEvent& evt, char* buffer, size_t length) {
+    if (!buffer || length == 0) {
+        return 0;
+    }
+    int written;
+    if (evt.category == HrErrorNone) {
+        written = snprintf(buffer, length, "%s", StatusStateText(evt.state));
+    }
+    else {
+        written = snprintf(buffer, length, "%s: %s", StatusStateText(evt.state), StatusCategoryText(evt.category));
+    }
+    if (written < 0) {
+        buffer[0] = '\0';
+        return 0;
+    }
+    size_t used = static_cast<size_t>(written) < length ? static_cast<size_t>(written) : length - 1;
+
+    if (evt.hresult != 0 && used + 16 < length) {
+        used += snprintf(buffer + used, length - used, " (0x%08X) ", static_cast<uint32_t>(evt.hresult));
+        // System message text straight into the caller's buffer, no allocation
+        DWORD chars = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+            nullptr, static_cast<DWORD>(evt.hresult), 0, buffer + used, static_cast<DWORD>(length - used), nullptr);
+        used += chars;
+        while (used > 0 && (buffer[used - 1] == '\n' || buffer[used - 1] == '\r' || buffer[used - 1] == ' ')) {
+            --used;
+        }
+        buffer[used] = '\0';
+    }
+    return static_cast<int>(used);
+}
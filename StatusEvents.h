@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include "BLEHeartRateMonitor.h"
+
+// Fixed-size queue of recent status events for hosts that poll instead of using callbacks.
+// Overwrites the oldest event when full, so it never allocates.
+class StatusEventQueue {
+public:
+    void Push(const HrStatusEvent& evt);
+    bool Pop(HrStatusEvent& out);
+    void Clear();
+
+private:
+    static constexpr size_t kCapacity = 64;
+    std::mutex m_mutex;
+    HrStatusEvent m_events[kCapacity] = {};
+    size_t m_head = 0; // Oldest event
+    size_t m_count = 0;
+};
+
+// Short descriptions; the state texts are the legacy StatusCallback messages
+const char* StatusStateText(int32_t state);
+const char* StatusCategoryText(int32_t category);
+
+// Writes a human-readable description of the event into buffer (always terminated).
+// Returns the number of characters written.
+int FormatStatusEvent(const HrStatusEvent& evt, char* buffer, size_t length);
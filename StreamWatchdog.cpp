@@ -0,0 +1,51 @@
+#include "pch.h"
+#include "StreamWatchdog.h"
+
+void StreamWatchdog::Reset(int64_t nowUs) {
+    m_lastNotificationUs.store(nowUs, std::memory_order_relaxed);
+    m_level = 0;
+}
+
+void StreamWatchdog::OnNotification(int64_t nowUs) {
+    m_lastNotificationUs.store(nowUs, std::memory_order_relaxed);
+}
+
+void StreamWatchdog::SetWarnAfterUs(int64_t warnAfterUs) {
+    m_warnAfterUs.store(warnAfterUs > 0 ? warnAfterUs : 0, std::memory_order_relaxed);
+}
+
+int64_t StreamWatchdog::WarnAfterUs(uint32_t nominalIntervalUs) const {
+    int64_t configured = m_warnAfterUs.load(std::memory_order_relaxed);
+    if (configured > 0) {
+        return configured;
+    }
+    int64_t derived = 3 * static_cast<int64_t>(nominalIntervalUs);
+    return derived > kMinWarnUs ? derived : kMinWarnUs;
+}
+
+WatchdogAction StreamWatchdog::Check(int64_t nowUs, uint32_t nominalIntervalUs) {
+    int64_t silence = nowUs - m_lastNotificationUs.load(std::memory_order_relaxed);
+    int64_t warn = WarnAfterUs(nominalIntervalUs);
+
+    if (silence < warn) {
+        if (m_level > 0) {
+            m_level = 0;
+            return WatchdogAction::Recovered;
+        }
+        return WatchdogAction::None;
+    }
+    // Each step doubles the deadline: warn at 1x, resubscribe at 2x, reconnect at 4x
+    if (m_level < 1) {
+        m_level = 1;
+        return WatchdogAction::Warn;
+    }
+    if (m_level < 2 && silence >= 2 * warn) {
+        m_level = 2;
+        return WatchdogAction::Resubscribe;
+    }
+    if (m_level < 3 && silence >= 4 * warn) {
+        m_level = 3;
+        return WatchdogAction::Reconnect;
+    }
+    return WatchdogAction::None;
+}
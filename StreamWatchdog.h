@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// What the session should do about a silent stream
+enum class WatchdogAction {
+    None,
+    Warn,         // Silence passed the warn deadline
+    Resubscribe,  // Still silent: rewrite the CCCD
+    Reconnect,    // Still silent: drop and re-establish the connection
+    Recovered,    // Notifications resumed after an escalation
+};
+
+// Notification-silence watchdog. OnNotification is called from the notification thread and is
+// a single atomic store; Check is called periodically from a timer and returns each escalation
+// step once per stall. Deadlines scale with the learned notification cadence.
+class StreamWatchdog {
+public:
+    void Reset(int64_t nowUs);
+    void OnNotification(int64_t nowUs);
+    WatchdogAction Check(int64_t nowUs, uint32_t nominalIntervalUs);
+
+    // 0 = derive from cadence (3 intervals, at least kMinWarnUs)
+    void SetWarnAfterUs(int64_t warnAfterUs);
+    int64_t WarnAfterUs(uint32_t nominalIntervalUs) const;
+    bool Escalated() const { return m_level > 0; }
+
+    static constexpr int64_t kMinWarnUs = 3000000;
+
+private:
+    std::atomic<int64_t> m_lastNotificationUs{ 0 };
+    std::atomic<int64_t> m_warnAfterUs{ 0 };
+    int m_level = 0; // Timer thread only: 0 healthy, then Warn/Resubscribe/Reconnect reached
+};
@@ -0,0 +1,227 @@
+#include "pch.h"
+#include "TimerWheel.h"
+#include <chrono>
+
+TimerWheel g_timers;
+
+TimerWheel::TimerWheel() {
+    for (auto& level : m_slots) {
+        for (auto& head : level) {
+            head.prev = head.next = &head;
+        }
+    }
+    m_expired.prev = m_expired.next = &m_expired;
+    m_nowMs = NowMs();
+    m_currentTick = m_nowMs / kTickMs;
+}
+
+uint64_t TimerWheel::NowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TimerWheel::Link(Timer& head, Timer& timer) {
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+void TimerWheel::Unlink(Timer& timer) {
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = timer.next = nullptr;
+}
+
+void TimerWheel::Reset(uint64_t nowMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& level : m_slots) {
+        for (auto& head : level) {
+            while (head.next != &head) {
+                Timer* timer = head.next;
+                Unlink(*timer);
+                timer->armed = false;
+            }
+        }
+    }
+    while (m_expired.next != &m_expired) {
+        Timer* timer = m_expired.next;
+        Unlink(*timer);
+        timer->armed = false;
+    }
+    m_count = 0;
+    m_nowMs = nowMs;
+    m_manualClock = true;
+    m_currentTick = nowMs / kTickMs;
+}
+
+uint64_t TimerWheel::CurrentMs() const {
+    if (m_manualClock) {
+        return m_nowMs;
+    }
+    uint64_t now = NowMs();
+    return now > m_nowMs ? now : m_nowMs;
+}
+
+void TimerWheel::Place(Timer& timer) {
+    if (timer.expiry <= m_currentTick) {
+        Link(m_expired, timer);
+        return;
+    }
+    uint64_t delta = timer.expiry - m_currentTick;
+    for (int level = 0; level < kLevels; ++level) {
+        if (delta < (uint64_t(1) << (kBits * (level + 1)))) {
+            size_t slot = (timer.expiry >> (kBits * level)) & (kSlots - 1);
+            Link(m_slots[level][slot], timer);
+            return;
+        }
+    }
+    // Beyond the top level: park in the furthest top-level slot and re-place on cascade
+    uint64_t parked = m_currentTick + (uint64_t(1) << (kBits * kLevels)) - 1;
+    size_t slot = (parked >> (kBits * (kLevels - 1))) & (kSlots - 1);
+    Link(m_slots[kLevels - 1][slot], timer);
+}
+
+void TimerWheel::Schedule(Timer& timer, uint64_t delayMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (timer.armed) {
+        Unlink(timer);
+        --m_count;
+    }
+    // m_currentTick lags the clock by up to a tick (more if the driver runs late), so count
+    // from the actual time and round up: Advance(t) only fires it once t >= now + delayMs
+    timer.expiry = (CurrentMs() + delayMs + kTickMs - 1) / kTickMs;
+    timer.armed = true;
+    Place(timer);
+    ++m_count;
+}
+
+void TimerWheel::Cancel(Timer& timer) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Wait out a running callback first, so a callback that re-arms itself is cancelled too
+    if (m_firing == &timer && m_firingThread != std::this_thread::get_id()) {
+        m_firingDone.wait(lock, [&] { return m_firing != &timer; });
+    }
+    if (timer.armed) {
+        Unlink(timer);
+        timer.armed = false;
+        --m_count;
+    }
+}
+
+bool TimerWheel::Armed(Timer const& timer) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return timer.armed;
+}
+
+size_t TimerWheel::Count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+void TimerWheel::Cascade(int level) {
+    size_t slot = (m_currentTick >> (kBits * level)) & (kSlots - 1);
+    Timer& head = m_slots[level][slot];
+    // Detach the whole slot first: re-placing can land timers back in this same slot
+    Timer pending;
+    pending.prev = pending.next = &pending;
+    if (head.next != &head) {
+        pending.next = head.next;
+        pending.prev = head.prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        head.prev = head.next = &head;
+    }
+    while (pending.next != &pending) {
+        Timer* timer = pending.next;
+        Unlink(*timer);
+        Place(*timer);
+    }
+}
+
+void TimerWheel::Advance(uint64_t nowMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_advancing) {
+        return; // The running Advance will pick up anything that became due
+    }
+    m_advancing = true;
+    if (nowMs > m_nowMs) {
+        m_nowMs = nowMs;
+    }
+    uint64_t target = nowMs / kTickMs;
+    while (m_currentTick < target) {
+        ++m_currentTick;
+        // Higher levels first, so their timers can still drop into the lower slots we cascade next
+        for (int level = kLevels - 1; level >= 1; --level) {
+            if ((m_currentTick & ((uint64_t(1) << (kBits * level)) - 1)) == 0) {
+                Cascade(level);
+            }
+        }
+        Timer& head = m_slots[0][m_currentTick & (kSlots - 1)];
+        while (head.next != &head) {
+            Timer* timer = head.next;
+            Unlink(*timer);
+            Link(m_expired, *timer);
+        }
+    }
+
+    // Fire one at a time without the lock, so callbacks may Schedule/Cancel freely
+    while (m_expired.next != &m_expired) {
+        Timer* timer = m_expired.next;
+        Unlink(*timer);
+        timer->armed = false;
+        --m_count;
+        Callback callback = timer->callback;
+        void* context = timer->context;
+        m_firing = timer;
+        m_firingThread = std::this_thread::get_id();
+        lock.unlock();
+        if (callback) {
+            callback(context);
+        }
+        lock.lock();
+        m_firing = nullptr;
+        m_firingThread = std::thread::id();
+        m_firingDone.notify_all();
+    }
+    m_advancing = false;
+}
+
+#ifdef _WIN32
+bool TimerWheel::StartDriver(PTP_CALLBACK_ENVIRON environment) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_driver) {
+        return true;
+    }
+    m_driver = CreateThreadpoolTimer(&DriverCallback, this, environment);
+    if (!m_driver) {
+        return false;
+    }
+    int64_t relative = -static_cast<int64_t>(kTickMs) * 10000; // 100 ns units, relative
+    FILETIME due{};
+    due.dwLowDateTime = static_cast<DWORD>(relative & 0xFFFFFFFF);
+    due.dwHighDateTime = static_cast<DWORD>(relative >> 32);
+    // Let the OS coalesce ticks a little; timers here are not that precise anyway
+    SetThreadpoolTimer(m_driver, &due, static_cast<DWORD>(kTickMs), static_cast<DWORD>(kTickMs / 2));
+    return true;
+}
+
+void TimerWheel::StopDriver() {
+    PTP_TIMER driver;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        driver = m_driver;
+        m_driver = nullptr;
+    }
+    if (driver) {
+        SetThreadpoolTimer(driver, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(driver, TRUE);
+        CloseThreadpoolTimer(driver);
+    }
+}
+
+void CALLBACK TimerWheel::DriverCallback(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER) {
+    auto wheel = static_cast<TimerWheel*>(context);
+    wheel->Advance(NowMs());
+}
+#endif
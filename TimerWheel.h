@@ -0,0 +1,88 @@
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Hierarchical timer wheel shared by all sessions: connect timeouts, watchdogs, reconnect
+// backoff, periodic flushes. Timers are intrusive nodes owned by the caller, so Schedule and
+// Cancel are O(1) and never allocate. 4 levels of 64 slots at 10 ms per tick cover ~46 hours;
+// longer delays are re-cascaded. Without the driver (e.g. under a virtual clock, or off
+// Windows) the owner calls Reset/Advance itself.
+// A timer never fires before delayMs has passed: its due time is rounded up to a tick boundary,
+// so it fires up to one tick (plus the driver's lateness) after that.
+class TimerWheel {
+public:
+    using Callback = void(*)(void* context);
+
+    struct Timer {
+        Callback callback = nullptr;
+        void* context = nullptr;
+        // Owned by the wheel
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t expiry = 0; // Tick
+        bool armed = false;
+    };
+
+    static constexpr uint64_t kTickMs = 10;
+
+    TimerWheel();
+
+    // Clears every timer and puts the wheel on the caller's clock: from here on "now" is the
+    // time last passed to Reset/Advance instead of NowMs
+    void Reset(uint64_t nowMs);
+    // (Re)arms timer to fire once, no earlier than delayMs from now
+    void Schedule(Timer& timer, uint64_t delayMs);
+    // Disarms timer. If its callback is running on another thread, waits for it to return,
+    // so the context can be freed right after Cancel.
+    void Cancel(Timer& timer);
+    bool Armed(Timer const& timer) const;
+    size_t Count() const;
+
+    // Fires every timer due at or before nowMs, on the calling thread
+    void Advance(uint64_t nowMs);
+
+#ifdef _WIN32
+    // Drives Advance from a thread-pool timer in the given environment (null = default pool)
+    bool StartDriver(PTP_CALLBACK_ENVIRON environment);
+    void StopDriver();
+#endif
+
+    static uint64_t NowMs();
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kBits = 6;
+    static constexpr int kSlots = 1 << kBits;
+
+    static void Link(Timer& head, Timer& timer);
+    static void Unlink(Timer& timer);
+    void Place(Timer& timer);  // Lock held
+    void Cascade(int level);   // Lock held
+    uint64_t CurrentMs() const; // Lock held
+#ifdef _WIN32
+    static void CALLBACK DriverCallback(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER);
+#endif
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_firingDone;
+    Timer m_slots[kLevels][kSlots]; // Circular list heads
+    Timer m_expired;                // Due, waiting to be fired
+    uint64_t m_currentTick = 0;
+    uint64_t m_nowMs = 0;           // Latest time passed to Reset/Advance
+    bool m_manualClock = false;     // Set by Reset: m_nowMs is the clock
+    size_t m_count = 0;
+    bool m_advancing = false;       // One Advance at a time; overlapping driver ticks just return
+    Timer* m_firing = nullptr;      // Callback currently running
+    std::thread::id m_firingThread;
+#ifdef _WIN32
+    PTP_TIMER m_driver = nullptr;
+#endif
+};
+
+extern TimerWheel g_timers;
@@ -0,0 +1,467 @@
+#include "pch.h"
+#include "WebSocketServer.h"
+#ifdef _WIN32
+#include <bcrypt.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "bcrypt.lib")
+#endif
+
+WebSocketServer g_webSocketServer;
+
+namespace {
+    constexpr char kAcceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    constexpr char kBadRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+    constexpr uint8_t kOpcodeClose = 0x8;
+    constexpr uint8_t kOpcodePing = 0x9;
+    constexpr uint8_t kOpcodePong = 0xA;
+
+    bool Sha1(const uint8_t* data, size_t length, uint8_t (&digest)[20]) {
+#ifdef _WIN32
+        return BCRYPT_SUCCESS(BCryptHash(BCRYPT_SHA1_ALG_HANDLE, nullptr, 0, const_cast<PUCHAR>(data),
+            static_cast<ULONG>(length), digest, sizeof(digest)));
+#else
+        // No system crypto library to lean on here; handshake keys are short, so plain FIPS 180-1
+        auto rotate = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        size_t padded = (length + 8) / 64 * 64 + 64;
+        for (size_t block = 0; block < padded; block += 64) {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i) {
+                w[i] = 0;
+                for (int b = 0; b < 4; ++b) {
+                    size_t at = block + 4 * static_cast<size_t>(i) + static_cast<size_t>(b);
+                    uint8_t byte = at < length ? data[at] : at == length ? 0x80 : 0;
+                    if (at >= padded - 8) {
+                        byte = static_cast<uint8_t>((static_cast<uint64_t>(length) * 8) >> (8 * (padded - 1 - at)));
+                    }
+                    w[i] = (w[i] << 8) | byte;
+                }
+            }
+            for (int i = 16; i < 80; ++i) {
+                w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f = i < 20 ? ((b & c) | (~b & d)) + 0x5A827999
+                    : i < 40 ? (b ^ c ^ d) + 0x6ED9EBA1
+                    : i < 60 ? ((b & c) | (b & d) | (c & d)) + 0x8F1BBCDC
+                    : (b ^ c ^ d) + 0xCA62C1D6;
+                uint32_t t = rotate(a, 5) + f + e + w[i];
+                e = d;
+                d = c;
+                c = rotate(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+        for (int i = 0; i < 20; ++i) {
+            digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+        }
+        return true;
+#endif
+    }
+
+    // Sec-WebSocket-Accept: base64(SHA-1(key + GUID)), 28 characters
+    bool ComputeAcceptKey(const char* key, size_t keyLength, char* out) {
+        char input[128];
+        if (keyLength == 0 || keyLength + sizeof(kAcceptGuid) > sizeof(input)) {
+            return false;
+        }
+        memcpy(input, key, keyLength);
+        memcpy(input + keyLength, kAcceptGuid, sizeof(kAcceptGuid) - 1);
+        uint8_t digest[20];
+        if (!Sha1(reinterpret_cast<const uint8_t*>(input), keyLength + sizeof(kAcceptGuid) - 1, digest)) {
+            return false;
+        }
+        static constexpr char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        char* p = out;
+        for (size_t i = 0; i < sizeof(digest); i += 3) {
+            uint32_t group = digest[i] << 16;
+            if (i + 1 < sizeof(digest)) group |= digest[i + 1] << 8;
+            if (i + 2 < sizeof(digest)) group |= digest[i + 2];
+            *p++ = kBase64[(group >> 18) & 63];
+            *p++ = kBase64[(group >> 12) & 63];
+            *p++ = i + 1 < sizeof(digest) ? kBase64[(group >> 6) & 63] : '=';
+            *p++ = i + 2 < sizeof(digest) ? kBase64[group & 63] : '=';
+        }
+        *p = '\0';
+        return true;
+    }
+
+    bool NameIs(const char* text, const char* name, size_t nameLength) {
+        for (size_t i = 0; i < nameLength; ++i) {
+            if (std::tolower(static_cast<unsigned char>(text[i])) != std::tolower(static_cast<unsigned char>(name[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Finds a header value in a request (case-insensitive name), trimmed. Null if absent.
+    const char* FindHeader(const char* request, const char* name, size_t& valueLength) {
+        size_t nameLength = strlen(name);
+        for (const char* line = strstr(request, "\r\n"); line; line = strstr(line, "\r\n")) {
+            line += 2;
+            if (NameIs(line, name, nameLength) && line[nameLength] == ':') {
+                const char* value = line + nameLength + 1;
+                while (*value == ' ' || *value == '\t') {
+                    ++value;
+                }
+                const char* end = strstr(value, "\r\n");
+                while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+                    --end;
+                }
+                valueLength = static_cast<size_t>(end - value);
+                return value;
+            }
+        }
+        return nullptr;
+    }
+}
+
+bool WebSocketServer::Start(uint16_t port, uint32_t cadenceMs, bool allInterfaces, NetLoopEnvironment environment) {
+    if (Running() || cadenceMs == 0) {
+        return false;
+    }
+    if (!NetStartup()) {
+        return false;
+    }
+    auto fail = [this] {
+        m_loop.Close();
+        CloseAll();
+        NetCleanup();
+        return false;
+    };
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(allInterfaces ? INADDR_ANY : INADDR_LOOPBACK);
+
+    m_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_listener == INVALID_SOCKET) {
+        return fail();
+    }
+    NetExclusiveAddress(m_listener);
+    if (bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR
+        || listen(m_listener, SOMAXCONN) == SOCKET_ERROR) {
+        return fail();
+    }
+
+    // Loop state is set before the loop can run a pass
+    m_cadenceMs = cadenceMs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingHead = 0;
+        m_pendingCount = 0;
+        m_batchLength = 0;
+        m_batchSequence = 0;
+    }
+    m_loopBatchLength = 0;
+    m_loopBatchSequence = 0;
+    m_samplesPublished = 0;
+    m_batchesDropped = 0;
+    if (!m_loop.Open(&OnPass, this, environment) || !m_loop.Watch(m_listener, NetLoop::NetAccept)) {
+        return fail();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running.store(true, std::memory_order_release);
+    }
+    m_flushTimer.callback = &OnFlush;
+    m_flushTimer.context = this;
+    g_timers.Schedule(m_flushTimer, cadenceMs);
+    return true;
+}
+
+void WebSocketServer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!Running()) {
+            return;
+        }
+        m_running.store(false, std::memory_order_release);
+    }
+    g_timers.Cancel(m_flushTimer);
+    m_loop.Close();
+    CloseAll();
+    NetCleanup();
+}
+
+void WebSocketServer::Publish(const HrSample& sample) {
+    if (!Running()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pendingCount == kMaxBatchSamples) {
+        m_pendingHead = (m_pendingHead + 1) % kMaxBatchSamples; // Overwrite the oldest
+        --m_pendingCount;
+    }
+    m_pending[(m_pendingHead + m_pendingCount) % kMaxBatchSamples] = sample;
+    ++m_pendingCount;
+    m_samplesPublished.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WebSocketServer::Snapshot(HrNetStats& out) const {
+    out.tcpClients = m_clientCount.load(std::memory_order_relaxed);
+    out.udpSubscribers = 0;
+    out.framesPublished = m_samplesPublished.load(std::memory_order_relaxed);
+    out.framesDropped = m_batchesDropped.load(std::memory_order_relaxed); // Batches skipped by slow clients
+}
+
+void WebSocketServer::OnFlush(void* context) {
+    auto server = static_cast<WebSocketServer*>(context);
+    server->BuildBatch();
+    if (server->Running()) {
+        g_timers.Schedule(server->m_flushTimer, server->m_cadenceMs);
+    }
+}
+
+// Turns the samples gathered since the last cadence into one binary message and wakes the loop
+void WebSocketServer::BuildBatch() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!Running() || m_pendingCount == 0) {
+        return;
+    }
+    size_t payload = 2;
+    for (size_t i = 0; i < m_pendingCount; ++i) {
+        payload += 34 + 2 * static_cast<size_t>(m_pending[(m_pendingHead + i) % kMaxBatchSamples].rrCount);
+    }
+    uint8_t* p = m_batch;
+    *p++ = 0x82; // FIN, binary
+    if (payload < 126) {
+        *p++ = static_cast<uint8_t>(payload);
+    }
+    else {
+        *p++ = 126;
+        *p++ = static_cast<uint8_t>(payload >> 8);
+        *p++ = static_cast<uint8_t>(payload);
+    }
+    *p++ = static_cast<uint8_t>(m_pendingCount);
+    *p++ = static_cast<uint8_t>(m_pendingCount >> 8);
+    uint8_t* end = m_batch + sizeof(m_batch);
+    for (size_t i = 0; i < m_pendingCount; ++i) {
+        p += EncodeSampleBinary(m_pending[(m_pendingHead + i) % kMaxBatchSamples], p, static_cast<size_t>(end - p));
+    }
+    m_batchLength = static_cast<size_t>(p - m_batch);
+    ++m_batchSequence;
+    m_pendingHead = 0;
+    m_pendingCount = 0;
+    m_loop.Wake();
+}
+
+void WebSocketServer::OnPass(void* context) {
+    static_cast<WebSocketServer*>(context)->RunLoop();
+}
+
+void WebSocketServer::RunLoop() {
+    uint64_t nowMs = TimerWheel::NowMs();
+    AcceptClients(nowMs);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_batchSequence != m_loopBatchSequence) {
+            memcpy(m_loopBatch, m_batch, m_batchLength);
+            m_loopBatchLength = m_batchLength;
+            m_loopBatchSequence = m_batchSequence;
+        }
+    }
+    for (auto& client : m_clients) {
+        bool keep = ReadClient(client) && FlushClient(client)
+            && (client.open || nowMs - client.acceptedMs < kHandshakeTimeoutMs);
+        if (!keep) {
+            closesocket(client.socket);
+            client.socket = INVALID_SOCKET;
+        }
+    }
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+        [](Client const& client) { return client.socket == INVALID_SOCKET; }), m_clients.end());
+    m_clientCount.store(static_cast<uint32_t>(m_clients.size()), std::memory_order_relaxed);
+}
+
+void WebSocketServer::AcceptClients(uint64_t nowMs) {
+    for (;;) {
+        SOCKET socket = accept(m_listener, nullptr, nullptr);
+        if (socket == INVALID_SOCKET) {
+            return;
+        }
+        NetNoDelay(socket);
+        if (m_clients.size() >= kMaxClients || !m_loop.Watch(socket, NetLoop::NetReadWrite)) {
+            closesocket(socket);
+            continue;
+        }
+        Client client;
+        client.socket = socket;
+        client.acceptedMs = nowMs;
+        client.in.reserve(kMaxRequestBytes);
+        client.out.reserve(kMaxBatchBytes); // Batches never reallocate after this
+        m_clients.push_back(std::move(client));
+    }
+}
+
+bool WebSocketServer::ReadClient(Client& client) {
+    uint8_t buffer[1024];
+    for (;;) {
+        int received = recv(client.socket, reinterpret_cast<char*>(buffer), sizeof(buffer), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received == SOCKET_ERROR) {
+            return NetWouldBlock();
+        }
+        if (client.closing) {
+            continue; // Answer already decided; drain
+        }
+        if (client.in.size() + static_cast<size_t>(received) > kMaxRequestBytes) {
+            return false; // Oversized handshake or a frame header we can't make sense of
+        }
+        client.in.insert(client.in.end(), buffer, buffer + received);
+        if (!(client.open ? ParseFrames(client) : Handshake(client))) {
+            return false;
+        }
+    }
+}
+
+bool WebSocketServer::Handshake(Client& client) {
+    client.in.push_back('\0');
+    const char* request = reinterpret_cast<const char*>(client.in.data());
+    const char* headerEnd = strstr(request, "\r\n\r\n");
+    if (!headerEnd) {
+        client.in.pop_back();
+        return true; // Wait for the rest of the request
+    }
+    size_t keyLength = 0;
+    const char* key = strncmp(request, "GET ", 4) == 0 ? FindHeader(request, "Sec-WebSocket-Key", keyLength) : nullptr;
+    char accept[32];
+    if (!key || !ComputeAcceptKey(key, keyLength, accept)) {
+        client.out.assign(kBadRequest, kBadRequest + sizeof(kBadRequest) - 1);
+        client.offset = 0;
+        client.closing = true;
+        return true;
+    }
+    static constexpr char kResponse[] = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+        "Connection: Upgrade\r\nSec-WebSocket-Accept: ";
+    client.out.assign(kResponse, kResponse + sizeof(kResponse) - 1);
+    client.out.insert(client.out.end(), accept, accept + strlen(accept));
+    client.out.insert(client.out.end(), { '\r', '\n', '\r', '\n' });
+    client.offset = 0;
+    client.open = true;
+    client.batch = m_loopBatchSequence; // Start with the next batch
+
+    // Anything after the request is already frame data
+    size_t consumed = static_cast<size_t>(headerEnd + 4 - request);
+    client.in.pop_back();
+    client.in.erase(client.in.begin(), client.in.begin() + consumed);
+    return ParseFrames(client);
+}
+
+// Dashboards don't send us anything meaningful; frames are skipped except for close and ping
+bool WebSocketServer::ParseFrames(Client& client) {
+    auto& in = client.in;
+    for (;;) {
+        if (client.skip > 0) {
+            size_t drop = static_cast<size_t>(std::min<uint64_t>(client.skip, in.size()));
+            in.erase(in.begin(), in.begin() + drop);
+            client.skip -= drop;
+        }
+        if (in.size() < 2) {
+            return true;
+        }
+        uint8_t opcode = in[0] & 0x0F;
+        uint64_t length = in[1] & 0x7F;
+        size_t header = 2 + (length == 126 ? 2 : length == 127 ? 8 : 0) + ((in[1] & 0x80) ? 4 : 0);
+        if (in.size() < header) {
+            return true;
+        }
+        if (length >= 126) {
+            size_t bytes = length == 126 ? 2 : 8;
+            length = 0;
+            for (size_t i = 0; i < bytes; ++i) {
+                length = (length << 8) | in[2 + i];
+            }
+        }
+        if (opcode == kOpcodeClose) {
+            client.closing = true; // Echo the close once the current message is out
+            in.clear();
+            return true;
+        }
+        if (opcode == kOpcodePing) {
+            if (length > kMaxControlPayload) {
+                return false; // Protocol error: control frames carry at most 125 bytes
+            }
+            if (in.size() < header + length) {
+                return true;
+            }
+            // Only the latest Ping needs an answer (RFC 6455 5.5.3); the payload comes back unmasked
+            const uint8_t* mask = (in[1] & 0x80) ? in.data() + header - 4 : nullptr;
+            client.pong[0] = 0x80 | kOpcodePong;
+            client.pong[1] = static_cast<uint8_t>(length);
+            for (size_t i = 0; i < length; ++i) {
+                client.pong[2 + i] = in[header + i] ^ (mask ? mask[i % 4] : 0);
+            }
+            client.pongLength = 2 + static_cast<size_t>(length);
+            in.erase(in.begin(), in.begin() + header + static_cast<size_t>(length));
+            continue;
+        }
+        in.erase(in.begin(), in.begin() + header);
+        client.skip = length;
+    }
+}
+
+bool WebSocketServer::FlushClient(Client& client) {
+    for (;;) {
+        if (client.offset < client.out.size()) {
+            int sent = send(client.socket, reinterpret_cast<const char*>(client.out.data()) + client.offset,
+                static_cast<int>(client.out.size() - client.offset), kNetSendFlags);
+            if (sent == SOCKET_ERROR) {
+                return NetWouldBlock(); // The loop runs again once the socket drains
+            }
+            client.offset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (client.closing) {
+            if (client.open) {
+                static constexpr uint8_t kCloseFrame[] = { 0x88, 0x00 };
+                send(client.socket, reinterpret_cast<const char*>(kCloseFrame), sizeof(kCloseFrame), kNetSendFlags);
+            }
+            return false;
+        }
+        if (client.pongLength > 0) {
+            // Control frames may go between messages, never inside one
+            client.out.assign(client.pong, client.pong + client.pongLength);
+            client.offset = 0;
+            client.pongLength = 0;
+            continue;
+        }
+        if (!client.open || client.batch == m_loopBatchSequence) {
+            return true;
+        }
+        // Coalesce: a client that missed batches while busy only gets the newest one
+        m_batchesDropped.fetch_add(m_loopBatchSequence - client.batch - 1, std::memory_order_relaxed);
+        client.out.assign(m_loopBatch, m_loopBatch + m_loopBatchLength);
+        client.offset = 0;
+        client.batch = m_loopBatchSequence;
+    }
+}
+
+void WebSocketServer::CloseAll() {
+    for (auto& client : m_clients) {
+        closesocket(client.socket);
+    }
+    m_clients.clear();
+    if (m_listener != INVALID_SOCKET) {
+        closesocket(m_listener);
+        m_listener = INVALID_SOCKET;
+    }
+    m_clientCount = 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "BLEHeartRateMonitor.h"
+#include "NetLoop.h"
+#include "NetPublisher.h"
+#include "TimerWheel.h"
+
+// --- WebSocket server for browser dashboards ---
+// Samples from every device are collected as they arrive and, every cadence, sent to each
+// open client as one binary message: u16 sample count, then that many NetPublisher binary
+// frames. Each client holds at most the message it is sending plus the newest batch; a client
+// still busy when the next batch is built skips straight to the newest one (counted as
+// dropped), so a slow browser costs a bounded buffer, never the notification thread.
+// Like NetPublisher, the sockets are served from a NetLoop. Pings are answered with a Pong
+// between messages; other client frames are skipped.
+class WebSocketServer {
+public:
+    bool Start(uint16_t port, uint32_t cadenceMs, bool allInterfaces, NetLoopEnvironment environment);
+    void Stop();
+    bool Running() const { return m_running.load(std::memory_order_acquire); }
+
+    void Publish(const HrSample& sample); // Any thread; only queues the sample
+    void Snapshot(HrNetStats& out) const; // tcpClients = open WebSocket clients
+
+private:
+    static constexpr size_t kMaxBatchSamples = 64; // Oldest are dropped beyond this per cadence
+    static constexpr size_t kMaxBatchBytes = 10 + 2 + kMaxBatchSamples * (34 + 2 * kHrSampleMaxRr);
+    static constexpr size_t kMaxClients = 1024;
+    static constexpr size_t kMaxRequestBytes = 2048;
+    static constexpr uint64_t kHandshakeTimeoutMs = 5000;
+    static constexpr size_t kMaxControlPayload = 125; // RFC 6455 5.5
+
+    struct Client {
+        SOCKET socket = INVALID_SOCKET;
+        bool open = false;         // Handshake done
+        bool closing = false;      // Close after out is flushed
+        uint64_t acceptedMs = 0;
+        std::vector<uint8_t> in;   // Handshake request, then partial frame headers
+        uint64_t skip = 0;         // Client payload bytes still to discard
+        std::vector<uint8_t> out;  // Message being sent
+        size_t offset = 0;
+        uint64_t batch = 0;        // Last batch copied into out
+        uint8_t pong[2 + kMaxControlPayload] = {}; // Answer to the latest Ping, sent after out
+        size_t pongLength = 0;
+    };
+
+    static void OnPass(void* context);
+    static void OnFlush(void* context);
+    void BuildBatch();
+    void RunLoop();
+    void AcceptClients(uint64_t nowMs);
+    bool ReadClient(Client& client);      // False if the client must be closed
+    bool Handshake(Client& client);
+    bool ParseFrames(Client& client);
+    bool FlushClient(Client& client);
+    void CloseAll();
+
+    std::atomic<bool> m_running{ false };
+    uint32_t m_cadenceMs = 0;
+    NetLoop m_loop;
+    SOCKET m_listener = INVALID_SOCKET;
+    TimerWheel::Timer m_flushTimer;
+
+    // Written by Publish and the flush timer
+    std::mutex m_mutex;
+    HrSample m_pending[kMaxBatchSamples] = {};
+    size_t m_pendingHead = 0;
+    size_t m_pendingCount = 0;
+    uint8_t m_batch[kMaxBatchBytes] = {}; // Latest complete WebSocket message
+    size_t m_batchLength = 0;
+    uint64_t m_batchSequence = 0;
+
+    // Loop only
+    uint8_t m_loopBatch[kMaxBatchBytes] = {};
+    size_t m_loopBatchLength = 0;
+    uint64_t m_loopBatchSequence = 0;
+    std::vector<Client> m_clients;
+
+    std::atomic<uint32_t> m_clientCount{ 0 };
+    std::atomic<uint64_t> m_samplesPublished{ 0 };
+    std::atomic<uint64_t> m_batchesDropped{ 0 };
+};
+
+extern WebSocketServer g_webSocketServer;
@@ -0,0 +1,128 @@
+// allocation_test: the streaming path must not allocate once warmed up. Streams notifications
+// from a fake strap through the real session engine (parse, link stats) into the latest-sample
+// table, the every-sample queue and the dispatcher with an every-sample, a coalesced and a
+// batched subscriber, all under AllocationTracker's counting operator new.
+//
+//   g++ -std=c++20 -O2 -pthread -DHR_TRACK_ALLOCATIONS -I.. -o allocation_test allocation_test.cpp
+//       ../AllocationTracker.cpp ../SessionEngine.cpp ../FakeTransport.cpp ../FaultInjector.cpp
+//       ../StartupProfile.cpp ../StreamWatchdog.cpp ../LinkStats.cpp ../TimerWheel.cpp
+//       ../LatestSamples.cpp ../SampleQueue.cpp ../SampleDispatcher.cpp
+//
+// Exit code 0 if nothing on the streaming path allocated after warm-up, 1 otherwise.
+#ifndef HR_TRACK_ALLOCATIONS
+#error allocation_test needs -DHR_TRACK_ALLOCATIONS
+#endif
+#include "AllocationTracker.h"
+#include "FakeTransport.h"
+#include "LatestSamples.h"
+#include "LinkStats.h"
+#include "SampleDispatcher.h"
+#include "SampleQueue.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include <cstdio>
+#include <memory>
+
+namespace {
+    constexpr uint64_t kStrap = 0xC0FFEE000001ull;
+    constexpr int kNotifications = 2000;
+
+    int g_failures = 0;
+    uint64_t g_delivered = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "allocation_test: %s\n", what);
+        ++g_failures;
+    }
+
+    void __stdcall OnSamples(const HrSample*, int count, void*) {
+        g_delivered += static_cast<uint64_t>(count);
+    }
+
+    // What the DLL's PublishSample does with a sample, minus the network and shared-memory sinks
+    class PipelineHost final : public SessionHost {
+    public:
+        explicit PipelineHost(SessionRuntime& runtime) : transport(std::make_shared<FakeTransport>(runtime, kStrap)) {}
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return transport; }
+        void OnStatus(HrState, HrErrorCategory, int32_t, uint64_t) override {}
+        void OnSample(const HrSample& sample) override {
+            latest.Store(sample);
+            queue.Push(sample);
+            dispatcher.Deliver(sample);
+        }
+
+        std::shared_ptr<FakeTransport> transport;
+        LatestSamples latest;
+        SampleQueue queue;
+        SampleDispatcher dispatcher;
+    };
+}
+
+int main() {
+    g_timers.Reset(0);
+    VirtualRuntime runtime;
+    PipelineHost host(runtime);
+    LinkStats stats;
+    StartupProfiler startup;
+    SessionEngine engine(runtime, host, stats, startup);
+    if (!host.queue.Reserve(1024)) {
+        Fail("could not reserve the queue");
+        return 1;
+    }
+    host.dispatcher.Add(&OnSamples, nullptr, HrDeliveryEverySample, 0);
+    host.dispatcher.Add(&OnSamples, nullptr, HrDeliveryCoalesce, 250);
+    host.dispatcher.Add(&OnSamples, nullptr, HrDeliveryBatch, 1000);
+
+    engine.Start(runtime.NowUs(), 1000);
+    runtime.AdvanceTo(1000000);
+    if (!host.transport->Subscribed()) {
+        Fail("never subscribed");
+        return 1;
+    }
+
+    // Varying payloads: RR counts, energy, 16-bit heart rate, the contact bits
+    uint8_t payloads[4][8] = {
+        { 0x10, 72, 0x00, 0x04 },
+        { 0x16, 75, 0x10, 0x04, 0x08, 0x04 },
+        { 0x19, 0x2C, 0x01, 0x20, 0x00, 0x00, 0x04 },
+        { 0x00, 80 },
+    };
+    const size_t lengths[4] = { 4, 6, 7, 2 };
+    HrSample popped{};
+    for (int i = 0; i < kNotifications; ++i) {
+        host.transport->Notify(payloads[i % 4], lengths[i % 4]);
+        runtime.AdvanceTo(runtime.NowUs() + 250000);
+        g_timers.Advance(static_cast<uint64_t>(runtime.NowUs() / 1000)); // Coalesced and batched deliveries
+        while (host.queue.Pop(popped)) {
+        }
+    }
+
+    HrAllocationStats allocations{};
+    AllocationStats(allocations);
+    if (g_delivered < kNotifications) {
+        Fail("samples did not reach the subscribers");
+    }
+    if (allocations.hotPathAllocations != 0) {
+        std::fprintf(stderr, "allocation_test: %llu allocations on the streaming path after warm-up\n",
+            static_cast<unsigned long long>(allocations.hotPathAllocations));
+        ++g_failures;
+    }
+
+    // The tracker itself: an allocation inside a warmed-up scope must be seen
+    {
+        HotPathScope scope;
+        delete new int(1);
+    }
+    AllocationStats(allocations);
+    if (allocations.hotPathAllocations == 0) {
+        Fail("tracker did not see an allocation on the streaming path");
+    }
+
+    engine.StopAsync();
+    runtime.AdvanceTo(runtime.NowUs() + 1000000);
+    if (g_failures == 0) {
+        std::printf("allocation_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// batchdecoder_bench: time per packet of decoding a recorded 0x2A37 stream packet by packet with
+// ParseHrMeasurement versus DecodeHrBatch with each kernel the CPU supports. The corpus mimics
+// real straps: mostly 8-bit HR with contact bits and one or two RR intervals, some energy
+// expended, a few 16-bit HR and the odd truncated packet.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o batchdecoder_bench batchdecoder_bench.cpp ../BatchDecoder.cpp
+//
+//   ./batchdecoder_bench [--packets N] [--rounds N]
+//
+// Prints one JSON object with the best round's ns per packet for each decoder.
+#include "BatchDecoder.h"
+#include "HrMeasurement.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Corpus {
+        std::vector<uint8_t> data;
+        std::vector<uint32_t> offsets{ 0 };
+    };
+
+    Corpus Generate(uint32_t packets) {
+        std::mt19937 rng(42);
+        Corpus corpus;
+        for (uint32_t i = 0; i < packets; ++i) {
+            uint32_t r = rng() % 100;
+            uint8_t flags = kHrFlagContactSupported | kHrFlagContactDetected | kHrFlagRrPresent;
+            if (r < 10) {
+                flags |= kHrFlagEnergyExpended;
+            }
+            else if (r < 13) {
+                flags |= kHrFlagValueUInt16;
+            }
+            corpus.data.push_back(flags);
+            corpus.data.push_back(static_cast<uint8_t>(60 + rng() % 120));
+            if (flags & kHrFlagValueUInt16) {
+                corpus.data.push_back(0);
+            }
+            if (flags & kHrFlagEnergyExpended) {
+                corpus.data.push_back(static_cast<uint8_t>(i));
+                corpus.data.push_back(static_cast<uint8_t>(i >> 8));
+            }
+            int rrCount = 1 + static_cast<int>(rng() % 2);
+            for (int k = 0; k < rrCount; ++k) {
+                uint16_t rr = static_cast<uint16_t>(600 + rng() % 500);
+                corpus.data.push_back(static_cast<uint8_t>(rr));
+                corpus.data.push_back(static_cast<uint8_t>(rr >> 8));
+            }
+            if (r == 99) {
+                corpus.data.pop_back(); // Cut mid-interval
+            }
+            corpus.offsets.push_back(static_cast<uint32_t>(corpus.data.size()));
+        }
+        return corpus;
+    }
+
+    struct Output {
+        std::vector<uint16_t> bpm, energy, rr;
+        std::vector<uint8_t> flags, valid;
+        std::vector<uint32_t> rrStart;
+    };
+
+    double NsPerPacket(Clock::duration elapsed, size_t packets) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+            / static_cast<double>(packets);
+    }
+
+    // The per-packet loop a host would write against the live parser, filling the same arrays
+    double ParserRound(const Corpus& corpus, Output& out) {
+        size_t count = corpus.offsets.size() - 1;
+        Clock::time_point begin = Clock::now();
+        uint32_t rrUsed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            HrMeasurement m;
+            bool ok = ParseHrMeasurement(corpus.data.data() + corpus.offsets[i], corpus.offsets[i + 1] - corpus.offsets[i], m);
+            out.bpm[i] = ok ? m.bpm : 0;
+            out.energy[i] = ok ? m.energyExpended : 0;
+            out.flags[i] = corpus.data[corpus.offsets[i]];
+            out.valid[i] = ok ? 1 : 0;
+            out.rrStart[i] = rrUsed;
+            if (ok) {
+                std::memcpy(out.rr.data() + rrUsed, m.rr, m.rrCount * sizeof(uint16_t));
+                rrUsed += m.rrCount;
+            }
+        }
+        out.rrStart[count] = rrUsed;
+        return NsPerPacket(Clock::now() - begin, count);
+    }
+
+    double BatchRound(const Corpus& corpus, Output& out, BatchDecoderKind kind) {
+        int count = static_cast<int>(corpus.offsets.size()) - 1;
+        HrBatchOutput batch{ out.bpm.data(), out.energy.data(), out.flags.data(), out.valid.data(), out.rrStart.data(),
+            out.rr.data(), static_cast<uint32_t>(out.rr.size()), 0 };
+        Clock::time_point begin = Clock::now();
+        int decoded = DecodeHrBatch(corpus.data.data(), corpus.data.size(), corpus.offsets.data(), count, batch, kind);
+        double ns = NsPerPacket(Clock::now() - begin, static_cast<size_t>(count));
+        if (decoded != count) {
+            std::fprintf(stderr, "batchdecoder_bench: kind %d stopped at %d of %d\n", static_cast<int>(kind), decoded, count);
+            std::exit(2);
+        }
+        return ns;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t packets = 1000000;
+    int rounds = 20;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--packets")) {
+            packets = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--rounds")) {
+            rounds = std::atoi(argv[i + 1]);
+        }
+    }
+    if (packets == 0 || rounds <= 0) {
+        std::fprintf(stderr, "usage: batchdecoder_bench [--packets N] [--rounds N]\n");
+        return 1;
+    }
+    Corpus corpus = Generate(packets);
+    Output out;
+    out.bpm.resize(packets);
+    out.energy.resize(packets);
+    out.flags.resize(packets);
+    out.valid.resize(packets);
+    out.rrStart.resize(packets + 1);
+    out.rr.resize(static_cast<size_t>(packets) * kMaxRrIntervals);
+
+    BatchDecoderKind supported = SelectedBatchDecoder();
+    double best[4] = { 1e30, 1e30, 1e30, 1e30 }; // Parser, scalar, SSE2, AVX2
+    for (int round = 0; round < rounds; ++round) {
+        best[0] = std::min(best[0], ParserRound(corpus, out));
+        for (int kind = 0; kind <= static_cast<int>(supported); ++kind) {
+            best[kind + 1] = std::min(best[kind + 1], BatchRound(corpus, out, static_cast<BatchDecoderKind>(kind)));
+        }
+    }
+    std::printf("{\"packets\":%u,\"rounds\":%d,\"selected\":%d,\"nsPerPacket\":{\"parser\":%.2f,\"scalar\":%.2f",
+        packets, rounds, static_cast<int>(supported), best[0], best[1]);
+    if (supported >= BatchDecoderKind::Sse2) {
+        std::printf(",\"sse2\":%.2f", best[2]);
+    }
+    if (supported >= BatchDecoderKind::Avx2) {
+        std::printf(",\"avx2\":%.2f", best[3]);
+    }
+    std::printf("}}\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+// batchdecoder_test: every DecodeHrBatch kernel the CPU supports gives exactly what
+// ParseHrMeasurement gives packet by packet, on random and malformed payloads, including when
+// the RR pool fills up part way.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o batchdecoder_test batchdecoder_test.cpp ../BatchDecoder.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "BatchDecoder.h"
+#include "HrMeasurement.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Corpus {
+        std::vector<uint8_t> data;
+        std::vector<uint32_t> offsets{ 0 };
+    };
+
+    Corpus Generate(uint32_t packets, uint32_t seed) {
+        std::mt19937 rng(seed);
+        Corpus corpus;
+        for (uint32_t i = 0; i < packets; ++i) {
+            uint32_t r = rng();
+            size_t length = r % 5 == 0 ? rng() % 48 : 0; // Every fifth packet is random bytes of any length
+            if (length == 0 && r % 5 != 0) {
+                uint8_t flags = static_cast<uint8_t>(rng());
+                length = 1 + ((flags & kHrFlagValueUInt16) ? 2 : 1) + ((flags & kHrFlagEnergyExpended) ? 2 : 0)
+                    + ((flags & kHrFlagRrPresent) ? 2 * (rng() % 20) : 0);
+                corpus.data.push_back(flags);
+                --length;
+            }
+            for (size_t k = 0; k < length; ++k) {
+                corpus.data.push_back(static_cast<uint8_t>(rng()));
+            }
+            corpus.offsets.push_back(static_cast<uint32_t>(corpus.data.size()));
+        }
+        return corpus;
+    }
+
+    // Decodes the whole corpus with kind, restarting with a fresh RR pool whenever it fills
+    int Check(const Corpus& corpus, BatchDecoderKind kind, uint32_t rrCapacity) {
+        int count = static_cast<int>(corpus.offsets.size()) - 1;
+        std::vector<uint16_t> bpm(count), energy(count), rr(rrCapacity);
+        std::vector<uint8_t> flags(count), valid(count);
+        std::vector<uint32_t> rrStart(count + 1);
+        int failures = 0;
+        for (int first = 0; first < count;) {
+            HrBatchOutput out{ bpm.data() + first, energy.data() + first, flags.data() + first, valid.data() + first,
+                rrStart.data() + first, rr.data(), rrCapacity, 0 };
+            int decoded = DecodeHrBatch(corpus.data.data(), corpus.data.size(), corpus.offsets.data() + first,
+                count - first, out, kind);
+            if (decoded <= 0) {
+                std::fprintf(stderr, "batchdecoder_test: kind %d made no progress at packet %d\n", static_cast<int>(kind), first);
+                return failures + 1;
+            }
+            uint32_t base = rrStart[first];
+            for (int i = first; i < first + decoded; ++i) {
+                HrMeasurement m;
+                uint32_t length = corpus.offsets[i + 1] - corpus.offsets[i];
+                bool ok = ParseHrMeasurement(corpus.data.data() + corpus.offsets[i], length, m);
+                uint32_t rrCount = rrStart[i + 1] - rrStart[i];
+                bool same = valid[i] == (ok ? 1 : 0) && bpm[i] == (ok ? m.bpm : 0) && energy[i] == (ok ? m.energyExpended : 0)
+                    && flags[i] == (length > 0 ? corpus.data[corpus.offsets[i]] : 0) && rrCount == (ok ? m.rrCount : 0);
+                for (uint32_t k = 0; same && k < rrCount; ++k) {
+                    same = rr[rrStart[i] - base + k] == m.rr[k];
+                }
+                if (!same && failures++ < 5) {
+                    std::fprintf(stderr, "batchdecoder_test: kind %d differs from the parser at packet %d\n",
+                        static_cast<int>(kind), i);
+                }
+            }
+            first += decoded;
+        }
+        return failures;
+    }
+}
+
+int main() {
+    int failures = 0;
+    BatchDecoderKind supported = SelectedBatchDecoder();
+    std::printf("batchdecoder_test: cpu supports kind %d\n", static_cast<int>(supported));
+    for (uint32_t seed = 1; seed <= 4; ++seed) {
+        Corpus corpus = Generate(20000, seed);
+        for (int kind = 0; kind <= static_cast<int>(supported); ++kind) {
+            failures += Check(corpus, static_cast<BatchDecoderKind>(kind), 1 << 20);
+            failures += Check(corpus, static_cast<BatchDecoderKind>(kind), 300); // Pool fills every few dozen packets
+        }
+    }
+    if (failures == 0) {
+        std::printf("batchdecoder_test: ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// capture_replay: runs a capture file (StartCapture, loadgen --capture) through ReplayCapture
+// and the live parser, to reproduce a strap's misbehaviour off Windows and as a regression
+// benchmark on real traffic. Prints per-device packet, parse failure and bpm/RR figures, and
+// the replay cost: the best of --rounds full replays (file read, record decode and parse).
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o capture_replay capture_replay.cpp
+//
+//   ./capture_replay FILE [--rounds 5] [--dump]
+//
+// --dump also prints every record, one per line, before the report (timestamp relative to the
+// first record, device, then the parsed packet or the status event).
+// Prints one JSON object. Exit code 0 on success, 1 on bad arguments, 2 if the file can't be
+// read, 3 if it ends mid-record (the report still covers everything before that).
+#include "CaptureFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct DeviceReport {
+        uint64_t address = 0;
+        uint64_t packets = 0;
+        uint64_t parseFailures = 0;
+        uint64_t rrIntervals = 0;
+        uint64_t bpmSum = 0;
+        uint16_t bpmMin = 0xFFFF;
+        uint16_t bpmMax = 0;
+        int64_t firstUs = 0;
+        int64_t lastUs = 0;
+    };
+
+    DeviceReport& Find(std::vector<DeviceReport>& devices, uint64_t address) {
+        for (DeviceReport& device : devices) {
+            if (device.address == address) {
+                return device;
+            }
+        }
+        devices.push_back({});
+        devices.back().address = address;
+        return devices.back();
+    }
+
+    void Usage() {
+        std::fprintf(stderr, "usage: capture_replay FILE [--rounds N] [--dump]\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    int rounds = 5;
+    bool dump = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--rounds") && i + 1 < argc) {
+            rounds = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (!std::strcmp(argv[i], "--dump")) {
+            dump = true;
+        }
+        else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        }
+        else {
+            Usage();
+            return 1;
+        }
+    }
+    if (!path) {
+        Usage();
+        return 1;
+    }
+
+    // One pass for the report
+    std::vector<DeviceReport> devices;
+    uint64_t statuses = 0;
+    int64_t firstUs = 0;
+    bool first = true;
+    int64_t notifications = ReplayCapture(path,
+        [&](const CaptureEvent& event, const HrMeasurement& measurement, bool parsed) {
+            if (first) {
+                firstUs = event.timestampUs;
+                first = false;
+            }
+            DeviceReport& device = Find(devices, event.deviceAddress);
+            if (device.packets++ == 0) {
+                device.firstUs = event.timestampUs;
+            }
+            device.lastUs = event.timestampUs;
+            if (!parsed) {
+                ++device.parseFailures;
+            }
+            else {
+                device.bpmSum += measurement.bpm;
+                device.bpmMin = std::min(device.bpmMin, measurement.bpm);
+                device.bpmMax = std::max(device.bpmMax, measurement.bpm);
+                device.rrIntervals += measurement.rrCount;
+            }
+            if (dump) {
+                std::printf("%lld %012llX", static_cast<long long>(event.timestampUs - firstUs),
+                    static_cast<unsigned long long>(event.deviceAddress));
+                if (parsed) {
+                    std::printf(" flags 0x%02X bpm %u", measurement.flags, measurement.bpm);
+                    for (uint8_t i = 0; i < measurement.rrCount; ++i) {
+                        std::printf(" rr %u", measurement.rr[i]);
+                    }
+                    std::printf("\n");
+                }
+                else {
+                    std::printf(" unparsable:");
+                    for (uint16_t i = 0; i < event.length; ++i) {
+                        std::printf(" %02X", event.payload[i]);
+                    }
+                    std::printf("\n");
+                }
+            }
+        },
+        [&](const CaptureEvent& event) {
+            if (first) {
+                firstUs = event.timestampUs;
+                first = false;
+            }
+            ++statuses;
+            int32_t state, category, hresult;
+            if (dump && ReadCaptureStatus(event, state, category, hresult)) {
+                std::printf("%lld %012llX status state %d category %d hresult 0x%08X\n",
+                    static_cast<long long>(event.timestampUs - firstUs), static_cast<unsigned long long>(event.deviceAddress),
+                    state, category, static_cast<uint32_t>(hresult));
+            }
+        });
+    if (notifications < 0) {
+        std::fprintf(stderr, "capture_replay: cannot read %s\n", path);
+        return 2;
+    }
+    bool truncated = false;
+    {
+        CaptureReader reader;
+        CaptureEvent event;
+        if (reader.Open(path)) {
+            while (reader.Next(event)) {
+            }
+            truncated = reader.Truncated();
+        }
+    }
+
+    // Timed passes: the regression figure is the best round
+    int64_t bestNs = 0;
+    uint64_t checksum = 0; // Keeps the parse from being optimised away
+    for (int round = 0; round < rounds; ++round) {
+        auto start = Clock::now();
+        ReplayCapture(path,
+            [&](const CaptureEvent&, const HrMeasurement& measurement, bool parsed) {
+                checksum += parsed ? measurement.bpm + measurement.rrCount : 1;
+            },
+            [&](const CaptureEvent&) { ++checksum; });
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        if (round == 0 || ns < bestNs) {
+            bestNs = ns;
+        }
+    }
+
+    std::printf("{\"file\":\"%s\",\"notifications\":%lld,\"statuses\":%llu,\"truncated\":%s,"
+        "\"rounds\":%d,\"replay_ns\":%lld,\"ns_per_notification\":%.1f,\"checksum\":%llu,\"devices\":[",
+        path, static_cast<long long>(notifications), static_cast<unsigned long long>(statuses),
+        truncated ? "true" : "false", rounds, static_cast<long long>(bestNs),
+        notifications > 0 ? static_cast<double>(bestNs) / static_cast<double>(notifications) : 0.0,
+        static_cast<unsigned long long>(checksum));
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const DeviceReport& device = devices[i];
+        uint64_t parsed = device.packets - device.parseFailures;
+        std::printf("%s{\"device\":\"%012llX\",\"packets\":%llu,\"parse_failures\":%llu,\"bpm_min\":%u,"
+            "\"bpm_max\":%u,\"bpm_mean\":%.1f,\"rr_intervals\":%llu,\"span_us\":%lld}", i ? "," : "",
+            static_cast<unsigned long long>(device.address), static_cast<unsigned long long>(device.packets),
+            static_cast<unsigned long long>(device.parseFailures), parsed ? device.bpmMin : 0u, device.bpmMax,
+            parsed ? static_cast<double>(device.bpmSum) / static_cast<double>(parsed) : 0.0,
+            static_cast<unsigned long long>(device.rrIntervals), static_cast<long long>(device.lastUs - device.firstUs));
+    }
+    std::printf("]}\n");
+    return truncated ? 3 : 0;
+}
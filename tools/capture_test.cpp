@@ -0,0 +1,321 @@
+// capture_test: round trip of the raw notification capture. Records go in through
+// CaptureWriter (the same writer the DLL and loadgen use) and come back out through
+// CaptureReader and ReplayCapture, which must return every payload byte for byte with its
+// timestamp and device: two straps interleaved with status events, clock jumps of more than
+// 2^31 us either way (Clock records), a payload over the ATT maximum, more devices than the
+// 255-entry device table (indexes get reassigned), and files cut off mid-record.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o capture_test capture_test.cpp ../CaptureWriter.cpp ../TimerWheel.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "CaptureFile.h"
+#include "CaptureWriter.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr uint64_t kStrapA = 0xC0FFEE000001ull;
+    constexpr uint64_t kStrapB = 0x0000DEADBEEFull;
+    constexpr int kRecords = 200000;
+    constexpr size_t kMaxPayload = 512; // CaptureWriter truncates to the largest ATT value
+
+    int g_failures = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "capture_test: %s\n", what);
+        ++g_failures;
+    }
+
+    // What a record should read back as
+    struct Expected {
+        uint8_t type;
+        int64_t timestampUs;
+        uint64_t deviceAddress;
+        std::vector<uint8_t> payload;
+    };
+
+    std::string TempPath(const char* name) {
+        return "/tmp/capture_test_" + std::to_string(static_cast<int>(getpid())) + "_" + name + ".hrcap";
+    }
+
+    // A plausible 0x2A37 value: uint8 or uint16 HR, maybe energy, 0-4 RR intervals; now and
+    // then cut short, which the parser must reject rather than the capture fix up
+    std::vector<uint8_t> MakeNotification(std::mt19937& random) {
+        std::vector<uint8_t> value;
+        uint8_t flags = static_cast<uint8_t>(random() & (kHrFlagValueUInt16 | kHrFlagContactDetected
+            | kHrFlagContactSupported | kHrFlagEnergyExpended | kHrFlagRrPresent));
+        value.push_back(flags);
+        value.push_back(static_cast<uint8_t>(40 + random() % 160));
+        if (flags & kHrFlagValueUInt16) {
+            value.push_back(0);
+        }
+        if (flags & kHrFlagEnergyExpended) {
+            value.push_back(static_cast<uint8_t>(random()));
+            value.push_back(static_cast<uint8_t>(random()));
+        }
+        if (flags & kHrFlagRrPresent) {
+            for (uint32_t i = 1 + random() % 4; i > 0; --i) {
+                uint16_t rr = static_cast<uint16_t>(600 + random() % 600);
+                value.push_back(static_cast<uint8_t>(rr));
+                value.push_back(static_cast<uint8_t>(rr >> 8));
+            }
+        }
+        if (random() % 50 == 0) {
+            value.resize(1 + random() % (value.size() - 1));
+        }
+        return value;
+    }
+
+    std::vector<uint8_t> StatusPayload(int32_t state, int32_t category, int32_t hresult) {
+        std::vector<uint8_t> payload(12);
+        const int32_t fields[3] = { state, category, hresult };
+        for (int i = 0; i < 3; ++i) {
+            for (int b = 0; b < 4; ++b) {
+                payload[4 * i + b] = static_cast<uint8_t>(static_cast<uint32_t>(fields[i]) >> (8 * b));
+            }
+        }
+        return payload;
+    }
+
+    // Records through the writer, pausing now and then so its flushes keep up (a dropped record
+    // would make the expected list wrong)
+    bool Write(const std::string& path, int64_t startUs, const std::vector<Expected>& records) {
+        CaptureWriter writer;
+        if (!writer.Start(path.c_str(), startUs)) {
+            return false;
+        }
+        for (size_t i = 0; i < records.size(); ++i) {
+            const Expected& record = records[i];
+            if (record.type == CaptureRecordStatus) {
+                int32_t state, category, hresult;
+                CaptureEvent event{ CaptureRecordStatus, 0, 0, record.payload.data(), 12 };
+                ReadCaptureStatus(event, state, category, hresult);
+                writer.RecordStatus(record.deviceAddress, record.timestampUs, state, category, hresult);
+            }
+            else {
+                writer.RecordNotification(record.deviceAddress, record.timestampUs, record.payload.data(),
+                    record.payload.size());
+            }
+            if (i % 2000 == 1999) {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        }
+        writer.Stop();
+        HrCaptureStats stats;
+        writer.Snapshot(stats);
+        if (stats.records != records.size() || stats.dropped != 0 || stats.writeFailed != 0) {
+            std::fprintf(stderr, "capture_test: %llu recorded, %llu dropped, write failed %u\n",
+                static_cast<unsigned long long>(stats.records), static_cast<unsigned long long>(stats.dropped),
+                stats.writeFailed);
+            return false;
+        }
+        return true;
+    }
+
+    // Reads path back and compares it with the first count records: the index of the first
+    // mismatch, count if they all matched and the file ends there, count + 1 if it goes on
+    size_t Compare(const std::string& path, const std::vector<Expected>& records, size_t count, bool& truncated) {
+        CaptureReader reader;
+        truncated = false;
+        if (!reader.Open(path.c_str())) {
+            return 0;
+        }
+        CaptureEvent event;
+        for (size_t i = 0; i < count; ++i) {
+            const Expected& record = records[i];
+            size_t length = record.payload.size() < kMaxPayload ? record.payload.size() : kMaxPayload;
+            if (!reader.Next(event) || event.type != record.type || event.timestampUs != record.timestampUs
+                || event.deviceAddress != record.deviceAddress || event.length != length
+                || (length > 0 && std::memcmp(event.payload, record.payload.data(), length) != 0)) {
+                return i;
+            }
+        }
+        if (reader.Next(event)) {
+            return count + 1;
+        }
+        truncated = reader.Truncated();
+        return count;
+    }
+
+    std::vector<uint8_t> ReadFile(const std::string& path) {
+        std::vector<uint8_t> bytes;
+        if (std::FILE* file = std::fopen(path.c_str(), "rb")) {
+            uint8_t chunk[65536];
+            size_t got;
+            while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+                bytes.insert(bytes.end(), chunk, chunk + got);
+            }
+            std::fclose(file);
+        }
+        return bytes;
+    }
+
+    void WriteFile(const std::string& path, const uint8_t* data, size_t length) {
+        if (std::FILE* file = std::fopen(path.c_str(), "wb")) {
+            std::fwrite(data, 1, length, file);
+            std::fclose(file);
+        }
+    }
+
+    void CheckRoundTrip() {
+        std::mt19937 random(43);
+        std::vector<Expected> records;
+        records.reserve(kRecords + 8);
+        const int64_t startUs = 5000000;
+        int64_t nowUs = startUs;
+        for (int i = 0; i < kRecords; ++i) {
+            nowUs += 250000 + static_cast<int64_t>(random() % 20000) - 10000; // Jitter; never backwards
+            if (i == kRecords / 3) {
+                nowUs += 3000000000ll; // Laptop asleep for 50 minutes: past a 32-bit delta
+            }
+            else if (i == kRecords / 2) {
+                nowUs -= 2500000000ll; // And a big step back (another clock source)
+            }
+            if (i % 97 == 0) {
+                uint64_t device = i % 2 ? kStrapA : (i % 3 ? kStrapB : 0); // Some before a device is known
+                records.push_back({ CaptureRecordStatus, nowUs, device,
+                    StatusPayload(i % 7, i % 5, static_cast<int32_t>(0x80000000u + static_cast<uint32_t>(i))) });
+            }
+            else {
+                records.push_back({ CaptureRecordNotification, nowUs, i % 2 ? kStrapA : kStrapB, MakeNotification(random) });
+            }
+        }
+        // Larger than any ATT value: kept up to the first 512 bytes
+        std::vector<uint8_t> oversized(700);
+        for (size_t i = 0; i < oversized.size(); ++i) {
+            oversized[i] = static_cast<uint8_t>(i * 7);
+        }
+        records.push_back({ CaptureRecordNotification, nowUs + 1000, kStrapA, oversized });
+
+        std::string path = TempPath("roundtrip");
+        if (!Write(path, startUs, records)) {
+            Fail("CaptureWriter did not record every record");
+            std::remove(path.c_str());
+            return;
+        }
+        bool truncated;
+        size_t matched = Compare(path, records, records.size(), truncated);
+        if (matched != records.size()) {
+            std::fprintf(stderr, "capture_test: record %zu of %zu differs\n", matched, records.size());
+            Fail("round trip does not return what was recorded");
+        }
+        if (truncated) {
+            Fail("a complete capture reads as truncated");
+        }
+
+        // The replay path: every notification through ParseHrMeasurement, in order
+        size_t next = 0;
+        int mismatches = 0;
+        int statuses = 0;
+        int64_t notifications = ReplayCapture(path.c_str(),
+            [&](const CaptureEvent& event, const HrMeasurement& measurement, bool parsed) {
+                while (next < records.size() && records[next].type != CaptureRecordNotification) {
+                    ++next;
+                }
+                const Expected& record = records[next++];
+                HrMeasurement expected;
+                size_t length = record.payload.size() < kMaxPayload ? record.payload.size() : kMaxPayload;
+                bool expectParsed = ParseHrMeasurement(record.payload.data(), length, expected);
+                if (parsed != expectParsed || event.timestampUs != record.timestampUs
+                    || (parsed && (measurement.bpm != expected.bpm || measurement.rrCount != expected.rrCount
+                        || std::memcmp(measurement.rr, expected.rr, sizeof(expected.rr)) != 0))) {
+                    ++mismatches;
+                }
+            },
+            [&](const CaptureEvent& event) {
+                int32_t state, category, hresult;
+                if (ReadCaptureStatus(event, state, category, hresult)) {
+                    ++statuses;
+                }
+            });
+        int64_t expectedNotifications = 0;
+        for (const Expected& record : records) {
+            expectedNotifications += record.type == CaptureRecordNotification ? 1 : 0;
+        }
+        if (notifications != expectedNotifications || mismatches != 0
+            || statuses != static_cast<int>(records.size() - expectedNotifications)) {
+            std::fprintf(stderr, "capture_test: replay gave %lld notifications (%lld expected), %d mismatched, %d statuses\n",
+                static_cast<long long>(notifications), static_cast<long long>(expectedNotifications), mismatches, statuses);
+            Fail("ReplayCapture does not match the recorded packets");
+        }
+
+        // Cut off mid-payload and mid-header: everything before the cut, then Truncated
+        std::vector<uint8_t> bytes = ReadFile(path);
+        std::string cutPath = TempPath("cut");
+        const size_t lastRecord = kCaptureRecordHeaderBytes + kMaxPayload;
+        const size_t cuts[] = { bytes.size() - 3, bytes.size() - lastRecord + 4 };
+        for (size_t cut : cuts) {
+            WriteFile(cutPath, bytes.data(), cut);
+            matched = Compare(cutPath, records, records.size() - 1, truncated);
+            if (matched != records.size() - 1 || !truncated) {
+                std::fprintf(stderr, "capture_test: cut at %zu of %zu bytes: %zu records, truncated %d\n", cut,
+                    bytes.size(), matched, truncated ? 1 : 0);
+                Fail("a capture cut off mid-record is not read up to the cut and flagged");
+            }
+        }
+        // A header on its own is a valid empty capture; less than that is not a capture
+        WriteFile(cutPath, bytes.data(), sizeof(CaptureFileHeader));
+        CaptureReader reader;
+        CaptureEvent event;
+        if (!reader.Open(cutPath.c_str()) || reader.Next(event) || reader.Truncated()) {
+            Fail("an empty capture does not read as empty");
+        }
+        WriteFile(cutPath, bytes.data(), sizeof(CaptureFileHeader) - 1);
+        if (reader.Open(cutPath.c_str())) {
+            Fail("a partial file header opens");
+        }
+        std::remove(cutPath.c_str());
+        std::remove(path.c_str());
+    }
+
+    // 300 straps, more than the 255 device indexes: the writer starts reassigning indexes and
+    // the reader must follow, including for straps seen again after their index was reused
+    void CheckDeviceTableWrap() {
+        std::vector<Expected> records;
+        int64_t nowUs = 1000;
+        const uint8_t value[2] = { 0x00, 72 };
+        auto add = [&](uint64_t device) {
+            nowUs += 1000;
+            records.push_back({ CaptureRecordNotification, nowUs, device, std::vector<uint8_t>(value, value + 2) });
+        };
+        for (uint64_t i = 0; i < 300; ++i) {
+            add(0xA00000000000ull + i);
+        }
+        const uint64_t revisit[] = { 0, 299, 10, 254, 255, 44, 0 };
+        for (uint64_t i : revisit) {
+            add(0xA00000000000ull + i);
+        }
+        for (uint64_t i = 0; i < 300; i += 7) {
+            add(0xA00000000000ull + i);
+        }
+
+        std::string path = TempPath("wrap");
+        if (!Write(path, 0, records)) {
+            Fail("CaptureWriter did not record every record (device wrap)");
+            std::remove(path.c_str());
+            return;
+        }
+        bool truncated;
+        size_t matched = Compare(path, records, records.size(), truncated);
+        if (matched != records.size() || truncated) {
+            std::fprintf(stderr, "capture_test: device wrap: record %zu of %zu differs\n", matched, records.size());
+            Fail("device addresses are wrong once the device table wraps");
+        }
+        std::remove(path.c_str());
+    }
+}
+
+int main() {
+    CheckRoundTrip();
+    CheckDeviceTableWrap();
+    if (g_failures == 0) {
+        std::printf("capture_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
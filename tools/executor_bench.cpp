@@ -0,0 +1,417 @@
+// executor_bench: measures the shared executor through the calls the DLL makes on it: how long
+// a Submit'ed callback waits for a pool thread, how many coroutine hops Schedule sustains, and
+// how long Shutdown takes with session coroutines still queued through Resume (each must run,
+// not be dropped with its frame). Then the claim the executor exists for: 1, 10 and 100
+// session engines streaming from fake straps through the executor's SessionRuntime (pool and
+// timer wheel, as in the DLL) must not add threads or context switches per device beyond the
+// work itself. Windows only.
+//
+//   cl /std:c++20 /EHsc /O2 /I.. executor_bench.cpp ..\Executor.cpp ..\SessionEngine.cpp ..\FakeTransport.cpp
+//       ..\FaultInjector.cpp ..\LinkStats.cpp ..\StartupProfile.cpp ..\StreamWatchdog.cpp ..\TimerWheel.cpp
+//   executor_bench [--tasks 100000] [--hops 100000] [--waiters 1000] [--threads 0] [--seconds 5] [--rate-hz 4]
+//
+// Prints one JSON object; times in microseconds. "sessions" has one entry per device count:
+// process thread count (at the end and the peak), context switches per second summed over the
+// process's threads (NtQuerySystemInformation), CPU cycles and CPU time per second, and the
+// samples delivered. Exit code 1 if a queued coroutine did not run before Shutdown returned,
+// or a session never streamed.
+#include <windows.h>
+#include <winternl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Executor.h"
+#include "FakeTransport.h"
+#include "LinkStats.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include "TimerWheel.h"
+
+#pragma comment(lib, "ntdll.lib")
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Coroutine that runs to completion on its own
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    int64_t Percentile(std::vector<int64_t> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size()));
+        return values[std::min(rank, values.size() - 1)];
+    }
+
+    int64_t ElapsedUs(Clock::time_point from) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - from).count();
+    }
+
+    void WaitFor(std::atomic<int>& counter, int target) {
+        while (counter.load() < target) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Submit takes a raw callback and context, as CaptureWriter's flush does
+    struct PostProbe {
+        Clock::time_point posted;
+        std::vector<int64_t>* postUs = nullptr;
+        std::atomic<int> ran{ 0 };
+    };
+
+    void CALLBACK Measure(PTP_CALLBACK_INSTANCE, void* context) {
+        auto probe = static_cast<PostProbe*>(context);
+        probe->postUs->push_back(ElapsedUs(probe->posted));
+        probe->ran.fetch_add(1);
+    }
+
+    void CALLBACK Count(PTP_CALLBACK_INSTANCE, void* context) {
+        static_cast<std::atomic<int>*>(context)->fetch_add(1);
+    }
+
+    // Suspends and hands the coroutine to the caller, the way the session engine parks one
+    // until a transport completion queues it through SessionRuntime::Resume
+    struct Park {
+        std::vector<std::coroutine_handle<>>& parked;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> coroutine) { parked.push_back(coroutine); }
+        void await_resume() const noexcept {}
+    };
+
+    Detached Hop(int hops, std::atomic<int>& done) {
+        for (int i = 0; i < hops; ++i) {
+            co_await g_executor.Schedule();
+        }
+        done.fetch_add(1);
+    }
+
+    Detached Parked(std::vector<std::coroutine_handle<>>& parked, std::atomic<int>& finished) {
+        co_await Park{ parked };
+        finished.fetch_add(1);
+    }
+
+    // --- Sessions on the executor ---
+    constexpr uint64_t kFirstStrap = 0xC0FFEE000001ull;
+    constexpr uint8_t kPayload[4] = { 0x10, 72, 0x00, 0x04 };
+    constexpr int kDeviceCounts[] = { 1, 10, 100 };
+
+    // The DLL's ExecutorRuntime: the shared pool, the steady clock and the shared timer wheel
+    class ExecutorRuntime final : public SessionRuntime {
+    public:
+        bool Resume(std::coroutine_handle<> coroutine) override { return g_executor.Resume(coroutine); }
+        int64_t NowUs() override {
+            return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+        }
+        TimerWheel& Timers() override { return g_timers; }
+    };
+
+    ExecutorRuntime g_runtime;
+
+    // One simulated device: its own engine and fake strap. The strap notifies from a wheel timer,
+    // so the bench adds no threads of its own while the sessions run.
+    class BenchSession final : public SessionHost {
+    public:
+        BenchSession(uint64_t address, uint64_t periodMs)
+            : transport(std::make_shared<FakeTransport>(g_runtime, address)), engine(g_runtime, *this, stats, startup),
+            m_periodMs(periodMs) {
+            m_strapTimer = { &OnStrapTimer, this };
+        }
+        ~BenchSession() { g_timers.Cancel(m_strapTimer); }
+
+        void StartStrap(uint64_t phaseMs) { g_timers.Schedule(m_strapTimer, phaseMs); }
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return transport; }
+        void OnStatus(HrState, HrErrorCategory, int32_t, uint64_t) override {}
+        void OnSample(const HrSample&) override { samples.fetch_add(1); }
+
+        std::shared_ptr<FakeTransport> transport;
+        LinkStats stats;
+        StartupProfiler startup;
+        SessionEngine engine;
+        std::atomic<uint64_t> samples{ 0 };
+
+    private:
+        static void OnStrapTimer(void* context) {
+            auto session = static_cast<BenchSession*>(context);
+            session->transport->Notify(kPayload, sizeof(kPayload));
+            g_timers.Schedule(session->m_strapTimer, session->m_periodMs);
+        }
+
+        uint64_t m_periodMs;
+        TimerWheel::Timer m_strapTimer;
+    };
+
+    // SYSTEM_THREAD_INFORMATION as the kernel lays it out; winternl.h leaves ContextSwitches unnamed
+    struct ThreadInformation {
+        LARGE_INTEGER kernelTime;
+        LARGE_INTEGER userTime;
+        LARGE_INTEGER createTime;
+        ULONG waitTime;
+        PVOID startAddress;
+        HANDLE uniqueProcess; // CLIENT_ID
+        HANDLE uniqueThread;
+        LONG priority;
+        LONG basePriority;
+        ULONG contextSwitches;
+        ULONG threadState;
+        ULONG waitReason;
+    };
+
+    struct ProcessCounters {
+        ULONG threads = 0;
+        uint64_t contextSwitches = 0; // Summed over the threads alive right now
+        uint64_t cycles = 0;
+        uint64_t cpu100ns = 0;        // Kernel + user
+    };
+
+    bool QueryCounters(ProcessCounters& out) {
+        static std::vector<uint8_t> buffer(1 << 20);
+        for (;;) {
+            ULONG needed = 0;
+            NTSTATUS status = NtQuerySystemInformation(SystemProcessInformation, buffer.data(),
+                static_cast<ULONG>(buffer.size()), &needed);
+            if (status == static_cast<NTSTATUS>(0xC0000004L)) { // STATUS_INFO_LENGTH_MISMATCH
+                buffer.resize(std::max<size_t>(needed + 65536, buffer.size() * 2));
+                continue;
+            }
+            if (status < 0) {
+                return false;
+            }
+            break;
+        }
+        out = {};
+        HANDLE self = reinterpret_cast<HANDLE>(static_cast<uintptr_t>(GetCurrentProcessId()));
+        for (size_t offset = 0;;) {
+            auto process = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(buffer.data() + offset);
+            if (process->UniqueProcessId == self) {
+                auto threads = reinterpret_cast<const ThreadInformation*>(process + 1);
+                out.threads = process->NumberOfThreads;
+                for (ULONG i = 0; i < process->NumberOfThreads; ++i) {
+                    out.contextSwitches += threads[i].contextSwitches;
+                }
+                break;
+            }
+            if (process->NextEntryOffset == 0) {
+                return false;
+            }
+            offset += process->NextEntryOffset;
+        }
+        ULONG64 cycles = 0;
+        QueryProcessCycleTime(GetCurrentProcess(), &cycles);
+        out.cycles = cycles;
+        FILETIME created, exited, kernel, user;
+        if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+            auto ticks = [](FILETIME time) { return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+            out.cpu100ns = ticks(kernel) + ticks(user);
+        }
+        return true;
+    }
+
+    struct ScalingResult {
+        int devices = 0;
+        ULONG threadsIdle = 0; // Before the sessions start
+        ULONG threads = 0;     // At the end of the window
+        ULONG threadsPeak = 0;
+        double contextSwitchesPerS = 0;
+        double cyclesPerS = 0;
+        double cpuMsPerS = 0;
+        uint64_t samples = 0;
+        int failures = 0;      // Sessions that never streamed
+    };
+
+    ScalingResult RunSessions(int devices, int seconds, double rateHz) {
+        ScalingResult result;
+        result.devices = devices;
+        ProcessCounters idle;
+        QueryCounters(idle);
+        result.threadsIdle = idle.threads;
+
+        uint64_t periodMs = static_cast<uint64_t>(1000.0 / rateHz);
+        std::vector<std::unique_ptr<BenchSession>> sessions;
+        for (int i = 0; i < devices; ++i) {
+            sessions.push_back(std::make_unique<BenchSession>(kFirstStrap + static_cast<uint64_t>(i), periodMs));
+            sessions.back()->engine.Start(g_runtime.NowUs(), 1000); // One that fails never streams
+            sessions.back()->StartStrap(periodMs * static_cast<uint64_t>(i) / static_cast<uint64_t>(devices));
+        }
+        // Measure only once every session streams, not the connects
+        auto deadline = Clock::now() + std::chrono::seconds(10);
+        auto streaming = [&] {
+            for (auto& session : sessions) {
+                if (session->samples.load() == 0) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        while (!streaming() && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        ProcessCounters before;
+        ProcessCounters after;
+        QueryCounters(before);
+        uint64_t samplesBefore = 0;
+        for (auto& session : sessions) {
+            samplesBefore += session->samples.load();
+        }
+        auto windowStart = Clock::now();
+        result.threadsPeak = before.threads;
+        for (int tick = 0; tick < seconds * 10; ++tick) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            ProcessCounters now;
+            if (QueryCounters(now)) {
+                result.threadsPeak = std::max(result.threadsPeak, now.threads);
+            }
+        }
+        QueryCounters(after);
+        double windowS = static_cast<double>(ElapsedUs(windowStart)) / 1e6;
+        for (auto& session : sessions) {
+            result.samples += session->samples.load();
+            if (session->samples.load() == 0) {
+                ++result.failures;
+            }
+        }
+        result.samples -= samplesBefore;
+        result.threads = after.threads;
+        // Pool threads that exit take their counts along; never report a negative rate
+        result.contextSwitchesPerS = after.contextSwitches > before.contextSwitches
+            ? static_cast<double>(after.contextSwitches - before.contextSwitches) / windowS : 0.0;
+        result.cyclesPerS = static_cast<double>(after.cycles - before.cycles) / windowS;
+        result.cpuMsPerS = static_cast<double>(after.cpu100ns - before.cpu100ns) / 1e4 / windowS;
+
+        for (auto& session : sessions) {
+            session->engine.Stop(5000, false);
+        }
+        sessions.clear(); // Cancels the strap timers
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    int tasks = 100000;
+    int hops = 100000;
+    int waiters = 1000;
+    unsigned threads = 0;
+    int seconds = 5;
+    double rateHz = 4.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--tasks")) {
+            tasks = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--hops")) {
+            hops = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--waiters")) {
+            waiters = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--threads")) {
+            threads = static_cast<unsigned>(std::atoi(argv[i + 1]));
+        }
+        else if (!std::strcmp(argv[i], "--seconds")) {
+            seconds = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--rate-hz")) {
+            rateHz = std::atof(argv[i + 1]);
+        }
+    }
+    if (rateHz <= 0.0) {
+        rateHz = 4.0;
+    }
+    if (!g_executor.Start(threads) || !g_timers.StartDriver(g_executor.Environment())) {
+        std::fprintf(stderr, "executor_bench: cannot start the executor\n");
+        return 2;
+    }
+
+    // Submit: queue-to-run latency, one task at a time so each sees an idle pool
+    std::vector<int64_t> postUs;
+    postUs.reserve(static_cast<size_t>(tasks));
+    PostProbe probe;
+    probe.postUs = &postUs;
+    for (int i = 0; i < tasks; ++i) {
+        probe.posted = Clock::now();
+        g_executor.Submit(&Measure, &probe);
+        WaitFor(probe.ran, i + 1);
+    }
+
+    // Burst: every task queued at once
+    std::atomic<int> ran{ 0 };
+    auto burstStart = Clock::now();
+    for (int i = 0; i < tasks; ++i) {
+        g_executor.Submit(&Count, &ran);
+    }
+    WaitFor(ran, tasks);
+    int64_t burstUs = ElapsedUs(burstStart);
+
+    // Coroutine hops through Schedule, one coroutine per pool thread
+    unsigned chains = std::max(1u, threads ? threads : std::thread::hardware_concurrency());
+    std::atomic<int> chainsDone{ 0 };
+    auto hopStart = Clock::now();
+    for (unsigned c = 0; c < chains; ++c) {
+        Hop(hops / static_cast<int>(chains), chainsDone);
+    }
+    WaitFor(chainsDone, static_cast<int>(chains));
+    int64_t hopUs = ElapsedUs(hopStart);
+
+    // Sessions: the same pool and wheel for 1, 10 and 100 devices
+    std::vector<ScalingResult> scaling;
+    int sessionFailures = 0;
+    for (int devices : kDeviceCounts) {
+        scaling.push_back(RunSessions(devices, seconds, rateHz));
+        sessionFailures += scaling.back().failures;
+    }
+    g_timers.StopDriver();
+
+    // Shutdown right after queuing suspended coroutines: Shutdown drains the queue, so every
+    // one must have run (and freed its frame) by the time it returns
+    std::vector<std::coroutine_handle<>> parked;
+    parked.reserve(static_cast<size_t>(waiters));
+    std::atomic<int> finished{ 0 };
+    for (int i = 0; i < waiters; ++i) {
+        Parked(parked, finished);
+    }
+    for (std::coroutine_handle<> coroutine : parked) {
+        if (!g_executor.Resume(coroutine)) {
+            coroutine.resume(); // Could not queue: run it here rather than leak it
+        }
+    }
+    auto shutdownStart = Clock::now();
+    g_executor.Shutdown();
+    int64_t shutdownUs = ElapsedUs(shutdownStart);
+
+    std::printf("{\"tasks\":%d,\"post_p50_us\":%lld,\"post_p99_us\":%lld,\"post_max_us\":%lld,"
+        "\"burst_tasks_per_s\":%.0f,\"hops\":%d,\"hops_per_s\":%.0f,"
+        "\"waiters\":%d,\"waiters_completed\":%d,\"shutdown_us\":%lld,",
+        tasks, static_cast<long long>(Percentile(postUs, 50)), static_cast<long long>(Percentile(postUs, 99)),
+        static_cast<long long>(Percentile(postUs, 100)),
+        burstUs > 0 ? tasks * 1e6 / static_cast<double>(burstUs) : 0.0,
+        hops, hopUs > 0 ? hops * 1e6 / static_cast<double>(hopUs) : 0.0,
+        waiters, finished.load(), static_cast<long long>(shutdownUs));
+    std::printf("\"seconds\":%d,\"rate_hz\":%.1f,\"sessions\":[", seconds, rateHz);
+    for (size_t i = 0; i < scaling.size(); ++i) {
+        const ScalingResult& r = scaling[i];
+        std::printf("%s{\"devices\":%d,\"threads_idle\":%lu,\"threads\":%lu,\"threads_peak\":%lu,"
+            "\"context_switches_per_s\":%.0f,\"cycles_per_s\":%.0f,\"cpu_ms_per_s\":%.2f,\"samples\":%llu,"
+            "\"failures\":%d}", i ? "," : "", r.devices, r.threadsIdle, r.threads, r.threadsPeak,
+            r.contextSwitchesPerS, r.cyclesPerS, r.cpuMsPerS, static_cast<unsigned long long>(r.samples), r.failures);
+    }
+    std::printf("]}\n");
+    return finished.load() == waiters && sessionFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// hrdecoder_bench: time per packet of ParseHrMeasurement (one indexed call into a decoder
+// generated per flags layout) versus the branchy parser it replaced, which re-tests each flag
+// for every packet. Corpora use a realistic flags mix (0x16 with RR 60%, 0x06 25%, 0x10 with
+// RR 10%, 0x1E with energy 5%, 1-3 RR intervals, the odd truncated packet):
+//   single      - one strap: every packet has that strap's flags byte
+//   grouped     - four straps with different flags, their packets in runs of 8 (how a
+//                 multi-device host sees notifications arrive)
+//   interleaved - flags drawn per packet: the worst case for both branch and jump prediction
+// Before timing, both parsers are checked to agree on every packet of every corpus.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o hrdecoder_bench hrdecoder_bench.cpp
+//
+//   ./hrdecoder_bench [--packets 4096] [--rounds 2000]
+//
+// Prints one JSON object with the best round's ns per packet for each parser and corpus. Exit
+// code 1 if the parsers disagree.
+#include "HrMeasurement.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // The parser before the decoder table, kept as the reference
+    bool BranchyParse(const uint8_t* data, size_t length, HrMeasurement& out) {
+        if (!data || length < 2) {
+            return false;
+        }
+        size_t pos = 0;
+        out.flags = data[pos++];
+        if (out.flags & kHrFlagValueUInt16) {
+            if (length < pos + 2) return false;
+            out.bpm = ReadLe16(data + pos);
+            pos += 2;
+        }
+        else {
+            out.bpm = data[pos++];
+        }
+        if (out.flags & kHrFlagEnergyExpended) {
+            if (length < pos + 2) return false;
+            out.energyExpended = ReadLe16(data + pos);
+            pos += 2;
+        }
+        else {
+            out.energyExpended = 0;
+        }
+        out.rrCount = 0;
+        if (out.flags & kHrFlagRrPresent) {
+            if ((length - pos) % 2 != 0) return false;
+            while (pos + 2 <= length) {
+                if (out.rrCount < kMaxRrIntervals) {
+                    out.rr[out.rrCount++] = ReadLe16(data + pos);
+                }
+                pos += 2;
+            }
+        }
+        return true;
+    }
+
+    struct Corpus {
+        std::vector<uint8_t> data;
+        std::vector<uint32_t> offsets{ 0 };
+    };
+
+    uint8_t DrawFlags(std::mt19937& rng) {
+        uint32_t r = rng() % 100;
+        if (r < 60) {
+            return 0x16;
+        }
+        if (r < 85) {
+            return 0x06;
+        }
+        if (r < 95) {
+            return 0x10;
+        }
+        return 0x1E;
+    }
+
+    void Append(Corpus& corpus, uint8_t flags, std::mt19937& rng) {
+        corpus.data.push_back(flags);
+        corpus.data.push_back(static_cast<uint8_t>(60 + rng() % 120));
+        if (flags & kHrFlagValueUInt16) {
+            corpus.data.push_back(0);
+        }
+        if (flags & kHrFlagEnergyExpended) {
+            uint16_t energy = static_cast<uint16_t>(rng());
+            corpus.data.push_back(static_cast<uint8_t>(energy));
+            corpus.data.push_back(static_cast<uint8_t>(energy >> 8));
+        }
+        if (flags & kHrFlagRrPresent) {
+            int rrCount = 1 + static_cast<int>(rng() % 3);
+            for (int k = 0; k < rrCount; ++k) {
+                uint16_t rr = static_cast<uint16_t>(600 + rng() % 500);
+                corpus.data.push_back(static_cast<uint8_t>(rr));
+                corpus.data.push_back(static_cast<uint8_t>(rr >> 8));
+            }
+            if (rng() % 200 == 0) {
+                corpus.data.pop_back(); // Cut mid-interval
+            }
+        }
+        corpus.offsets.push_back(static_cast<uint32_t>(corpus.data.size()));
+    }
+
+    enum Kind { Single, Grouped, Interleaved, KindCount };
+    const char* const kKindNames[KindCount] = { "single", "grouped", "interleaved" };
+
+    Corpus Generate(Kind kind, uint32_t packets) {
+        std::mt19937 rng(42);
+        Corpus corpus;
+        uint8_t straps[4] = { 0x16, 0x06, 0x10, 0x1E };
+        for (uint32_t i = 0; i < packets; ++i) {
+            uint8_t flags = kind == Single ? straps[0] : kind == Grouped ? straps[(i / 8) % 4] : DrawFlags(rng);
+            Append(corpus, flags, rng);
+        }
+        return corpus;
+    }
+
+    bool Same(bool okA, const HrMeasurement& a, bool okB, const HrMeasurement& b) {
+        if (okA != okB) {
+            return false;
+        }
+        return !okA || (a.flags == b.flags && a.bpm == b.bpm && a.energyExpended == b.energyExpended
+            && a.rrCount == b.rrCount && std::memcmp(a.rr, b.rr, a.rrCount * sizeof(uint16_t)) == 0);
+    }
+
+    template <bool (*Parse)(const uint8_t*, size_t, HrMeasurement&)>
+    double Round(const Corpus& corpus, uint64_t& checksum) {
+        size_t count = corpus.offsets.size() - 1;
+        HrMeasurement m;
+        Clock::time_point begin = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            if (Parse(corpus.data.data() + corpus.offsets[i], corpus.offsets[i + 1] - corpus.offsets[i], m)) {
+                checksum += m.bpm + m.energyExpended + m.rrCount + m.rr[0];
+            }
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        return static_cast<double>(ns) / static_cast<double>(count);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t packets = 4096;
+    int rounds = 2000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--packets")) {
+            packets = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--rounds")) {
+            rounds = std::atoi(argv[i + 1]);
+        }
+    }
+    if (packets == 0 || rounds <= 0) {
+        std::fprintf(stderr, "usage: hrdecoder_bench [--packets N] [--rounds N]\n");
+        return 1;
+    }
+
+    uint64_t checksum = 0;
+    std::printf("{\"packets\":%u,\"rounds\":%d", packets, rounds);
+    for (int kind = 0; kind < KindCount; ++kind) {
+        Corpus corpus = Generate(static_cast<Kind>(kind), packets);
+        for (uint32_t i = 0; i < packets; ++i) {
+            HrMeasurement a, b;
+            const uint8_t* data = corpus.data.data() + corpus.offsets[i];
+            size_t length = corpus.offsets[i + 1] - corpus.offsets[i];
+            bool okA = ParseHrMeasurement(data, length, a);
+            bool okB = BranchyParse(data, length, b);
+            if (!Same(okA, a, okB, b)) {
+                std::fprintf(stderr, "hrdecoder_bench: parsers disagree on %s packet %u\n", kKindNames[kind], i);
+                return 1;
+            }
+        }
+        // Alternate the parsers so neither always runs on a warmer cache or clock
+        double table = 1e30;
+        double branchy = 1e30;
+        for (int round = 0; round < rounds; ++round) {
+            table = std::min(table, Round<&ParseHrMeasurement>(corpus, checksum));
+            branchy = std::min(branchy, Round<&BranchyParse>(corpus, checksum));
+        }
+        std::printf(",\"%s\":{\"table_ns\":%.2f,\"branchy_ns\":%.2f}", kKindNames[kind], table, branchy);
+    }
+    std::printf(",\"checksum\":%llu}\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,163 @@
+// latestsamples_bench: cost of publishing and polling the latest sample per device on
+// LatestSamples (a seqlock cell per device) versus one mutex around an array of samples (the
+// obvious alternative). One writer stores a sample per device at full speed (the notification
+// path) while readers poll every device. Throughput shows what a poll costs; the writer's
+// per-store tail shows whether a polling host can stall the notification thread (with the
+// mutex, a reader preempted inside the lock does). Run it on several cores: on one, preemption
+// dominates both tails.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o latestsamples_bench latestsamples_bench.cpp ../LatestSamples.cpp
+//
+//   ./latestsamples_bench [--devices 8] [--readers 8] [--ms 1000]
+//
+// Prints one JSON object: stores and loads per second and the store p99.9/max in ns, for each
+// table alone and polled, and for the polled runs ns_per_load of each reader thread (its wall
+// time over its loads, so it includes waiting for the mutex or for a core).
+#include "LatencyHistogram.h"
+#include "LatestSamples.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    class MutexSamples {
+    public:
+        explicit MutexSamples(uint32_t capacity) : m_samples(capacity) {}
+
+        int Store(const HrSample& sample, int hint) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_samples[static_cast<size_t>(hint)] = sample;
+            return hint;
+        }
+        bool Load(uint64_t deviceAddress, HrSample& out) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const HrSample& sample : m_samples) {
+                if (sample.deviceAddress == deviceAddress) {
+                    out = sample;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<HrSample> m_samples;
+    };
+
+    struct Rates {
+        double storesPerS;
+        double loadsPerS;
+        uint64_t storeP999Ns;
+        uint64_t storeMaxNs;
+        std::vector<double> nsPerLoad; // Per reader thread
+    };
+
+    // One writer for all devices (the engine's notification path), readers polling round-robin
+    template <typename Table>
+    Rates Run(Table& table, uint32_t devices, int readers, int ms) {
+        std::atomic<bool> running{ true };
+        std::atomic<uint64_t> loads{ 0 };
+        std::atomic<uint64_t> torn{ 0 };
+        std::vector<double> nsPerLoad(static_cast<size_t>(readers), 0.0);
+        std::vector<std::thread> pollers;
+        for (int r = 0; r < readers; ++r) {
+            pollers.emplace_back([&, r] {
+                HrSample sample{};
+                uint64_t count = 0;
+                auto start = Clock::now();
+                for (uint32_t d = 0; running.load(std::memory_order_relaxed); d = (d + 1) % devices) {
+                    if (table.Load(d + 1, sample) && sample.bpm != static_cast<uint16_t>(sample.sequence)) {
+                        torn.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    ++count;
+                }
+                double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                nsPerLoad[static_cast<size_t>(r)] = count > 0 ? ns / static_cast<double>(count) : 0.0;
+                loads.fetch_add(count);
+            });
+        }
+        std::vector<int> slots(devices, -1);
+        HrSample sample{};
+        LatencyHistogram storeNs;
+        uint64_t stores = 0;
+        auto begin = Clock::now();
+        auto end = begin + std::chrono::milliseconds(ms);
+        while (Clock::now() < end) {
+            for (int k = 0; k < 1024; ++k, ++stores) {
+                uint32_t d = static_cast<uint32_t>(stores % devices);
+                sample.deviceAddress = d + 1;
+                sample.sequence = stores;
+                sample.bpm = static_cast<uint16_t>(stores);
+                sample.timestampUs = static_cast<int64_t>(stores);
+                auto before = Clock::now();
+                slots[d] = table.Store(sample, slots[d] < 0 ? static_cast<int>(d) : slots[d]);
+                storeNs.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+            }
+        }
+        double elapsedS = std::chrono::duration<double>(Clock::now() - begin).count();
+        running = false;
+        for (auto& poller : pollers) {
+            poller.join();
+        }
+        if (torn.load() != 0) {
+            std::fprintf(stderr, "latestsamples_bench: %llu torn reads\n", static_cast<unsigned long long>(torn.load()));
+        }
+        return { static_cast<double>(stores) / elapsedS, static_cast<double>(loads.load()) / elapsedS,
+            storeNs.Percentile(99.9), storeNs.Max(), std::move(nsPerLoad) };
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t devices = 8;
+    int readers = 8;
+    int ms = 1000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--devices")) {
+            devices = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--readers")) {
+            readers = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--ms")) {
+            ms = std::atoi(argv[i + 1]);
+        }
+    }
+    if (devices == 0) {
+        devices = 1;
+    }
+
+    std::printf("{\"devices\":%u,\"readers\":%d,\"cores\":%u", devices, readers, std::thread::hardware_concurrency());
+    for (int withReaders = 0; withReaders < 2; ++withReaders) {
+        int r = withReaders ? readers : 0;
+        LatestSamples seqlock(devices);
+        MutexSamples mutex(devices);
+        Rates a = Run(seqlock, devices, r, ms);
+        Rates b = Run(mutex, devices, r, ms);
+        const char* suffix = withReaders ? "polled" : "alone";
+        const Rates* rates[2] = { &a, &b };
+        const char* names[2] = { "seqlock", "mutex" };
+        for (int t = 0; t < 2; ++t) {
+            std::printf(",\"%s_%s\":{\"stores_per_s\":%.0f,\"loads_per_s\":%.0f,\"store_p999_ns\":%llu,\"store_max_ns\":%llu",
+                names[t], suffix, rates[t]->storesPerS, rates[t]->loadsPerS,
+                static_cast<unsigned long long>(rates[t]->storeP999Ns), static_cast<unsigned long long>(rates[t]->storeMaxNs));
+            if (withReaders) {
+                std::printf(",\"ns_per_load\":[");
+                for (size_t i = 0; i < rates[t]->nsPerLoad.size(); ++i) {
+                    std::printf("%s%.1f", i ? "," : "", rates[t]->nsPerLoad[i]);
+                }
+                std::printf("]");
+            }
+            std::printf("}");
+        }
+    }
+    std::printf("}\n");
+    return 0;
+}
@@ -0,0 +1,123 @@
+// latestsamples_test: slot hand-over in LatestSamples. A full table keeps devices that are still
+// sending and counts the newcomer as untracked; a device silent for kEvictAfterUs gives its slot
+// up; and devices churning through a small table from several threads never produce a torn or
+// misattributed sample.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o latestsamples_test latestsamples_test.cpp ../LatestSamples.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "LatestSamples.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+    int g_failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "latestsamples_test: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    HrSample Sample(uint64_t address, int64_t timestampUs, uint64_t sequence) {
+        HrSample sample{};
+        sample.deviceAddress = address;
+        sample.timestampUs = timestampUs;
+        sample.sequence = sequence;
+        sample.bpm = static_cast<uint16_t>(address * 3 + sequence);
+        return sample;
+    }
+
+    void CheckHandOver() {
+        LatestSamples latest(4);
+        int slots[4];
+        for (uint64_t d = 0; d < 4; ++d) {
+            slots[d] = latest.Store(Sample(100 + d, 0, 1));
+            Check(slots[d] >= 0, "free slot not handed out");
+        }
+        Check(latest.Store(Sample(200, 1000000, 1)) < 0, "live device lost its slot to a newcomer");
+        Check(latest.Untracked() == 1, "newcomer not counted as untracked");
+
+        // Devices 0-2 keep sending, device 3 goes quiet
+        int64_t now = 1000000;
+        for (int round = 1; round <= 6; ++round, now += 1000000) {
+            for (uint64_t d = 0; d < 3; ++d) {
+                Check(latest.Store(Sample(100 + d, now, 1 + round), slots[d]) == slots[d], "hint not honoured");
+            }
+        }
+        int taken = latest.Store(Sample(200, now, 2));
+        Check(taken == slots[3], "silent device's slot not handed over");
+        HrSample out{};
+        Check(!latest.Load(103, out), "evicted device still readable");
+        Check(latest.Load(200, out) && out.deviceAddress == 200 && out.sequence == 2, "new device not readable");
+        Check(latest.Load(100, out) && out.sequence == 7, "live device lost its sample");
+
+        // The evicted device coming back with its stale hint must not write into the new owner's slot
+        int back = latest.Store(Sample(103, now, 9), slots[3]);
+        Check(back < 0, "returning device displaced a live one");
+        Check(latest.Load(200, out) && out.deviceAddress == 200, "stale hint overwrote another device");
+    }
+
+    // More devices than slots, with silence long enough that slots keep changing hands
+    void CheckChurn() {
+        constexpr int kThreads = 4;
+        constexpr uint64_t kDevicesPerThread = 6;
+        LatestSamples latest(8);
+        std::atomic<bool> running{ true };
+        std::atomic<int> bad{ 0 };
+        std::vector<std::thread> writers;
+        for (int t = 0; t < kThreads; ++t) {
+            writers.emplace_back([&, t] {
+                int hints[kDevicesPerThread];
+                for (auto& hint : hints) {
+                    hint = -1;
+                }
+                for (uint64_t round = 1; running.load(std::memory_order_relaxed); ++round) {
+                    for (uint64_t d = 0; d < kDevicesPerThread; ++d) {
+                        uint64_t address = 1 + t * kDevicesPerThread + d;
+                        // Devices take turns being silent for longer than kEvictAfterUs
+                        int64_t now = static_cast<int64_t>(round) * 1000000;
+                        if ((round / 8) % kDevicesPerThread == d) {
+                            continue;
+                        }
+                        hints[d] = latest.Store(Sample(address, now, round), hints[d]);
+                    }
+                }
+            });
+        }
+        std::thread reader([&] {
+            while (running.load(std::memory_order_relaxed)) {
+                for (uint64_t address = 1; address <= kThreads * kDevicesPerThread; ++address) {
+                    HrSample out{};
+                    if (latest.Load(address, out)
+                        && (out.deviceAddress != address || out.bpm != static_cast<uint16_t>(address * 3 + out.sequence))) {
+                        bad.fetch_add(1);
+                    }
+                }
+                HrSample out{};
+                if (latest.Load(out) && out.bpm != static_cast<uint16_t>(out.deviceAddress * 3 + out.sequence)) {
+                    bad.fetch_add(1);
+                }
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        running = false;
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        reader.join();
+        Check(bad.load() == 0, "torn or misattributed sample while slots changed hands");
+    }
+}
+
+int main() {
+    CheckHandOver();
+    CheckChurn();
+    if (g_failures == 0) {
+        std::printf("latestsamples_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
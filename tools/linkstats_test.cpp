@@ -0,0 +1,95 @@
+// linkstats_test: loss and lateness accounting in LinkStats for gaps with and without RR.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o linkstats_test linkstats_test.cpp ../LinkStats.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "LinkStats.h"
+#include <cstdio>
+
+namespace {
+    constexpr int64_t kIntervalUs = 1000000;
+
+    int g_failures = 0;
+
+    void Check(bool ok, const char* what, uint64_t got, uint64_t expected) {
+        if (!ok) {
+            std::fprintf(stderr, "linkstats_test: %s: got %llu, expected %llu\n", what,
+                static_cast<unsigned long long>(got), static_cast<unsigned long long>(expected));
+            ++g_failures;
+        }
+    }
+
+    HrMeasurement Beat(int64_t rrUs = 0) {
+        HrMeasurement measurement;
+        measurement.bpm = 60;
+        if (rrUs != 0) {
+            measurement.flags = kHrFlagRrPresent;
+            measurement.rrCount = 1;
+            measurement.rr[0] = static_cast<uint16_t>(rrUs * 1024 / 1000000);
+        }
+        return measurement;
+    }
+
+    // Ten on-time packets, then one after gapFactor intervals; returns the drops counted
+    uint64_t DroppedAfterGap(double gapFactor) {
+        LinkStats stats;
+        stats.Reset(1);
+        int64_t now = 0;
+        for (int i = 0; i < 10; ++i) {
+            stats.OnPacket(now, Beat());
+            now += kIntervalUs;
+        }
+        now += static_cast<int64_t>((gapFactor - 1.0) * kIntervalUs);
+        stats.OnPacket(now, Beat());
+        HrLinkStats snapshot{};
+        stats.Snapshot(snapshot);
+        return snapshot.droppedEstimated;
+    }
+}
+
+int main() {
+    uint64_t dropped = DroppedAfterGap(2.0);
+    Check(dropped == 1, "2x gap without RR", dropped, 1);
+    dropped = DroppedAfterGap(3.0);
+    Check(dropped == 2, "3x gap without RR", dropped, 2);
+    dropped = DroppedAfterGap(1.6);
+    Check(dropped == 1, "1.6x gap without RR (floor)", dropped, 1);
+    dropped = DroppedAfterGap(1.0);
+    Check(dropped == 0, "on-time packets", dropped, 0);
+
+    // A per-beat strap reporting one long RR that covers the whole gap lost nothing
+    LinkStats stats;
+    stats.Reset(1);
+    int64_t now = 0;
+    for (int i = 0; i < 10; ++i) {
+        stats.OnPacket(now, Beat(kIntervalUs));
+        now += kIntervalUs;
+    }
+    now += kIntervalUs;
+    stats.OnPacket(now, Beat(2 * kIntervalUs - 1000));
+    HrLinkStats snapshot{};
+    stats.Snapshot(snapshot);
+    Check(snapshot.droppedEstimated == 0, "2x gap explained by RR", snapshot.droppedEstimated, 0);
+
+    // Notifications a slow stack held back and then delivered together don't shrink the cadence,
+    // so the next ordinary gap isn't mistaken for a long outage
+    stats.Reset(1);
+    now = 0;
+    for (int i = 0; i < 10; ++i) {
+        stats.OnPacket(now, Beat());
+        now += kIntervalUs;
+    }
+    for (int i = 0; i < 20; ++i) {
+        stats.OnPacket(now, Beat());
+    }
+    now += kIntervalUs;
+    stats.OnPacket(now, Beat());
+    stats.Snapshot(snapshot);
+    Check(snapshot.droppedEstimated == 0, "bunched delivery", snapshot.droppedEstimated, 0);
+    Check(stats.NominalIntervalUs() == kIntervalUs, "cadence after bunched delivery", stats.NominalIntervalUs(), kIntervalUs);
+
+    if (g_failures == 0) {
+        std::printf("linkstats_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+// loadgen: runs the pipeline load test headless and prints the JSON report to stdout.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o loadgen loadgen.cpp ../LoadGenerator.cpp ../CaptureWriter.cpp
+//       ../LatestSamples.cpp ../LinkStats.cpp ../SampleDispatcher.cpp ../SampleQueue.cpp ../TimerWheel.cpp
+//
+//   ./loadgen --devices 1000 --rate 4 --duration-ms 30000 [--threads N] [--capture out.hrcap]
+//
+// Exit code 0 on success, 1 on bad arguments, 2 if the run could not be set up.
+#include "LoadGenerator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    void Usage() {
+        std::fprintf(stderr, "usage: loadgen [--devices N] [--rate HZ] [--duration-ms MS] [--threads N]"
+            " [--queue N] [--poll-ms MS] [--capture PATH]\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    LoadConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const char* option = argv[i];
+        if (i + 1 >= argc) {
+            Usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (!std::strcmp(option, "--devices")) {
+            config.devices = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--rate")) {
+            config.rateHz = std::strtod(value, nullptr);
+        }
+        else if (!std::strcmp(option, "--duration-ms")) {
+            config.durationMs = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--threads")) {
+            config.threads = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--queue")) {
+            config.queueCapacity = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--poll-ms")) {
+            config.pollIntervalMs = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--capture")) {
+            config.capturePath = value;
+        }
+        else {
+            Usage();
+            return 1;
+        }
+    }
+
+    LoadReport report;
+    if (!RunLoadTest(config, report)) {
+        std::fprintf(stderr, "loadgen: invalid configuration or a pipeline stage failed to start\n");
+        return 2;
+    }
+    char json[2048];
+    if (FormatLoadReportJson(report, json, sizeof(json)) == 0) {
+        return 2;
+    }
+    std::printf("%s\n", json);
+    return 0;
+}
@@ -0,0 +1,400 @@
+// netpublisher_test: loopback load test of the network publisher. 300 TCP clients and 50 UDP
+// subscribers connect; 400 samples are published 2 ms apart from another thread while one
+// thread reads every socket. Each client must get well-formed binary frames in sequence order
+// up to the last sample, with any gap accounted for in framesDropped (a client more than the
+// backlog behind skips ahead); Publish must stay cheap however many clients there are. Then:
+// "bye" unsubscribes, Stop closes every client, a client that stops reading is skipped ahead
+// (or cut off) without holding up the others, and JSON framing.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o netpublisher_test netpublisher_test.cpp ../NetPublisher.cpp
+//       ../NetLoop.cpp ../TimerWheel.cpp
+//
+// Linux only (the loop is epoll). Exit code 0 if every check passed, 1 otherwise.
+#include "LatencyHistogram.h"
+#include "NetPublisher.h"
+#include <poll.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kTcpClients = 300;
+    constexpr int kUdpSubscribers = 50;
+    constexpr uint64_t kSamples = 400;
+
+    int g_failures = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "netpublisher_test: %s\n", what);
+        ++g_failures;
+    }
+
+    uint64_t GetLe(const uint8_t* p, int bytes) {
+        uint64_t value = 0;
+        for (int i = bytes - 1; i >= 0; --i) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    HrSample MakeSample(uint64_t sequence) {
+        HrSample sample{};
+        sample.deviceAddress = 0xC0FFEE000001ull;
+        sample.sequence = sequence;
+        sample.timestampUs = static_cast<int64_t>(sequence) * 2000;
+        sample.bpm = static_cast<uint16_t>(60 + sequence % 100);
+        sample.flags = 0x16;
+        sample.rrCount = static_cast<uint8_t>(sequence % 3);
+        for (uint8_t i = 0; i < sample.rrCount; ++i) {
+            sample.rr[i] = static_cast<uint16_t>(800 + i);
+        }
+        return sample;
+    }
+
+    template <typename Condition>
+    bool WaitFor(Condition condition, int timeoutMs) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!condition()) {
+            if (Clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    sockaddr_in Loopback(uint16_t port) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return address;
+    }
+
+    SOCKET ConnectTcp(uint16_t port) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address = Loopback(port);
+        if (s == INVALID_SOCKET || connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            if (s != INVALID_SOCKET) {
+                closesocket(s);
+            }
+            return INVALID_SOCKET;
+        }
+        NetSetNonBlocking(s);
+        return s;
+    }
+
+    // What one client has seen so far
+    struct Reader {
+        SOCKET socket = INVALID_SOCKET;
+        bool stream = true;
+        std::vector<uint8_t> buffer;
+        uint64_t lastSequence = 0;
+        uint64_t received = 0;
+        bool bad = false;
+        bool closed = false;
+    };
+
+    // Checks one binary frame against what was published
+    void Consume(Reader& reader, const uint8_t* frame, size_t length) {
+        if (length < 34 || GetLe(frame, 2) != length - 2 || frame[2] != 1 || length != 34 + 2u * frame[3]) {
+            reader.bad = true;
+            return;
+        }
+        uint64_t sequence = GetLe(frame + 12, 8);
+        HrSample expected = MakeSample(sequence);
+        if (sequence <= reader.lastSequence || GetLe(frame + 4, 8) != expected.deviceAddress
+            || GetLe(frame + 28, 2) != expected.bpm || frame[3] != expected.rrCount) {
+            reader.bad = true;
+            return;
+        }
+        reader.lastSequence = sequence;
+        ++reader.received;
+    }
+
+    void Read(Reader& reader) {
+        uint8_t chunk[4096];
+        for (;;) {
+            int received = static_cast<int>(recv(reader.socket, reinterpret_cast<char*>(chunk), sizeof(chunk), 0));
+            if (received == 0) {
+                reader.closed = true;
+                return;
+            }
+            if (received < 0) {
+                if (!NetWouldBlock()) {
+                    reader.closed = true;
+                }
+                return;
+            }
+            if (!reader.stream) {
+                Consume(reader, chunk, static_cast<size_t>(received)); // One frame per datagram
+                continue;
+            }
+            reader.buffer.insert(reader.buffer.end(), chunk, chunk + received);
+            size_t used = 0;
+            while (reader.buffer.size() - used >= 2) {
+                size_t length = 2 + GetLe(reader.buffer.data() + used, 2);
+                if (reader.buffer.size() - used < length) {
+                    break;
+                }
+                Consume(reader, reader.buffer.data() + used, length);
+                used += length;
+            }
+            reader.buffer.erase(reader.buffer.begin(), reader.buffer.begin() + used);
+        }
+    }
+
+    // Polls every reader until done() or the timeout
+    template <typename Done>
+    bool Pump(std::vector<Reader>& readers, Done done, int timeoutMs) {
+        std::vector<pollfd> fds(readers.size());
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!done()) {
+            if (Clock::now() > deadline) {
+                return false;
+            }
+            for (size_t i = 0; i < readers.size(); ++i) {
+                fds[i] = { readers[i].closed ? -1 : readers[i].socket, POLLIN, 0 };
+            }
+            if (poll(fds.data(), fds.size(), 10) > 0) {
+                for (size_t i = 0; i < readers.size(); ++i) {
+                    if (fds[i].revents != 0) {
+                        Read(readers[i]);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    uint16_t StartOnFreePort(NetPublisher& publisher, HrNetFormat format) {
+        for (uint16_t port = 47310; port < 47410; ++port) {
+            if (publisher.Start(port, format, false, nullptr)) {
+                return port;
+            }
+        }
+        return 0;
+    }
+
+    void CheckLoad() {
+        auto publisher = std::make_unique<NetPublisher>();
+        uint16_t port = StartOnFreePort(*publisher, HrNetFormatBinary);
+        if (port == 0) {
+            Fail("could not start the publisher");
+            return;
+        }
+
+        std::vector<Reader> readers;
+        for (int i = 0; i < kTcpClients; ++i) {
+            Reader reader;
+            reader.socket = ConnectTcp(port);
+            if (reader.socket == INVALID_SOCKET) {
+                Fail("TCP connect failed");
+                break;
+            }
+            readers.push_back(std::move(reader));
+        }
+        sockaddr_in server = Loopback(port);
+        for (int i = 0; i < kUdpSubscribers; ++i) {
+            Reader reader;
+            reader.stream = false;
+            reader.socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            NetSetNonBlocking(reader.socket);
+            sendto(reader.socket, "hi", 2, 0, reinterpret_cast<sockaddr*>(&server), sizeof(server));
+            readers.push_back(std::move(reader));
+        }
+        HrNetStats stats{};
+        if (!WaitFor([&] {
+            publisher->Snapshot(stats);
+            return stats.tcpClients == kTcpClients && stats.udpSubscribers == kUdpSubscribers;
+        }, 10000)) {
+            std::fprintf(stderr, "netpublisher_test: %u TCP clients, %u UDP subscribers registered\n",
+                stats.tcpClients, stats.udpSubscribers);
+            Fail("not every client was registered");
+        }
+
+        LatencyHistogram publishNs;
+        std::thread notifier([&] {
+            auto next = Clock::now();
+            for (uint64_t sequence = 1; sequence <= kSamples; ++sequence) {
+                HrSample sample = MakeSample(sequence);
+                auto before = Clock::now();
+                publisher->Publish(sample);
+                publishNs.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+                next += std::chrono::milliseconds(2);
+                std::this_thread::sleep_until(next);
+            }
+        });
+        bool complete = Pump(readers, [&] {
+            for (const Reader& reader : readers) {
+                if (reader.lastSequence != kSamples && !reader.bad && !reader.closed) {
+                    return false;
+                }
+            }
+            return true;
+        }, 20000);
+        notifier.join();
+
+        publisher->Snapshot(stats);
+        uint64_t missing = 0;
+        int bad = 0;
+        int incomplete = 0;
+        for (const Reader& reader : readers) {
+            bad += reader.bad || reader.closed ? 1 : 0;
+            incomplete += reader.lastSequence != kSamples ? 1 : 0;
+            if (reader.stream) {
+                missing += kSamples - reader.received;
+            }
+        }
+        if (!complete || incomplete != 0) {
+            std::fprintf(stderr, "netpublisher_test: %d clients did not see the last sample\n", incomplete);
+            Fail("not every client was served to the end");
+        }
+        if (bad != 0) {
+            std::fprintf(stderr, "netpublisher_test: %d clients saw a bad frame or were closed\n", bad);
+            Fail("malformed or out-of-order frames");
+        }
+        if (missing > stats.framesDropped) {
+            Fail("TCP clients missed frames that were not counted as dropped");
+        }
+        if (stats.framesPublished != kSamples) {
+            Fail("framesPublished does not match");
+        }
+        if (publishNs.Percentile(99) > 1000000) {
+            std::fprintf(stderr, "netpublisher_test: Publish p99 %llu ns\n",
+                static_cast<unsigned long long>(publishNs.Percentile(99)));
+            Fail("Publish is slow with many clients");
+        }
+        std::printf("netpublisher_test: %d TCP + %d UDP clients, %llu TCP frames skipped, Publish p50 %llu ns p99 %llu ns max %llu ns\n",
+            kTcpClients, kUdpSubscribers, static_cast<unsigned long long>(missing),
+            static_cast<unsigned long long>(publishNs.Percentile(50)),
+            static_cast<unsigned long long>(publishNs.Percentile(99)), static_cast<unsigned long long>(publishNs.Max()));
+
+        // "bye" unsubscribes right away rather than after the 30 s expiry
+        for (Reader& reader : readers) {
+            if (!reader.stream) {
+                sendto(reader.socket, "bye", 3, 0, reinterpret_cast<sockaddr*>(&server), sizeof(server));
+            }
+        }
+        if (!WaitFor([&] { publisher->Snapshot(stats); return stats.udpSubscribers == 0; }, 5000)) {
+            Fail("\"bye\" did not unsubscribe");
+        }
+
+        // Stop closes every TCP client
+        publisher->Stop();
+        bool closed = Pump(readers, [&] {
+            for (const Reader& reader : readers) {
+                if (reader.stream && !reader.closed) {
+                    return false;
+                }
+            }
+            return true;
+        }, 5000);
+        if (!closed) {
+            Fail("Stop left clients connected");
+        }
+        for (Reader& reader : readers) {
+            closesocket(reader.socket);
+        }
+    }
+
+    // One client never reads while another keeps up: the stalled one only costs dropped frames
+    void CheckStalledClient() {
+        constexpr uint64_t kBurst = 150000; // ~5.7 MB: more than the loopback socket buffers grow to
+        auto publisher = std::make_unique<NetPublisher>();
+        uint16_t port = StartOnFreePort(*publisher, HrNetFormatBinary);
+        SOCKET stalled = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        int small = 1024;
+        setsockopt(stalled, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&small), sizeof(small));
+        sockaddr_in address = Loopback(port);
+        std::vector<Reader> readers(1);
+        readers[0].socket = ConnectTcp(port);
+        HrNetStats stats{};
+        if (port == 0 || connect(stalled, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || readers[0].socket == INVALID_SOCKET
+            || !WaitFor([&] { publisher->Snapshot(stats); return stats.tcpClients == 2; }, 5000)) {
+            Fail("stalled-client setup failed");
+            closesocket(stalled);
+            closesocket(readers[0].socket);
+            return;
+        }
+        std::thread notifier([&] {
+            for (uint64_t sequence = 1; sequence <= kBurst; ++sequence) {
+                publisher->Publish(MakeSample(sequence));
+                if (sequence % 32 == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+        });
+        bool complete = Pump(readers, [&] { return readers[0].lastSequence == kBurst || readers[0].bad || readers[0].closed; }, 20000);
+        notifier.join();
+        publisher->Snapshot(stats);
+        if (!complete || readers[0].lastSequence != kBurst || readers[0].bad || readers[0].closed) {
+            Fail("a stalled client held up a live one");
+        }
+        // What the stalled client finally reads is still well-formed and in order, with a gap
+        // where it was skipped ahead, or up to where it was cut off
+        readers.resize(1);
+        readers[0] = Reader{};
+        readers[0].socket = stalled;
+        NetSetNonBlocking(stalled);
+        Pump(readers, [&] { return readers[0].lastSequence == kBurst || readers[0].bad || readers[0].closed; }, 5000);
+        if (readers[0].bad) {
+            Fail("stalled client got a torn frame");
+        }
+        if (!readers[0].closed && (readers[0].received == kBurst || stats.framesDropped == 0)) {
+            Fail("a stalled client was never skipped ahead");
+        }
+        std::printf("netpublisher_test: stalled client: %llu of %llu frames read, %llu dropped%s\n",
+            static_cast<unsigned long long>(readers[0].received), static_cast<unsigned long long>(kBurst),
+            static_cast<unsigned long long>(stats.framesDropped), readers[0].closed ? ", then disconnected" : "");
+        publisher->Stop();
+        closesocket(stalled);
+    }
+
+    void CheckJson() {
+        auto publisher = std::make_unique<NetPublisher>();
+        uint16_t port = StartOnFreePort(*publisher, HrNetFormatJson);
+        SOCKET client = port != 0 ? ConnectTcp(port) : INVALID_SOCKET;
+        HrNetStats stats{};
+        if (client == INVALID_SOCKET || !WaitFor([&] { publisher->Snapshot(stats); return stats.tcpClients == 1; }, 5000)) {
+            Fail("JSON client did not connect");
+            if (client != INVALID_SOCKET) {
+                closesocket(client);
+            }
+            return;
+        }
+        publisher->Publish(MakeSample(7));
+        std::string text;
+        WaitFor([&] {
+            char chunk[512];
+            int received = static_cast<int>(recv(client, chunk, sizeof(chunk), 0));
+            if (received > 0) {
+                text.append(chunk, static_cast<size_t>(received));
+            }
+            return text.find('\n') != std::string::npos;
+        }, 5000);
+        if (text != "{\"device\":212205442170881,\"seq\":7,\"t\":14000,\"bpm\":67,\"energy\":0,\"flags\":22,\"rr\":[800]}\n") {
+            std::fprintf(stderr, "netpublisher_test: JSON frame %s", text.c_str());
+            Fail("unexpected JSON frame");
+        }
+        publisher->Stop();
+        closesocket(client);
+    }
+}
+
+int main() {
+    CheckLoad();
+    CheckStalledClient();
+    CheckJson();
+    if (g_failures == 0) {
+        std::printf("netpublisher_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
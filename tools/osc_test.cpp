@@ -0,0 +1,262 @@
+// osc_test: loopback test of the OSC output. A UDP socket on 127.0.0.1 receives what the
+// emitter sends and parses every datagram as an OSC bundle from scratch: "#bundle", timetag 1
+// (immediately), then one size-prefixed message per element with a padded address, a ",i"
+// type tag and a big-endian int32. Each bundle must carry /hr/<device>/bpm and one
+// /hr/<device>/rr (milliseconds) per RR interval, across device switches (the templates are
+// rebuilt) and every RR count up to the cap. Also: Publish cost and arrival latency, nothing
+// sent after Close, and bad Open arguments.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o osc_test osc_test.cpp ../OscEmitter.cpp
+//
+// Linux only (POSIX sockets). Exit code 0 if every check passed, 1 otherwise.
+#include "LatencyHistogram.h"
+#include "OscEmitter.h"
+#include <poll.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint64_t kSamples = 2000;
+    constexpr uint64_t kDevices[] = { 0xC0FFEE000001ull, 0x0000000000A5ull, 0xFEDCBA987654ull };
+
+    int g_failures = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "osc_test: %s\n", what);
+        ++g_failures;
+    }
+
+    uint32_t GetBe32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    struct Message {
+        std::string address;
+        int32_t argument = 0;
+    };
+
+    // Reads a null-terminated OSC string padded with zeros to a multiple of 4
+    bool ParseString(const uint8_t*& p, const uint8_t* end, std::string& text) {
+        const uint8_t* terminator = static_cast<const uint8_t*>(memchr(p, 0, end - p));
+        if (!terminator) {
+            return false;
+        }
+        size_t padded = (terminator - p + 4) & ~static_cast<size_t>(3);
+        if (padded > static_cast<size_t>(end - p)) {
+            return false;
+        }
+        for (const uint8_t* q = terminator; q < p + padded; ++q) {
+            if (*q != 0) {
+                return false;
+            }
+        }
+        text.assign(reinterpret_cast<const char*>(p), terminator - p);
+        p += padded;
+        return true;
+    }
+
+    // Parses a whole datagram; false unless it is a bundle of ",i" messages with nothing left over
+    bool ParseBundle(const uint8_t* data, size_t length, std::vector<Message>& messages) {
+        static constexpr uint8_t kHeader[16] = { '#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+        messages.clear();
+        if (length < sizeof(kHeader) || memcmp(data, kHeader, sizeof(kHeader)) != 0) {
+            return false;
+        }
+        const uint8_t* p = data + sizeof(kHeader);
+        const uint8_t* end = data + length;
+        while (p < end) {
+            if (end - p < 4) {
+                return false;
+            }
+            uint32_t size = GetBe32(p);
+            p += 4;
+            if (size % 4 != 0 || size > static_cast<size_t>(end - p)) {
+                return false;
+            }
+            const uint8_t* elementEnd = p + size;
+            Message message;
+            std::string tags;
+            if (!ParseString(p, elementEnd, message.address) || !ParseString(p, elementEnd, tags) ||
+                tags != ",i" || elementEnd - p != 4) {
+                return false;
+            }
+            message.argument = static_cast<int32_t>(GetBe32(p));
+            p = elementEnd;
+            messages.push_back(message);
+        }
+        return true;
+    }
+
+    HrSample MakeSample(uint64_t sequence) {
+        HrSample sample{};
+        sample.deviceAddress = kDevices[(sequence / 5) % 3]; // Switch device every 5 samples
+        sample.sequence = sequence;
+        sample.bpm = static_cast<uint16_t>(sequence % 300);
+        sample.rrCount = static_cast<uint8_t>(sequence % (kHrSampleMaxRr + 1));
+        for (uint8_t i = 0; i < sample.rrCount; ++i) {
+            sample.rr[i] = static_cast<uint16_t>(sequence * 7 + i * 131); // Spread of roundings
+        }
+        return sample;
+    }
+
+    std::string Address(uint64_t device, const char* leaf) {
+        char address[40];
+        std::snprintf(address, sizeof(address), "/hr/%012llX/%s", static_cast<unsigned long long>(device), leaf);
+        return address;
+    }
+
+    bool Matches(const std::vector<Message>& messages, const HrSample& sample) {
+        size_t rrCount = sample.rrCount < kHrSampleMaxRr ? sample.rrCount : kHrSampleMaxRr;
+        if (messages.size() != 1 + rrCount) {
+            return false;
+        }
+        if (messages[0].address != Address(sample.deviceAddress, "bpm") || messages[0].argument != sample.bpm) {
+            return false;
+        }
+        std::string rrAddress = Address(sample.deviceAddress, "rr");
+        for (size_t i = 0; i < rrCount; ++i) {
+            // Milliseconds, rounded to nearest
+            int32_t expected = static_cast<int32_t>((static_cast<uint64_t>(sample.rr[i]) * 1000 + 512) / 1024);
+            if (messages[1 + i].address != rrAddress || messages[1 + i].argument != expected) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Waits up to timeoutMs for one datagram; its length, or -1 if none came
+    int Receive(int socket, uint8_t* buffer, size_t size, int timeoutMs) {
+        pollfd entry{ socket, POLLIN, 0 };
+        if (poll(&entry, 1, timeoutMs) <= 0) {
+            return -1;
+        }
+        return static_cast<int>(recv(socket, buffer, size, 0));
+    }
+
+    int OpenReceiver(uint16_t& port) {
+        int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (s < 0 || bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            getsockname(s, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            return -1;
+        }
+        port = ntohs(address.sin_port);
+        return s;
+    }
+
+    void CheckBundles(int receiver, uint16_t port) {
+        OscEmitter emitter;
+        if (!emitter.Open("127.0.0.1", port)) {
+            Fail("Open failed");
+            return;
+        }
+        LatencyHistogram publishNs;
+        LatencyHistogram arrivalUs;
+        uint8_t buffer[2048];
+        std::vector<Message> messages;
+        int lost = 0;
+        int bad = 0;
+        // One at a time so a full receive buffer cannot drop any
+        for (uint64_t sequence = 1; sequence <= kSamples; ++sequence) {
+            HrSample sample = MakeSample(sequence);
+            auto before = Clock::now();
+            emitter.Publish(sample);
+            auto published = Clock::now();
+            int length = Receive(receiver, buffer, sizeof(buffer), 1000);
+            auto arrived = Clock::now();
+            publishNs.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(published - before).count()));
+            if (length < 0) {
+                ++lost;
+                continue;
+            }
+            arrivalUs.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(arrived - before).count()));
+            if (!ParseBundle(buffer, static_cast<size_t>(length), messages) || !Matches(messages, sample)) {
+                if (bad++ == 0) {
+                    std::fprintf(stderr, "osc_test: first bad bundle is sample %llu (%d bytes)\n",
+                        static_cast<unsigned long long>(sequence), length);
+                }
+            }
+        }
+        if (lost != 0) {
+            std::fprintf(stderr, "osc_test: %d bundles never arrived\n", lost);
+            Fail("bundles lost on loopback");
+        }
+        if (bad != 0) {
+            std::fprintf(stderr, "osc_test: %d bundles malformed or wrong\n", bad);
+            Fail("bundle contents do not match the samples");
+        }
+
+        // An RR count past the cap sends the capped number of intervals, not garbage
+        HrSample sample = MakeSample(kHrSampleMaxRr);
+        sample.rrCount = 200;
+        emitter.Publish(sample);
+        int length = Receive(receiver, buffer, sizeof(buffer), 1000);
+        if (length < 0 || !ParseBundle(buffer, static_cast<size_t>(length), messages) ||
+            messages.size() != 1 + kHrSampleMaxRr) {
+            Fail("an RR count past the cap is not clamped");
+        }
+
+        if (publishNs.Percentile(99) > 1000000) {
+            Fail("Publish is slow");
+        }
+        std::printf("osc_test: %llu bundles, Publish p50 %llu ns p99 %llu ns, arrival p50 %llu us p99 %llu us\n",
+            static_cast<unsigned long long>(kSamples), static_cast<unsigned long long>(publishNs.Percentile(50)),
+            static_cast<unsigned long long>(publishNs.Percentile(99)),
+            static_cast<unsigned long long>(arrivalUs.Percentile(50)),
+            static_cast<unsigned long long>(arrivalUs.Percentile(99)));
+
+        emitter.Close();
+        emitter.Publish(MakeSample(1));
+        if (Receive(receiver, buffer, sizeof(buffer), 100) >= 0) {
+            Fail("Publish after Close still sends");
+        }
+
+        // Reopening works and starts from fresh templates
+        if (!emitter.Open("127.0.0.1", port)) {
+            Fail("reopen failed");
+            return;
+        }
+        sample = MakeSample(7);
+        emitter.Publish(sample);
+        length = Receive(receiver, buffer, sizeof(buffer), 1000);
+        if (length < 0 || !ParseBundle(buffer, static_cast<size_t>(length), messages) || !Matches(messages, sample)) {
+            Fail("bundle after reopen is wrong");
+        }
+    }
+
+    void CheckOpenArguments() {
+        OscEmitter emitter;
+        if (emitter.Open(nullptr, 9000) || emitter.Open("127.0.0.1", 0)) {
+            Fail("Open accepts a missing host or port 0");
+        }
+        if (emitter.Open("no-such-host.invalid", 9000)) {
+            Fail("Open accepts an unresolvable host");
+        }
+        emitter.Publish(MakeSample(1)); // Not open: must be a no-op
+    }
+}
+
+int main() {
+    uint16_t port = 0;
+    int receiver = OpenReceiver(port);
+    if (receiver < 0) {
+        Fail("cannot bind the loopback receiver");
+        return 1;
+    }
+    CheckBundles(receiver, port);
+    CheckOpenArguments();
+    close(receiver);
+    if (g_failures == 0) {
+        std::printf("osc_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+// prewarm_bench: time to first sample (TTFS) of the real session engine on a fake strap, with
+// and without pre-warm, on a virtual clock. Operation latencies are drawn from ranges typical
+// of a Windows stack (device enumeration dominates the cold path) and the strap's 1 Hz
+// notifications start at a random phase, so the numbers are what a host would see, minus the
+// radio's own variance.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o prewarm_bench prewarm_bench.cpp ../SessionEngine.cpp
+//       ../FakeTransport.cpp ../FaultInjector.cpp ../LinkStats.cpp ../StartupProfile.cpp
+//       ../StreamWatchdog.cpp ../TimerWheel.cpp
+//
+//   ./prewarm_bench [--runs 1000] [--seed 1]
+//
+// Modes: cold (no candidate: scan, then connect), warm (candidate in range), gone (candidate
+// heard but no longer there: falls back to the scan), throw (opening the candidate fails in the
+// stack: falls back to the scan). Prints one JSON object with p50/p99/max TTFS per mode, in ms.
+#include "FakeTransport.h"
+#include "LinkStats.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr uint64_t kStrap = 0xC0FFEE000001ull;
+    constexpr uint8_t kPayload[4] = { 0x10, 72, 0x00, 0x04 };
+    constexpr int64_t kGiveUpUs = 60000000;
+
+    enum Mode { Cold, Warm, Gone, Throw, ModeCount };
+    const char* const kModeNames[ModeCount] = { "cold", "warm", "gone", "throw" };
+
+    struct Latencies {
+        std::mt19937 random;
+        int connects = 0;
+        HrTransportResult firstConnect{ HrErrorNone, 0 }; // How the candidate's connect turns out
+
+        uint32_t Between(uint32_t low, uint32_t high) {
+            return std::uniform_int_distribution<uint32_t>(low, high)(random);
+        }
+    };
+
+    FakeOutcome Draw(void* context, FakeOp op) {
+        auto latencies = static_cast<Latencies*>(context);
+        FakeOutcome outcome;
+        switch (op) {
+        case FakeOp::Scan:
+            outcome.latencyMs = latencies->Between(800, 2500);
+            break;
+        case FakeOp::Connect:
+            outcome.latencyMs = latencies->Between(150, 600);
+            if (latencies->connects++ == 0) {
+                outcome.result = latencies->firstConnect;
+            }
+            break;
+        case FakeOp::Discover:
+            outcome.latencyMs = latencies->Between(200, 800);
+            break;
+        default:
+            outcome.latencyMs = latencies->Between(40, 120);
+            break;
+        }
+        return outcome;
+    }
+
+    class BenchHost final : public SessionHost {
+    public:
+        explicit BenchHost(SessionRuntime& runtime) : transport(std::make_shared<FakeTransport>(runtime, kStrap)) {}
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return transport; }
+        void OnStatus(HrState, HrErrorCategory, int32_t, uint64_t) override {}
+        void OnSample(const HrSample&) override { ++samples; }
+        uint64_t WarmAddress(int64_t) override { return warmAddress; }
+
+        std::shared_ptr<FakeTransport> transport;
+        uint64_t warmAddress = 0;
+        uint64_t samples = 0;
+    };
+
+    // One Start until the first sample; microseconds, or -1 if none came
+    int64_t MeasureOnce(Mode mode, std::mt19937& random) {
+        VirtualRuntime runtime;
+        BenchHost host(runtime);
+        LinkStats stats;
+        StartupProfiler startup;
+        SessionEngine engine(runtime, host, stats, startup);
+        Latencies latencies{ std::mt19937(random()) };
+        if (mode == Gone) {
+            latencies.firstConnect = { HrErrorDeviceUnavailable, 0 };
+        }
+        else if (mode == Throw) {
+            latencies.firstConnect = { HrErrorWinRt, static_cast<int32_t>(0x80004005) };
+        }
+        host.transport->SetScript(&Draw, &latencies);
+        host.warmAddress = mode == Cold ? 0 : kStrap;
+
+        int64_t nextNotifyUs = std::uniform_int_distribution<int64_t>(0, 999999)(random);
+        if (engine.Start(runtime.NowUs(), 1000) != 0) {
+            return -1;
+        }
+        while (host.samples == 0 && runtime.NowUs() < kGiveUpUs) {
+            runtime.AdvanceTo(nextNotifyUs);
+            host.transport->Notify(kPayload, sizeof(kPayload));
+            nextNotifyUs += 1000000;
+        }
+        int64_t ttfsUs = host.samples != 0 ? runtime.NowUs() : -1;
+        engine.StopAsync();
+        runtime.AdvanceTo(runtime.NowUs() + 2000000);
+        return ttfsUs;
+    }
+
+    double PercentileMs(std::vector<int64_t>& values, double p) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size()));
+        return values[std::min(rank, values.size() - 1)] / 1000.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    int runs = 1000;
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--runs")) {
+            runs = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--seed")) {
+            seed = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    std::printf("{\"runs\":%d", runs);
+    for (int mode = 0; mode < ModeCount; ++mode) {
+        std::mt19937 random(seed); // Same draws for every mode
+        std::vector<int64_t> ttfsUs;
+        int failed = 0;
+        for (int run = 0; run < runs; ++run) {
+            int64_t us = MeasureOnce(static_cast<Mode>(mode), random);
+            if (us < 0) {
+                ++failed;
+            }
+            else {
+                ttfsUs.push_back(us);
+            }
+        }
+        std::printf(",\"%s\":{\"p50_ms\":%.1f,\"p99_ms\":%.1f,\"max_ms\":%.1f,\"failed\":%d}", kModeNames[mode],
+            PercentileMs(ttfsUs, 50), PercentileMs(ttfsUs, 99), PercentileMs(ttfsUs, 100), failed);
+    }
+    std::printf("}\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+// samplequeue_bench: steady-state cost of the every-sample queue (pooled records, recycled on
+// Pop) versus the per-event allocation it replaced: a std::make_shared record per sample in a
+// mutex-guarded deque, the oldest dropped when full. Two runs per queue:
+//   burst     - one thread pushes 64 samples then polls them back, so the queue never overflows:
+//               the per-sample cost of the storage itself
+//   contended - producers push at full speed (the notification path) while one consumer polls
+//               the queue dry (PollSamples); the consumer can't keep up, so overflow is exercised
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o samplequeue_bench samplequeue_bench.cpp ../SampleQueue.cpp
+//
+//   ./samplequeue_bench [--producers 1] [--capacity 1024] [--ms 1000]
+//
+// Prints one JSON object: for each queue and run, pushes and pops per second and the push
+// p50/p99/max in ns; samples lost to a full queue for the contended run.
+#include "LatencyHistogram.h"
+#include "SampleQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    int64_t NowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    class SharedQueue {
+    public:
+        bool Reserve(uint32_t capacity) {
+            m_capacity = capacity;
+            return true;
+        }
+        void Push(const HrSample& sample) {
+            auto record = std::make_shared<HrSample>(sample);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.size() >= m_capacity) {
+                m_queue.pop_front();
+                ++m_overflows;
+            }
+            m_queue.push_back(std::move(record));
+        }
+        bool Pop(HrSample& out) {
+            std::shared_ptr<HrSample> record;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_queue.empty()) {
+                    return false;
+                }
+                record = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            out = *record;
+            return true;
+        }
+        uint64_t Overflows() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_overflows;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::deque<std::shared_ptr<HrSample>> m_queue;
+        size_t m_capacity = 0;
+        uint64_t m_overflows = 0;
+    };
+
+    constexpr int kBurst = 64;
+
+    struct Rates {
+        double pushesPerS = 0;
+        double popsPerS = 0;
+        LatencyHistogram pushNs;
+        uint64_t overflows = 0;
+    };
+
+    HrSample MakeSample(uint64_t device, uint64_t sequence) {
+        HrSample sample{};
+        sample.deviceAddress = device;
+        sample.sequence = sequence;
+        sample.bpm = static_cast<uint16_t>(60 + sequence % 100);
+        sample.flags = 0x10;
+        sample.rrCount = 2;
+        return sample;
+    }
+
+    template <typename Queue>
+    void Burst(Queue& queue, int ms, Rates& rates) {
+        uint64_t pushes = 0;
+        uint64_t pops = 0;
+        HrSample out{};
+        auto begin = Clock::now();
+        auto end = begin + std::chrono::milliseconds(ms);
+        while (Clock::now() < end) {
+            for (int k = 0; k < kBurst; ++k) {
+                HrSample sample = MakeSample(1, ++pushes);
+                int64_t before = NowNs();
+                queue.Push(sample);
+                rates.pushNs.Record(static_cast<uint64_t>(NowNs() - before));
+            }
+            while (queue.Pop(out)) {
+                ++pops;
+            }
+        }
+        double elapsedS = std::chrono::duration<double>(Clock::now() - begin).count();
+        rates.pushesPerS = static_cast<double>(pushes) / elapsedS;
+        rates.popsPerS = static_cast<double>(pops) / elapsedS;
+    }
+
+    template <typename Queue>
+    void Contended(Queue& queue, int producers, int ms, Rates& rates) {
+        uint64_t overflowsBefore = queue.Overflows();
+        std::atomic<bool> running{ true };
+        std::atomic<uint64_t> pushes{ 0 };
+        std::vector<LatencyHistogram> pushNs(static_cast<size_t>(producers));
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                uint64_t count = 0;
+                while (running.load(std::memory_order_relaxed)) {
+                    HrSample sample = MakeSample(static_cast<uint64_t>(p) + 1, ++count);
+                    int64_t before = NowNs();
+                    queue.Push(sample);
+                    pushNs[static_cast<size_t>(p)].Record(static_cast<uint64_t>(NowNs() - before));
+                }
+                pushes.fetch_add(count);
+            });
+        }
+
+        uint64_t pops = 0;
+        HrSample sample{};
+        auto begin = Clock::now();
+        auto end = begin + std::chrono::milliseconds(ms);
+        while (Clock::now() < end) {
+            bool any = false;
+            while (queue.Pop(sample)) {
+                ++pops;
+                any = true;
+            }
+            if (!any) {
+                std::this_thread::yield();
+            }
+        }
+        double elapsedS = std::chrono::duration<double>(Clock::now() - begin).count();
+        running = false;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        while (queue.Pop(sample)) {
+        }
+        for (const LatencyHistogram& histogram : pushNs) {
+            rates.pushNs.Merge(histogram);
+        }
+        rates.pushesPerS = static_cast<double>(pushes.load()) / elapsedS;
+        rates.popsPerS = static_cast<double>(pops) / elapsedS;
+        rates.overflows = queue.Overflows() - overflowsBefore;
+    }
+
+    void Print(const char* name, const Rates& rates) {
+        std::printf(",\"%s\":{\"pushes_per_s\":%.0f,\"pops_per_s\":%.0f,\"push_p50_ns\":%llu,\"push_p99_ns\":%llu,"
+            "\"push_max_ns\":%llu,\"overflows\":%llu}", name, rates.pushesPerS, rates.popsPerS,
+            static_cast<unsigned long long>(rates.pushNs.Percentile(50)),
+            static_cast<unsigned long long>(rates.pushNs.Percentile(99)),
+            static_cast<unsigned long long>(rates.pushNs.Max()),
+            static_cast<unsigned long long>(rates.overflows));
+    }
+}
+
+int main(int argc, char** argv) {
+    int producers = 1;
+    uint32_t capacity = 1024;
+    int ms = 1000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--producers")) {
+            producers = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--capacity")) {
+            capacity = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--ms")) {
+            ms = std::atoi(argv[i + 1]);
+        }
+    }
+    if (producers < 1) {
+        producers = 1;
+    }
+    if (capacity == 0) {
+        capacity = 1024;
+    }
+
+    auto pooled = std::make_unique<SampleQueue>();
+    auto shared = std::make_unique<SharedQueue>();
+    if (!pooled->Reserve(capacity) || !shared->Reserve(capacity)) {
+        std::fprintf(stderr, "samplequeue_bench: could not reserve %u records\n", capacity);
+        return 1;
+    }
+    auto rates = std::make_unique<Rates[]>(4);
+    Burst(*pooled, ms, rates[0]);
+    Burst(*shared, ms, rates[1]);
+    Contended(*pooled, producers, ms, rates[2]);
+    Contended(*shared, producers, ms, rates[3]);
+
+    std::printf("{\"producers\":%d,\"capacity\":%u", producers, capacity);
+    Print("pooled_burst", rates[0]);
+    Print("make_shared_burst", rates[1]);
+    Print("pooled_contended", rates[2]);
+    Print("make_shared_contended", rates[3]);
+    std::printf("}\n");
+    return 0;
+}
@@ -0,0 +1,118 @@
+// samplequeue_test: a producer far ahead of the consumer loses exactly the samples counted as
+// overflows; and producers keep pushing while the consumer pops and another thread re-Reserves
+// the queue, without a popped record ever being torn or recycled under a producer. Build with
+// -fsanitize=thread to check the Reserve/Push handshake as well.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o samplequeue_test samplequeue_test.cpp ../SampleQueue.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "SampleQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+    int g_failures = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "samplequeue_test: %s\n", what);
+        ++g_failures;
+    }
+
+    // Single producer far ahead of the consumer: every push past capacity is one overflow
+    void CheckOverflowAccounting() {
+        SampleQueue queue;
+        if (!queue.Reserve(64)) {
+            Fail("Reserve(64) failed");
+            return;
+        }
+        for (uint32_t i = 0; i < 1000; ++i) {
+            HrSample sample{};
+            sample.sequence = i;
+            queue.Push(sample);
+        }
+        if (queue.Overflows() != 1000 - 64) {
+            Fail("overflows do not match the samples lost");
+        }
+        HrSample sample{};
+        uint32_t expected = 1000 - 64;
+        while (queue.Pop(sample)) {
+            if (sample.sequence != expected++) {
+                Fail("queue did not keep the newest samples in order");
+                return;
+            }
+        }
+        if (expected != 1000) {
+            Fail("queue lost samples it should have kept");
+        }
+    }
+
+    void CheckConcurrentReserve() {
+        constexpr int kProducers = 4;
+        SampleQueue queue;
+        queue.Reserve(256);
+        std::atomic<bool> producing{ true };
+        std::atomic<uint64_t> popped{ 0 };
+        std::atomic<int> corrupt{ 0 };
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p) {
+            producers.emplace_back([&queue, &producing, p] {
+                for (uint32_t i = 0; producing.load(std::memory_order_relaxed); ++i) {
+                    HrSample sample{};
+                    sample.deviceAddress = static_cast<uint64_t>(p) + 1;
+                    sample.sequence = i;
+                    sample.bpm = static_cast<uint16_t>(p * 7 + 1);
+                    queue.Push(sample);
+                }
+            });
+        }
+        std::thread consumer([&] {
+            HrSample sample{};
+            while (producing.load()) {
+                if (queue.Pop(sample)) {
+                    popped.fetch_add(1);
+                    if (sample.deviceAddress == 0 || sample.bpm != (sample.deviceAddress - 1) * 7 + 1) {
+                        corrupt.fetch_add(1);
+                    }
+                }
+            }
+        });
+        std::thread reserver([&] {
+            uint32_t sizes[] = { 128, 0, 512, 256 };
+            for (int i = 0; producing.load(); ++i) {
+                queue.Reserve(sizes[i % 4]);
+                // Long enough open for the consumer to get a turn when every thread shares one core
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        });
+        // At least 300 ms, and until the consumer got something (10 s at most)
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        while (popped.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        producing = false;
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        reserver.join();
+        consumer.join();
+        if (corrupt.load() != 0) {
+            Fail("popped a sample that was torn or recycled while in use");
+        }
+        if (popped.load() == 0) {
+            Fail("consumer never got a sample");
+        }
+    }
+}
+
+int main() {
+    CheckOverflowAccounting();
+    CheckConcurrentReserve();
+    if (g_failures == 0) {
+        std::printf("samplequeue_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,334 @@
+// sessionengine_test: drives the session engine over FakeTransport on a virtual clock: connect
+// and stream, reconnect after a lost link, watchdog escalation on a silent strap, connect
+// timeout, stop, stop linger, faults injected at the transport seam, a pre-warmed connect and
+// its fallback to the scan; and, on the threaded
+// runtime, a blocking Stop and one that must give up on a wedged radio within its deadline.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o sessionengine_test sessionengine_test.cpp ../SessionEngine.cpp
+//       ../FakeTransport.cpp ../FaultInjector.cpp ../LinkStats.cpp ../StartupProfile.cpp
+//       ../StreamWatchdog.cpp ../TimerWheel.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "FakeTransport.h"
+#include "FaultInjector.h"
+#include "LinkStats.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    constexpr uint64_t kStrap = 0xC0FFEE000001ull;
+    constexpr uint8_t kPayload[4] = { 0x10, 72, 0x00, 0x04 }; // 72 bpm, one RR of 1024/1024 s
+
+    int g_failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "sessionengine_test: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    struct Event {
+        HrState state;
+        HrErrorCategory category;
+    };
+
+    class TestHost final : public SessionHost {
+    public:
+        explicit TestHost(SessionRuntime& runtime) : transport(std::make_shared<FakeTransport>(runtime, kStrap)) {}
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return wrapped ? wrapped : transport; }
+        void OnStatus(HrState state, HrErrorCategory category, int32_t, uint64_t) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            events.push_back({ state, category });
+        }
+        uint64_t WarmAddress(int64_t) override { return warmAddress; }
+        void OnSample(const HrSample& sample) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            lastSequence = sample.sequence;
+            lastTimestampUs = sample.timestampUs;
+            ++samples;
+        }
+
+        bool Saw(HrState state, HrErrorCategory category = HrErrorNone) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::any_of(events.begin(), events.end(),
+                [&](Event const& e) { return e.state == state && e.category == category; });
+        }
+        HrState Last() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return events.empty() ? HrStateIdle : events.back().state;
+        }
+        void Clear() {
+            std::lock_guard<std::mutex> lock(mutex);
+            events.clear();
+        }
+
+        std::shared_ptr<FakeTransport> transport;
+        std::shared_ptr<HrTransport> wrapped; // Handed out instead of transport when set
+        uint64_t warmAddress = 0;
+        std::mutex mutex;
+        std::vector<Event> events;
+        uint64_t samples = 0;
+        uint64_t lastSequence = 0;
+        int64_t lastTimestampUs = 0;
+    };
+
+    struct Rig {
+        VirtualRuntime runtime;
+        TestHost host{ runtime };
+        LinkStats stats;
+        StartupProfiler startup;
+        SessionEngine engine{ runtime, host, stats, startup };
+
+        void Run(int64_t forUs) {
+            runtime.AdvanceTo(runtime.NowUs() + forUs);
+        }
+        // One notification a second for seconds
+        void Stream(int seconds) {
+            for (int i = 0; i < seconds; ++i) {
+                host.transport->Notify(kPayload, sizeof(kPayload));
+                Run(1000000);
+            }
+        }
+    };
+
+    void ConnectStreamStop() {
+        Rig rig;
+        Check(rig.engine.Start(rig.runtime.NowUs(), 1000) == 0, "start");
+        Check(rig.engine.Start(rig.runtime.NowUs(), 1000) == -1, "second start while running");
+        rig.Run(1000000);
+        Check(rig.host.transport->Subscribed(), "subscribed after connect");
+        Check(rig.host.Saw(HrStateScanning) && rig.host.Saw(HrStateDiscovering) && rig.host.Last() == HrStateStreaming,
+            "scan, discover, stream");
+        rig.Stream(5);
+        Check(rig.host.samples == 5 && rig.host.lastSequence == 5, "five samples, sequence 1..5");
+        HrStartupProfile profile{};
+        Check(rig.startup.Profile(0, profile) && profile.outcome == HrErrorNone, "startup profile completed");
+
+        Check(rig.engine.StopAsync() == 0, "stop");
+        rig.Run(1000000);
+        Check(!rig.engine.Active(), "stopped");
+        Check(rig.host.Last() == HrStateIdle && rig.host.Saw(HrStateStopping), "stopping, then idle");
+        Check(rig.host.transport->Operations(FakeOp::Unsubscribe) == 1, "CCCD cleared on stop");
+        Check(!rig.host.transport->Connected(), "disconnected on stop");
+        Check(rig.engine.StopAsync() == -1, "stop when idle");
+    }
+
+    void ReconnectAfterLinkLoss() {
+        Rig rig;
+        rig.engine.Start(rig.runtime.NowUs(), 1000);
+        rig.Run(1000000);
+        rig.Stream(3);
+        rig.host.transport->DropLink();
+        rig.Run(10000);
+        Check(rig.host.Saw(HrStateDisconnected) && rig.host.Saw(HrStateReconnecting), "link loss reported");
+        rig.host.Clear();
+        rig.Run(2000000); // 1 s backoff plus the connect
+        Check(rig.host.transport->Subscribed() && rig.host.Last() == HrStateStreaming, "reconnected");
+        Check(rig.host.transport->Operations(FakeOp::Scan) == 1, "reconnect goes straight to the strap");
+        rig.Stream(2);
+        Check(rig.host.lastSequence == 5, "sequence carries on across the reconnect");
+        rig.engine.StopAsync();
+        rig.Run(1000000);
+        Check(!rig.engine.Active(), "stopped after reconnect");
+    }
+
+    void WatchdogEscalates() {
+        Rig rig;
+        rig.engine.Start(rig.runtime.NowUs(), 1000);
+        rig.Run(1000000);
+        rig.Stream(10);
+        uint64_t subscribes = rig.host.transport->Operations(FakeOp::Subscribe);
+        rig.Run(7000000); // Silent: warn at 3 s, resubscribe at 6 s
+        Check(rig.host.Saw(HrStateStalled), "silence warned");
+        Check(rig.host.transport->Operations(FakeOp::Subscribe) == subscribes + 1, "resubscribed");
+        rig.Run(8000000); // Reconnect at 12 s
+        Check(rig.host.transport->Operations(FakeOp::Connect) >= 2, "reconnected after the resubscribe did not help");
+        rig.engine.StopAsync();
+        rig.Run(1000000);
+    }
+
+    FakeOutcome HangOnConnect(void*, FakeOp op) {
+        FakeOutcome outcome;
+        outcome.latencyMs = 10;
+        outcome.hang = op == FakeOp::Connect;
+        return outcome;
+    }
+
+    void ConnectTimeout() {
+        Rig rig;
+        rig.engine.connectTimeoutMs = 2000;
+        rig.host.transport->SetScript(&HangOnConnect, nullptr);
+        rig.engine.Start(rig.runtime.NowUs(), 1000);
+        rig.Run(3000000);
+        Check(rig.host.Saw(HrStateError, HrErrorTimeout), "connect timeout reported");
+        Check(!rig.engine.Active(), "session that never streamed ends on the timeout");
+    }
+
+    void LingerAndResume() {
+        Rig rig;
+        rig.engine.stopLingerMs = 5000;
+        rig.engine.Start(rig.runtime.NowUs(), 1000);
+        rig.Run(1000000);
+        rig.Stream(2);
+        Check(rig.engine.StopAsync() == 0 && rig.host.Last() == HrStateIdle, "parked on stop");
+        rig.Stream(2);
+        Check(rig.host.samples == 2 && rig.host.transport->Subscribed(), "parked: link kept, nothing delivered");
+        Check(rig.engine.Start(rig.runtime.NowUs(), 1000) == 0 && rig.host.Last() == HrStateStreaming, "resumed");
+        rig.Stream(1);
+        Check(rig.host.samples == 3, "delivering again");
+        Check(rig.host.transport->Operations(FakeOp::Connect) == 1, "resume did not reconnect");
+        rig.engine.StopAsync();
+        rig.Run(6000000);
+        Check(!rig.engine.Active() && !rig.host.transport->Connected(), "disconnected when the linger ran out");
+    }
+
+    void LateAndFailedAtTheSeam() {
+        FaultInjector faults;
+        Rig rig;
+        HrFaultConfig config{};
+        config.seed = 1;
+        config.delayRate = 1.0;
+        config.delayMinMs = 300;
+        config.delayMaxMs = 300;
+        faults.Configure(config);
+        rig.host.wrapped = std::make_shared<FaultyTransport>(rig.host.transport, faults, rig.runtime);
+        rig.engine.Start(rig.runtime.NowUs(), 1000);
+        rig.Run(1000000);
+        Check(rig.host.Last() == HrStateStreaming, "streaming through the faulty transport");
+        int64_t sentUs = rig.runtime.NowUs();
+        rig.host.transport->Notify(kPayload, sizeof(kPayload));
+        rig.host.transport->Notify(kPayload, sizeof(kPayload));
+        rig.Run(200000);
+        Check(rig.host.samples == 0, "late notifications held back");
+        rig.Run(200000);
+        Check(rig.host.samples == 2 && rig.host.lastSequence == 2, "late notifications delivered, in order");
+        Check(rig.host.lastTimestampUs >= sentUs + 300000, "stamped when they finally arrived");
+        HrFaultStats stats{};
+        faults.Snapshot(stats);
+        Check(stats.delayed == 2, "delays counted");
+        rig.engine.StopAsync();
+        rig.Run(1000000);
+        Check(!rig.engine.Active(), "stopped through the faulty transport");
+
+        Rig failing;
+        config = HrFaultConfig{};
+        config.seed = 1;
+        config.cccdFailureRate = 1.0;
+        faults.Configure(config);
+        failing.host.wrapped = std::make_shared<FaultyTransport>(failing.host.transport, faults, failing.runtime);
+        failing.engine.Start(failing.runtime.NowUs(), 1000);
+        failing.Run(1000000);
+        Check(failing.host.Saw(HrStateError, HrErrorSubscribeFailed), "injected CCCD failure ends a first connect");
+        Check(!failing.engine.Active(), "session ended");
+    }
+
+    // The first connect fails the way a throwing FromBluetoothAddressAsync does
+    FakeOutcome FailFirstConnect(void* context, FakeOp op) {
+        auto connects = static_cast<int*>(context);
+        FakeOutcome outcome;
+        outcome.latencyMs = 10;
+        if (op == FakeOp::Connect && (*connects)++ == 0) {
+            outcome.result = { HrErrorWinRt, static_cast<int32_t>(0x80004005) };
+        }
+        return outcome;
+    }
+
+    void PrewarmedConnect() {
+        Rig warm;
+        warm.host.warmAddress = kStrap;
+        warm.engine.Start(warm.runtime.NowUs(), 1000);
+        warm.Run(1000000);
+        Check(warm.host.Last() == HrStateStreaming && warm.host.transport->Operations(FakeOp::Scan) == 0,
+            "pre-warmed: straight to the strap, no scan");
+        warm.Stream(1);
+        HrStartupProfile profile{};
+        Check(warm.startup.Profile(0, profile) && profile.prewarmed == 1, "pre-warmed: marked in the startup profile");
+
+        Rig gone;
+        gone.host.warmAddress = kStrap + 1; // Heard, but not there any more
+        gone.engine.Start(gone.runtime.NowUs(), 1000);
+        gone.Run(1000000);
+        Check(gone.host.Last() == HrStateStreaming && gone.host.transport->Operations(FakeOp::Scan) == 1,
+            "pre-warmed strap gone: fell back to the scan");
+        gone.Stream(1);
+        Check(gone.startup.Profile(0, profile) && profile.prewarmed == 0, "fallback: not counted as pre-warmed");
+
+        Rig throwing;
+        int connects = 0;
+        throwing.host.warmAddress = kStrap;
+        throwing.host.transport->SetScript(&FailFirstConnect, &connects);
+        throwing.engine.Start(throwing.runtime.NowUs(), 1000);
+        throwing.Run(1000000);
+        Check(throwing.host.Last() == HrStateStreaming && throwing.host.transport->Operations(FakeOp::Scan) == 1,
+            "pre-warmed connect failed in the stack: fell back to the scan");
+    }
+
+    void BlockingStop() {
+        ThreadRuntime runtime;
+        TestHost host(runtime);
+        LinkStats stats;
+        StartupProfiler startup;
+        SessionEngine engine(runtime, host, stats, startup);
+        engine.Start(runtime.NowUs(), 1000);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!host.transport->Subscribed() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        Check(host.transport->Subscribed(), "threaded runtime: subscribed");
+        Check(engine.Stop(5000, false) == 0, "threaded runtime: stop returns 0");
+        Check(!engine.Active() && !host.transport->Connected(), "threaded runtime: stopped and disconnected");
+    }
+
+    void WedgedStop() {
+        ThreadRuntime runtime;
+        TestHost host(runtime);
+        LinkStats stats;
+        StartupProfiler startup;
+        SessionEngine engine(runtime, host, stats, startup);
+        engine.Start(runtime.NowUs(), 1000);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!host.transport->Subscribed() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        host.transport->SetUnresponsive(true); // The CCCD write on the way out never completes
+        auto started = std::chrono::steady_clock::now();
+        int result = engine.Stop(200, false);
+        auto tookMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+        Check(result == -3, "wedged radio: stop reports abandoned resources");
+        Check(tookMs >= 190 && tookMs < 400, "wedged radio: stop returns at its deadline");
+        Check(!engine.Active() && host.Saw(HrStateIdle, HrErrorTimeout), "wedged radio: idle, with the timeout reported");
+
+        // The radio comes back: the abandoned session finishes its cleanup in the background
+        host.transport->SetUnresponsive(false);
+        host.transport->Cancel();
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (host.transport->Connected() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        Check(!host.transport->Connected(), "wedged radio: disconnected once it answered again");
+    }
+}
+
+int main() {
+    ConnectStreamStop();
+    ReconnectAfterLinkLoss();
+    WatchdogEscalates();
+    ConnectTimeout();
+    LingerAndResume();
+    LateAndFailedAtTheSeam();
+    PrewarmedConnect();
+    BlockingStop();
+    WedgedStop();
+    if (g_failures == 0) {
+        std::printf("sessionengine_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+// sessionsim_bench: reconnect time and data loss per incident across thousands of randomized
+// session scenarios. Each scenario is one RunSessionSimulation (the real engine on scripted
+// straps, virtual clock) with its own seed and a configuration drawn from that seed: device
+// count, length, cadence, link drops and outages, stalls, connect failures, the reconnect
+// limit and, in half of them, injected transport faults. A scenario is reproducible on its own
+// from the seed printed for the worst one.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o sessionsim_bench sessionsim_bench.cpp ../SessionSim.cpp
+//       ../SessionEngine.cpp ../FakeTransport.cpp ../FaultInjector.cpp ../LinkStats.cpp
+//       ../StartupProfile.cpp ../StreamWatchdog.cpp ../TimerWheel.cpp
+//
+//   ./sessionsim_bench [--scenarios 1000] [--seed 1]
+//
+// Prints one JSON object: recovery time p50/p90/p99 over every recovered incident (overall
+// and per incident kind), notifications lost per incident, incidents never recovered, and
+// LinkStats' drop estimate against the simulator's ground truth (sent but not delivered). The
+// estimate only sees gaps between delivered samples, so that comparison covers the scenarios
+// in which no session gave up early. The "faults" table breaks the injected transport faults
+// down per type: how many, the notifications and latency they cost, the reconnects they forced
+// and, for disconnects, CCCD failures and slow discoveries, the time to recover (pooled over
+// every scenario).
+#include "SessionSim.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr const char* kIncidentNames[] = { "disconnect", "stall", "spurious_disconnect" };
+    constexpr int kIncidentKinds = 3;
+    constexpr const char* kFaultNames[] = { "drop", "delay", "malformed", "cccd_failure", "disconnect", "slow_discovery" };
+    constexpr int kFaultKinds = static_cast<int>(FaultKind::Count);
+
+    int64_t Percentile(std::vector<int64_t> values, double p) {
+        if (values.empty()) {
+            return -1;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size()));
+        return values[std::min(rank, values.size() - 1)];
+    }
+
+    double Real(std::mt19937_64& random, double low, double high) {
+        return std::uniform_real_distribution<double>(low, high)(random);
+    }
+
+    uint32_t Whole(std::mt19937_64& random, uint32_t low, uint32_t high) {
+        return std::uniform_int_distribution<uint32_t>(low, high)(random);
+    }
+
+    // Everything about the scenario comes from its seed
+    SimConfig RandomConfig(uint64_t seed) {
+        std::mt19937_64 random(seed);
+        SimConfig config;
+        config.seed = seed;
+        config.devices = Whole(random, 1, 4);
+        config.durationUs = static_cast<int64_t>(Whole(random, 30, 240)) * 60 * 1000000;
+        const uint32_t cadences[] = { 250, 500, 750, 1000, 1000, 1000, 2000 };
+        config.notifyIntervalMs = cadences[Whole(random, 0, 6)];
+        config.notifyJitterMs = Whole(random, 0, config.notifyIntervalMs / 10);
+        config.packetLossRate = Real(random, 0.0, 0.05);
+        config.disconnectsPerHour = Real(random, 0.0, 8.0);
+        config.outageMinMs = Whole(random, 500, 5000);
+        config.outageMaxMs = config.outageMinMs + Whole(random, 0, 120000);
+        config.stallsPerHour = Real(random, 0.0, 4.0);
+        config.stallMinMs = Whole(random, 2000, 10000);
+        config.stallMaxMs = config.stallMinMs + Whole(random, 0, 180000);
+        config.resubscribeFixRate = Real(random, 0.0, 1.0);
+        config.connectMinMs = Whole(random, 100, 1000);
+        config.connectMaxMs = config.connectMinMs + Whole(random, 0, 5000);
+        config.connectFailureRate = Real(random, 0.0, 0.3);
+        config.maxReconnectAttempts = Whole(random, 2, 10);
+        if (Whole(random, 0, 1) == 1) {
+            config.faults.dropRate = Real(random, 0.0, 0.05);
+            config.faults.delayRate = Real(random, 0.0, 0.05);
+            config.faults.delayMinMs = Whole(random, 10, 200);
+            config.faults.delayMaxMs = config.faults.delayMinMs + Whole(random, 0, 1000);
+            config.faults.malformedRate = Real(random, 0.0, 0.02);
+            config.faults.cccdFailureRate = Real(random, 0.0, 0.3);
+            config.faults.disconnectsPerHour = Real(random, 0.0, 4.0);
+            config.faults.slowDiscoveryRate = Real(random, 0.0, 0.3);
+            config.faults.discoveryDelayMinMs = Whole(random, 100, 2000);
+            config.faults.discoveryDelayMaxMs = config.faults.discoveryDelayMinMs + Whole(random, 0, 8000);
+        }
+        return config;
+    }
+
+    void PrintRecovery(const char* name, const std::vector<int64_t>& recoveryUs) {
+        std::printf("\"%s\":{\"incidents\":%zu,\"p50_us\":%lld,\"p90_us\":%lld,\"p99_us\":%lld,\"max_us\":%lld}", name,
+            recoveryUs.size(), static_cast<long long>(Percentile(recoveryUs, 50)),
+            static_cast<long long>(Percentile(recoveryUs, 90)), static_cast<long long>(Percentile(recoveryUs, 99)),
+            static_cast<long long>(Percentile(recoveryUs, 100)));
+    }
+}
+
+int main(int argc, char** argv) {
+    int scenarios = 1000;
+    uint64_t firstSeed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--scenarios")) {
+            scenarios = std::max(1, std::atoi(argv[i + 1]));
+        }
+        else if (!std::strcmp(argv[i], "--seed")) {
+            firstSeed = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    std::vector<int64_t> recoveryUs;
+    std::vector<int64_t> recoveryByKind[kIncidentKinds];
+    std::vector<int64_t> lostPerIncident;
+    SimFaultImpact faults[kFaultKinds];
+    uint64_t incidents = 0;
+    uint64_t unrecovered = 0;
+    uint64_t sent = 0;
+    uint64_t lostTrue = 0;
+    uint64_t lostEstimated = 0;
+    double estimateErrorSum = 0.0; // |estimate - truth| / truth, per scenario with losses
+    int scenariosWithLoss = 0;
+    int scenariosCompared = 0;
+    uint64_t sessionsEnded = 0;
+    uint64_t worstSeed = 0;
+    int64_t worstRecoveryUs = -1;
+    int64_t simulatedUs = 0;
+    auto start = Clock::now();
+    for (int n = 0; n < scenarios; ++n) {
+        SimConfig config = RandomConfig(firstSeed + static_cast<uint64_t>(n));
+        SimReport report;
+        if (!RunSessionSimulation(config, report)) {
+            std::fprintf(stderr, "sessionsim_bench: seed %llu: invalid configuration\n",
+                static_cast<unsigned long long>(config.seed));
+            return 1;
+        }
+        simulatedUs += config.durationUs * config.devices;
+        for (const SimIncident& incident : report.incidents) {
+            ++incidents;
+            if (incident.recoveredUs < 0) {
+                ++unrecovered;
+                continue;
+            }
+            int64_t us = incident.recoveredUs - incident.startUs;
+            recoveryUs.push_back(us);
+            recoveryByKind[static_cast<int>(incident.kind)].push_back(us);
+            lostPerIncident.push_back(incident.lost);
+            if (us > worstRecoveryUs) {
+                worstRecoveryUs = us;
+                worstSeed = config.seed;
+            }
+        }
+        for (int kind = 0; kind < kFaultKinds; ++kind) {
+            SimFaultImpact& total = faults[kind];
+            const SimFaultImpact& impact = report.faults[kind];
+            total.injected += impact.injected;
+            total.samplesLost += impact.samplesLost;
+            total.addedLatencyUs += impact.addedLatencyUs;
+            total.reconnects += impact.reconnects;
+            total.unrecovered += impact.unrecovered;
+            total.recoveryUs.insert(total.recoveryUs.end(), impact.recoveryUs.begin(), impact.recoveryUs.end());
+        }
+        sessionsEnded += report.sessionsEnded;
+        if (report.sessionsEnded == 0) {
+            uint64_t lost = report.sent - std::min(report.sent, report.delivered);
+            ++scenariosCompared;
+            sent += report.sent;
+            lostTrue += lost;
+            lostEstimated += report.estimatedDropped;
+            if (lost > 0) {
+                estimateErrorSum += std::fabs(static_cast<double>(report.estimatedDropped) - static_cast<double>(lost))
+                    / static_cast<double>(lost);
+                ++scenariosWithLoss;
+            }
+        }
+    }
+    double wallS = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double lostMean = 0.0;
+    for (int64_t lost : lostPerIncident) {
+        lostMean += static_cast<double>(lost);
+    }
+    lostMean = lostPerIncident.empty() ? 0.0 : lostMean / static_cast<double>(lostPerIncident.size());
+
+    std::printf("{\"scenarios\":%d,\"first_seed\":%llu,\"simulated_device_hours\":%.0f,\"wall_s\":%.2f,"
+        "\"incidents\":%llu,\"unrecovered\":%llu,\"sessions_ended\":%llu,", scenarios,
+        static_cast<unsigned long long>(firstSeed), static_cast<double>(simulatedUs) / 3.6e9, wallS,
+        static_cast<unsigned long long>(incidents), static_cast<unsigned long long>(unrecovered),
+        static_cast<unsigned long long>(sessionsEnded));
+    PrintRecovery("recovery", recoveryUs);
+    for (int kind = 0; kind < kIncidentKinds; ++kind) {
+        std::printf(",");
+        PrintRecovery(kIncidentNames[kind], recoveryByKind[kind]);
+    }
+    std::printf(",\"lost_per_incident\":{\"mean\":%.2f,\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"max\":%lld},"
+        "\"worst_recovery_seed\":%llu,", lostMean,
+        static_cast<long long>(Percentile(lostPerIncident, 50)), static_cast<long long>(Percentile(lostPerIncident, 90)),
+        static_cast<long long>(Percentile(lostPerIncident, 99)), static_cast<long long>(Percentile(lostPerIncident, 100)),
+        static_cast<unsigned long long>(worstSeed));
+    std::printf("\"linkstats\":{\"scenarios\":%d,\"sent\":%llu,\"lost_true\":%llu,\"lost_estimated\":%llu,\"estimate_ratio\":%.3f,"
+        "\"mean_abs_error\":%.3f},\"faults\":{", scenariosCompared, static_cast<unsigned long long>(sent), static_cast<unsigned long long>(lostTrue),
+        static_cast<unsigned long long>(lostEstimated),
+        lostTrue > 0 ? static_cast<double>(lostEstimated) / static_cast<double>(lostTrue) : 0.0,
+        scenariosWithLoss > 0 ? estimateErrorSum / scenariosWithLoss : 0.0);
+    for (int kind = 0; kind < kFaultKinds; ++kind) {
+        const SimFaultImpact& impact = faults[kind];
+        std::printf("%s\"%s\":{\"injected\":%llu,\"samples_lost\":%llu,\"added_latency_us\":%llu,\"reconnects\":%u,"
+            "\"recovered\":%zu,\"unrecovered\":%u,\"recovery_p50_us\":%lld,\"recovery_p90_us\":%lld,\"recovery_p99_us\":%lld}",
+            kind ? "," : "", kFaultNames[kind], static_cast<unsigned long long>(impact.injected),
+            static_cast<unsigned long long>(impact.samplesLost), static_cast<unsigned long long>(impact.addedLatencyUs),
+            impact.reconnects, impact.recoveryUs.size(), impact.unrecovered,
+            static_cast<long long>(Percentile(impact.recoveryUs, 50)), static_cast<long long>(Percentile(impact.recoveryUs, 90)),
+            static_cast<long long>(Percentile(impact.recoveryUs, 99)));
+    }
+    std::printf("}}\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+// sessionsim_test: runs the session simulator (the real engine on scripted straps) and checks
+// that a scenario replays exactly from its seed, that sessions recover from link drops and
+// stalls, and that injected faults show up in the report.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o sessionsim_test sessionsim_test.cpp ../SessionSim.cpp
+//       ../SessionEngine.cpp ../FakeTransport.cpp ../FaultInjector.cpp ../LinkStats.cpp
+//       ../StartupProfile.cpp ../StreamWatchdog.cpp ../TimerWheel.cpp
+//
+// Exit code 0 if every check passed, 1 otherwise.
+#include "SessionSim.h"
+#include <cstdio>
+
+namespace {
+    int g_failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "sessionsim_test: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    bool SameReport(SimReport const& a, SimReport const& b) {
+        if (a.sent != b.sent || a.delivered != b.delivered || a.estimatedDropped != b.estimatedDropped
+            || a.connects != b.connects || a.resubscribes != b.resubscribes || a.incidents.size() != b.incidents.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.incidents.size(); ++i) {
+            if (a.incidents[i].startUs != b.incidents[i].startUs || a.incidents[i].recoveredUs != b.incidents[i].recoveredUs) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    SimConfig config;
+    config.devices = 3;
+    config.durationUs = 4ll * 3600 * 1000000;
+    config.disconnectsPerHour = 4.0;
+    config.stallsPerHour = 2.0;
+
+    SimReport first;
+    SimReport second;
+    Check(RunSessionSimulation(config, first) && RunSessionSimulation(config, second), "runs");
+    Check(SameReport(first, second), "same seed, same report");
+    Check(first.sent > 3 * 4 * 3500 && first.delivered > first.sent / 2, "straps streamed most of the time");
+    Check(!first.incidents.empty() && first.Unrecovered() <= config.devices, "incidents recovered");
+    Check(first.connects > config.devices && first.RecoveryPercentileUs(50) > 0, "reconnected after drops");
+
+    config.seed = 2;
+    SimReport other;
+    RunSessionSimulation(config, other);
+    Check(!SameReport(first, other), "another seed, another scenario");
+
+    config.faults.dropRate = 0.05;
+    config.faults.disconnectsPerHour = 2.0;
+    config.faults.delayRate = 0.05;
+    config.faults.delayMinMs = 200;
+    config.faults.delayMaxMs = 800;
+    SimReport faulty;
+    RunSessionSimulation(config, faulty);
+    SimFaultImpact const& drop = faulty.faults[static_cast<int>(FaultKind::Drop)];
+    SimFaultImpact const& delay = faulty.faults[static_cast<int>(FaultKind::Delay)];
+    SimFaultImpact const& disconnect = faulty.faults[static_cast<int>(FaultKind::Disconnect)];
+    Check(drop.injected > 0 && drop.samplesLost == drop.injected, "drops injected and lost");
+    Check(delay.injected > 0 && delay.addedLatencyUs >= delay.injected * 200000, "delays injected");
+    Check(disconnect.injected > 0 && disconnect.reconnects == disconnect.injected, "spurious disconnects forced reconnects");
+    Check(!disconnect.recoveryUs.empty() && disconnect.recoveryP50Us > 0 && disconnect.recoveryP99Us >= disconnect.recoveryP50Us,
+        "recovery from spurious disconnects timed");
+    Check(drop.recoveryUs.empty() && drop.recoveryP50Us == -1, "no recovery time for drops");
+
+    config.faults.cccdFailureRate = 0.3;
+    config.faults.slowDiscoveryRate = 0.5;
+    config.faults.discoveryDelayMinMs = 2000;
+    config.faults.discoveryDelayMaxMs = 4000;
+    RunSessionSimulation(config, faulty);
+    SimFaultImpact const& cccd = faulty.faults[static_cast<int>(FaultKind::CccdFailure)];
+    SimFaultImpact const& slow = faulty.faults[static_cast<int>(FaultKind::SlowDiscovery)];
+    Check(cccd.injected > 0 && !cccd.recoveryUs.empty() && cccd.recoveryP50Us > 0, "recovery from CCCD failures timed");
+    Check(slow.injected > 0 && slow.recoveryUs.size() + slow.unrecovered <= slow.injected && slow.recoveryP50Us >= 2000000,
+        "recovery from slow discoveries includes the delay");
+
+    SimConfig invalid;
+    invalid.devices = 0;
+    Check(!RunSessionSimulation(invalid, other), "invalid configuration rejected");
+    invalid = SimConfig{};
+    invalid.notifyIntervalMs = 64000;
+    Check(!RunSessionSimulation(invalid, other), "interval too long for an RR value rejected");
+
+    if (g_failures == 0) {
+        std::printf("sessionsim_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+// sharedchannel_test: multi-process test of the shared-memory sample channel on POSIX shared
+// memory. The parent creates the channel and forks reader processes, each opening it
+// read-only on its own. It then publishes samples faster than a small ring can hold. Every
+// reader must see samples in order, each one intact (no torn slot), and account for every
+// sample as read or lost. Also checked in-process: the ring itself, Latest, Open rejecting a
+// bad capacity, a mismatched layout or a missing channel, and readers giving up on a slot a
+// dead writer left mid-write instead of spinning on it.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o sharedchannel_test sharedchannel_test.cpp ../SharedChannel.cpp
+//
+// Linux only (fork, shm_open). Exit code 0 if every check passed, 1 otherwise.
+#include "SharedChannel.h"
+#include <sys/wait.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kReaders = 4;
+    constexpr uint32_t kCapacity = 256;
+    constexpr uint32_t kSamples = 400000;
+
+    int g_failures = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "sharedchannel_test: %s\n", what);
+        ++g_failures;
+    }
+
+    // Every field derives from the sequence, so a slot mixing two writes shows up
+    HrSample MakeSample(uint64_t sequence) {
+        HrSample sample{};
+        sample.timestampUs = static_cast<int64_t>(sequence) * 1000;
+        sample.deviceAddress = 0xC0FFEE000000ull | (sequence & 0xFFFF);
+        sample.sequence = sequence;
+        sample.bpm = static_cast<uint16_t>(sequence % 300);
+        sample.energyExpended = static_cast<uint16_t>(sequence >> 3);
+        sample.flags = static_cast<uint8_t>(sequence);
+        sample.rrCount = static_cast<uint8_t>(sequence % (kHrSampleMaxRr + 1));
+        for (uint8_t i = 0; i < kHrSampleMaxRr; ++i) {
+            sample.rr[i] = static_cast<uint16_t>(sequence + i);
+        }
+        return sample;
+    }
+
+    bool Intact(const HrSample& sample) {
+        HrSample expected = MakeSample(sample.sequence);
+        return std::memcmp(&expected, &sample, sizeof(HrSample)) == 0;
+    }
+
+    // Reader process body; the exit code says what went wrong
+    int RunReader(const char* name, int readyPipe) {
+        SharedChannelReader reader;
+        if (!reader.Open(name)) {
+            return 2;
+        }
+        char ready = 1;
+        if (write(readyPipe, &ready, 1) != 1) {
+            return 3;
+        }
+        close(readyPipe);
+        HrSample samples[64];
+        uint64_t last = 0;
+        uint32_t lost = 0;
+        uint64_t read = 0;
+        auto deadline = Clock::now() + std::chrono::seconds(60);
+        while (read + lost < kSamples) {
+            int count = reader.Read(samples, 64, &lost);
+            for (int i = 0; i < count; ++i) {
+                if (samples[i].sequence <= last || !Intact(samples[i])) {
+                    return 4;
+                }
+                last = samples[i].sequence;
+            }
+            read += static_cast<uint64_t>(count);
+            if (count == 0) {
+                if (Clock::now() > deadline) {
+                    return 5;
+                }
+                std::this_thread::yield();
+            }
+        }
+        if (read + lost != kSamples || last != kSamples) {
+            return 6;
+        }
+        std::printf("sharedchannel_test: reader %d read %llu, lost %u\n", static_cast<int>(getpid()),
+            static_cast<unsigned long long>(read), lost);
+        std::fflush(stdout);
+        return 0;
+    }
+
+    void CheckReaderProcesses(const char* name) {
+        SharedChannelWriter writer;
+        if (!writer.Open(name, kCapacity)) {
+            Fail("writer Open failed");
+            return;
+        }
+        int pipes[2];
+        if (pipe(pipes) != 0) {
+            Fail("pipe failed");
+            return;
+        }
+        pid_t children[kReaders];
+        for (int i = 0; i < kReaders; ++i) {
+            children[i] = fork();
+            if (children[i] == 0) {
+                close(pipes[0]);
+                _exit(RunReader(name, pipes[1]));
+            }
+        }
+        close(pipes[1]);
+        // Publish only once every reader has its starting position
+        int ready = 0;
+        char byte;
+        while (ready < kReaders && read(pipes[0], &byte, 1) == 1) {
+            ++ready;
+        }
+        close(pipes[0]);
+        if (ready != kReaders) {
+            Fail("a reader process could not open the channel");
+        }
+        for (uint32_t sequence = 1; sequence <= kSamples; ++sequence) {
+            writer.Publish(MakeSample(sequence));
+            if (sequence % 1024 == 0) {
+                std::this_thread::yield(); // Let the readers run on a single core too
+            }
+        }
+        for (int i = 0; i < kReaders; ++i) {
+            int status = 0;
+            waitpid(children[i], &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::fprintf(stderr, "sharedchannel_test: reader exited with %d\n",
+                    WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+                Fail("a reader process saw a torn, reordered or unaccounted sample");
+            }
+        }
+    }
+
+    void CheckInProcess(const char* name) {
+        SharedChannelWriter writer;
+        SharedChannelReader reader;
+        if (writer.Open(name, 0)) {
+            Fail("Open accepts capacity 0");
+        }
+        if (reader.Open(name)) {
+            Fail("reader opens a channel that does not exist");
+        }
+        if (!writer.Open(name, 8)) {
+            Fail("writer Open failed");
+            return;
+        }
+        SharedChannelWriter other;
+        if (other.Open(name, 16)) {
+            Fail("a second writer opens the channel with another capacity");
+        }
+        if (!reader.Open(name)) {
+            Fail("reader Open failed");
+            return;
+        }
+        HrSample latest;
+        if (reader.Latest(latest)) {
+            Fail("Latest on an empty channel");
+        }
+        for (uint32_t sequence = 1; sequence <= 20; ++sequence) {
+            writer.Publish(MakeSample(sequence));
+        }
+        HrSample samples[32];
+        uint32_t lost = 0;
+        int count = reader.Read(samples, 32, &lost);
+        if (count != 8 || lost != 12 || samples[0].sequence != 13 || samples[7].sequence != 20) {
+            Fail("a reader a ring behind does not get the newest samples and the lost count");
+        }
+        if (!reader.Latest(latest) || latest.sequence != 20 || !Intact(latest)) {
+            Fail("Latest is not the last sample");
+        }
+        writer.Publish(MakeSample(21));
+        count = reader.Read(samples, 32, &lost);
+        if (count != 1 || samples[0].sequence != 21 || lost != 12) {
+            Fail("Read after catching up");
+        }
+        // The creator's Close removes the name; a reader that has it mapped is unaffected
+        writer.Close();
+        SharedChannelReader late;
+        if (late.Open(name)) {
+            Fail("channel still opens after its writer closed");
+        }
+        if (!reader.Latest(latest) || latest.sequence != 21) {
+            Fail("open reader lost its mapping");
+        }
+    }
+
+    // A writer that dies mid-Store leaves the slot's sequence odd for good; forged here through
+    // a read-write mapping
+    void CheckDeadWriter(const char* name) {
+        SharedChannelWriter writer;
+        SharedChannelReader reader;
+        if (!writer.Open(name, 8) || !reader.Open(name)) {
+            Fail("Open failed");
+            return;
+        }
+        int fd = shm_open(name, O_RDWR, 0);
+        void* view = fd == -1 ? MAP_FAILED : mmap(nullptr, SharedChannelSize(8), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (fd != -1) {
+            close(fd);
+        }
+        if (view == MAP_FAILED) {
+            Fail("cannot map the channel read-write");
+            return;
+        }
+        auto* slots = reinterpret_cast<SharedChannelSlot*>(static_cast<SharedChannelHeader*>(view) + 1);
+        for (uint32_t sequence = 1; sequence <= 4; ++sequence) {
+            writer.Publish(MakeSample(sequence));
+        }
+        slots[2].sequence.fetch_add(1); // Sample 3's slot
+        auto start = Clock::now();
+        HrSample samples[8];
+        uint32_t lost = 0;
+        int count = reader.Read(samples, 8, &lost);
+        if (count != 3 || lost != 1 || samples[1].sequence != 2 || samples[2].sequence != 4) {
+            Fail("Read does not skip a slot left mid-write and count it as lost");
+        }
+        slots[3].sequence.fetch_add(1); // The newest
+        HrSample latest;
+        if (reader.Latest(latest)) {
+            Fail("Latest returns a slot left mid-write");
+        }
+        if (Clock::now() - start > std::chrono::seconds(1)) {
+            Fail("readers wait on a dead writer");
+        }
+        munmap(view, SharedChannelSize(8));
+    }
+}
+
+int main() {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/hrchannel_test_%d", static_cast<int>(getpid()));
+    CheckInProcess(name);
+    CheckDeadWriter(name);
+    CheckReaderProcesses(name);
+    if (g_failures == 0) {
+        std::printf("sharedchannel_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// soak: runs the load generator and session engines on fake straps for a long time, and fails on
+// upward drift in memory, handles, queue depth or latency, or on a session that failed to start
+// or stop (see SoakTest.h). Writes the per-interval CSV as it goes and the JSON summary to
+// stdout when done.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o soak soak.cpp ../SoakTest.cpp ../LoadGenerator.cpp ../CaptureWriter.cpp
+//       ../LatestSamples.cpp ../LinkStats.cpp ../SampleDispatcher.cpp ../SampleQueue.cpp ../TimerWheel.cpp
+//       ../SessionEngine.cpp ../FakeTransport.cpp ../FaultInjector.cpp ../StartupProfile.cpp ../StreamWatchdog.cpp
+//
+//   ./soak --devices 200 --rate 4 --sessions 16 --duration-ms 43200000 --interval-ms 10000 --csv soak.csv
+//
+// Exit code 0 if nothing drifted and every session behaved, 3 otherwise, 1 on bad arguments, 2 if
+// the run failed.
+#include "SoakTest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    void Usage() {
+        std::fprintf(stderr, "usage: soak [--devices N] [--rate HZ] [--duration-ms MS] [--threads N] [--capture PATH]"
+            " [--interval-ms MS] [--warmup FRACTION] [--z Z] [--min-growth FRACTION] [--csv PATH]"
+            " [--sessions N] [--link-drop-ms MS] [--restart-ms MS]\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    SoakConfig config;
+    config.load.devices = 200;
+    config.load.durationMs = 3600000;
+    for (int i = 1; i < argc; ++i) {
+        const char* option = argv[i];
+        if (i + 1 >= argc) {
+            Usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (!std::strcmp(option, "--devices")) {
+            config.load.devices = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--rate")) {
+            config.load.rateHz = std::strtod(value, nullptr);
+        }
+        else if (!std::strcmp(option, "--duration-ms")) {
+            config.load.durationMs = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--threads")) {
+            config.load.threads = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--capture")) {
+            config.load.capturePath = value;
+        }
+        else if (!std::strcmp(option, "--interval-ms")) {
+            config.intervalMs = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--warmup")) {
+            config.warmupFraction = std::strtod(value, nullptr);
+        }
+        else if (!std::strcmp(option, "--z")) {
+            config.zCritical = std::strtod(value, nullptr);
+        }
+        else if (!std::strcmp(option, "--min-growth")) {
+            config.minGrowth = std::strtod(value, nullptr);
+        }
+        else if (!std::strcmp(option, "--csv")) {
+            config.csvPath = value;
+        }
+        else if (!std::strcmp(option, "--sessions")) {
+            config.sessions = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--link-drop-ms")) {
+            config.linkDropMs = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (!std::strcmp(option, "--restart-ms")) {
+            config.restartMs = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else {
+            Usage();
+            return 1;
+        }
+    }
+
+    SoakReport report;
+    if (!RunSoakTest(config, report)) {
+        std::fprintf(stderr, "soak: invalid configuration, or the CSV file or a pipeline stage could not be set up\n");
+        return 2;
+    }
+    char json[4096];
+    if (FormatSoakReportJson(report, json, sizeof(json)) == 0) {
+        return 2;
+    }
+    std::printf("%s\n", json);
+    for (int m = 0; m < SoakMetricCount; ++m) {
+        if (report.drift[m].failed) {
+            std::fprintf(stderr, "soak: %s drifted from %.0f to %.0f (z = %.2f)\n", SoakMetricName(static_cast<SoakMetric>(m)),
+                report.drift[m].start, report.drift[m].end, report.drift[m].z);
+        }
+    }
+    const SoakSessions& sessions = report.sessions;
+    if (sessions.startFailures != 0 || sessions.stopFailures != 0 || sessions.ended != 0) {
+        std::fprintf(stderr, "soak: sessions: %u failed to start, %u missed their stop deadline, %u gave up\n",
+            sessions.startFailures, sessions.stopFailures, sessions.ended);
+    }
+    return report.passed ? 0 : 3;
+}
@@ -0,0 +1,120 @@
+// startstop_bench: times Start/Stop cycles against a real strap, the way a host that stops and
+// starts around every exercise interval uses the DLL. Windows only; needs a strap in range.
+//
+//   cl /std:c++20 /EHsc /O2 /I.. startstop_bench.cpp
+//   startstop_bench [--dll Dll3.dll] [--cycles 20] [--linger-ms 0] [--rest-ms 1000]
+//
+// Per cycle: StartHrMonitoring until a new sample shows up in GetLatestSample, then
+// StopHrMonitoring. Prints one JSON object with p50/p99/max of both, in microseconds.
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "BLEHeartRateMonitor.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    typedef int(__cdecl* IntFn)();
+    typedef int(__cdecl* IntArgFn)(int);
+    typedef int(__cdecl* LatestFn)(HrSample*);
+
+    int64_t Percentile(std::vector<int64_t> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size()));
+        return values[std::min(rank, values.size() - 1)];
+    }
+
+    int64_t ElapsedUs(Clock::time_point from) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - from).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* dllPath = "Dll3.dll";
+    int cycles = 20;
+    int lingerMs = 0;
+    int restMs = 1000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--dll")) {
+            dllPath = argv[i + 1];
+        }
+        else if (!std::strcmp(argv[i], "--cycles")) {
+            cycles = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--linger-ms")) {
+            lingerMs = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--rest-ms")) {
+            restMs = std::atoi(argv[i + 1]);
+        }
+    }
+
+    HMODULE dll = LoadLibraryA(dllPath);
+    if (!dll) {
+        std::fprintf(stderr, "startstop_bench: cannot load %s\n", dllPath);
+        return 2;
+    }
+    auto initialize = reinterpret_cast<IntFn>(GetProcAddress(dll, "InitializePlugin"));
+    auto shutdown = reinterpret_cast<IntFn>(GetProcAddress(dll, "ShutdownPlugin"));
+    auto start = reinterpret_cast<IntFn>(GetProcAddress(dll, "StartHrMonitoring"));
+    auto stop = reinterpret_cast<IntFn>(GetProcAddress(dll, "StopHrMonitoring"));
+    auto setLinger = reinterpret_cast<IntArgFn>(GetProcAddress(dll, "SetStopLinger"));
+    auto latest = reinterpret_cast<LatestFn>(GetProcAddress(dll, "GetLatestSample"));
+    if (!initialize || !shutdown || !start || !stop || !setLinger || !latest) {
+        std::fprintf(stderr, "startstop_bench: %s is missing an export\n", dllPath);
+        return 2;
+    }
+    initialize();
+    setLinger(lingerMs);
+
+    std::vector<int64_t> firstSampleUs;
+    std::vector<int64_t> stopUs;
+    int failures = 0;
+    for (int cycle = 0; cycle < cycles; ++cycle) {
+        HrSample before{};
+        latest(&before);
+        Clock::time_point began = Clock::now();
+        if (start() != 0) {
+            ++failures;
+            continue;
+        }
+        bool streamed = false;
+        while (ElapsedUs(began) < 30000000) {
+            HrSample sample{};
+            if (latest(&sample) == 1 && (sample.sequence != before.sequence || sample.timestampUs != before.timestampUs)) {
+                streamed = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (streamed) {
+            firstSampleUs.push_back(ElapsedUs(began));
+        }
+        else {
+            ++failures;
+        }
+        Clock::time_point stopping = Clock::now();
+        stop();
+        stopUs.push_back(ElapsedUs(stopping));
+        std::this_thread::sleep_for(std::chrono::milliseconds(restMs));
+    }
+    shutdown();
+
+    std::printf("{\"cycles\":%d,\"lingerMs\":%d,\"failures\":%d,"
+        "\"startToFirstSampleUs\":{\"p50\":%lld,\"p99\":%lld,\"max\":%lld},"
+        "\"stopUs\":{\"p50\":%lld,\"p99\":%lld,\"max\":%lld}}\n",
+        cycles, lingerMs, failures,
+        static_cast<long long>(Percentile(firstSampleUs, 50.0)), static_cast<long long>(Percentile(firstSampleUs, 99.0)),
+        static_cast<long long>(Percentile(firstSampleUs, 100.0)),
+        static_cast<long long>(Percentile(stopUs, 50.0)), static_cast<long long>(Percentile(stopUs, 99.0)),
+        static_cast<long long>(Percentile(stopUs, 100.0)));
+    return failures == 0 ? 0 : 3;
+}
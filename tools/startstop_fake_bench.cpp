@@ -0,0 +1,160 @@
+// startstop_fake_bench: times Start/Stop cycles of the real session engine on a fake strap and
+// the threaded runtime (real clock), with and without stop linger, the way startstop_bench does
+// against a real strap. Portable, and the fake's latencies are fixed, so the difference between
+// the two modes is what linger itself buys.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o startstop_fake_bench startstop_fake_bench.cpp ../SessionEngine.cpp
+//       ../FakeTransport.cpp ../FaultInjector.cpp ../LinkStats.cpp ../StartupProfile.cpp
+//       ../StreamWatchdog.cpp ../TimerWheel.cpp
+//
+//   ./startstop_fake_bench [--cycles 50] [--linger-ms 5000] [--rest-ms 200] [--rate-hz 4]
+//
+// Per cycle: Start until a new sample arrives, then Stop (allowed to park, as the
+// StopHrMonitoring export does). Prints one JSON object with p50/p99/max of both per mode, in
+// microseconds. Exit code 1 if a cycle failed.
+#include "FakeTransport.h"
+#include "LinkStats.h"
+#include "SessionEngine.h"
+#include "StartupProfile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint64_t kStrap = 0xC0FFEE000001ull;
+    constexpr uint8_t kPayload[4] = { 0x10, 72, 0x00, 0x04 };
+
+    class BenchHost final : public SessionHost {
+    public:
+        explicit BenchHost(SessionRuntime& runtime) : transport(std::make_shared<FakeTransport>(runtime, kStrap)) {}
+
+        std::shared_ptr<HrTransport> CreateTransport() override { return transport; }
+        void OnStatus(HrState, HrErrorCategory, int32_t, uint64_t) override {}
+        void OnSample(const HrSample&) override { samples.fetch_add(1); }
+
+        std::shared_ptr<FakeTransport> transport;
+        std::atomic<uint64_t> samples{ 0 };
+    };
+
+    int64_t Percentile(std::vector<int64_t> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size()));
+        return values[std::min(rank, values.size() - 1)];
+    }
+
+    int64_t ElapsedUs(Clock::time_point from) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - from).count();
+    }
+
+    struct Result {
+        std::vector<int64_t> firstSampleUs;
+        std::vector<int64_t> stopUs;
+        int failures = 0;
+    };
+
+    Result Run(int cycles, uint32_t lingerMs, int restMs, double rateHz) {
+        ThreadRuntime runtime;
+        BenchHost host(runtime);
+        LinkStats stats;
+        StartupProfiler startup;
+        SessionEngine engine(runtime, host, stats, startup);
+        engine.stopLingerMs = lingerMs;
+
+        // The strap notifies at rateHz whether or not anyone listens
+        std::atomic<bool> running{ true };
+        auto period = std::chrono::microseconds(static_cast<int64_t>(1e6 / rateHz));
+        std::thread strap([&] {
+            auto next = Clock::now();
+            while (running.load()) {
+                host.transport->Notify(kPayload, sizeof(kPayload));
+                next += period;
+                std::this_thread::sleep_until(next);
+            }
+        });
+
+        Result result;
+        for (int cycle = 0; cycle < cycles; ++cycle) {
+            uint64_t before = host.samples.load();
+            auto started = Clock::now();
+            if (engine.Start(runtime.NowUs(), 1000) != 0) {
+                ++result.failures;
+                continue;
+            }
+            auto deadline = started + std::chrono::seconds(10);
+            while (host.samples.load() == before && Clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            if (host.samples.load() == before) {
+                ++result.failures;
+            }
+            else {
+                result.firstSampleUs.push_back(ElapsedUs(started));
+            }
+            auto stopping = Clock::now();
+            if (engine.Stop(5000, true) != 0) {
+                ++result.failures;
+            }
+            result.stopUs.push_back(ElapsedUs(stopping));
+            // Spread the cycles over the notification phase rather than locking onto it
+            std::this_thread::sleep_for(std::chrono::milliseconds(restMs) + period * (cycle % 10) / 10);
+        }
+        engine.Stop(5000, false);
+        running = false;
+        strap.join();
+        return result;
+    }
+
+    void Print(const char* name, const Result& result) {
+        std::printf("\"%s\":{\"first_sample_p50_us\":%lld,\"first_sample_p99_us\":%lld,\"first_sample_max_us\":%lld,"
+            "\"stop_p50_us\":%lld,\"stop_p99_us\":%lld,\"stop_max_us\":%lld,\"failures\":%d}", name,
+            static_cast<long long>(Percentile(result.firstSampleUs, 50)),
+            static_cast<long long>(Percentile(result.firstSampleUs, 99)),
+            static_cast<long long>(Percentile(result.firstSampleUs, 100)),
+            static_cast<long long>(Percentile(result.stopUs, 50)), static_cast<long long>(Percentile(result.stopUs, 99)),
+            static_cast<long long>(Percentile(result.stopUs, 100)), result.failures);
+    }
+}
+
+int main(int argc, char** argv) {
+    int cycles = 50;
+    int lingerMs = 5000;
+    int restMs = 200;
+    double rateHz = 4.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--cycles")) {
+            cycles = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--linger-ms")) {
+            lingerMs = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--rest-ms")) {
+            restMs = std::atoi(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--rate-hz")) {
+            rateHz = std::atof(argv[i + 1]);
+        }
+    }
+    if (rateHz <= 0.0) {
+        rateHz = 4.0;
+    }
+
+    Result cold = Run(cycles, 0, restMs, rateHz);
+    Result lingering = Run(cycles, static_cast<uint32_t>(lingerMs), restMs, rateHz);
+    std::printf("{\"cycles\":%d,\"linger_ms\":%d,\"rest_ms\":%d,\"rate_hz\":%.1f,", cycles, lingerMs, restMs, rateHz);
+    Print("no_linger", cold);
+    std::printf(",");
+    Print("linger", lingering);
+    std::printf("}\n");
+    return cold.failures == 0 && lingering.failures == 0 ? 0 : 1;
+}
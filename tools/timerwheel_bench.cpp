@@ -0,0 +1,169 @@
+// timerwheel_bench: cost of the timer patterns the sessions use, on TimerWheel versus an ordered
+// multimap under a mutex (the usual alternative: one deadline queue, O(log n) per operation, an
+// allocation per arm). Workloads, each at several armed-timer counts:
+//   rearm   - every timer already armed; push a random one further out (watchdog per notification)
+//   arm     - schedule then cancel before it fires (connect timeout that didn't trip)
+//   fire    - every timer periodic, re-armed from its callback; 60 s of 10 ms ticks
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o timerwheel_bench timerwheel_bench.cpp ../TimerWheel.cpp
+//
+//   ./timerwheel_bench [--ops 1000000]
+//
+// Prints one JSON object with ns per operation (per fired timer for "fire") for each.
+#include "TimerWheel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t kCounts[] = { 16, 1000, 100000 };
+
+    double NsPer(Clock::time_point begin, uint64_t ops) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        return ops ? static_cast<double>(ns) / static_cast<double>(ops) : 0.0;
+    }
+
+    // Deadline queue baseline with the same interface as the wheel
+    class MapTimers {
+    public:
+        struct Timer {
+            TimerWheel::Callback callback = nullptr;
+            void* context = nullptr;
+            std::multimap<uint64_t, Timer*>::iterator position;
+            bool armed = false;
+        };
+
+        void Reset(uint64_t nowMs) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.clear();
+            m_nowMs = nowMs;
+        }
+        void Schedule(Timer& timer, uint64_t delayMs) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (timer.armed) {
+                m_queue.erase(timer.position);
+            }
+            timer.position = m_queue.emplace(m_nowMs + delayMs, &timer);
+            timer.armed = true;
+        }
+        void Cancel(Timer& timer) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (timer.armed) {
+                m_queue.erase(timer.position);
+                timer.armed = false;
+            }
+        }
+        void Advance(uint64_t nowMs) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_nowMs = nowMs;
+            while (!m_queue.empty() && m_queue.begin()->first <= nowMs) {
+                Timer* timer = m_queue.begin()->second;
+                m_queue.erase(m_queue.begin());
+                timer->armed = false;
+                lock.unlock();
+                timer->callback(timer->context);
+                lock.lock();
+            }
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::multimap<uint64_t, Timer*> m_queue;
+        uint64_t m_nowMs = 0;
+    };
+
+    template <typename Wheel, typename Timer>
+    struct Periodic {
+        Wheel* wheel;
+        Timer timer;
+        uint64_t periodMs;
+        uint64_t* fired;
+
+        static void OnFire(void* context) {
+            auto self = static_cast<Periodic*>(context);
+            ++*self->fired;
+            self->wheel->Schedule(self->timer, self->periodMs);
+        }
+    };
+
+    void Noop(void*) {}
+
+    template <typename Wheel, typename Timer>
+    void Measure(const char* name, size_t count, uint64_t ops, bool& first) {
+        std::mt19937 rng(7);
+        auto wheel = std::make_unique<Wheel>();
+        wheel->Reset(0);
+        std::vector<Timer> timers(count);
+        for (Timer& timer : timers) {
+            timer.callback = &Noop;
+            wheel->Schedule(timer, 1000 + rng() % 20000);
+        }
+
+        Clock::time_point begin = Clock::now();
+        for (uint64_t i = 0; i < ops; ++i) {
+            wheel->Schedule(timers[rng() % count], 3000 + (i & 1023));
+        }
+        double rearmNs = NsPer(begin, ops);
+
+        Timer extra;
+        extra.callback = &Noop;
+        begin = Clock::now();
+        for (uint64_t i = 0; i < ops; ++i) {
+            wheel->Schedule(extra, 20000);
+            wheel->Cancel(extra);
+        }
+        double armNs = NsPer(begin, ops) / 2;
+        for (Timer& timer : timers) {
+            wheel->Cancel(timer);
+        }
+
+        wheel->Reset(0);
+        uint64_t fired = 0;
+        std::vector<Periodic<Wheel, Timer>> periodic(count);
+        for (size_t i = 0; i < count; ++i) {
+            periodic[i].wheel = wheel.get();
+            periodic[i].timer.callback = &Periodic<Wheel, Timer>::OnFire;
+            periodic[i].timer.context = &periodic[i];
+            periodic[i].periodMs = 250 + rng() % 1000; // Flushes and coalesced deliveries
+            periodic[i].fired = &fired;
+            wheel->Schedule(periodic[i].timer, periodic[i].periodMs);
+        }
+        begin = Clock::now();
+        for (uint64_t nowMs = TimerWheel::kTickMs; nowMs <= 60000; nowMs += TimerWheel::kTickMs) {
+            wheel->Advance(nowMs);
+        }
+        double fireNs = NsPer(begin, fired);
+        for (auto& p : periodic) {
+            wheel->Cancel(p.timer);
+        }
+
+        std::printf("%s\"%s_%zu\":{\"rearm_ns\":%.1f,\"arm_cancel_ns\":%.1f,\"fire_ns\":%.1f}", first ? "" : ",",
+            name, count, rearmNs, armNs, fireNs);
+        first = false;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t ops = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--ops")) {
+            ops = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+    bool first = true;
+    std::printf("{");
+    for (size_t count : kCounts) {
+        Measure<TimerWheel, TimerWheel::Timer>("wheel", count, ops, first);
+        Measure<MapTimers, MapTimers::Timer>("multimap", count, ops, first);
+    }
+    std::printf("}\n");
+    return 0;
+}
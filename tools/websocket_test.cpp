@@ -0,0 +1,479 @@
+// websocket_test: loopback load test of the WebSocket server. 250 clients handshake (checked
+// against the RFC 6455 sample key), Ping and get their payload back in a Pong, then receive
+// batched samples from four devices published 1 ms apart from another thread: every batch
+// well-formed, each device's sequence increasing, every client served up to the last sample,
+// and Publish cheap however many clients there are. Also: a request without a key gets a 400,
+// a client Close is echoed, a client that stops reading is coalesced to the newest batch
+// without holding up a live one, and Stop closes everyone.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o websocket_test websocket_test.cpp ../WebSocketServer.cpp
+//       ../NetPublisher.cpp ../NetLoop.cpp ../TimerWheel.cpp
+//
+// Linux only (the loop is epoll). Exit code 0 if every check passed, 1 otherwise.
+#include "LatencyHistogram.h"
+#include "WebSocketServer.h"
+#include <poll.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kClients = 250;
+    constexpr int kDevices = 4;
+    constexpr uint64_t kSamplesPerDevice = 250;
+    constexpr uint32_t kCadenceMs = 20;
+    constexpr char kRequest[] = "GET /hr HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    constexpr char kAccept[] = "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"; // RFC 6455 1.3
+
+    int g_failures = 0;
+
+    void Fail(const char* what) {
+        std::fprintf(stderr, "websocket_test: %s\n", what);
+        ++g_failures;
+    }
+
+    uint64_t GetLe(const uint8_t* p, int bytes) {
+        uint64_t value = 0;
+        for (int i = bytes - 1; i >= 0; --i) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    HrSample MakeSample(int device, uint64_t sequence) {
+        HrSample sample{};
+        sample.deviceAddress = 0xC0FFEE000000ull + static_cast<uint64_t>(device);
+        sample.sequence = sequence;
+        sample.bpm = static_cast<uint16_t>(60 + (sequence + static_cast<uint64_t>(device)) % 100);
+        sample.flags = 0x16;
+        sample.rrCount = static_cast<uint8_t>(1 + sequence % 3);
+        for (uint8_t i = 0; i < sample.rrCount; ++i) {
+            sample.rr[i] = static_cast<uint16_t>(800 + i);
+        }
+        return sample;
+    }
+
+    // Client frames must be masked
+    std::string ClientFrame(uint8_t opcode, const std::string& payload) {
+        const uint8_t mask[4] = { 0x37, 0xFA, 0x21, 0x3D };
+        std::string frame;
+        frame += static_cast<char>(0x80 | opcode);
+        frame += static_cast<char>(0x80 | payload.size());
+        frame.append(reinterpret_cast<const char*>(mask), 4);
+        for (size_t i = 0; i < payload.size(); ++i) {
+            frame += static_cast<char>(payload[i] ^ mask[i % 4]);
+        }
+        return frame;
+    }
+
+    template <typename Condition>
+    bool WaitFor(Condition condition, int timeoutMs) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!condition()) {
+            if (Clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    SOCKET ConnectTcp(uint16_t port, int receiveBuffer = 0) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s == INVALID_SOCKET) {
+            return s;
+        }
+        if (receiveBuffer > 0) {
+            setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receiveBuffer), sizeof(receiveBuffer));
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            closesocket(s);
+            return INVALID_SOCKET;
+        }
+        NetSetNonBlocking(s);
+        return s;
+    }
+
+    bool SendAll(SOCKET s, const std::string& data) {
+        return send(s, data.data(), data.size(), kNetSendFlags) == static_cast<ssize_t>(data.size());
+    }
+
+    // What one client has seen so far
+    struct Client {
+        SOCKET socket = INVALID_SOCKET;
+        std::string in;
+        bool upgraded = false;
+        std::string response; // Handshake response
+        std::string pong;     // Latest Pong payload
+        uint64_t lastSequence[kDevices] = {};
+        uint64_t batches = 0;
+        bool bad = false;
+        bool closeFrame = false;
+        bool closed = false;
+    };
+
+    void ConsumeBatch(Client& client, const uint8_t* payload, size_t length) {
+        if (length < 2) {
+            client.bad = true;
+            return;
+        }
+        size_t count = GetLe(payload, 2);
+        size_t at = 2;
+        for (size_t i = 0; i < count; ++i) {
+            if (length - at < 34 || payload[at + 2] != 1 || GetLe(payload + at, 2) != 32u + 2u * payload[at + 3]) {
+                client.bad = true;
+                return;
+            }
+            const uint8_t* frame = payload + at;
+            int device = static_cast<int>(GetLe(frame + 4, 8) - 0xC0FFEE000000ull);
+            uint64_t sequence = GetLe(frame + 12, 8);
+            if (device < 0 || device >= kDevices || sequence <= client.lastSequence[device]
+                || GetLe(frame + 28, 2) != MakeSample(device, sequence).bpm) {
+                client.bad = true;
+                return;
+            }
+            client.lastSequence[device] = sequence;
+            at += 34 + 2u * frame[3];
+        }
+        if (at != length) {
+            client.bad = true;
+        }
+        ++client.batches;
+    }
+
+    void Read(Client& client) {
+        char chunk[8192];
+        for (;;) {
+            ssize_t received = recv(client.socket, chunk, sizeof(chunk), 0);
+            if (received == 0) {
+                client.closed = true;
+                break;
+            }
+            if (received < 0) {
+                if (!NetWouldBlock()) {
+                    client.closed = true;
+                }
+                break;
+            }
+            client.in.append(chunk, static_cast<size_t>(received));
+        }
+        if (!client.upgraded) {
+            size_t end = client.in.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                return;
+            }
+            client.response = client.in.substr(0, end + 4);
+            client.in.erase(0, end + 4);
+            client.upgraded = client.response.compare(0, 12, "HTTP/1.1 101") == 0;
+            if (!client.upgraded) {
+                return;
+            }
+        }
+        // Server frames: never masked, never fragmented
+        const auto* data = reinterpret_cast<const uint8_t*>(client.in.data());
+        size_t used = 0;
+        while (client.in.size() - used >= 2) {
+            const uint8_t* frame = data + used;
+            size_t length = frame[1] & 0x7F;
+            size_t header = 2;
+            if (length == 126) {
+                if (client.in.size() - used < 4) {
+                    break;
+                }
+                length = static_cast<size_t>(frame[2]) << 8 | frame[3];
+                header = 4;
+            }
+            if ((frame[1] & 0x80) || length == 127) {
+                client.bad = true;
+                break;
+            }
+            if (client.in.size() - used < header + length) {
+                break;
+            }
+            if (frame[0] == 0x82) {
+                ConsumeBatch(client, frame + header, length);
+            }
+            else if (frame[0] == 0x8A) {
+                client.pong.assign(reinterpret_cast<const char*>(frame + header), length);
+            }
+            else if (frame[0] == 0x88) {
+                client.closeFrame = true;
+            }
+            else {
+                client.bad = true;
+            }
+            used += header + length;
+        }
+        client.in.erase(0, used);
+    }
+
+    // Polls every client until done() or the timeout
+    template <typename Done>
+    bool Pump(std::vector<Client>& clients, Done done, int timeoutMs) {
+        std::vector<pollfd> fds(clients.size());
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!done()) {
+            if (Clock::now() > deadline) {
+                return false;
+            }
+            for (size_t i = 0; i < clients.size(); ++i) {
+                fds[i] = { clients[i].closed ? -1 : clients[i].socket, POLLIN, 0 };
+            }
+            if (poll(fds.data(), fds.size(), 10) > 0) {
+                for (size_t i = 0; i < clients.size(); ++i) {
+                    if (fds[i].revents != 0) {
+                        Read(clients[i]);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    uint16_t StartOnFreePort(WebSocketServer& server, uint32_t cadenceMs) {
+        for (uint16_t port = 47410; port < 47510; ++port) {
+            if (server.Start(port, cadenceMs, false, nullptr)) {
+                return port;
+            }
+        }
+        return 0;
+    }
+
+    // Fires the batch cadence; off Windows nothing else drives the wheel
+    class TimerDriver {
+    public:
+        TimerDriver() : m_thread([this] {
+            while (m_running.load()) {
+                g_timers.Advance(TimerWheel::NowMs());
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }) {}
+        ~TimerDriver() {
+            m_running = false;
+            m_thread.join();
+        }
+
+    private:
+        std::atomic<bool> m_running{ true };
+        std::thread m_thread;
+    };
+
+    bool AllDone(const std::vector<Client>& clients, size_t count, bool (*done)(const Client&)) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!done(clients[i]) && !clients[i].bad && !clients[i].closed) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void CheckLoad() {
+        auto server = std::make_unique<WebSocketServer>();
+        uint16_t port = StartOnFreePort(*server, kCadenceMs);
+        if (port == 0) {
+            Fail("could not start the server");
+            return;
+        }
+
+        std::vector<Client> clients(kClients);
+        for (Client& client : clients) {
+            client.socket = ConnectTcp(port);
+            if (client.socket == INVALID_SOCKET || !SendAll(client.socket, kRequest)) {
+                Fail("connect or request failed");
+                return;
+            }
+        }
+        Pump(clients, [&] { return AllDone(clients, clients.size(), [](const Client& c) { return !c.response.empty(); }); }, 10000);
+        int rejected = 0;
+        for (const Client& client : clients) {
+            rejected += !client.upgraded || client.response.find(kAccept) == std::string::npos ? 1 : 0;
+        }
+        if (rejected != 0) {
+            std::fprintf(stderr, "websocket_test: %d handshakes failed\n", rejected);
+            Fail("handshake");
+        }
+
+        // Every client pings with its own payload and must get it back
+        for (size_t i = 0; i < clients.size(); ++i) {
+            SendAll(clients[i].socket, ClientFrame(0x9, "ping " + std::to_string(i)));
+        }
+        Pump(clients, [&] { return AllDone(clients, clients.size(), [](const Client& c) { return !c.pong.empty(); }); }, 10000);
+        int unanswered = 0;
+        for (size_t i = 0; i < clients.size(); ++i) {
+            unanswered += clients[i].pong != "ping " + std::to_string(i) ? 1 : 0;
+        }
+        if (unanswered != 0) {
+            std::fprintf(stderr, "websocket_test: %d pings unanswered\n", unanswered);
+            Fail("Ping did not get a matching Pong");
+        }
+
+        TimerDriver timers;
+        LatencyHistogram publishNs;
+        std::thread notifier([&] {
+            auto next = Clock::now();
+            for (uint64_t sequence = 1; sequence <= kSamplesPerDevice; ++sequence) {
+                for (int device = 0; device < kDevices; ++device) {
+                    HrSample sample = MakeSample(device, sequence);
+                    auto before = Clock::now();
+                    server->Publish(sample);
+                    publishNs.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+                    next += std::chrono::milliseconds(1);
+                    std::this_thread::sleep_until(next);
+                }
+            }
+            // A lone last sample, so the final batch holds it whatever a client skipped
+            std::this_thread::sleep_for(std::chrono::milliseconds(3 * kCadenceMs));
+            server->Publish(MakeSample(0, kSamplesPerDevice + 1));
+        });
+        bool complete = Pump(clients, [&] {
+            return AllDone(clients, clients.size(), [](const Client& c) { return c.lastSequence[0] == kSamplesPerDevice + 1; });
+        }, 30000);
+        notifier.join();
+
+        HrNetStats stats{};
+        server->Snapshot(stats);
+        int bad = 0;
+        int incomplete = 0;
+        uint64_t batches = 0;
+        for (const Client& client : clients) {
+            bad += client.bad || client.closed ? 1 : 0;
+            incomplete += client.lastSequence[0] != kSamplesPerDevice + 1 ? 1 : 0;
+            batches += client.batches;
+        }
+        if (!complete || incomplete != 0) {
+            std::fprintf(stderr, "websocket_test: %d clients did not see the last sample\n", incomplete);
+            Fail("not every client was served to the end");
+        }
+        if (bad != 0) {
+            std::fprintf(stderr, "websocket_test: %d clients saw a bad frame or were closed\n", bad);
+            Fail("malformed batches or out-of-order samples");
+        }
+        if (stats.tcpClients != kClients || stats.framesPublished != kDevices * kSamplesPerDevice + 1) {
+            Fail("stats do not match");
+        }
+        if (publishNs.Percentile(99) > 1000000) {
+            Fail("Publish is slow with many clients");
+        }
+        std::printf("websocket_test: %d clients, %.1f batches each, %llu coalesced, Publish p50 %llu ns p99 %llu ns max %llu ns\n",
+            kClients, static_cast<double>(batches) / kClients, static_cast<unsigned long long>(stats.framesDropped),
+            static_cast<unsigned long long>(publishNs.Percentile(50)),
+            static_cast<unsigned long long>(publishNs.Percentile(99)), static_cast<unsigned long long>(publishNs.Max()));
+
+        // A client Close is echoed, then the connection ends
+        SendAll(clients[0].socket, ClientFrame(0x8, ""));
+        std::vector<Client> one(1);
+        std::swap(one[0], clients[0]);
+        if (!Pump(one, [&] { return one[0].closed; }, 5000) || !one[0].closeFrame) {
+            Fail("Close was not echoed");
+        }
+        std::swap(one[0], clients[0]);
+
+        // Stop closes everyone else
+        server->Stop();
+        if (!Pump(clients, [&] { return AllDone(clients, clients.size(), [](const Client& c) { return c.closed; }); }, 5000)) {
+            Fail("Stop left clients connected");
+        }
+        for (Client& client : clients) {
+            closesocket(client.socket);
+        }
+    }
+
+    // One client never reads after its handshake while another keeps up: the stalled one is
+    // coalesced to the newest batch instead of queueing, and the live one gets everything
+    void CheckStalledClient() {
+        constexpr uint64_t kBatches = 1000; // Full 64-sample batches: ~4 MB per client
+        constexpr uint64_t kTickMs = TimerWheel::kTickMs;
+        // The cadence runs on a virtual clock here, one batch per step, as fast as the loop sends
+        uint64_t nowMs = 0;
+        g_timers.Reset(nowMs);
+        auto server = std::make_unique<WebSocketServer>();
+        uint16_t port = StartOnFreePort(*server, static_cast<uint32_t>(kTickMs));
+        std::vector<Client> clients(2);
+        clients[0].socket = port != 0 ? ConnectTcp(port) : INVALID_SOCKET;
+        clients[1].socket = port != 0 ? ConnectTcp(port, 1024) : INVALID_SOCKET;
+        if (clients[0].socket == INVALID_SOCKET || clients[1].socket == INVALID_SOCKET
+            || !SendAll(clients[0].socket, kRequest) || !SendAll(clients[1].socket, kRequest)
+            || !Pump(clients, [&] { return clients[0].upgraded && clients[1].upgraded; }, 5000)) {
+            Fail("stalled-client setup failed");
+            closesocket(clients[0].socket);
+            closesocket(clients[1].socket);
+            return;
+        }
+        std::vector<Client> live(1);
+        std::swap(live[0], clients[0]);
+
+        std::thread notifier([&] {
+            uint64_t sequence = 0;
+            for (uint64_t batch = 0; batch < kBatches; ++batch) {
+                for (int k = 0; k < 64; ++k) {
+                    HrSample sample = MakeSample(1, ++sequence);
+                    sample.rrCount = kHrSampleMaxRr;
+                    server->Publish(sample);
+                }
+                g_timers.Advance(nowMs += kTickMs);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            server->Publish(MakeSample(0, 1));
+            g_timers.Advance(nowMs += kTickMs);
+        });
+        bool complete = Pump(live, [&] { return live[0].lastSequence[0] == 1 || live[0].bad || live[0].closed; }, 60000);
+        notifier.join();
+        HrNetStats stats{};
+        server->Snapshot(stats);
+        if (!complete || live[0].lastSequence[0] != 1 || live[0].bad || live[0].closed) {
+            Fail("a stalled client held up a live one");
+        }
+        if (stats.framesDropped == 0) {
+            Fail("a stalled client was never coalesced");
+        }
+        // Whatever the stalled client finally reads is still whole batches
+        std::swap(live[0], clients[1]);
+        Pump(live, [&] { return live[0].lastSequence[0] == 1 || live[0].bad || live[0].closed; }, 10000);
+        if (live[0].bad) {
+            Fail("stalled client got a torn batch");
+        }
+        std::printf("websocket_test: stalled client: %llu batches read, %llu coalesced away\n",
+            static_cast<unsigned long long>(live[0].batches), static_cast<unsigned long long>(stats.framesDropped));
+        server->Stop();
+        closesocket(live[0].socket);
+        closesocket(clients[0].socket);
+    }
+
+    void CheckBadRequest() {
+        auto server = std::make_unique<WebSocketServer>();
+        uint16_t port = StartOnFreePort(*server, kCadenceMs);
+        std::vector<Client> clients(1);
+        clients[0].socket = port != 0 ? ConnectTcp(port) : INVALID_SOCKET;
+        if (clients[0].socket == INVALID_SOCKET || !SendAll(clients[0].socket, "GET / HTTP/1.1\r\nHost: x\r\n\r\n")) {
+            Fail("bad-request setup failed");
+        }
+        else if (!Pump(clients, [&] { return clients[0].closed; }, 5000)
+            || clients[0].response.compare(0, 12, "HTTP/1.1 400") != 0) {
+            Fail("a request without a key was not refused");
+        }
+        server->Stop();
+        closesocket(clients[0].socket);
+    }
+}
+
+int main() {
+    CheckLoad();
+    CheckStalledClient();
+    CheckBadRequest();
+    if (g_failures == 0) {
+        std::printf("websocket_test: ok\n");
+    }
+    return g_failures == 0 ? 0 : 1;
+}